@@ -1,5 +1,9 @@
 #include <lumios.h>
 #include <GLFW/glfw3.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
 
 class DemoApp : public lumios::Application {
     lumios::Engine* engine_ = nullptr;
@@ -10,8 +14,25 @@ class DemoApp : public lumios::Application {
 
     float time_ = 0.0f;
 
+    // Draw path comparison: --objects N adds a grid of N cubes, F2 cycles
+    // the draw paths, F3 toggles culling and the averaged render_scene CPU
+    // time is logged. --lights N scatters N small point lights over the
+    // ground for the clustered lighting; they cast no shadows. F4 toggles
+    // shadows, F5 bloom and F6 SSAO; GPU time per render pass is logged.
+    // --particles N sizes the fountain's particle pool. F7 toggles
+    // recording the direct and instanced draw lists on several threads.
+    lumios::u32 stress_objects_   = 0;
+    lumios::u32 stress_lights_    = 0;
+    lumios::u32 stress_particles_ = 0;
+    double      record_ms_sum_  = 0.0;
+    lumios::u32 record_frames_  = 0;
+    float       report_timer_   = 0.0f;
+
 public:
     void bind(lumios::Engine& e) { engine_ = &e; }
+    void set_stress_objects(lumios::u32 count) { stress_objects_ = count; }
+    void set_stress_lights(lumios::u32 count)  { stress_lights_ = count; }
+    void set_stress_particles(lumios::u32 count) { stress_particles_ = count; }
 
     void on_init() override {
         auto& r = engine_->renderer();
@@ -49,6 +70,28 @@ public:
             scene.add<lumios::MeshComponent>(cube, cube_mesh_, (i % 2 == 0) ? red_mat_ : blue_mat_);
         }
 
+        // Stress grid, spread around the demo scene
+        lumios::u32 side = static_cast<lumios::u32>(std::ceil(std::sqrt(static_cast<float>(stress_objects_))));
+        for (lumios::u32 i = 0; i < stress_objects_; i++) {
+            float x = (static_cast<float>(i % side) - side * 0.5f) * 1.5f;
+            float z = (static_cast<float>(i / side) + 8.0f) * -1.5f;
+
+            auto cube = scene.create_entity("stress_" + std::to_string(i));
+            scene.get<lumios::Transform>(cube).position = {x, 0.0f, z};
+            scene.get<lumios::Transform>(cube).scale = {0.5f, 0.5f, 0.5f};
+            scene.add<lumios::MeshComponent>(cube, (i % 3 == 0) ? sphere_mesh_ : cube_mesh_,
+                                             (i % 2 == 0) ? red_mat_ : white_mat_);
+        }
+
+        // Particle fountain over the sphere, spawning as fast as its pool frees up
+        auto fountain = scene.create_entity("fountain");
+        scene.get<lumios::Transform>(fountain).position = {0, 1.2f, 0};
+        auto& emitter = scene.add<lumios::ParticleEmitterComponent>(fountain);
+        if (stress_particles_ > 0) {
+            emitter.max_particles = stress_particles_;
+            emitter.emit_rate     = static_cast<float>(stress_particles_) / emitter.lifetime;
+        }
+
         // Directional light (sun)
         auto sun = scene.create_entity("sun");
         scene.get<lumios::Transform>(sun).rotation = {-45.0f, 30.0f, 0.0f};
@@ -66,6 +109,19 @@ public:
         scene.add<lumios::LightComponent>(light2,
             lumios::LightType::Point, glm::vec3(0.2f, 0.4f, 1.0f), 2.0f, 15.0f);
 
+        // Light stress: a jittered grid over the ground, hues around the wheel
+        lumios::u32 light_side = static_cast<lumios::u32>(std::ceil(std::sqrt(static_cast<float>(stress_lights_))));
+        for (lumios::u32 i = 0; i < stress_lights_; i++) {
+            float x = (static_cast<float>(i % light_side) + 0.5f) / light_side * 28.0f - 14.0f;
+            float z = (static_cast<float>(i / light_side) + 0.5f) / light_side * 28.0f - 14.0f;
+            float h = static_cast<float>(i) * 0.618034f * 2.0f * lumios::PI;
+            glm::vec3 color = glm::vec3(cos(h), cos(h + 2.094f), cos(h + 4.189f)) * 0.5f + 0.5f;
+
+            auto light = scene.create_entity("stress_light_" + std::to_string(i));
+            scene.get<lumios::Transform>(light).position = {x, 0.3f + 0.2f * static_cast<float>(i % 3), z};
+            scene.add<lumios::LightComponent>(light, lumios::LightType::Point, color, 1.5f, 3.0f, 45.0f, false);
+        }
+
         // Camera
         camera_.set_perspective(60.0f, engine_->window().aspect(), 0.1f, 500.0f);
         camera_.set_position({0, 4, 10});
@@ -80,6 +136,84 @@ public:
         if (input.key_pressed(GLFW_KEY_ESCAPE))
             glfwSetWindowShouldClose(engine_->window().handle(), GLFW_TRUE);
 
+        // F2 cycles the draw paths (ones the device lacks are skipped)
+        auto& renderer = engine_->renderer();
+        if (input.key_pressed(GLFW_KEY_F2)) {
+            auto current = renderer.draw_path();
+            for (int step = 1; step < lumios::DRAW_PATH_COUNT && renderer.draw_path() == current; step++)
+                renderer.set_draw_path(static_cast<lumios::DrawPath>(
+                    (static_cast<int>(current) + step) % lumios::DRAW_PATH_COUNT));
+            record_ms_sum_ = 0.0;
+            record_frames_ = 0;
+        }
+
+        // F3 toggles frustum culling
+        if (input.key_pressed(GLFW_KEY_F3)) {
+            renderer.set_frustum_culling(!renderer.frustum_culling());
+            record_ms_sum_ = 0.0;
+            record_frames_ = 0;
+        }
+
+        // F4 toggles shadows
+        if (input.key_pressed(GLFW_KEY_F4)) {
+            renderer.set_shadows(!renderer.shadows());
+            record_ms_sum_ = 0.0;
+            record_frames_ = 0;
+        }
+
+        // F5 toggles bloom, F6 ambient occlusion
+        if (input.key_pressed(GLFW_KEY_F5)) renderer.set_bloom(!renderer.bloom());
+        if (input.key_pressed(GLFW_KEY_F6)) renderer.set_ssao(!renderer.ssao());
+
+        // F7 toggles recording long draw lists on several threads
+        if (input.key_pressed(GLFW_KEY_F7)) {
+            renderer.set_parallel_recording(!renderer.parallel_recording());
+            record_ms_sum_ = 0.0;
+            record_frames_ = 0;
+        }
+
+        const auto& stats = renderer.stats();
+        record_ms_sum_ += stats.record_ms;
+        record_frames_++;
+        report_timer_ += dt;
+        if (report_timer_ >= 2.0f) {
+            if (stats.path == lumios::DrawPath::GpuCulled) {
+                LOG_INFO("%s path: %u submitted, %u kept on the GPU, %u bounds updated, %u batches, "
+                         "%u draw calls, render_scene %.3f ms avg",
+                         lumios::draw_path_name(stats.path), stats.objects, stats.gpu_visible,
+                         stats.bounds_updated, stats.batches, stats.draw_calls, record_ms_sum_ / record_frames_);
+            } else {
+                LOG_INFO("%s path: %u visible, %u culled%s, %u bounds updated, %u batches, %u draw calls, "
+                         "render_scene %.3f ms avg",
+                         lumios::draw_path_name(stats.path), stats.objects, stats.culled,
+                         renderer.frustum_culling() ? "" : " (culling off)", stats.bounds_updated,
+                         stats.batches, stats.draw_calls, record_ms_sum_ / record_frames_);
+            }
+            if (stats.record_chunks > 0)
+                LOG_INFO("Main pass recorded in %u secondary command buffers", stats.record_chunks);
+            if (stats.lights > 0)
+                LOG_INFO("%u lights, %u froxel light references", stats.lights, stats.light_refs);
+            if (stats.shadow_views > 0)
+                LOG_INFO("%u shadow views (%u from the static cache), %u shadow draw calls",
+                         stats.shadow_views, stats.shadow_cached, stats.shadow_draws);
+            if (stats.emitters > 0)
+                LOG_INFO("%u particle emitters, %u particle slots", stats.emitters, stats.particles);
+            LOG_INFO("%u render graph passes (%u culled), %u barriers",
+                     stats.passes, stats.passes_culled, stats.barriers);
+            if (!renderer.gpu_timings().empty()) {
+                std::string passes;
+                for (const auto& t : renderer.gpu_timings()) {
+                    char entry[96];
+                    std::snprintf(entry, sizeof(entry), "%s%s %.3f", passes.empty() ? "" : ", ", t.name.c_str(), t.ms);
+                    passes += entry;
+                }
+                LOG_INFO("GPU %.3f ms: %s", stats.gpu_ms, passes.c_str());
+            }
+            record_ms_sum_ = 0.0;
+            record_frames_ = 0;
+            report_timer_  = 0.0f;
+        }
+
         // Camera movement
         float speed = 8.0f * dt;
         if (input.key_down(GLFW_KEY_LEFT_SHIFT)) speed *= 3.0f;
@@ -101,13 +235,15 @@ public:
         camera_.set_aspect(engine_->window().aspect());
 
         // Animate cubes
-        auto cube_view = engine_->scene().view<lumios::Transform, lumios::MeshComponent, lumios::NameComponent>();
+        auto& scene = engine_->scene();
+        auto cube_view = scene.view<lumios::Transform, lumios::MeshComponent, lumios::NameComponent>();
         for (auto entity : cube_view) {
             auto& name = cube_view.get<lumios::NameComponent>(entity);
             if (name.name.starts_with("cube_")) {
-                auto& t = cube_view.get<lumios::Transform>(entity);
-                t.rotation.y = time_ * 45.0f;
-                t.position.y = sin(time_ * 2.0f + t.position.x) * 0.5f + 0.5f;
+                scene.patch<lumios::Transform>(entity, [&](lumios::Transform& t) {
+                    t.rotation.y = time_ * 45.0f;
+                    t.position.y = sin(time_ * 2.0f + t.position.x) * 0.5f + 0.5f;
+                });
             }
         }
     }
@@ -117,14 +253,23 @@ public:
     }
 };
 
-int main() {
+int main(int argc, char** argv) {
     DemoApp app;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::string(argv[i]) == "--objects")
+            app.set_stress_objects(static_cast<lumios::u32>(std::atoi(argv[++i])));
+        else if (std::string(argv[i]) == "--lights")
+            app.set_stress_lights(static_cast<lumios::u32>(std::atoi(argv[++i])));
+        else if (std::string(argv[i]) == "--particles")
+            app.set_stress_particles(static_cast<lumios::u32>(std::atoi(argv[++i])));
+    }
 
     lumios::EngineConfig config;
-    config.window.title  = "Lumios Engine - Demo";
-    config.window.width  = 1600;
-    config.window.height = 900;
-    config.shader_dir    = LUMIOS_SHADER_DIR;
+    config.window.title   = "Lumios Engine - Demo";
+    config.window.width   = 1600;
+    config.window.height  = 900;
+    config.shader_dir     = LUMIOS_SHADER_DIR;
+    config.pipeline_cache = LUMIOS_PIPELINE_CACHE;
 
     lumios::Engine engine;
     app.bind(engine);
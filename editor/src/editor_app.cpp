@@ -25,7 +25,7 @@ bool EditorApp::init() {
     input_.init(window_.handle());
     timer_.reset();
 
-    if (!renderer_.init(window_, LUMIOS_SHADER_DIR)) return false;
+    if (!renderer_.init(window_, LUMIOS_SHADER_DIR, LUMIOS_PIPELINE_CACHE)) return false;
 
     state_.scene  = &scene_;
     state_.camera = &editor_camera_;
@@ -307,6 +307,7 @@ void EditorApp::render_menu_bar() {
             ImGui::MenuItem("Console",          nullptr, &show_console_);
             ImGui::MenuItem("Assets",           nullptr, &show_assets_);
             ImGui::MenuItem("Script Reference", nullptr, &show_script_ref_);
+            ImGui::MenuItem("Network",          nullptr, &show_network_);
             ImGui::Separator();
             if (ImGui::MenuItem("Reset Layout"))
                 layout_initialized_ = false;
@@ -364,11 +365,12 @@ void EditorApp::render_toolbar() {
         if (ImGui::Button("Play", play_sz)) {
             state_.playing = true;
             scene_snapshot_ = SceneSerializer::serialize(scene_);
-            game_window_.open(renderer_.context(), renderer_.get_shader_dir(),
+            game_window_.open(renderer_.context(), renderer_.pipelines(), renderer_.get_shader_dir(),
                               renderer_.get_meshes(), renderer_.get_materials(),
                               renderer_.get_default_mat());
             physics_world_.sync_from_scene(scene_);
             script_manager_.on_play();
+            start_net_session();
         }
         ImGui::PopStyleColor(2);
     } else {
@@ -378,6 +380,7 @@ void EditorApp::render_toolbar() {
             state_.playing = false;
             state_.paused  = false;
             script_manager_.on_stop();
+            stop_net_session();
             game_window_.close();
             SceneSerializer::deserialize(scene_, scene_snapshot_);
             state_.selected = entt::null;
@@ -491,6 +494,7 @@ void EditorApp::run() {
         if (show_console_)   draw_console_panel();
         if (show_assets_)    draw_assets_panel(state_);
         if (show_script_ref_) draw_script_reference_panel();
+        if (show_network_)    draw_network_panel(state_);
 
         renderer_.end_ui();
         renderer_.end_frame();
@@ -500,11 +504,13 @@ void EditorApp::run() {
                 state_.playing = false;
                 state_.paused  = false;
                 script_manager_.on_stop();
+                stop_net_session();
                 game_window_.close();
                 SceneSerializer::deserialize(scene_, scene_snapshot_);
                 state_.selected = entt::null;
             } else {
                 script_manager_.reload();
+                update_net_session();
                 float dt = timer_.delta();
                 if (!state_.paused) {
                     physics_world_.step(dt);
@@ -519,6 +525,36 @@ void EditorApp::run() {
     }
 }
 
+// --- Network session ---
+
+static constexpr u16 EDITOR_NET_PORT = 7777;
+
+void EditorApp::start_net_session() {
+    net_server_ = std::make_unique<net::LoopbackTransport>(net_hub_);
+    net_client_ = std::make_unique<net::LoopbackTransport>(net_hub_);
+    net_stats_  = net::NetStats();
+    net_server_->set_stats(&net_stats_);
+    if (!net_server_->start_server(EDITOR_NET_PORT) || !net_client_->connect("localhost", EDITOR_NET_PORT)) {
+        LOG_WARN("Failed to start the loopback network session");
+        stop_net_session();
+        return;
+    }
+    state_.net_stats = &net_stats_;
+}
+
+void EditorApp::stop_net_session() {
+    state_.net_stats = nullptr;
+    net_client_.reset();
+    net_server_.reset();
+}
+
+void EditorApp::update_net_session() {
+    if (!net_server_) return;
+    net_client_->poll();
+    net_server_->poll();
+    net_stats_.update(*net_server_);
+}
+
 void EditorApp::compile_and_load_scripts() {
     LOG_INFO("Compiling scripts...");
     int ret = std::system("cmake --build build --target game_scripts 2>&1");
@@ -691,6 +727,7 @@ void EditorApp::add_recent_project(const std::string& path) {
 
 void EditorApp::shutdown() {
     script_manager_.shutdown();
+    stop_net_session();
     physics_world_.shutdown();
     if (game_window_.is_open()) game_window_.close();
     renderer_.shutdown();
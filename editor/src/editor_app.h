@@ -11,6 +11,8 @@
 #include "scene/scene_serializer.h"
 #include "scripting/script_manager.h"
 #include "physics/physics_world.h"
+#include "networking/loopback_transport.h"
+#include "networking/net_stats.h"
 #include "graphics/camera.h"
 
 namespace lumios::editor {
@@ -40,6 +42,13 @@ class EditorApp {
     ProjectConfig   project_;
     std::string     scene_snapshot_;
 
+    // Loopback server/client pair run while playing, so the Network panel
+    // shows live traffic and RTT for the session
+    net::LoopbackHub               net_hub_;
+    Unique<net::LoopbackTransport> net_server_;
+    Unique<net::LoopbackTransport> net_client_;
+    net::NetStats                  net_stats_;
+
     glm::vec3 focus_point_{0, 0, 0};
     float     orbit_distance_ = 12.0f;
     float     orbit_yaw_   = -45.0f;
@@ -53,6 +62,7 @@ class EditorApp {
     bool show_console_   = true;
     bool show_assets_    = true;
     bool show_script_ref_ = false;
+    bool show_network_    = false;
 
     int gizmo_op_ = 0;
     bool viewport_captured_ = false;
@@ -78,6 +88,9 @@ class EditorApp {
     void compile_and_load_scripts();
     void open_scripts_in_editor();
     void check_script_auto_compile();
+    void start_net_session();
+    void stop_net_session();
+    void update_net_session();
 
     void save_project(const std::string& path);
     void load_project(const std::string& path);
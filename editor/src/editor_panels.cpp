@@ -2,7 +2,9 @@
 #include "editor_renderer.h"
 #include "scripting/script_manager.h"
 #include "assets/loader.h"
+#include "networking/net_stats.h"
 #include "ImGuizmo.h"
+#include <algorithm>
 #include <cstring>
 #include <filesystem>
 #include <fstream>
@@ -128,9 +130,10 @@ void draw_inspector_panel(EditorState& state) {
     if (state.scene->has<Transform>(e)) {
         if (ImGui::CollapsingHeader("Transform", ImGuiTreeNodeFlags_DefaultOpen)) {
             auto& t = state.scene->get<Transform>(e);
-            draw_vec3("Position", t.position);
-            draw_vec3("Rotation", t.rotation);
-            draw_vec3("Scale", t.scale, 1.0f);
+            bool changed = draw_vec3("Position", t.position);
+            changed |= draw_vec3("Rotation", t.rotation);
+            changed |= draw_vec3("Scale", t.scale, 1.0f);
+            if (changed) state.scene->patch<Transform>(e);
         }
     }
 
@@ -333,6 +336,7 @@ void draw_inspector_panel(EditorState& state) {
                 if (l.type == LightType::Spot)
                     ImGui::DragFloat("Spot Angle", &l.spot_angle, 1.0f, 1.0f, 90.0f);
             }
+            ImGui::Checkbox("Cast Shadows", &l.cast_shadows);
         }
         if (ImGui::SmallButton("Remove Light"))
             state.scene->registry().remove<LightComponent>(e);
@@ -583,9 +587,11 @@ void draw_viewport_panel(EditorState& state, ImTextureID scene_texture, lumios::
                     rot.z = 0.0f;
                 }
 
-                t.position = pos;
-                t.rotation = rot;
-                t.scale    = scl;
+                state.scene->patch<Transform>(state.selected, [&](Transform& pt) {
+                    pt.position = pos;
+                    pt.rotation = rot;
+                    pt.scale    = scl;
+                });
             }
         }
     }
@@ -1092,4 +1098,106 @@ void draw_script_reference_panel() {
     ImGui::End();
 }
 
+// ─── Network panel ──────────────────────────────────────────────────
+
+static constexpr int NET_HISTORY = 240;
+static float s_send_history[NET_HISTORY] = {};
+static float s_recv_history[NET_HISTORY] = {};
+static int   s_history_offset = 0;
+
+static void format_rate(char* buf, size_t size, float bytes_per_sec) {
+    if (bytes_per_sec >= 1.0e6f)      snprintf(buf, size, "%.2f MB/s", bytes_per_sec / 1.0e6f);
+    else if (bytes_per_sec >= 1.0e3f) snprintf(buf, size, "%.1f KB/s", bytes_per_sec / 1.0e3f);
+    else                              snprintf(buf, size, "%.0f B/s", bytes_per_sec);
+}
+
+void draw_network_panel(EditorState& state) {
+    ImGui::Begin("Network");
+
+    if (!state.net_stats) {
+        ImGui::TextDisabled("No network session");
+        ImGui::End();
+        return;
+    }
+
+    net::NetStatsSnapshot snap = state.net_stats->snapshot();
+
+    s_send_history[s_history_offset] = snap.send_bps / 1000.0f;
+    s_recv_history[s_history_offset] = snap.recv_bps / 1000.0f;
+    s_history_offset = (s_history_offset + 1) % NET_HISTORY;
+
+    char send[32], recv[32];
+    format_rate(send, sizeof(send), snap.send_bps);
+    format_rate(recv, sizeof(recv), snap.recv_bps);
+    ImGui::Text("Clients: %zu   Send: %s   Recv: %s   Inbox: %u",
+                snap.clients.size(), send, recv, snap.inbox_depth);
+
+    float width = ImGui::GetContentRegionAvail().x;
+    ImGui::PlotLines("##send", s_send_history, NET_HISTORY, s_history_offset, "send KB/s", 0.0f, FLT_MAX,
+                     ImVec2(width, 50));
+    ImGui::PlotLines("##recv", s_recv_history, NET_HISTORY, s_history_offset, "recv KB/s", 0.0f, FLT_MAX,
+                     ImVec2(width, 50));
+
+    if (ImGui::CollapsingHeader("Clients", ImGuiTreeNodeFlags_DefaultOpen)) {
+        ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_ScrollY |
+                                ImGuiTableFlags_SizingStretchProp;
+        float height = ImGui::GetTextLineHeightWithSpacing() * std::min<float>(12.0f, snap.clients.size() + 1.5f);
+        if (ImGui::BeginTable("NetClients", 7, flags, ImVec2(0, height))) {
+            ImGui::TableSetupScrollFreeze(0, 1);
+            ImGui::TableSetupColumn("Client");
+            ImGui::TableSetupColumn("RTT (ms)");
+            ImGui::TableSetupColumn("Loss");
+            ImGui::TableSetupColumn("Send");
+            ImGui::TableSetupColumn("Recv");
+            ImGui::TableSetupColumn("Send Q");
+            ImGui::TableSetupColumn("Recv Q");
+            ImGui::TableHeadersRow();
+
+            ImGuiListClipper clipper;
+            clipper.Begin(static_cast<int>(snap.clients.size()));
+            while (clipper.Step()) {
+                for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                    const auto& c = snap.clients[i];
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn(); ImGui::Text("%u", c.client);
+                    ImGui::TableNextColumn(); ImGui::Text("%.1f +/- %.1f", c.rtt_ms, c.rtt_var_ms);
+                    ImGui::TableNextColumn();
+                    if (c.loss > 0.05f) ImGui::TextColored(ImVec4(0.9f, 0.3f, 0.3f, 1.0f), "%.1f%%", c.loss * 100.0f);
+                    else                ImGui::Text("%.1f%%", c.loss * 100.0f);
+                    format_rate(send, sizeof(send), c.send_bps);
+                    format_rate(recv, sizeof(recv), c.recv_bps);
+                    ImGui::TableNextColumn(); ImGui::TextUnformatted(send);
+                    ImGui::TableNextColumn(); ImGui::TextUnformatted(recv);
+                    ImGui::TableNextColumn(); ImGui::Text("%u", c.send_queue);
+                    ImGui::TableNextColumn(); ImGui::Text("%u", c.recv_queue);
+                }
+            }
+            ImGui::EndTable();
+        }
+    }
+
+    if (ImGui::CollapsingHeader("Message Types", ImGuiTreeNodeFlags_DefaultOpen)) {
+        ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_SizingStretchProp;
+        if (ImGui::BeginTable("NetTypes", 5, flags)) {
+            ImGui::TableSetupColumn("Type");
+            ImGui::TableSetupColumn("Sent");
+            ImGui::TableSetupColumn("Sent KB");
+            ImGui::TableSetupColumn("Recv");
+            ImGui::TableSetupColumn("Recv KB");
+            ImGui::TableHeadersRow();
+            for (const auto& [type, t] : snap.by_type) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn(); ImGui::TextUnformatted(net::message_type_name(type));
+                ImGui::TableNextColumn(); ImGui::Text("%llu", static_cast<unsigned long long>(t.sent_count));
+                ImGui::TableNextColumn(); ImGui::Text("%.1f", t.sent_bytes / 1024.0);
+                ImGui::TableNextColumn(); ImGui::Text("%llu", static_cast<unsigned long long>(t.recv_count));
+                ImGui::TableNextColumn(); ImGui::Text("%.1f", t.recv_bytes / 1024.0);
+            }
+            ImGui::EndTable();
+        }
+    }
+
+    ImGui::End();
+}
+
 } // namespace lumios::editor
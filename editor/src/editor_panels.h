@@ -13,6 +13,7 @@
 namespace lumios {
 class EditorRenderer;
 class ScriptManager;
+namespace net { class NetStats; }
 }
 
 namespace lumios::editor {
@@ -39,6 +40,9 @@ struct EditorState {
     // Script property access
     ScriptManager* script_manager = nullptr;
 
+    // Network session to inspect, if the running game has one
+    const net::NetStats* net_stats = nullptr;
+
     // Assets panel state
     std::string assets_root = "assets";
     std::string current_assets_path = "assets";
@@ -50,6 +54,7 @@ void draw_viewport_panel(EditorState& state, ImTextureID scene_texture, lumios::
 void draw_console_panel();
 void draw_assets_panel(EditorState& state);
 void draw_script_reference_panel();
+void draw_network_panel(EditorState& state);
 
 void init_console_log();
 
@@ -11,16 +11,20 @@
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_vulkan.h"
 #include "ImGuizmo.h"
+#include <algorithm>
 
 namespace lumios {
 
+static constexpr size_t MIN_LIGHT_CAPACITY = 64;
+
 // ─── Init / Shutdown ─────────────────────────────────────────────────
 
-bool EditorRenderer::init(Window& window, const std::string& shader_dir) {
+bool EditorRenderer::init(Window& window, const std::string& shader_dir, const std::string& pipeline_cache) {
     window_ = &window;
     shader_dir_ = shader_dir;
 
     if (!ctx_.init(window.handle())) return false;
+    if (!pipelines_.init(ctx_, pipeline_cache)) return false;
 
     int w, h;
     window.get_framebuffer_size(w, h);
@@ -32,20 +36,28 @@ bool EditorRenderer::init(Window& window, const std::string& shader_dir) {
     pci.queueFamilyIndex = ctx_.graphics_family;
     VK_CHECK(vkCreateCommandPool(ctx_.device, &pci, nullptr, &command_pool_));
 
-    if (!create_ui_pass()) return false;
-    if (!create_ui_framebuffers()) return false;
-    if (!create_scene_pass()) return false;
+    ui_pass_    = graph_.compatible_pass(ctx_, {swapchain_.image_format});
+    scene_pass_ = graph_.compatible_pass(ctx_, {VK_FORMAT_R8G8B8A8_UNORM}, VK_FORMAT_D32_SFLOAT);
+    pick_pass_  = scene_pass_; // same formats
 
     VkDescriptorPoolSize pool_sizes[] = {
         {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 200},
-        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 200}
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 200},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 16}
     };
-    auto span = std::span<VkDescriptorPoolSize>(pool_sizes, 2);
+    auto span = std::span<VkDescriptorPoolSize>(pool_sizes, 3);
     desc_alloc_.init(ctx_.device, 300, span);
 
+    // Bindings 2 and 3 are the runtime's instance buffers, unused here. No
+    // shadows are drawn either: 6 and 7 hold an empty ShadowUBO and a
+    // placeholder atlas, and every light is gathered unshadowed.
     global_layout_ = DescriptorLayoutBuilder()
         .add(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
         .add(1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+        .add(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+        .add(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+        .add(6, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+        .add(7, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
         .build(ctx_.device);
     material_layout_ = DescriptorLayoutBuilder()
         .add(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
@@ -53,7 +65,6 @@ bool EditorRenderer::init(Window& window, const std::string& shader_dir) {
         .build(ctx_.device);
 
     if (!create_scene_pipeline()) return false;
-    if (!create_pick_pass()) return false;
     if (!create_pick_pipeline()) return false;
     if (!create_pick_target(800, 600)) return false;
     if (!create_frame_resources()) return false;
@@ -75,6 +86,8 @@ void EditorRenderer::shutdown() {
     ImGui::DestroyContext();
 
     destroy_texture(ctx_, default_texture_);
+    destroy_texture(ctx_, no_shadow_atlas_);
+    destroy_buffer(ctx_.allocator, no_shadow_ubo_);
     destroy_buffer(ctx_.allocator, default_material_.ubo);
     for (auto& m : materials_) destroy_buffer(ctx_.allocator, m.ubo);
     for (auto& t : textures_)  destroy_texture(ctx_, t);
@@ -85,148 +98,28 @@ void EditorRenderer::shutdown() {
 
     for (auto& f : frames_) {
         destroy_buffer(ctx_.allocator, f.global_ubo);
-        destroy_buffer(ctx_.allocator, f.light_ubo);
+        destroy_buffer(ctx_.allocator, f.grid_ubo);
+        destroy_buffer(ctx_.allocator, f.light_buffer);
+        destroy_buffer(ctx_.allocator, f.cluster_buffer);
         vkDestroyFence(ctx_.device, f.fence, nullptr);
-        vkDestroySemaphore(ctx_.device, f.render_finished, nullptr);
         vkDestroySemaphore(ctx_.device, f.image_available, nullptr);
     }
+    destroy_present_semaphores();
 
     destroy_pick_target();
-    if (pick_pipeline_)   vkDestroyPipeline(ctx_.device, pick_pipeline_, nullptr);
+    pipelines_.destroy(ctx_);
     if (pick_pl_layout_)  vkDestroyPipelineLayout(ctx_.device, pick_pl_layout_, nullptr);
-    if (pick_pass_)       vkDestroyRenderPass(ctx_.device, pick_pass_, nullptr);
     desc_alloc_.destroy(ctx_.device);
-    if (pipeline_)        vkDestroyPipeline(ctx_.device, pipeline_, nullptr);
     if (pipeline_layout_) vkDestroyPipelineLayout(ctx_.device, pipeline_layout_, nullptr);
     if (material_layout_) vkDestroyDescriptorSetLayout(ctx_.device, material_layout_, nullptr);
     if (global_layout_)   vkDestroyDescriptorSetLayout(ctx_.device, global_layout_, nullptr);
-    if (scene_pass_)      vkDestroyRenderPass(ctx_.device, scene_pass_, nullptr);
     // ImGui manages its own descriptor pool via DescriptorPoolSize
-    cleanup_ui_framebuffers();
-    if (ui_pass_)         vkDestroyRenderPass(ctx_.device, ui_pass_, nullptr);
+    graph_.destroy(ctx_);
     vkDestroyCommandPool(ctx_.device, command_pool_, nullptr);
     swapchain_.cleanup(ctx_);
     ctx_.shutdown();
 }
 
-// ─── UI render pass (to swapchain) ──────────────────────────────────
-
-bool EditorRenderer::create_ui_pass() {
-    VkAttachmentDescription att{};
-    att.format         = swapchain_.image_format;
-    att.samples        = VK_SAMPLE_COUNT_1_BIT;
-    att.loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    att.storeOp        = VK_ATTACHMENT_STORE_OP_STORE;
-    att.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    att.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    att.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
-    att.finalLayout    = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-    VkAttachmentReference ref{0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
-    VkSubpassDescription sub{};
-    sub.pipelineBindPoint    = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    sub.colorAttachmentCount = 1;
-    sub.pColorAttachments    = &ref;
-
-    VkSubpassDependency dep{};
-    dep.srcSubpass    = VK_SUBPASS_EXTERNAL;
-    dep.dstSubpass    = 0;
-    dep.srcStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dep.dstStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dep.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-
-    VkRenderPassCreateInfo ci{};
-    ci.sType           = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    ci.attachmentCount = 1;
-    ci.pAttachments    = &att;
-    ci.subpassCount    = 1;
-    ci.pSubpasses      = &sub;
-    ci.dependencyCount = 1;
-    ci.pDependencies   = &dep;
-    VK_CHECK(vkCreateRenderPass(ctx_.device, &ci, nullptr, &ui_pass_));
-    return ui_pass_ != VK_NULL_HANDLE;
-}
-
-bool EditorRenderer::create_ui_framebuffers() {
-    ui_framebuffers_.resize(swapchain_.image_views.size());
-    for (size_t i = 0; i < swapchain_.image_views.size(); i++) {
-        VkFramebufferCreateInfo ci{};
-        ci.sType           = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        ci.renderPass      = ui_pass_;
-        ci.attachmentCount = 1;
-        ci.pAttachments    = &swapchain_.image_views[i];
-        ci.width           = swapchain_.extent.width;
-        ci.height          = swapchain_.extent.height;
-        ci.layers          = 1;
-        VK_CHECK(vkCreateFramebuffer(ctx_.device, &ci, nullptr, &ui_framebuffers_[i]));
-    }
-    return true;
-}
-
-void EditorRenderer::cleanup_ui_framebuffers() {
-    for (auto fb : ui_framebuffers_) vkDestroyFramebuffer(ctx_.device, fb, nullptr);
-    ui_framebuffers_.clear();
-}
-
-// ─── Scene render pass (offscreen) ──────────────────────────────────
-
-bool EditorRenderer::create_scene_pass() {
-    VkAttachmentDescription atts[2]{};
-    // Color
-    atts[0].format         = VK_FORMAT_R8G8B8A8_UNORM;
-    atts[0].samples        = VK_SAMPLE_COUNT_1_BIT;
-    atts[0].loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    atts[0].storeOp        = VK_ATTACHMENT_STORE_OP_STORE;
-    atts[0].stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    atts[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    atts[0].initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
-    atts[0].finalLayout    = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    // Depth
-    atts[1].format         = VK_FORMAT_D32_SFLOAT;
-    atts[1].samples        = VK_SAMPLE_COUNT_1_BIT;
-    atts[1].loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    atts[1].storeOp        = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    atts[1].stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    atts[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    atts[1].initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
-    atts[1].finalLayout    = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-    VkAttachmentReference color_ref{0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
-    VkAttachmentReference depth_ref{1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
-
-    VkSubpassDescription sub{};
-    sub.pipelineBindPoint       = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    sub.colorAttachmentCount    = 1;
-    sub.pColorAttachments       = &color_ref;
-    sub.pDepthStencilAttachment = &depth_ref;
-
-    VkSubpassDependency deps[2]{};
-    deps[0].srcSubpass    = VK_SUBPASS_EXTERNAL;
-    deps[0].dstSubpass    = 0;
-    deps[0].srcStageMask  = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    deps[0].dstStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    deps[0].srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
-    deps[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
-    deps[1].srcSubpass    = 0;
-    deps[1].dstSubpass    = VK_SUBPASS_EXTERNAL;
-    deps[1].srcStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    deps[1].dstStageMask  = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    deps[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    deps[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-    VkRenderPassCreateInfo ci{};
-    ci.sType           = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    ci.attachmentCount = 2;
-    ci.pAttachments    = atts;
-    ci.subpassCount    = 1;
-    ci.pSubpasses      = &sub;
-    ci.dependencyCount = 2;
-    ci.pDependencies   = deps;
-    VK_CHECK(vkCreateRenderPass(ctx_.device, &ci, nullptr, &scene_pass_));
-    return scene_pass_ != VK_NULL_HANDLE;
-}
-
 // ─── Offscreen viewport target ──────────────────────────────────────
 
 bool EditorRenderer::create_viewport_target(u32 w, u32 h) {
@@ -263,28 +156,6 @@ bool EditorRenderer::create_viewport_target(u32 w, u32 h) {
     si.minFilter = VK_FILTER_LINEAR;
     VK_CHECK(vkCreateSampler(ctx_.device, &si, nullptr, &vp_.sampler));
 
-    // Depth image
-    ici.format = VK_FORMAT_D32_SFLOAT;
-    ici.usage  = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-    VK_CHECK(vmaCreateImage(ctx_.allocator, &ici, &aci, &vp_.depth, &vp_.depth_alloc, nullptr));
-
-    vi.image  = vp_.depth;
-    vi.format = VK_FORMAT_D32_SFLOAT;
-    vi.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-    VK_CHECK(vkCreateImageView(ctx_.device, &vi, nullptr, &vp_.depth_view));
-
-    // Framebuffer
-    VkImageView views[] = {vp_.color_view, vp_.depth_view};
-    VkFramebufferCreateInfo fci{};
-    fci.sType           = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-    fci.renderPass      = scene_pass_;
-    fci.attachmentCount = 2;
-    fci.pAttachments    = views;
-    fci.width           = vp_.width;
-    fci.height          = vp_.height;
-    fci.layers          = 1;
-    VK_CHECK(vkCreateFramebuffer(ctx_.device, &fci, nullptr, &vp_.framebuffer));
-
     // ImGui descriptor for displaying the viewport texture
     vp_.imgui_ds = ImGui_ImplVulkan_AddTexture(vp_.sampler, vp_.color_view,
                                                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
@@ -292,10 +163,8 @@ bool EditorRenderer::create_viewport_target(u32 w, u32 h) {
 }
 
 void EditorRenderer::destroy_viewport_target() {
+    graph_.invalidate(ctx_);
     if (vp_.imgui_ds)   ImGui_ImplVulkan_RemoveTexture(vp_.imgui_ds);
-    if (vp_.framebuffer) vkDestroyFramebuffer(ctx_.device, vp_.framebuffer, nullptr);
-    if (vp_.depth_view)  vkDestroyImageView(ctx_.device, vp_.depth_view, nullptr);
-    if (vp_.depth)       vmaDestroyImage(ctx_.allocator, vp_.depth, vp_.depth_alloc);
     if (vp_.sampler)     vkDestroySampler(ctx_.device, vp_.sampler, nullptr);
     if (vp_.color_view)  vkDestroyImageView(ctx_.device, vp_.color_view, nullptr);
     if (vp_.color)       vmaDestroyImage(ctx_.allocator, vp_.color, vp_.color_alloc);
@@ -329,11 +198,11 @@ bool EditorRenderer::create_scene_pipeline() {
     li.pPushConstantRanges    = &push;
     VK_CHECK(vkCreatePipelineLayout(ctx_.device, &li, nullptr, &pipeline_layout_));
 
-    auto vert = load_shader_module(ctx_.device, shader_dir_ + "/mesh.vert.spv");
-    auto frag = load_shader_module(ctx_.device, shader_dir_ + "/mesh.frag.spv");
+    auto vert = pipelines_.shader(shader_dir_ + "/mesh.vert.spv");
+    auto frag = pipelines_.shader(shader_dir_ + "/mesh.frag.spv");
     if (!vert || !frag) { LOG_ERROR("Editor: Failed to load shaders"); return false; }
 
-    pipeline_ = PipelineBuilder()
+    pipeline_ = pipelines_.graphics(PipelineBuilder()
         .set_shaders(vert, frag)
         .set_vertex_layout()
         .set_topology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
@@ -341,11 +210,7 @@ bool EditorRenderer::create_scene_pipeline() {
         .set_cull_mode(VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE)
         .enable_depth_test(true, VK_COMPARE_OP_LESS)
         .disable_blending()
-        .set_layout(pipeline_layout_)
-        .build(ctx_.device, scene_pass_);
-
-    vkDestroyShaderModule(ctx_.device, vert, nullptr);
-    vkDestroyShaderModule(ctx_.device, frag, nullptr);
+        .set_layout(pipeline_layout_), scene_pass_);
     return pipeline_ != VK_NULL_HANDLE;
 }
 
@@ -356,44 +221,6 @@ struct PickPushConstants {
     u32 entity_id;
 };
 
-bool EditorRenderer::create_pick_pass() {
-    VkAttachmentDescription atts[2]{};
-    atts[0].format         = VK_FORMAT_R8G8B8A8_UNORM;
-    atts[0].samples        = VK_SAMPLE_COUNT_1_BIT;
-    atts[0].loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    atts[0].storeOp        = VK_ATTACHMENT_STORE_OP_STORE;
-    atts[0].stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    atts[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    atts[0].initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
-    atts[0].finalLayout    = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-
-    atts[1].format         = VK_FORMAT_D32_SFLOAT;
-    atts[1].samples        = VK_SAMPLE_COUNT_1_BIT;
-    atts[1].loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    atts[1].storeOp        = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    atts[1].stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    atts[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    atts[1].initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
-    atts[1].finalLayout    = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-    VkAttachmentReference color_ref{0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
-    VkAttachmentReference depth_ref{1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
-
-    VkSubpassDescription sub{};
-    sub.pipelineBindPoint       = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    sub.colorAttachmentCount    = 1;
-    sub.pColorAttachments       = &color_ref;
-    sub.pDepthStencilAttachment = &depth_ref;
-
-    VkRenderPassCreateInfo ci{VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO};
-    ci.attachmentCount = 2;
-    ci.pAttachments    = atts;
-    ci.subpassCount    = 1;
-    ci.pSubpasses      = &sub;
-    VK_CHECK(vkCreateRenderPass(ctx_.device, &ci, nullptr, &pick_pass_));
-    return pick_pass_ != VK_NULL_HANDLE;
-}
-
 bool EditorRenderer::create_pick_pipeline() {
     VkPushConstantRange push{};
     push.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
@@ -407,11 +234,11 @@ bool EditorRenderer::create_pick_pipeline() {
     li.pPushConstantRanges    = &push;
     VK_CHECK(vkCreatePipelineLayout(ctx_.device, &li, nullptr, &pick_pl_layout_));
 
-    auto vert = load_shader_module(ctx_.device, shader_dir_ + "/pick.vert.spv");
-    auto frag = load_shader_module(ctx_.device, shader_dir_ + "/pick.frag.spv");
+    auto vert = pipelines_.shader(shader_dir_ + "/pick.vert.spv");
+    auto frag = pipelines_.shader(shader_dir_ + "/pick.frag.spv");
     if (!vert || !frag) { LOG_WARN("Pick shaders not found - entity selection disabled"); return true; }
 
-    pick_pipeline_ = PipelineBuilder()
+    pick_pipeline_ = pipelines_.graphics(PipelineBuilder()
         .set_shaders(vert, frag)
         .set_vertex_layout()
         .set_topology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
@@ -419,11 +246,7 @@ bool EditorRenderer::create_pick_pipeline() {
         .set_cull_mode(VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE)
         .enable_depth_test(true, VK_COMPARE_OP_LESS)
         .disable_blending()
-        .set_layout(pick_pl_layout_)
-        .build(ctx_.device, pick_pass_);
-
-    vkDestroyShaderModule(ctx_.device, vert, nullptr);
-    vkDestroyShaderModule(ctx_.device, frag, nullptr);
+        .set_layout(pick_pl_layout_), pick_pass_);
     return true;
 }
 
@@ -452,35 +275,14 @@ bool EditorRenderer::create_pick_target(u32 w, u32 h) {
     vi.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
     VK_CHECK(vkCreateImageView(ctx_.device, &vi, nullptr, &pick_.color_view));
 
-    ici.format = VK_FORMAT_D32_SFLOAT;
-    ici.usage  = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-    VK_CHECK(vmaCreateImage(ctx_.allocator, &ici, &aci, &pick_.depth, &pick_.depth_alloc, nullptr));
-
-    vi.image  = pick_.depth;
-    vi.format = VK_FORMAT_D32_SFLOAT;
-    vi.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-    VK_CHECK(vkCreateImageView(ctx_.device, &vi, nullptr, &pick_.depth_view));
-
-    VkImageView views[] = {pick_.color_view, pick_.depth_view};
-    VkFramebufferCreateInfo fci{VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO};
-    fci.renderPass      = pick_pass_;
-    fci.attachmentCount = 2;
-    fci.pAttachments    = views;
-    fci.width           = pick_.width;
-    fci.height          = pick_.height;
-    fci.layers          = 1;
-    VK_CHECK(vkCreateFramebuffer(ctx_.device, &fci, nullptr, &pick_.framebuffer));
-
     pick_.staging = create_buffer(ctx_.allocator, 4,
         VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU);
     return true;
 }
 
 void EditorRenderer::destroy_pick_target() {
+    graph_.invalidate(ctx_);
     if (pick_.staging.buffer) destroy_buffer(ctx_.allocator, pick_.staging);
-    if (pick_.framebuffer) vkDestroyFramebuffer(ctx_.device, pick_.framebuffer, nullptr);
-    if (pick_.depth_view)  vkDestroyImageView(ctx_.device, pick_.depth_view, nullptr);
-    if (pick_.depth)       vmaDestroyImage(ctx_.allocator, pick_.depth, pick_.depth_alloc);
     if (pick_.color_view)  vkDestroyImageView(ctx_.device, pick_.color_view, nullptr);
     if (pick_.color)       vmaDestroyImage(ctx_.allocator, pick_.color, pick_.color_alloc);
     pick_ = {};
@@ -495,56 +297,54 @@ void EditorRenderer::render_pick(Scene& scene, const Camera& camera) {
         create_pick_target(vp_.width, vp_.height);
     }
 
-    auto& f = frames_[current_frame_];
+    // Left in TRANSFER_SRC_OPTIMAL for read_pick_pixel(), which copies
+    // from the last frame's result while this one is being declared
+    RGImage color = graph_.import_image("pick", {pick_.color, pick_.color_view,
+                                                 VK_FORMAT_R8G8B8A8_UNORM, {pick_.width, pick_.height}});
+    RGImage depth = graph_.create_image("pick depth", VK_FORMAT_D32_SFLOAT, {pick_.width, pick_.height});
+    graph_.set_final(color, RGUsage::TransferSrc);
 
-    VkRenderPassBeginInfo rpbi{VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
-    rpbi.renderPass  = pick_pass_;
-    rpbi.framebuffer = pick_.framebuffer;
-    rpbi.renderArea  = {{0, 0}, {pick_.width, pick_.height}};
-    VkClearValue clears[2];
-    clears[0].color        = {{0.0f, 0.0f, 0.0f, 0.0f}};
-    clears[1].depthStencil = {1.0f, 0};
-    rpbi.clearValueCount = 2;
-    rpbi.pClearValues    = clears;
-
-    vkCmdBeginRenderPass(f.cmd, &rpbi, VK_SUBPASS_CONTENTS_INLINE);
-
-    VkViewport vp{};
-    vp.x      = 0;
-    vp.y      = static_cast<float>(pick_.height);
-    vp.width  = static_cast<float>(pick_.width);
-    vp.height = -static_cast<float>(pick_.height);
-    vp.maxDepth = 1.0f;
-    vkCmdSetViewport(f.cmd, 0, 1, &vp);
-
-    VkRect2D scissor{{0, 0}, {pick_.width, pick_.height}};
-    vkCmdSetScissor(f.cmd, 0, 1, &scissor);
-
-    vkCmdBindPipeline(f.cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pick_pipeline_);
-    vkCmdBindDescriptorSets(f.cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pick_pl_layout_,
-                            0, 1, &f.global_descriptor, 0, nullptr);
-
-    auto mv = scene.view<Transform, MeshComponent>();
-    for (auto entity : mv) {
-        auto& tr = mv.get<Transform>(entity);
-        auto& mc = mv.get<MeshComponent>(entity);
-        if (!mc.mesh.valid() || mc.mesh.index >= meshes_.size()) continue;
-
-        PickPushConstants pc{};
-        pc.model     = tr.matrix();
-        pc.entity_id = static_cast<u32>(entity);
-        vkCmdPushConstants(f.cmd, pick_pl_layout_,
-            VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-            0, sizeof(pc), &pc);
-
-        auto& gm = meshes_[mc.mesh.index];
-        VkDeviceSize off = 0;
-        vkCmdBindVertexBuffers(f.cmd, 0, 1, &gm.vertex_buffer.buffer, &off);
-        vkCmdBindIndexBuffer(f.cmd, gm.index_buffer.buffer, 0, VK_INDEX_TYPE_UINT32);
-        vkCmdDrawIndexed(f.cmd, gm.index_count, 1, 0, 0, 0);
-    }
-
-    vkCmdEndRenderPass(f.cmd);
+    auto& f = frames_[current_frame_];
+    graph_.add_pass("pick")
+        .color(color, VK_ATTACHMENT_LOAD_OP_CLEAR, {{0.0f, 0.0f, 0.0f, 0.0f}})
+        .depth(depth)
+        .record([this, &scene, &f](VkCommandBuffer cmd) {
+            VkViewport vp{};
+            vp.x      = 0;
+            vp.y      = static_cast<float>(pick_.height);
+            vp.width  = static_cast<float>(pick_.width);
+            vp.height = -static_cast<float>(pick_.height);
+            vp.maxDepth = 1.0f;
+            vkCmdSetViewport(cmd, 0, 1, &vp);
+
+            VkRect2D scissor{{0, 0}, {pick_.width, pick_.height}};
+            vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pick_pipeline_);
+            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pick_pl_layout_,
+                                    0, 1, &f.global_descriptor, 0, nullptr);
+
+            scene.update_world_matrices();
+            auto mv = scene.view<WorldMatrix, MeshComponent>();
+            for (auto entity : mv) {
+                auto& wm = mv.get<WorldMatrix>(entity);
+                auto& mc = mv.get<MeshComponent>(entity);
+                if (!mc.mesh.valid() || mc.mesh.index >= meshes_.size()) continue;
+
+                PickPushConstants pc{};
+                pc.model     = wm.matrix;
+                pc.entity_id = static_cast<u32>(entity);
+                vkCmdPushConstants(cmd, pick_pl_layout_,
+                    VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                    0, sizeof(pc), &pc);
+
+                auto& gm = meshes_[mc.mesh.index];
+                VkDeviceSize off = 0;
+                vkCmdBindVertexBuffers(cmd, 0, 1, &gm.vertex_buffer.buffer, &off);
+                vkCmdBindIndexBuffer(cmd, gm.index_buffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+                vkCmdDrawIndexed(cmd, gm.index_count, 1, 0, 0, 0);
+            }
+        });
 }
 
 u32 EditorRenderer::read_pick_pixel(u32 x, u32 y) {
@@ -588,9 +388,15 @@ u32 EditorRenderer::read_pick_pixel(u32 x, u32 y) {
 // ─── Frame resources ────────────────────────────────────────────────
 
 bool EditorRenderer::create_frame_resources() {
-    u32 count = static_cast<u32>(swapchain_.images.size());
-    frames_.resize(count);
-    images_in_flight_.resize(count, VK_NULL_HANDLE);
+    frames_.resize(MAX_FRAMES_IN_FLIGHT);
+    images_in_flight_.assign(swapchain_.images.size(), VK_NULL_HANDLE);
+    if (!create_present_semaphores()) return false;
+
+    ShadowUBO no_shadows{};
+    no_shadow_atlas_ = create_shadow_placeholder(ctx_, command_pool_);
+    no_shadow_ubo_   = create_buffer(ctx_.allocator, sizeof(ShadowUBO),
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+    upload_buffer_data(ctx_.allocator, no_shadow_ubo_, &no_shadows, sizeof(no_shadows));
 
     for (auto& f : frames_) {
         VkCommandBufferAllocateInfo ai{};
@@ -602,7 +408,6 @@ bool EditorRenderer::create_frame_resources() {
 
         VkSemaphoreCreateInfo sci{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
         VK_CHECK(vkCreateSemaphore(ctx_.device, &sci, nullptr, &f.image_available));
-        VK_CHECK(vkCreateSemaphore(ctx_.device, &sci, nullptr, &f.render_finished));
 
         VkFenceCreateInfo fci{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
         fci.flags = VK_FENCE_CREATE_SIGNALED_BIT;
@@ -610,18 +415,72 @@ bool EditorRenderer::create_frame_resources() {
 
         f.global_ubo = create_buffer(ctx_.allocator, sizeof(GlobalUBO),
             VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-        f.light_ubo = create_buffer(ctx_.allocator, sizeof(LightUBO),
+        f.grid_ubo = create_buffer(ctx_.allocator, sizeof(LightGridUBO),
             VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
 
         f.global_descriptor = desc_alloc_.allocate(ctx_.device, global_layout_);
         DescriptorWriter()
             .write_buffer(0, f.global_ubo.buffer, sizeof(GlobalUBO), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
-            .write_buffer(1, f.light_ubo.buffer, sizeof(LightUBO), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+            .write_buffer(1, f.grid_ubo.buffer, sizeof(LightGridUBO), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+            .write_buffer(6, no_shadow_ubo_.buffer, sizeof(ShadowUBO), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+            .write_image(7, no_shadow_atlas_.view, no_shadow_atlas_.sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
             .update(ctx_.device, f.global_descriptor);
+        upload_lights(f);
     }
     return true;
 }
 
+// Called once the frame's fence has been waited on, so its storage buffers
+// and set can be replaced when the lights outgrow them
+void EditorRenderer::upload_lights(FrameData& f) {
+    const auto& lights = light_clusters_.lights();
+    const auto& lists  = light_clusters_.lists();
+    VkDeviceSize light_bytes = std::max<size_t>(lights.size(), MIN_LIGHT_CAPACITY) * sizeof(GPULight);
+    VkDeviceSize list_bytes  = std::max<size_t>(lists.size(), LightClusters::CLUSTER_COUNT * 2) * sizeof(u32);
+
+    bool rewrite = false;
+    if (f.light_buffer.size < light_bytes) {
+        destroy_buffer(ctx_.allocator, f.light_buffer);
+        f.light_buffer = create_buffer(ctx_.allocator, std::max(light_bytes, f.light_buffer.size * 2),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+        rewrite = true;
+    }
+    if (f.cluster_buffer.size < list_bytes) {
+        destroy_buffer(ctx_.allocator, f.cluster_buffer);
+        f.cluster_buffer = create_buffer(ctx_.allocator, std::max(list_bytes, f.cluster_buffer.size * 2),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+        rewrite = true;
+    }
+    if (rewrite) {
+        DescriptorWriter()
+            .write_buffer(4, f.light_buffer.buffer, f.light_buffer.size, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+            .write_buffer(5, f.cluster_buffer.buffer, f.cluster_buffer.size, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+            .update(ctx_.device, f.global_descriptor);
+    }
+
+    upload_buffer_data(ctx_.allocator, f.grid_ubo, &light_clusters_.grid(), sizeof(LightGridUBO));
+    if (!lights.empty())
+        upload_buffer_data(ctx_.allocator, f.light_buffer, lights.data(), lights.size() * sizeof(GPULight));
+    if (!lists.empty())
+        upload_buffer_data(ctx_.allocator, f.cluster_buffer, lists.data(), lists.size() * sizeof(u32));
+}
+
+// A present waits on the semaphore of its image, not of the frame slot:
+// with fewer slots than images a slot's semaphore could be re-signalled
+// while the presentation engine still holds it.
+bool EditorRenderer::create_present_semaphores() {
+    render_finished_.resize(swapchain_.images.size(), VK_NULL_HANDLE);
+    VkSemaphoreCreateInfo sci{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+    for (auto& s : render_finished_)
+        VK_CHECK(vkCreateSemaphore(ctx_.device, &sci, nullptr, &s));
+    return true;
+}
+
+void EditorRenderer::destroy_present_semaphores() {
+    for (auto s : render_finished_) vkDestroySemaphore(ctx_.device, s, nullptr);
+    render_finished_.clear();
+}
+
 // ─── Default resources ──────────────────────────────────────────────
 
 bool EditorRenderer::create_default_resources() {
@@ -751,7 +610,7 @@ void EditorRenderer::recreate_swapchain() {
     while (w == 0 || h == 0) { window_->get_framebuffer_size(w, h); glfwWaitEvents(); }
 
     vkDeviceWaitIdle(ctx_.device);
-    cleanup_ui_framebuffers();
+    graph_.invalidate(ctx_);
 
     auto old = swapchain_.handle;
     swapchain_.handle = VK_NULL_HANDLE;
@@ -765,7 +624,8 @@ void EditorRenderer::recreate_swapchain() {
     if (old) vkDestroySwapchainKHR(ctx_.device, old, nullptr);
 
     images_in_flight_.assign(swapchain_.images.size(), VK_NULL_HANDLE);
-    create_ui_framebuffers();
+    destroy_present_semaphores();
+    create_present_semaphores();
 }
 
 // ─── Frame lifecycle ────────────────────────────────────────────────
@@ -787,6 +647,7 @@ bool EditorRenderer::begin_frame() {
 
     VkCommandBufferBeginInfo bi{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
     VK_CHECK(vkBeginCommandBuffer(f.cmd, &bi));
+    graph_.begin();
     return true;
 }
 
@@ -799,82 +660,60 @@ void EditorRenderer::render_scene(Scene& scene, const Camera& camera) {
     global.camera_pos    = glm::vec4(camera.position(), 1.0f);
     global.ambient_color = glm::vec4(0.08f, 0.08f, 0.12f, 0.3f);
 
-    LightUBO light_data{};
-    int lc = 0;
-    auto lv = scene.view<Transform, LightComponent>();
-    for (auto e : lv) {
-        if (lc >= 16) break;
-        auto& t = lv.get<Transform>(e);
-        auto& l = lv.get<LightComponent>(e);
-        auto& gl = light_data.lights[lc];
-        gl.position  = glm::vec4(t.position, l.type == LightType::Directional ? 0.0f : 1.0f);
-        gl.color     = glm::vec4(l.color, l.intensity);
-        gl.direction = glm::vec4(glm::normalize(glm::vec3(
-            cos(glm::radians(t.rotation.y)) * cos(glm::radians(t.rotation.x)),
-            sin(glm::radians(t.rotation.x)),
-            sin(glm::radians(t.rotation.y)) * cos(glm::radians(t.rotation.x))
-        )), 0.0f);
-        gl.params = glm::vec4(l.range, cos(glm::radians(l.spot_angle)),
-                              static_cast<float>(static_cast<int>(l.type)), 0.0f);
-        lc++;
-    }
-    global.num_lights = lc;
+    light_clusters_.gather(scene);
+    light_clusters_.build(camera);
+    global.num_lights = static_cast<int>(light_clusters_.lights().size());
 
     upload_buffer_data(ctx_.allocator, f.global_ubo, &global, sizeof(global));
-    upload_buffer_data(ctx_.allocator, f.light_ubo, &light_data, sizeof(light_data));
-
-    // Begin offscreen render pass
-    VkRenderPassBeginInfo rpbi{VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
-    rpbi.renderPass  = scene_pass_;
-    rpbi.framebuffer = vp_.framebuffer;
-    rpbi.renderArea  = {{0, 0}, {vp_.width, vp_.height}};
-    VkClearValue clears[2];
-    clears[0].color        = {{0.05f, 0.05f, 0.07f, 1.0f}};
-    clears[1].depthStencil = {1.0f, 0};
-    rpbi.clearValueCount = 2;
-    rpbi.pClearValues    = clears;
-
-    vkCmdBeginRenderPass(f.cmd, &rpbi, VK_SUBPASS_CONTENTS_INLINE);
-
-    VkViewport vp{};
-    vp.x      = 0;
-    vp.y      = static_cast<float>(vp_.height);
-    vp.width  = static_cast<float>(vp_.width);
-    vp.height = -static_cast<float>(vp_.height);
-    vp.maxDepth = 1.0f;
-    vkCmdSetViewport(f.cmd, 0, 1, &vp);
-
-    VkRect2D scissor{{0, 0}, {vp_.width, vp_.height}};
-    vkCmdSetScissor(f.cmd, 0, 1, &scissor);
-
-    vkCmdBindPipeline(f.cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_);
-    vkCmdBindDescriptorSets(f.cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_,
-                            0, 1, &f.global_descriptor, 0, nullptr);
-
-    auto mv = scene.view<Transform, MeshComponent>();
-    for (auto entity : mv) {
-        auto& tr = mv.get<Transform>(entity);
-        auto& mc = mv.get<MeshComponent>(entity);
-        if (!mc.mesh.valid() || mc.mesh.index >= meshes_.size()) continue;
-
-        PushConstants pc{};
-        pc.model = tr.matrix();
-        vkCmdPushConstants(f.cmd, pipeline_layout_, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pc), &pc);
-
-        VkDescriptorSet ms = default_material_.descriptor;
-        if (mc.material.valid() && mc.material.index < materials_.size())
-            ms = materials_[mc.material.index].descriptor;
-        vkCmdBindDescriptorSets(f.cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_,
-                                1, 1, &ms, 0, nullptr);
-
-        auto& gm = meshes_[mc.mesh.index];
-        VkDeviceSize off = 0;
-        vkCmdBindVertexBuffers(f.cmd, 0, 1, &gm.vertex_buffer.buffer, &off);
-        vkCmdBindIndexBuffer(f.cmd, gm.index_buffer.buffer, 0, VK_INDEX_TYPE_UINT32);
-        vkCmdDrawIndexed(f.cmd, gm.index_count, 1, 0, 0, 0);
-    }
-
-    vkCmdEndRenderPass(f.cmd);
+    upload_lights(f);
+
+    viewport_image_ = graph_.import_image("viewport", {vp_.color, vp_.color_view,
+                                                       VK_FORMAT_R8G8B8A8_UNORM, {vp_.width, vp_.height}});
+    RGImage depth = graph_.create_image("viewport depth", VK_FORMAT_D32_SFLOAT, {vp_.width, vp_.height});
+
+    graph_.add_pass("scene")
+        .color(viewport_image_, VK_ATTACHMENT_LOAD_OP_CLEAR, {{0.05f, 0.05f, 0.07f, 1.0f}})
+        .depth(depth)
+        .record([this, &scene, &f](VkCommandBuffer cmd) {
+            VkViewport vp{};
+            vp.x      = 0;
+            vp.y      = static_cast<float>(vp_.height);
+            vp.width  = static_cast<float>(vp_.width);
+            vp.height = -static_cast<float>(vp_.height);
+            vp.maxDepth = 1.0f;
+            vkCmdSetViewport(cmd, 0, 1, &vp);
+
+            VkRect2D scissor{{0, 0}, {vp_.width, vp_.height}};
+            vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_);
+            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_,
+                                    0, 1, &f.global_descriptor, 0, nullptr);
+
+            scene.update_world_matrices();
+            auto mv = scene.view<WorldMatrix, MeshComponent>();
+            for (auto entity : mv) {
+                auto& wm = mv.get<WorldMatrix>(entity);
+                auto& mc = mv.get<MeshComponent>(entity);
+                if (!mc.mesh.valid() || mc.mesh.index >= meshes_.size()) continue;
+
+                PushConstants pc{};
+                pc.model = wm.matrix;
+                vkCmdPushConstants(cmd, pipeline_layout_, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pc), &pc);
+
+                VkDescriptorSet ms = default_material_.descriptor;
+                if (mc.material.valid() && mc.material.index < materials_.size())
+                    ms = materials_[mc.material.index].descriptor;
+                vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_,
+                                        1, 1, &ms, 0, nullptr);
+
+                auto& gm = meshes_[mc.mesh.index];
+                VkDeviceSize off = 0;
+                vkCmdBindVertexBuffers(cmd, 0, 1, &gm.vertex_buffer.buffer, &off);
+                vkCmdBindIndexBuffer(cmd, gm.index_buffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+                vkCmdDrawIndexed(cmd, gm.index_count, 1, 0, 0, 0);
+            }
+        });
 }
 
 void EditorRenderer::begin_ui() {
@@ -887,19 +726,21 @@ void EditorRenderer::begin_ui() {
 void EditorRenderer::end_ui() {
     ImGui::Render();
 
+    RGImage target = graph_.import_image("swapchain", {swapchain_.images[image_index_],
+                                                       swapchain_.image_views[image_index_],
+                                                       swapchain_.image_format, swapchain_.extent});
+    graph_.set_final(target, RGUsage::Present);
+
+    auto ui = graph_.add_pass("ui");
+    ui.color(target, VK_ATTACHMENT_LOAD_OP_CLEAR, {{0.04f, 0.04f, 0.05f, 1.0f}})
+      .record([](VkCommandBuffer cmd) {
+          ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmd);
+      });
+    if (viewport_image_ != RG_NO_IMAGE) ui.read(viewport_image_, RGUsage::SampledFragment);
+
     auto& f = frames_[current_frame_];
-    VkRenderPassBeginInfo rpbi{VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
-    rpbi.renderPass  = ui_pass_;
-    rpbi.framebuffer = ui_framebuffers_[image_index_];
-    rpbi.renderArea  = {{0, 0}, swapchain_.extent};
-    VkClearValue clear{};
-    clear.color = {{0.04f, 0.04f, 0.05f, 1.0f}};
-    rpbi.clearValueCount = 1;
-    rpbi.pClearValues    = &clear;
-
-    vkCmdBeginRenderPass(f.cmd, &rpbi, VK_SUBPASS_CONTENTS_INLINE);
-    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), f.cmd);
-    vkCmdEndRenderPass(f.cmd);
+    if (graph_.compile(ctx_)) graph_.execute(f.cmd);
+    viewport_image_ = RG_NO_IMAGE;
 }
 
 void EditorRenderer::end_frame() {
@@ -914,12 +755,12 @@ void EditorRenderer::end_frame() {
     si.commandBufferCount   = 1;
     si.pCommandBuffers      = &f.cmd;
     si.signalSemaphoreCount = 1;
-    si.pSignalSemaphores    = &f.render_finished;
+    si.pSignalSemaphores    = &render_finished_[image_index_];
     VK_CHECK(vkQueueSubmit(ctx_.graphics_queue, 1, &si, f.fence));
 
     VkPresentInfoKHR pi{VK_STRUCTURE_TYPE_PRESENT_INFO_KHR};
     pi.waitSemaphoreCount = 1;
-    pi.pWaitSemaphores    = &f.render_finished;
+    pi.pWaitSemaphores    = &render_finished_[image_index_];
     pi.swapchainCount     = 1;
     pi.pSwapchains        = &swapchain_.handle;
     pi.pImageIndices      = &image_index_;
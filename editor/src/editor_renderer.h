@@ -4,7 +4,10 @@
 #include "graphics/vulkan/vk_init.h"
 #include "graphics/vulkan/vk_swapchain.h"
 #include "graphics/vulkan/vk_descriptors.h"
+#include "graphics/vulkan/vk_pipeline.h"
+#include "graphics/vulkan/vk_render_graph.h"
 #include "graphics/gpu_types.h"
+#include "graphics/light_clusters.h"
 #include "graphics/camera.h"
 #include "imgui.h"
 
@@ -18,7 +21,7 @@ class Scene;
 
 class EditorRenderer {
 public:
-    bool init(Window& window, const std::string& shader_dir);
+    bool init(Window& window, const std::string& shader_dir, const std::string& pipeline_cache);
     void shutdown();
 
     bool begin_frame();
@@ -37,42 +40,44 @@ public:
     MaterialHandle create_material(const MaterialData& data);
 
 private:
-    VulkanContext   ctx_;
-    VulkanSwapchain swapchain_;
-    Window*         window_ = nullptr;
-    std::string     shader_dir_;
+    VulkanContext    ctx_;
+    VulkanSwapchain  swapchain_;
+    PipelineRegistry pipelines_; // shared with the game window
+    Window*          window_ = nullptr;
+    std::string      shader_dir_;
 
     VkCommandPool command_pool_ = VK_NULL_HANDLE;
 
     struct FrameData {
         VkCommandBuffer cmd          = VK_NULL_HANDLE;
         VkSemaphore image_available  = VK_NULL_HANDLE;
-        VkSemaphore render_finished  = VK_NULL_HANDLE;
         VkFence     fence            = VK_NULL_HANDLE;
-        GPUBuffer   global_ubo, light_ubo;
+        GPUBuffer   global_ubo, grid_ubo;
+        GPUBuffer   light_buffer, cluster_buffer; // GPULight[] and froxel lists, grown on demand
         VkDescriptorSet global_descriptor = VK_NULL_HANDLE;
     };
-    std::vector<FrameData> frames_;
-    std::vector<VkFence>   images_in_flight_;
+    std::vector<FrameData>   frames_;          // MAX_FRAMES_IN_FLIGHT slots
+    std::vector<VkFence>     images_in_flight_;
+    std::vector<VkSemaphore> render_finished_; // one per swapchain image
+    LightClusters            light_clusters_;
     u32 current_frame_ = 0, image_index_ = 0;
 
-    // UI pass -> swapchain
-    VkRenderPass               ui_pass_ = VK_NULL_HANDLE;
-    std::vector<VkFramebuffer> ui_framebuffers_;
-    VkDescriptorPool           imgui_pool_ = VK_NULL_HANDLE;
-
-    // Scene pass -> offscreen
-    VkRenderPass scene_pass_ = VK_NULL_HANDLE;
+    // render_scene, render_pick and end_ui each declare a pass; end_ui
+    // records the frame. Both depth buffers are graph transients sharing
+    // one allocation, and the render passes below, for building pipelines
+    // against, are owned by the graph.
+    RenderGraph  graph_;
+    RGImage      viewport_image_ = RG_NO_IMAGE; // of the frame being declared
+    VkRenderPass ui_pass_    = VK_NULL_HANDLE;  // -> swapchain
+    VkRenderPass scene_pass_ = VK_NULL_HANDLE;  // -> offscreen viewport
+    VkRenderPass pick_pass_  = VK_NULL_HANDLE;  // -> pick target
+    VkDescriptorPool imgui_pool_ = VK_NULL_HANDLE;
 
     struct ViewportTarget {
         VkImage       color = VK_NULL_HANDLE;
         VmaAllocation color_alloc = VK_NULL_HANDLE;
         VkImageView   color_view = VK_NULL_HANDLE;
         VkSampler     sampler = VK_NULL_HANDLE;
-        VkImage       depth = VK_NULL_HANDLE;
-        VmaAllocation depth_alloc = VK_NULL_HANDLE;
-        VkImageView   depth_view = VK_NULL_HANDLE;
-        VkFramebuffer framebuffer = VK_NULL_HANDLE;
         VkDescriptorSet imgui_ds = VK_NULL_HANDLE;
         u32 width = 0, height = 0;
     };
@@ -87,6 +92,8 @@ private:
 
     GPUTexture  default_texture_;
     GPUMaterial default_material_;
+    GPUTexture  no_shadow_atlas_; // mesh.frag's shadow bindings, see create_frame_resources
+    GPUBuffer   no_shadow_ubo_;
     std::vector<GPUMesh>     meshes_;
     std::vector<GPUTexture>  textures_;
     std::vector<GPUMaterial> materials_;
@@ -96,38 +103,32 @@ private:
         VkImage       color = VK_NULL_HANDLE;
         VmaAllocation color_alloc = VK_NULL_HANDLE;
         VkImageView   color_view = VK_NULL_HANDLE;
-        VkImage       depth = VK_NULL_HANDLE;
-        VmaAllocation depth_alloc = VK_NULL_HANDLE;
-        VkImageView   depth_view = VK_NULL_HANDLE;
-        VkFramebuffer framebuffer = VK_NULL_HANDLE;
         GPUBuffer     staging;
         u32 width = 0, height = 0;
     };
     PickTarget pick_;
-    VkRenderPass       pick_pass_       = VK_NULL_HANDLE;
     VkPipelineLayout   pick_pl_layout_  = VK_NULL_HANDLE;
     VkPipeline         pick_pipeline_   = VK_NULL_HANDLE;
 
-    bool create_ui_pass();
-    bool create_ui_framebuffers();
-    bool create_scene_pass();
     bool create_viewport_target(u32 w, u32 h);
     void destroy_viewport_target();
     bool create_scene_pipeline();
-    bool create_pick_pass();
     bool create_pick_pipeline();
     bool create_pick_target(u32 w, u32 h);
     void destroy_pick_target();
     bool create_frame_resources();
+    bool create_present_semaphores();
+    void upload_lights(FrameData& f);
+    void destroy_present_semaphores();
     bool create_default_resources();
     bool init_imgui();
-    void cleanup_ui_framebuffers();
     void recreate_swapchain();
 
 public:
     void render_pick(Scene& scene, const Camera& camera);
     u32  read_pick_pixel(u32 x, u32 y);
     VulkanContext& context() { return ctx_; }
+    PipelineRegistry& pipelines() { return pipelines_; }
     const std::vector<GPUMesh>&     get_meshes()      const { return meshes_; }
     const std::vector<GPUMaterial>& get_materials()    const { return materials_; }
     const GPUMaterial&              get_default_mat()  const { return default_material_; }
@@ -1,16 +1,21 @@
 #include "game_window.h"
 #include "graphics/vulkan/vk_pipeline.h"
 #include "graphics/vulkan/vk_buffer.h"
+#include "graphics/vulkan/vk_texture.h"
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
+#include <algorithm>
 
 namespace lumios::editor {
 
-bool GameWindow::open(VulkanContext& shared_ctx, const std::string& shader_dir,
+static constexpr size_t MIN_LIGHT_CAPACITY = 64;
+
+bool GameWindow::open(VulkanContext& shared_ctx, PipelineRegistry& pipelines, const std::string& shader_dir,
                       const std::vector<GPUMesh>& meshes, const std::vector<GPUMaterial>& materials,
                       const GPUMaterial& default_mat) {
-    ctx_ = &shared_ctx;
+    ctx_       = &shared_ctx;
+    pipelines_ = &pipelines;
     meshes_ptr_      = &meshes;
     materials_ptr_   = &materials;
     default_mat_ptr_ = &default_mat;
@@ -44,14 +49,20 @@ bool GameWindow::open(VulkanContext& shared_ctx, const std::string& shader_dir,
 
     VkDescriptorPoolSize pool_sizes[] = {
         {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 100},
-        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 100}
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 100},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 16}
     };
-    auto span = std::span<VkDescriptorPoolSize>(pool_sizes, 2);
+    auto span = std::span<VkDescriptorPoolSize>(pool_sizes, 3);
     desc_alloc_.init(ctx_->device, 200, span);
 
+    // Bindings 6 and 7 are unused shadow maps, as in EditorRenderer
     global_layout_ = DescriptorLayoutBuilder()
         .add(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
         .add(1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+        .add(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+        .add(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+        .add(6, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+        .add(7, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
         .build(ctx_->device);
     material_layout_ = DescriptorLayoutBuilder()
         .add(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
@@ -77,17 +88,27 @@ void GameWindow::close() {
 
     for (auto& f : frames_) {
         if (f.fence)           { vkDestroyFence(ctx_->device, f.fence, nullptr); f.fence = VK_NULL_HANDLE; }
-        if (f.render_finished) { vkDestroySemaphore(ctx_->device, f.render_finished, nullptr); f.render_finished = VK_NULL_HANDLE; }
         if (f.image_available) { vkDestroySemaphore(ctx_->device, f.image_available, nullptr); f.image_available = VK_NULL_HANDLE; }
         destroy_buffer(ctx_->allocator, f.global_ubo);
-        destroy_buffer(ctx_->allocator, f.light_ubo);
+        destroy_buffer(ctx_->allocator, f.grid_ubo);
+        destroy_buffer(ctx_->allocator, f.light_buffer);
+        destroy_buffer(ctx_->allocator, f.cluster_buffer);
         f.cmd = VK_NULL_HANDLE;
     }
     frames_.clear();
+    destroy_texture(*ctx_, no_shadow_atlas_);
+    destroy_buffer(ctx_->allocator, no_shadow_ubo_);
+    destroy_present_semaphores();
 
     desc_alloc_.destroy(ctx_->device);
-    if (pipeline_)        { vkDestroyPipeline(ctx_->device, pipeline_, nullptr); pipeline_ = VK_NULL_HANDLE; }
-    if (pipeline_layout_) { vkDestroyPipelineLayout(ctx_->device, pipeline_layout_, nullptr); pipeline_layout_ = VK_NULL_HANDLE; }
+    // The layout and render pass die with the window, so its pipelines must
+    // too; the next open() rebuilds them from the registry's pipeline cache
+    if (pipeline_layout_) {
+        pipelines_->release(pipeline_layout_);
+        vkDestroyPipelineLayout(ctx_->device, pipeline_layout_, nullptr);
+        pipeline_layout_ = VK_NULL_HANDLE;
+    }
+    pipeline_ = VK_NULL_HANDLE;
     if (material_layout_) { vkDestroyDescriptorSetLayout(ctx_->device, material_layout_, nullptr); material_layout_ = VK_NULL_HANDLE; }
     if (global_layout_)   { vkDestroyDescriptorSetLayout(ctx_->device, global_layout_, nullptr); global_layout_ = VK_NULL_HANDLE; }
 
@@ -219,11 +240,11 @@ bool GameWindow::create_pipeline(const std::string& shader_dir) {
     li.pPushConstantRanges    = &push;
     VK_CHECK(vkCreatePipelineLayout(ctx_->device, &li, nullptr, &pipeline_layout_));
 
-    auto vert = load_shader_module(ctx_->device, shader_dir + "/mesh.vert.spv");
-    auto frag = load_shader_module(ctx_->device, shader_dir + "/mesh.frag.spv");
+    auto vert = pipelines_->shader(shader_dir + "/mesh.vert.spv");
+    auto frag = pipelines_->shader(shader_dir + "/mesh.frag.spv");
     if (!vert || !frag) return false;
 
-    pipeline_ = PipelineBuilder()
+    pipeline_ = pipelines_->graphics(PipelineBuilder()
         .set_shaders(vert, frag)
         .set_vertex_layout()
         .set_topology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
@@ -231,20 +252,22 @@ bool GameWindow::create_pipeline(const std::string& shader_dir) {
         .set_cull_mode(VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE)
         .enable_depth_test(true, VK_COMPARE_OP_LESS)
         .disable_blending()
-        .set_layout(pipeline_layout_)
-        .build(ctx_->device, render_pass_);
-
-    vkDestroyShaderModule(ctx_->device, vert, nullptr);
-    vkDestroyShaderModule(ctx_->device, frag, nullptr);
+        .set_layout(pipeline_layout_), render_pass_);
     return pipeline_ != VK_NULL_HANDLE;
 }
 
 bool GameWindow::create_frame_resources() {
-    u32 count = static_cast<u32>(swapchain_.images.size());
-    frames_.resize(count);
-    images_in_flight_.assign(count, VK_NULL_HANDLE);
+    frames_.resize(MAX_FRAMES_IN_FLIGHT);
+    images_in_flight_.assign(swapchain_.images.size(), VK_NULL_HANDLE);
+    if (!create_present_semaphores()) return false;
+
+    ShadowUBO no_shadows{};
+    no_shadow_atlas_ = create_shadow_placeholder(*ctx_, command_pool_);
+    no_shadow_ubo_   = create_buffer(ctx_->allocator, sizeof(ShadowUBO),
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+    upload_buffer_data(ctx_->allocator, no_shadow_ubo_, &no_shadows, sizeof(no_shadows));
 
-    for (u32 i = 0; i < count; i++) {
+    for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         auto& f = frames_[i];
         VkCommandBufferAllocateInfo ai{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
         ai.commandPool        = command_pool_;
@@ -255,8 +278,7 @@ bool GameWindow::create_frame_resources() {
         }
 
         VkSemaphoreCreateInfo sci{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
-        if (vkCreateSemaphore(ctx_->device, &sci, nullptr, &f.image_available) != VK_SUCCESS ||
-            vkCreateSemaphore(ctx_->device, &sci, nullptr, &f.render_finished) != VK_SUCCESS) {
+        if (vkCreateSemaphore(ctx_->device, &sci, nullptr, &f.image_available) != VK_SUCCESS) {
             LOG_ERROR("Failed to create game semaphores"); return false;
         }
 
@@ -268,18 +290,72 @@ bool GameWindow::create_frame_resources() {
 
         f.global_ubo = create_buffer(ctx_->allocator, sizeof(GlobalUBO),
             VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-        f.light_ubo = create_buffer(ctx_->allocator, sizeof(LightUBO),
+        f.grid_ubo = create_buffer(ctx_->allocator, sizeof(LightGridUBO),
             VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
 
         f.global_descriptor = desc_alloc_.allocate(ctx_->device, global_layout_);
         DescriptorWriter()
             .write_buffer(0, f.global_ubo.buffer, sizeof(GlobalUBO), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
-            .write_buffer(1, f.light_ubo.buffer, sizeof(LightUBO), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+            .write_buffer(1, f.grid_ubo.buffer, sizeof(LightGridUBO), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+            .write_buffer(6, no_shadow_ubo_.buffer, sizeof(ShadowUBO), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+            .write_image(7, no_shadow_atlas_.view, no_shadow_atlas_.sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
             .update(ctx_->device, f.global_descriptor);
+        upload_lights(f);
     }
     return true;
 }
 
+// Same scheme as EditorRenderer::upload_lights: per-frame storage buffers,
+// replaced after the frame's fence when the lights outgrow them
+void GameWindow::upload_lights(FrameData& f) {
+    const auto& lights = light_clusters_.lights();
+    const auto& lists  = light_clusters_.lists();
+    VkDeviceSize light_bytes = std::max<size_t>(lights.size(), MIN_LIGHT_CAPACITY) * sizeof(GPULight);
+    VkDeviceSize list_bytes  = std::max<size_t>(lists.size(), LightClusters::CLUSTER_COUNT * 2) * sizeof(u32);
+
+    bool rewrite = false;
+    if (f.light_buffer.size < light_bytes) {
+        destroy_buffer(ctx_->allocator, f.light_buffer);
+        f.light_buffer = create_buffer(ctx_->allocator, std::max(light_bytes, f.light_buffer.size * 2),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+        rewrite = true;
+    }
+    if (f.cluster_buffer.size < list_bytes) {
+        destroy_buffer(ctx_->allocator, f.cluster_buffer);
+        f.cluster_buffer = create_buffer(ctx_->allocator, std::max(list_bytes, f.cluster_buffer.size * 2),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+        rewrite = true;
+    }
+    if (rewrite) {
+        DescriptorWriter()
+            .write_buffer(4, f.light_buffer.buffer, f.light_buffer.size, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+            .write_buffer(5, f.cluster_buffer.buffer, f.cluster_buffer.size, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+            .update(ctx_->device, f.global_descriptor);
+    }
+
+    upload_buffer_data(ctx_->allocator, f.grid_ubo, &light_clusters_.grid(), sizeof(LightGridUBO));
+    if (!lights.empty())
+        upload_buffer_data(ctx_->allocator, f.light_buffer, lights.data(), lights.size() * sizeof(GPULight));
+    if (!lists.empty())
+        upload_buffer_data(ctx_->allocator, f.cluster_buffer, lists.data(), lists.size() * sizeof(u32));
+}
+
+bool GameWindow::create_present_semaphores() {
+    render_finished_.resize(swapchain_.images.size(), VK_NULL_HANDLE);
+    VkSemaphoreCreateInfo sci{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+    for (auto& s : render_finished_) {
+        if (vkCreateSemaphore(ctx_->device, &sci, nullptr, &s) != VK_SUCCESS) {
+            LOG_ERROR("Failed to create game present semaphores"); return false;
+        }
+    }
+    return true;
+}
+
+void GameWindow::destroy_present_semaphores() {
+    for (auto s : render_finished_) if (s) vkDestroySemaphore(ctx_->device, s, nullptr);
+    render_finished_.clear();
+}
+
 void GameWindow::recreate_swapchain() {
     int w = 0, h = 0;
     glfwGetFramebufferSize(window_, &w, &h);
@@ -300,6 +376,8 @@ void GameWindow::recreate_swapchain() {
     if (old) vkDestroySwapchainKHR(ctx_->device, old, nullptr);
 
     images_in_flight_.assign(swapchain_.images.size(), VK_NULL_HANDLE);
+    destroy_present_semaphores();
+    create_present_semaphores();
     create_framebuffers();
     need_swapchain_recreate_ = false;
 }
@@ -359,29 +437,12 @@ void GameWindow::render_frame(Scene& scene, ScriptManager* scripts, float dt) {
     global.camera_pos    = glm::vec4(cam.position(), 1.0f);
     global.ambient_color = glm::vec4(0.08f, 0.08f, 0.12f, 0.3f);
 
-    LightUBO light_data{};
-    int lc = 0;
-    auto lv = scene.view<Transform, LightComponent>();
-    for (auto e : lv) {
-        if (lc >= 16) break;
-        auto& t = lv.get<Transform>(e);
-        auto& l = lv.get<LightComponent>(e);
-        auto& gl = light_data.lights[lc];
-        gl.position  = glm::vec4(t.position, l.type == LightType::Directional ? 0.0f : 1.0f);
-        gl.color     = glm::vec4(l.color, l.intensity);
-        gl.direction = glm::vec4(glm::normalize(glm::vec3(
-            cos(glm::radians(t.rotation.y)) * cos(glm::radians(t.rotation.x)),
-            sin(glm::radians(t.rotation.x)),
-            sin(glm::radians(t.rotation.y)) * cos(glm::radians(t.rotation.x))
-        )), 0.0f);
-        gl.params = glm::vec4(l.range, cos(glm::radians(l.spot_angle)),
-                              static_cast<float>(static_cast<int>(l.type)), 0.0f);
-        lc++;
-    }
-    global.num_lights = lc;
+    light_clusters_.gather(scene);
+    light_clusters_.build(cam);
+    global.num_lights = static_cast<int>(light_clusters_.lights().size());
 
     upload_buffer_data(ctx_->allocator, f.global_ubo, &global, sizeof(global));
-    upload_buffer_data(ctx_->allocator, f.light_ubo, &light_data, sizeof(light_data));
+    upload_lights(f);
 
     VkRenderPassBeginInfo rpbi{VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
     rpbi.renderPass  = render_pass_;
@@ -409,14 +470,15 @@ void GameWindow::render_frame(Scene& scene, ScriptManager* scripts, float dt) {
     vkCmdBindDescriptorSets(f.cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_,
                             0, 1, &f.global_descriptor, 0, nullptr);
 
-    auto mv = scene.view<Transform, MeshComponent>();
+    scene.update_world_matrices();
+    auto mv = scene.view<WorldMatrix, MeshComponent>();
     for (auto entity : mv) {
-        auto& tr = mv.get<Transform>(entity);
+        auto& wm = mv.get<WorldMatrix>(entity);
         auto& mc = mv.get<MeshComponent>(entity);
         if (!mc.mesh.valid() || mc.mesh.index >= meshes_ptr_->size()) continue;
 
         PushConstants pc{};
-        pc.model = tr.matrix();
+        pc.model = wm.matrix;
         vkCmdPushConstants(f.cmd, pipeline_layout_, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pc), &pc);
 
         VkDescriptorSet ms = default_mat_ptr_->descriptor;
@@ -443,12 +505,12 @@ void GameWindow::render_frame(Scene& scene, ScriptManager* scripts, float dt) {
     si.commandBufferCount   = 1;
     si.pCommandBuffers      = &f.cmd;
     si.signalSemaphoreCount = 1;
-    si.pSignalSemaphores    = &f.render_finished;
+    si.pSignalSemaphores    = &render_finished_[image_index_];
     vkQueueSubmit(ctx_->graphics_queue, 1, &si, f.fence);
 
     VkPresentInfoKHR pi{VK_STRUCTURE_TYPE_PRESENT_INFO_KHR};
     pi.waitSemaphoreCount = 1;
-    pi.pWaitSemaphores    = &f.render_finished;
+    pi.pWaitSemaphores    = &render_finished_[image_index_];
     pi.swapchainCount     = 1;
     pi.pSwapchains        = &swapchain_.handle;
     pi.pImageIndices      = &image_index_;
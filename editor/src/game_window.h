@@ -5,6 +5,7 @@
 #include "graphics/vulkan/vk_swapchain.h"
 #include "graphics/vulkan/vk_descriptors.h"
 #include "graphics/gpu_types.h"
+#include "graphics/light_clusters.h"
 #include "graphics/camera.h"
 #include "scene/scene.h"
 #include "scene/components.h"
@@ -12,11 +13,15 @@
 
 struct GLFWwindow;
 
+namespace lumios { class PipelineRegistry; }
+
 namespace lumios::editor {
 
 class GameWindow {
 public:
-    bool open(VulkanContext& shared_ctx, const std::string& shader_dir,
+    // Pipelines come from the editor's registry, so reopening reuses its
+    // shader modules and pipeline cache instead of compiling from scratch
+    bool open(VulkanContext& shared_ctx, PipelineRegistry& pipelines, const std::string& shader_dir,
               const std::vector<GPUMesh>& meshes, const std::vector<GPUMaterial>& materials,
               const GPUMaterial& default_mat);
     void close();
@@ -26,23 +31,28 @@ public:
     void render_frame(Scene& scene, ScriptManager* scripts, float dt);
 
 private:
-    GLFWwindow*     window_ = nullptr;
-    VulkanContext*  ctx_     = nullptr;
-    VkSurfaceKHR    surface_ = VK_NULL_HANDLE;
-    VulkanSwapchain swapchain_;
+    GLFWwindow*       window_    = nullptr;
+    VulkanContext*    ctx_       = nullptr;
+    PipelineRegistry* pipelines_ = nullptr; // the editor's, outlives the window
+    VkSurfaceKHR      surface_   = VK_NULL_HANDLE;
+    VulkanSwapchain   swapchain_;
 
     VkCommandPool command_pool_ = VK_NULL_HANDLE;
 
     struct FrameData {
         VkCommandBuffer cmd = VK_NULL_HANDLE;
         VkSemaphore image_available = VK_NULL_HANDLE;
-        VkSemaphore render_finished = VK_NULL_HANDLE;
         VkFence     fence           = VK_NULL_HANDLE;
-        GPUBuffer   global_ubo, light_ubo;
+        GPUBuffer   global_ubo, grid_ubo;
+        GPUBuffer   light_buffer, cluster_buffer; // GPULight[] and froxel lists, grown on demand
         VkDescriptorSet global_descriptor = VK_NULL_HANDLE;
     };
-    std::vector<FrameData> frames_;
-    std::vector<VkFence>   images_in_flight_;
+    std::vector<FrameData>   frames_;          // MAX_FRAMES_IN_FLIGHT slots
+    std::vector<VkFence>     images_in_flight_;
+    std::vector<VkSemaphore> render_finished_; // one per swapchain image
+    LightClusters            light_clusters_;
+    GPUTexture               no_shadow_atlas_; // mesh.frag's shadow bindings, never drawn into
+    GPUBuffer                no_shadow_ubo_;
     u32 current_frame_ = 0, image_index_ = 0;
     bool need_swapchain_recreate_ = false;
 
@@ -63,6 +73,9 @@ private:
     void cleanup_framebuffers();
     bool create_pipeline(const std::string& shader_dir);
     bool create_frame_resources();
+    bool create_present_semaphores();
+    void upload_lights(FrameData& f);
+    void destroy_present_semaphores();
     void recreate_swapchain();
 
     Camera resolve_game_camera(Scene& scene);
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "types.h"
+#include <string>
+
+namespace lumios {
+
+// FNV-1a over the bytes of each value added. Values are hashed as their
+// object representation, so they must have no padding that varies.
+struct ByteHash {
+    u64 value = 1469598103934665603ull;
+
+    template<typename T>
+    void add(const T& v) {
+        const u8* p = reinterpret_cast<const u8*>(&v);
+        for (size_t i = 0; i < sizeof(T); i++) {
+            value ^= p[i];
+            value *= 1099511628211ull;
+        }
+    }
+
+    void add(const std::string& s) {
+        for (char c : s) add(c);
+        add(s.size());
+    }
+};
+
+} // namespace lumios
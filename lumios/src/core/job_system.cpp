@@ -0,0 +1,82 @@
+#include "job_system.h"
+#include <algorithm>
+
+namespace lumios {
+
+JobSystem::JobSystem(u32 worker_count) {
+    if (worker_count == UINT32_MAX) {
+        u32 hw = std::thread::hardware_concurrency();
+        worker_count = hw > 1 ? hw - 1 : 0;
+    }
+    workers_.reserve(worker_count);
+    for (u32 i = 0; i < worker_count; i++)
+        workers_.emplace_back([this] { worker_loop(); });
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    wake_cv_.notify_all();
+    for (auto& t : workers_) t.join();
+}
+
+void JobSystem::run_chunks() {
+    for (;;) {
+        u32 begin = next_.fetch_add(chunk_, std::memory_order_relaxed);
+        if (begin >= count_) return;
+        (*job_)(begin, std::min(begin + chunk_, count_));
+    }
+}
+
+void JobSystem::worker_loop() {
+    u64 seen = 0;
+    for (;;) {
+        {
+            std::unique_lock lock(mutex_);
+            wake_cv_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_) return;
+            seen = generation_;
+        }
+
+        run_chunks();
+
+        std::lock_guard lock(mutex_);
+        if (--busy_ == 0) done_cv_.notify_one();
+    }
+}
+
+void JobSystem::parallel_for(u32 count, u32 min_chunk, const RangeFn& fn) {
+    if (count == 0) return;
+
+    // Roughly four chunks per thread keeps the tail short without making
+    // the shared counter hot.
+    u32 chunk = std::max(min_chunk, count / (thread_count() * 4));
+    chunk = std::max(chunk, 1u);
+
+    if (workers_.empty() || chunk >= count) {
+        fn(0, count);
+        return;
+    }
+
+    std::lock_guard dispatch(dispatch_mutex_);
+    {
+        std::lock_guard lock(mutex_);
+        job_   = &fn;
+        count_ = count;
+        chunk_ = chunk;
+        next_.store(0, std::memory_order_relaxed);
+        busy_  = worker_count();
+        generation_++;
+    }
+    wake_cv_.notify_all();
+
+    run_chunks();
+
+    std::unique_lock lock(mutex_);
+    done_cv_.wait(lock, [&] { return busy_ == 0; });
+    job_ = nullptr;
+}
+
+} // namespace lumios
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "types.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace lumios {
+
+// Fixed pool of worker threads for data-parallel loops. The calling thread
+// takes part in every loop, so a pool with zero workers runs inline.
+class JobSystem {
+public:
+    using RangeFn = std::function<void(u32 begin, u32 end)>;
+
+    // worker_count == UINT32_MAX picks hardware_concurrency - 1
+    explicit JobSystem(u32 worker_count = UINT32_MAX);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Splits [0, count) into chunks of at least min_chunk items and blocks
+    // until fn has run over every chunk. Calls from different threads are
+    // serialized.
+    void parallel_for(u32 count, u32 min_chunk, const RangeFn& fn);
+
+    u32 worker_count() const { return static_cast<u32>(workers_.size()); }
+    u32 thread_count() const { return worker_count() + 1; }
+
+private:
+    void worker_loop();
+    void run_chunks();
+
+    std::vector<std::thread> workers_;
+
+    std::mutex              dispatch_mutex_; // one parallel_for at a time
+    std::mutex              mutex_;
+    std::condition_variable wake_cv_;
+    std::condition_variable done_cv_;
+    u64                     generation_ = 0;
+    u32                     busy_       = 0;
+    bool                    stop_       = false;
+
+    const RangeFn*   job_   = nullptr;
+    u32              count_ = 0;
+    u32              chunk_ = 1;
+    std::atomic<u32> next_{0};
+};
+
+} // namespace lumios
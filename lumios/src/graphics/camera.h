@@ -63,6 +63,8 @@ public:
     const glm::vec3& front()    const { return front_; }
     float fov()    const { return fov_; }
     float aspect() const { return aspect_; }
+    float near_plane() const { return near_; }
+    float far_plane()  const { return far_; }
 };
 
 } // namespace lumios
@@ -0,0 +1,148 @@
+#include "culling.h"
+#include "gpu_types.h"
+#include <algorithm>
+
+#if defined(__AVX__)
+    #include <immintrin.h>
+    #define LUMIOS_CULL_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define LUMIOS_CULL_SSE 1
+#endif
+
+namespace lumios {
+
+// --- Bounds ---
+
+MeshBounds compute_mesh_bounds(const MeshData& data) {
+    MeshBounds b;
+    if (data.vertices.empty()) return b;
+
+    b.aabb_min = b.aabb_max = data.vertices[0].position;
+    for (const auto& v : data.vertices) {
+        b.aabb_min = glm::min(b.aabb_min, v.position);
+        b.aabb_max = glm::max(b.aabb_max, v.position);
+    }
+
+    // Tighter than the AABB's half diagonal for round meshes
+    b.sphere.center = (b.aabb_min + b.aabb_max) * 0.5f;
+    float r2 = 0.0f;
+    for (const auto& v : data.vertices) {
+        glm::vec3 d = v.position - b.sphere.center;
+        r2 = std::max(r2, glm::dot(d, d));
+    }
+    b.sphere.radius = std::sqrt(r2);
+    return b;
+}
+
+BoundingSphere transform_sphere(const BoundingSphere& local, const glm::mat4& model) {
+    BoundingSphere s;
+    s.center = glm::vec3(model * glm::vec4(local.center, 1.0f));
+    float sx = glm::dot(glm::vec3(model[0]), glm::vec3(model[0]));
+    float sy = glm::dot(glm::vec3(model[1]), glm::vec3(model[1]));
+    float sz = glm::dot(glm::vec3(model[2]), glm::vec3(model[2]));
+    s.radius = local.radius * std::sqrt(std::max({sx, sy, sz}));
+    return s;
+}
+
+// --- Frustum ---
+
+Frustum Frustum::from_view_projection(const glm::mat4& m) {
+    // Gribb/Hartmann: planes are sums of the clip matrix rows (glm is column-major)
+    auto row = [&](int i) { return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]); };
+    glm::vec4 r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+
+    Frustum f;
+    f.planes[0] = r3 + r0; // left
+    f.planes[1] = r3 - r0; // right
+    f.planes[2] = r3 + r1; // bottom
+    f.planes[3] = r3 - r1; // top
+    f.planes[4] = r2;      // near (z >= 0)
+    f.planes[5] = r3 - r2; // far
+    for (auto& p : f.planes) p /= glm::length(glm::vec3(p));
+    return f;
+}
+
+// --- CullingSet ---
+
+void CullingSet::grow() {
+    size_t size = std::max<size_t>(x_.size() * 2, 256);
+    x_.resize(size);
+    y_.resize(size);
+    z_.resize(size);
+    r_.resize(size);
+}
+
+u32 CullingSet::cull(const Frustum& frustum, std::vector<u8>& visible) const {
+    u32 padded = (count_ + LANES - 1) / LANES * LANES;
+    visible.resize(padded);
+    if (count_ == 0) return 0;
+
+    // Padding lanes hold stale data and are discarded below
+    const float* xs = x_.data();
+    const float* ys = y_.data();
+    const float* zs = z_.data();
+    const float* rs = r_.data();
+    u32 i = 0;
+
+#if defined(LUMIOS_CULL_AVX)
+    __m256 px[6], py[6], pz[6], pw[6];
+    for (int p = 0; p < 6; p++) {
+        px[p] = _mm256_set1_ps(frustum.planes[p].x);
+        py[p] = _mm256_set1_ps(frustum.planes[p].y);
+        pz[p] = _mm256_set1_ps(frustum.planes[p].z);
+        pw[p] = _mm256_set1_ps(frustum.planes[p].w);
+    }
+    const __m256 zero = _mm256_setzero_ps();
+    for (; i < padded; i += 8) {
+        __m256 x = _mm256_loadu_ps(xs + i);
+        __m256 y = _mm256_loadu_ps(ys + i);
+        __m256 z = _mm256_loadu_ps(zs + i);
+        __m256 neg_r = _mm256_sub_ps(zero, _mm256_loadu_ps(rs + i));
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < 6; p++) {
+            __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px[p], x), _mm256_mul_ps(py[p], y)),
+                                     _mm256_add_ps(_mm256_mul_ps(pz[p], z), pw[p]));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, neg_r, _CMP_GT_OQ));
+        }
+        int mask = _mm256_movemask_ps(inside);
+        for (int l = 0; l < 8; l++) visible[i + l] = static_cast<u8>((mask >> l) & 1);
+    }
+#elif defined(LUMIOS_CULL_SSE)
+    __m128 px[6], py[6], pz[6], pw[6];
+    for (int p = 0; p < 6; p++) {
+        px[p] = _mm_set1_ps(frustum.planes[p].x);
+        py[p] = _mm_set1_ps(frustum.planes[p].y);
+        pz[p] = _mm_set1_ps(frustum.planes[p].z);
+        pw[p] = _mm_set1_ps(frustum.planes[p].w);
+    }
+    const __m128 zero = _mm_setzero_ps();
+    for (; i < padded; i += 4) {
+        __m128 x = _mm_loadu_ps(xs + i);
+        __m128 y = _mm_loadu_ps(ys + i);
+        __m128 z = _mm_loadu_ps(zs + i);
+        __m128 neg_r = _mm_sub_ps(zero, _mm_loadu_ps(rs + i));
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; p++) {
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px[p], x), _mm_mul_ps(py[p], y)),
+                                  _mm_add_ps(_mm_mul_ps(pz[p], z), pw[p]));
+            inside = _mm_and_ps(inside, _mm_cmpgt_ps(d, neg_r));
+        }
+        int mask = _mm_movemask_ps(inside);
+        for (int l = 0; l < 4; l++) visible[i + l] = static_cast<u8>((mask >> l) & 1);
+    }
+#endif
+
+    for (; i < count_; i++) {
+        bool inside = true;
+        for (const auto& p : frustum.planes)
+            inside &= p.x * xs[i] + p.y * ys[i] + p.z * zs[i] + p.w > -rs[i];
+        visible[i] = inside ? 1 : 0;
+    }
+
+    u32 count = 0;
+    for (u32 j = 0; j < count_; j++) count += visible[j];
+    return count;
+}
+
+} // namespace lumios
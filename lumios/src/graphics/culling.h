@@ -0,0 +1,64 @@
+#pragma once
+
+#include "../core/types.h"
+#include "../math/math.h"
+
+namespace lumios {
+
+struct MeshData;
+
+struct BoundingSphere {
+    glm::vec3 center{0.0f};
+    float     radius = 0.0f;
+};
+
+struct MeshBounds {
+    glm::vec3      aabb_min{0.0f};
+    glm::vec3      aabb_max{0.0f};
+    BoundingSphere sphere;   // centered on the AABB
+};
+
+MeshBounds compute_mesh_bounds(const MeshData& data);
+
+// Sphere of the mesh bounds under model; the radius takes the largest axis
+// scale so it stays conservative for non-uniform scaling
+BoundingSphere transform_sphere(const BoundingSphere& local, const glm::mat4& model);
+
+// Inward-facing, normalized planes (xyz normal, w distance) of a 0..1 depth
+// clip space: left, right, bottom, top, near, far
+struct Frustum {
+    glm::vec4 planes[6];
+
+    static Frustum from_view_projection(const glm::mat4& view_proj);
+};
+
+// Bounding spheres packed structure-of-arrays so the frustum test runs 8
+// (AVX) or 4 (SSE) spheres at a time; arrays are padded to the lane width.
+class CullingSet {
+public:
+    static constexpr u32 LANES = 8;
+
+    void clear() { count_ = 0; }
+    u32  size() const { return count_; }
+
+    void add(const BoundingSphere& sphere) {
+        if (count_ == x_.size()) grow();
+        x_[count_] = sphere.center.x;
+        y_[count_] = sphere.center.y;
+        z_[count_] = sphere.center.z;
+        r_[count_] = sphere.radius;
+        count_++;
+    }
+
+    // visible[i] = 1 when sphere i touches the frustum; returns how many do.
+    // visible is resized to the padded count, only [0, size()) is meaningful.
+    u32 cull(const Frustum& frustum, std::vector<u8>& visible) const;
+
+private:
+    void grow();
+
+    std::vector<float> x_, y_, z_, r_;
+    u32 count_ = 0;
+};
+
+} // namespace lumios
@@ -34,7 +34,7 @@ struct alignas(16) GlobalUBO {
     glm::mat4 projection;
     glm::vec4 camera_pos;
     glm::vec4 ambient_color;
-    int       num_lights;
+    int       num_lights; // directional included, see LightGridUBO
     int       _pad[3];
 };
 
@@ -42,11 +42,29 @@ struct alignas(16) GPULight {
     glm::vec4 position;   // w=0 directional, w=1 point/spot
     glm::vec4 color;      // rgb + intensity in w
     glm::vec4 direction;  // normalized direction
-    glm::vec4 params;     // x=range, y=spot_angle_cos, z=type, w=unused
+    glm::vec4 params;     // x=range, y=spot_angle_cos, z=type, w=first shadow view or -1
 };
 
-struct alignas(16) LightUBO {
-    GPULight lights[16];
+// Froxel grid of the clustered light lists, see LightClusters. The lights
+// and the lists themselves are storage buffers.
+struct alignas(16) LightGridUBO {
+    glm::uvec4 size;  // tiles x, tiles y, depth slices, directional lights
+    glm::vec4  depth; // near, far, scale, bias: slice = log(view depth) * scale + bias
+};
+
+// One shadow map, a square tile of the ShadowMaps atlas
+struct GPUShadowView {
+    glm::mat4 view_projection;
+    glm::vec4 rect; // atlas uv, offset xy and scale zw
+    glm::vec4 bias; // x = normal offset in world units, per unit of light distance when y = 1
+};
+
+constexpr u32 MAX_SHADOW_VIEWS = 52; // 4 cascades + 48 point/spot tiles, mesh.frag sizes its array to it
+
+struct alignas(16) ShadowUBO {
+    glm::vec4     splits; // view depth each cascade ends at
+    glm::vec4     params; // x = cascades in use, y = atlas texel size in uv
+    GPUShadowView views[MAX_SHADOW_VIEWS];
 };
 
 struct alignas(16) MaterialUBOData {
@@ -57,8 +75,61 @@ struct alignas(16) MaterialUBOData {
     float _pad;
 };
 
+// Inputs of cull.comp and draw_compact.comp
+struct alignas(16) CullUBO {
+    glm::mat4 view_projection; // previous frame's, the one the depth pyramid was rendered with
+    glm::vec4 planes[6];       // current frustum
+    glm::vec2 pyramid_size;    // mip 0 of the depth pyramid, in texels
+    u32       instance_count;
+    u32       draw_count;
+    u32       occlusion;       // 0 while the pyramid holds no valid frame
+    u32       _pad[3];
+};
+
 struct PushConstants {
     glm::mat4 model;
 };
 
+// GPU-side storage buffer structs (std430 alignment)
+
+struct GPUInstance {
+    glm::mat4 model;
+    u32       material; // slot in the material table
+    u32       batch;    // draw command this instance belongs to
+    u32       _pad[2];
+    glm::vec4 sphere;   // world bounding sphere, xyz = center, w = radius
+};
+
+struct MaterialTableEntry {
+    glm::vec4 base_color;
+    float     metallic;
+    float     roughness;
+    float     ao;
+    u32       albedo_texture; // slot in the bindless texture array
+};
+
+// Inputs of particle.comp and particle.vert
+struct GPUParticle {
+    glm::vec4 position; // xyz, w = remaining life in seconds, <= 0 when dead
+    glm::vec4 velocity; // xyz, w = size
+    glm::vec4 color;
+};
+
+struct GPUEmitter {
+    glm::vec4 origin;       // xyz = world position, w = lifetime
+    glm::vec4 velocity_min; // w = size at birth
+    glm::vec4 velocity_max; // w = size at death
+    glm::vec4 color_start;
+    glm::vec4 color_end;
+    glm::vec4 gravity;
+    u32       first;        // pool range in the particle buffer
+    u32       capacity;
+    u32       sim_first;    // first simulate thread
+    u32       emit_first;   // first emit thread
+    u32       emit_count;
+    u32       pool;         // dead list counter
+    u32       reset;        // 1 on the frame the pool is (re)assigned
+    u32       seed;
+};
+
 } // namespace lumios
@@ -0,0 +1,134 @@
+#include "light_clusters.h"
+#include "camera.h"
+#include "../scene/scene.h"
+#include "../scene/components.h"
+#include <algorithm>
+#include <cmath>
+
+namespace lumios {
+
+// --- Gather ---
+
+void LightClusters::gather(Scene& scene) {
+    lights_.clear();
+    casts_shadows_.clear();
+    auto view = scene.view<Transform, LightComponent>();
+
+    // Two passes keep each kind in scene order, directional lights first
+    for (int pass = 0; pass < 2; pass++) {
+        for (auto entity : view) {
+            auto& t = view.get<Transform>(entity);
+            auto& l = view.get<LightComponent>(entity);
+            if ((l.type == LightType::Directional) != (pass == 0)) continue;
+
+            GPULight gl;
+            gl.position  = glm::vec4(t.position, l.type == LightType::Directional ? 0.0f : 1.0f);
+            gl.color     = glm::vec4(l.color, l.intensity);
+            gl.direction = glm::vec4(glm::normalize(glm::vec3(
+                cos(glm::radians(t.rotation.y)) * cos(glm::radians(t.rotation.x)),
+                sin(glm::radians(t.rotation.x)),
+                sin(glm::radians(t.rotation.y)) * cos(glm::radians(t.rotation.x))
+            )), 0.0f);
+            gl.params = glm::vec4(l.range, cos(glm::radians(l.spot_angle)),
+                                  static_cast<float>(static_cast<int>(l.type)), -1.0f);
+            lights_.push_back(gl);
+            casts_shadows_.push_back(l.cast_shadows ? 1 : 0);
+        }
+        if (pass == 0) directional_ = static_cast<u32>(lights_.size());
+    }
+}
+
+void LightClusters::set_shadow_view(u32 light, i32 first_view) {
+    lights_[light].params.w = static_cast<float>(first_view);
+}
+
+// --- Froxel lists ---
+
+void LightClusters::build(const Camera& camera) {
+    glm::mat4 view = camera.view();
+    glm::mat4 proj = camera.projection();
+    float near_z = camera.near_plane();
+    float far_z  = camera.far_plane();
+
+    // slice = log(depth) * scale + bias puts near at 0 and far at SLICES
+    float scale = static_cast<float>(SLICES) / std::log(far_z / near_z);
+    float bias  = -std::log(near_z) * scale;
+    grid_.size  = glm::uvec4(TILES_X, TILES_Y, SLICES, directional_);
+    grid_.depth = glm::vec4(near_z, far_z, scale, bias);
+
+    auto slice_of = [&](float depth) {
+        float s = std::floor(std::log(depth) * scale + bias);
+        return static_cast<u32>(std::clamp(s, 0.0f, static_cast<float>(SLICES - 1)));
+    };
+    auto tile_of = [](float ndc, u32 tiles) {
+        float t = std::floor((ndc * 0.5f + 0.5f) * static_cast<float>(tiles));
+        return static_cast<u32>(std::clamp(t, 0.0f, static_cast<float>(tiles - 1)));
+    };
+
+    counts_.assign(CLUSTER_COUNT, 0);
+    ranges_.clear();
+    for (u32 i = directional_; i < static_cast<u32>(lights_.size()); i++) {
+        const GPULight& l = lights_[i];
+        glm::vec3 center = glm::vec3(view * glm::vec4(glm::vec3(l.position), 1.0f));
+        float radius   = l.params.x;
+        float closest  = -center.z - radius; // view depth, positive in front
+        float farthest = -center.z + radius;
+        if (farthest <= near_z || closest >= far_z) continue;
+
+        Range r;
+        r.light = i;
+        r.z0 = slice_of(std::max(closest, near_z));
+        r.z1 = slice_of(std::min(farthest, far_z));
+
+        if (closest <= near_z) {
+            // Wraps around the camera, the projection of the box is unbounded
+            r.x0 = 0; r.x1 = TILES_X - 1;
+            r.y0 = 0; r.y1 = TILES_Y - 1;
+        } else {
+            glm::vec2 lo(1.0f), hi(-1.0f);
+            for (int c = 0; c < 8; c++) {
+                glm::vec3 corner = center + radius * glm::vec3((c & 1) ? 1.0f : -1.0f,
+                                                               (c & 2) ? 1.0f : -1.0f,
+                                                               (c & 4) ? 1.0f : -1.0f);
+                glm::vec4 clip = proj * glm::vec4(corner, 1.0f);
+                glm::vec2 ndc  = glm::vec2(clip) / clip.w;
+                lo = glm::min(lo, ndc);
+                hi = glm::max(hi, ndc);
+            }
+            if (hi.x < -1.0f || lo.x > 1.0f || hi.y < -1.0f || lo.y > 1.0f) continue;
+            r.x0 = tile_of(lo.x, TILES_X); r.x1 = tile_of(hi.x, TILES_X);
+            r.y0 = tile_of(lo.y, TILES_Y); r.y1 = tile_of(hi.y, TILES_Y);
+        }
+
+        for (u32 z = r.z0; z <= r.z1; z++)
+            for (u32 y = r.y0; y <= r.y1; y++)
+                for (u32 x = r.x0; x <= r.x1; x++)
+                    counts_[(z * TILES_Y + y) * TILES_X + x]++;
+        ranges_.push_back(r);
+    }
+
+    // Counting sort: offsets from the counts, then a second pass fills them
+    // in, leaving each froxel's indices in ascending light order
+    references_ = 0;
+    for (u32 c : counts_) references_ += c;
+    lists_.resize(CLUSTER_COUNT * 2 + references_);
+
+    u32 offset = 0;
+    for (u32 c = 0; c < CLUSTER_COUNT; c++) {
+        lists_[c * 2]     = offset;
+        lists_[c * 2 + 1] = 0;
+        offset += counts_[c];
+    }
+
+    u32* indices = lists_.data() + CLUSTER_COUNT * 2;
+    for (const Range& r : ranges_) {
+        for (u32 z = r.z0; z <= r.z1; z++)
+            for (u32 y = r.y0; y <= r.y1; y++)
+                for (u32 x = r.x0; x <= r.x1; x++) {
+                    u32 c = (z * TILES_Y + y) * TILES_X + x;
+                    indices[lists_[c * 2] + lists_[c * 2 + 1]++] = r.light;
+                }
+    }
+}
+
+} // namespace lumios
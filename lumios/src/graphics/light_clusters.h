@@ -0,0 +1,64 @@
+#pragma once
+
+#include "gpu_types.h"
+#include <vector>
+
+namespace lumios {
+
+class Camera;
+class Scene;
+
+// Clustered forward lighting. The view frustum is cut into froxels (screen
+// tiles by exponential depth slices) and every froxel lists the point and
+// spot lights whose range reaches it, so a fragment shades only the lights
+// around it instead of all of them. Directional lights reach everything:
+// they lead lights() and are not listed.
+//
+// lists() is uploaded as is: CLUSTER_COUNT (offset, count) pairs, then the
+// light indices they point into. A light goes into every froxel its view
+// space bounding box touches, which is conservative.
+class LightClusters {
+public:
+    static constexpr u32 TILES_X       = 16;
+    static constexpr u32 TILES_Y       = 9;
+    static constexpr u32 SLICES        = 24;
+    static constexpr u32 CLUSTER_COUNT = TILES_X * TILES_Y * SLICES;
+
+    // Collects the scene's lights, directional ones first, all unshadowed
+    void gather(Scene& scene);
+
+    // Points the light at its shadow views in ShadowUBO, -1 for none
+    void set_shadow_view(u32 light, i32 first_view);
+
+    // Rebuilds the froxel lists of the gathered lights for camera
+    void build(const Camera& camera);
+
+    const std::vector<GPULight>& lights() const { return lights_; }
+    const std::vector<u32>&      lists()  const { return lists_; }
+    const LightGridUBO&          grid()   const { return grid_; }
+    u32                          directional() const { return directional_; }
+
+    // Per light, whether its LightComponent asks for shadows
+    bool casts_shadows(u32 light) const { return casts_shadows_[light] != 0; }
+
+    // Light indices over all froxels, a measure of the shading work
+    u32 references() const { return references_; }
+
+private:
+    // Froxels a light covers, [x0, x1] x [y0, y1] x [z0, z1]
+    struct Range {
+        u32 light;
+        u32 x0, x1, y0, y1, z0, z1;
+    };
+
+    std::vector<GPULight> lights_;
+    std::vector<u32>      lists_;
+    std::vector<u8>       casts_shadows_; // parallel to lights_
+    std::vector<u32>      counts_; // scratch, lights per froxel
+    std::vector<Range>    ranges_; // scratch, one per light that reaches the frustum
+    u32                   directional_ = 0;
+    u32                   references_  = 0;
+    LightGridUBO          grid_{};
+};
+
+} // namespace lumios
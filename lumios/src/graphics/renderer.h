@@ -4,17 +4,69 @@
 #include "gpu_types.h"
 #include "camera.h"
 #include <string>
+#include <vector>
 
 namespace lumios {
 
 class Window;
 class Scene;
 
+// How render_scene submits meshes:
+//   Direct    - push constant, material bind, buffer binds and a draw per entity
+//   Instanced - entities bucketed by (mesh, material), one instanced draw per bucket
+//   Indirect  - the same buckets as indirect commands, one multi-draw call total
+//   GpuCulled - indirect, with a compute pass doing frustum and occlusion culling
+//               against the previous frame's depth and compacting the survivors
+enum class DrawPath { Direct, Instanced, Indirect, GpuCulled };
+constexpr int DRAW_PATH_COUNT = 4;
+
+inline const char* draw_path_name(DrawPath path) {
+    switch (path) {
+        case DrawPath::Direct:    return "direct";
+        case DrawPath::Instanced: return "instanced";
+        case DrawPath::Indirect:  return "indirect";
+        case DrawPath::GpuCulled: return "gpu-culled";
+    }
+    return "unknown";
+}
+
+// GPU time of one render pass, from timestamps around it
+struct PassTiming {
+    std::string name;
+    double      ms = 0.0;
+};
+
+struct RenderStats {
+    DrawPath path           = DrawPath::Direct;
+    u32      objects        = 0;   // mesh entities submitted after culling
+    u32      culled         = 0;   // mesh entities outside the frustum
+    u32      gpu_visible    = 0;   // instances kept by the GPU cull, read back a few frames late
+    u32      bounds_updated = 0;   // world bounds rebuilt after a Transform change
+    u32      batches        = 0;   // distinct (mesh, material) pairs, 0 on the direct path
+    u32      draw_calls     = 0;   // vkCmdDraw* calls recorded
+    u32      record_chunks  = 0;   // secondary command buffers the main pass was recorded into, 0 inline
+    u32      lights         = 0;   // lights gathered, directional included
+    u32      light_refs     = 0;   // light indices over all froxel lists
+    u32      shadow_views   = 0;   // cascades and light tiles rendered into the shadow atlas
+    u32      shadow_cached  = 0;   // of those, views whose static casters came from the cache
+    u32      shadow_draws   = 0;   // draw calls of the shadow passes, not in draw_calls
+    u32      emitters       = 0;   // particle emitters simulated on the GPU
+    u32      particles      = 0;   // particle slots of those, every one stepped each frame
+    u32      passes         = 0;   // render graph passes recorded
+    u32      passes_culled  = 0;   // declared but culled, nothing read what they wrote
+    u32      barriers       = 0;   // image barriers placed by the render graph
+    double   texture_mb     = 0.0; // streamed texture mips resident in VRAM
+    double   record_ms      = 0.0; // CPU time spent in render_scene
+    double   gpu_ms         = 0.0; // GPU time of all passes, a few frames late
+};
+
 class Renderer {
 public:
     virtual ~Renderer() = default;
 
-    virtual bool init(Window& window, const std::string& shader_dir) = 0;
+    // pipeline_cache is a writable file outside the shader directory, such
+    // as in the build or user cache directory; empty keeps no cache
+    virtual bool init(Window& window, const std::string& shader_dir, const std::string& pipeline_cache) = 0;
     virtual void shutdown() = 0;
 
     virtual bool begin_frame() = 0;
@@ -26,6 +78,31 @@ public:
 
     virtual void render_scene(Scene& scene, const Camera& camera) = 0;
 
+    // Ignored with a warning when the device lacks the needed features
+    virtual void     set_draw_path(DrawPath path) = 0;
+    virtual DrawPath draw_path() const = 0;
+    virtual const RenderStats& stats() const = 0;
+
+    virtual void set_frustum_culling(bool enabled) = 0;
+    virtual bool frustum_culling() const = 0;
+
+    virtual void set_shadows(bool enabled) = 0;
+    virtual bool shadows() const = 0;
+
+    virtual void set_bloom(bool enabled) = 0;
+    virtual bool bloom() const = 0;
+    virtual void set_ssao(bool enabled) = 0;
+    virtual bool ssao() const = 0;
+
+    // Long draw lists of the direct and instanced paths are recorded on
+    // several threads; false without worker threads
+    virtual void set_parallel_recording(bool enabled) = 0;
+    virtual bool parallel_recording() const = 0;
+
+    // Per pass, of the same frame as RenderStats::gpu_ms; empty when the
+    // device has no timestamps
+    virtual const std::vector<PassTiming>& gpu_timings() const = 0;
+
     static Unique<Renderer> create();
 };
 
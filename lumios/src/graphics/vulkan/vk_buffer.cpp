@@ -4,20 +4,30 @@
 namespace lumios {
 
 GPUBuffer create_buffer(VmaAllocator allocator, VkDeviceSize size,
-                        VkBufferUsageFlags usage, VmaMemoryUsage mem_usage) {
+                        VkBufferUsageFlags usage, VmaMemoryUsage mem_usage,
+                        std::span<const u32> queue_families) {
     VkBufferCreateInfo bci{};
     bci.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     bci.size  = size;
     bci.usage = usage;
+    if (queue_families.size() > 1) {
+        bci.sharingMode           = VK_SHARING_MODE_CONCURRENT;
+        bci.queueFamilyIndexCount = static_cast<u32>(queue_families.size());
+        bci.pQueueFamilyIndices   = queue_families.data();
+    }
 
     VmaAllocationCreateInfo aci{};
     aci.usage = mem_usage;
     if (mem_usage == VMA_MEMORY_USAGE_CPU_ONLY || mem_usage == VMA_MEMORY_USAGE_CPU_TO_GPU)
         aci.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+    else if (mem_usage == VMA_MEMORY_USAGE_GPU_TO_CPU)
+        aci.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
 
     GPUBuffer buf;
     buf.size = size;
-    VK_CHECK(vmaCreateBuffer(allocator, &bci, &aci, &buf.buffer, &buf.allocation, nullptr));
+    VmaAllocationInfo info{};
+    VK_CHECK(vmaCreateBuffer(allocator, &bci, &aci, &buf.buffer, &buf.allocation, &info));
+    buf.mapped = static_cast<u8*>(info.pMappedData);
     return buf;
 }
 
@@ -26,18 +36,40 @@ void destroy_buffer(VmaAllocator allocator, GPUBuffer& buf) {
         vmaDestroyBuffer(allocator, buf.buffer, buf.allocation);
         buf.buffer = VK_NULL_HANDLE;
         buf.allocation = VK_NULL_HANDLE;
+        buf.mapped = nullptr;
     }
 }
 
-void upload_buffer_data(VmaAllocator allocator, GPUBuffer& buf, const void* data, VkDeviceSize size) {
+// Host-visible buffers stay mapped for their lifetime; the flush and
+// invalidate are no-ops on coherent memory
+void upload_buffer_data(VmaAllocator allocator, GPUBuffer& buf, const void* data, VkDeviceSize size,
+                        VkDeviceSize offset) {
+    if (buf.mapped) {
+        memcpy(buf.mapped + offset, data, size);
+        vmaFlushAllocation(allocator, buf.allocation, offset, size);
+        return;
+    }
     void* mapped;
     vmaMapMemory(allocator, buf.allocation, &mapped);
-    memcpy(mapped, data, size);
+    memcpy(static_cast<u8*>(mapped) + offset, data, size);
+    vmaUnmapMemory(allocator, buf.allocation);
+}
+
+void read_buffer_data(VmaAllocator allocator, const GPUBuffer& buf, void* data, VkDeviceSize size,
+                      VkDeviceSize offset) {
+    vmaInvalidateAllocation(allocator, buf.allocation, offset, size);
+    if (buf.mapped) {
+        memcpy(data, buf.mapped + offset, size);
+        return;
+    }
+    void* mapped;
+    vmaMapMemory(allocator, buf.allocation, &mapped);
+    memcpy(data, static_cast<const u8*>(mapped) + offset, size);
     vmaUnmapMemory(allocator, buf.allocation);
 }
 
 void upload_to_gpu(VulkanContext& ctx, VkCommandPool pool,
-                   GPUBuffer& dst, const void* data, VkDeviceSize size) {
+                   GPUBuffer& dst, const void* data, VkDeviceSize size, VkDeviceSize dst_offset) {
     GPUBuffer staging = create_buffer(ctx.allocator, size,
         VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
 
@@ -46,7 +78,8 @@ void upload_to_gpu(VulkanContext& ctx, VkCommandPool pool,
     VkCommandBuffer cmd = ctx.begin_single_command(pool);
 
     VkBufferCopy region{};
-    region.size = size;
+    region.dstOffset = dst_offset;
+    region.size      = size;
     vkCmdCopyBuffer(cmd, staging.buffer, dst.buffer, 1, &region);
 
     ctx.end_single_command(pool, cmd);
@@ -54,4 +87,15 @@ void upload_to_gpu(VulkanContext& ctx, VkCommandPool pool,
     destroy_buffer(ctx.allocator, staging);
 }
 
+void copy_buffer(VulkanContext& ctx, VkCommandPool pool,
+                 const GPUBuffer& src, GPUBuffer& dst, VkDeviceSize size) {
+    VkCommandBuffer cmd = ctx.begin_single_command(pool);
+
+    VkBufferCopy region{};
+    region.size = size;
+    vkCmdCopyBuffer(cmd, src.buffer, dst.buffer, 1, &region);
+
+    ctx.end_single_command(pool, cmd);
+}
+
 } // namespace lumios
@@ -6,14 +6,28 @@ namespace lumios {
 
 struct VulkanContext;
 
+// More than one queue family makes the buffer VK_SHARING_MODE_CONCURRENT
 GPUBuffer create_buffer(VmaAllocator allocator, VkDeviceSize size,
-                        VkBufferUsageFlags usage, VmaMemoryUsage mem_usage);
+                        VkBufferUsageFlags usage, VmaMemoryUsage mem_usage,
+                        std::span<const u32> queue_families = {});
 
 void destroy_buffer(VmaAllocator allocator, GPUBuffer& buf);
 
-void upload_buffer_data(VmaAllocator allocator, GPUBuffer& buf, const void* data, VkDeviceSize size);
+void upload_buffer_data(VmaAllocator allocator, GPUBuffer& buf, const void* data, VkDeviceSize size,
+                        VkDeviceSize offset = 0);
 
+// For GPU_TO_CPU buffers the device wrote; the caller makes sure the writes
+// are finished (fence)
+void read_buffer_data(VmaAllocator allocator, const GPUBuffer& buf, void* data, VkDeviceSize size,
+                      VkDeviceSize offset = 0);
+
+// Blocking staged copy on the graphics queue, for tools; the renderer
+// streams through UploadManager instead
 void upload_to_gpu(VulkanContext& ctx, VkCommandPool pool,
-                   GPUBuffer& dst, const void* data, VkDeviceSize size);
+                   GPUBuffer& dst, const void* data, VkDeviceSize size, VkDeviceSize dst_offset = 0);
+
+// Blocking GPU-side copy, used when growing device-local buffers
+void copy_buffer(VulkanContext& ctx, VkCommandPool pool,
+                 const GPUBuffer& src, GPUBuffer& dst, VkDeviceSize size);
 
 } // namespace lumios
@@ -21,6 +21,7 @@ struct GPUBuffer {
     VkBuffer      buffer     = VK_NULL_HANDLE;
     VmaAllocation allocation = VK_NULL_HANDLE;
     VkDeviceSize  size       = 0;
+    u8*           mapped     = nullptr; // persistent mapping of host-visible buffers
 };
 
 struct GPUTexture {
@@ -29,18 +30,27 @@ struct GPUTexture {
     VkImageView   view       = VK_NULL_HANDLE;
     VkSampler     sampler    = VK_NULL_HANDLE;
     u32           width = 0, height = 0;
+    u32           levels = 1;
+    VkFormat      format = VK_FORMAT_R8G8B8A8_SRGB;
+    u64           upload_ticket = 0; // UploadManager ticket, 0 when uploaded synchronously
 };
 
+// Either owns its buffers or, when suballocated from a GeometryPool, leaves
+// them empty and draws with the offsets below
 struct GPUMesh {
     GPUBuffer vertex_buffer;
     GPUBuffer index_buffer;
-    u32 vertex_count = 0;
-    u32 index_count  = 0;
+    u32 vertex_count  = 0;
+    u32 index_count   = 0;
+    i32 vertex_offset = 0;
+    u32 first_index   = 0;
+    u64 upload_ticket = 0;
 };
 
 struct GPUMaterial {
     GPUBuffer        ubo;
     VkDescriptorSet  descriptor = VK_NULL_HANDLE;
+    u64              upload_ticket = 0; // of its texture
 };
 
 } // namespace lumios
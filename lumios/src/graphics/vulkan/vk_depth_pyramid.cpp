@@ -0,0 +1,186 @@
+#include "vk_depth_pyramid.h"
+#include "vk_init.h"
+#include "vk_pipeline.h"
+#include <algorithm>
+
+namespace lumios {
+
+static constexpr u32 MAX_LEVELS = 16;
+
+static u32 previous_pow2(u32 v) {
+    u32 r = 1;
+    while (r * 2 <= v) r *= 2;
+    return r;
+}
+
+struct PyramidPush {
+    u32 src_size[2];
+    u32 dst_size[2];
+};
+
+bool DepthPyramid::init(VulkanContext& ctx, PipelineRegistry& pipelines, const std::string& shader_dir) {
+    set_layout_ = DescriptorLayoutBuilder()
+        .add(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+        .add(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)
+        .build(ctx.device);
+
+    VkPushConstantRange push{};
+    push.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    push.size       = sizeof(PyramidPush);
+
+    VkPipelineLayoutCreateInfo li{};
+    li.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    li.setLayoutCount         = 1;
+    li.pSetLayouts            = &set_layout_;
+    li.pushConstantRangeCount = 1;
+    li.pPushConstantRanges    = &push;
+    VK_CHECK(vkCreatePipelineLayout(ctx.device, &li, nullptr, &layout_));
+
+    pipeline_ = pipelines.compute(layout_, shader_dir + "/depth_pyramid.comp.spv");
+    if (!pipeline_) return false;
+
+    // Exact texel reads only; the clamp keeps 2x2 lookups on the edge inside
+    VkSamplerCreateInfo si{};
+    si.sType        = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    si.magFilter    = VK_FILTER_NEAREST;
+    si.minFilter    = VK_FILTER_NEAREST;
+    si.mipmapMode   = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    si.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    si.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    si.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    si.maxLod       = VK_LOD_CLAMP_NONE;
+    VK_CHECK(vkCreateSampler(ctx.device, &si, nullptr, &sampler_));
+
+    VkDescriptorPoolSize sizes[] = {
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_LEVELS},
+        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, MAX_LEVELS}
+    };
+    descriptor_alloc_.init(ctx.device, MAX_LEVELS, std::span<VkDescriptorPoolSize>(sizes, 2));
+    return true;
+}
+
+void DepthPyramid::destroy(VulkanContext& ctx) {
+    destroy_image(ctx);
+    descriptor_alloc_.destroy(ctx.device);
+    if (sampler_)    { vkDestroySampler(ctx.device, sampler_, nullptr); sampler_ = VK_NULL_HANDLE; }
+    pipeline_ = VK_NULL_HANDLE;
+    if (layout_)     { vkDestroyPipelineLayout(ctx.device, layout_, nullptr); layout_ = VK_NULL_HANDLE; }
+    if (set_layout_) { vkDestroyDescriptorSetLayout(ctx.device, set_layout_, nullptr); set_layout_ = VK_NULL_HANDLE; }
+}
+
+void DepthPyramid::destroy_image(VulkanContext& ctx) {
+    for (auto v : level_views_) vkDestroyImageView(ctx.device, v, nullptr);
+    level_views_.clear();
+    level_sets_.clear();
+    if (view_)  { vkDestroyImageView(ctx.device, view_, nullptr); view_ = VK_NULL_HANDLE; }
+    if (image_) { vmaDestroyImage(ctx.allocator, image_, allocation_); image_ = VK_NULL_HANDLE; }
+    width_ = height_ = levels_ = 0;
+}
+
+bool DepthPyramid::resize(VulkanContext& ctx, VkCommandPool pool, VkImageView depth_view, VkExtent2D extent) {
+    if (!pipeline_) return false;
+    destroy_image(ctx);
+    descriptor_alloc_.reset(ctx.device);
+
+    depth_extent_ = extent;
+    width_  = previous_pow2(extent.width);
+    height_ = previous_pow2(extent.height);
+    levels_ = 1;
+    while ((std::max(width_, height_) >> levels_) > 0 && levels_ < MAX_LEVELS) levels_++;
+
+    VkImageCreateInfo ici{};
+    ici.sType       = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    ici.imageType   = VK_IMAGE_TYPE_2D;
+    ici.format      = VK_FORMAT_R32_SFLOAT;
+    ici.extent      = {width_, height_, 1};
+    ici.mipLevels   = levels_;
+    ici.arrayLayers = 1;
+    ici.samples     = VK_SAMPLE_COUNT_1_BIT;
+    ici.tiling      = VK_IMAGE_TILING_OPTIMAL;
+    ici.usage       = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+
+    VmaAllocationCreateInfo aci{};
+    aci.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    VK_CHECK(vmaCreateImage(ctx.allocator, &ici, &aci, &image_, &allocation_, nullptr));
+    if (!image_) return false;
+
+    VkImageViewCreateInfo vi{};
+    vi.sType    = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    vi.image    = image_;
+    vi.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    vi.format   = VK_FORMAT_R32_SFLOAT;
+    vi.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    vi.subresourceRange.levelCount = levels_;
+    vi.subresourceRange.layerCount = 1;
+    VK_CHECK(vkCreateImageView(ctx.device, &vi, nullptr, &view_));
+
+    level_views_.resize(levels_);
+    for (u32 i = 0; i < levels_; i++) {
+        vi.subresourceRange.baseMipLevel = i;
+        vi.subresourceRange.levelCount   = 1;
+        VK_CHECK(vkCreateImageView(ctx.device, &vi, nullptr, &level_views_[i]));
+    }
+
+    level_sets_.resize(levels_);
+    for (u32 i = 0; i < levels_; i++) {
+        level_sets_[i] = descriptor_alloc_.allocate(ctx.device, set_layout_);
+        DescriptorWriter writer;
+        if (i == 0) writer.write_image(0, depth_view, sampler_, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+        else        writer.write_image(0, level_views_[i - 1], sampler_, VK_IMAGE_LAYOUT_GENERAL);
+        writer.write_image(1, level_views_[i], VK_NULL_HANDLE, VK_IMAGE_LAYOUT_GENERAL, 0,
+                           VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+        writer.update(ctx.device, level_sets_[i]);
+    }
+
+    // GENERAL for its whole life, the cull pass samples it before the first build
+    VkCommandBuffer cmd = ctx.begin_single_command(pool);
+    VkImageMemoryBarrier barrier{};
+    barrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.dstAccessMask       = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout           = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image               = image_;
+    barrier.subresourceRange    = {VK_IMAGE_ASPECT_COLOR_BIT, 0, levels_, 0, 1};
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+    ctx.end_single_command(pool, cmd);
+
+    LOG_INFO("Depth pyramid: %ux%u, %u levels", width_, height_, levels_);
+    return true;
+}
+
+void DepthPyramid::build(VkCommandBuffer cmd) {
+    // This frame's cull reads of the old pyramid before the first level is
+    // written; the depth itself was handed over by the caller
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline_);
+
+    VkMemoryBarrier level_barrier{};
+    level_barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    level_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    level_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    u32 src_w = depth_extent_.width, src_h = depth_extent_.height;
+    for (u32 i = 0; i < levels_; i++) {
+        u32 dst_w = std::max(1u, width_ >> i);
+        u32 dst_h = std::max(1u, height_ >> i);
+
+        PyramidPush pc{{src_w, src_h}, {dst_w, dst_h}};
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, layout_, 0, 1, &level_sets_[i], 0, nullptr);
+        vkCmdPushConstants(cmd, layout_, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pc), &pc);
+        vkCmdDispatch(cmd, (dst_w + 7) / 8, (dst_h + 7) / 8, 1);
+
+        if (i + 1 < levels_) {
+            vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                 0, 1, &level_barrier, 0, nullptr, 0, nullptr);
+        }
+        src_w = dst_w;
+        src_h = dst_h;
+    }
+}
+
+} // namespace lumios
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "vk_common.h"
+#include "vk_descriptors.h"
+#include <string>
+#include <vector>
+
+namespace lumios {
+
+struct VulkanContext;
+class PipelineRegistry;
+
+// Hierarchical depth (Hi-Z) built from the depth buffer after the main pass,
+// for occlusion culling in the next frame. Mip 0 is the largest power of two
+// not above the framebuffer size; every texel holds the farthest depth of the
+// area it covers, so anything whose nearest depth lies behind it is hidden.
+// The image stays in GENERAL layout. Only core compute features are used
+// (no subgroup ops or min/max sampler reduction), so it runs on lavapipe.
+class DepthPyramid {
+public:
+    // The pipeline comes from, and stays owned by, the registry
+    bool init(VulkanContext& ctx, PipelineRegistry& pipelines, const std::string& shader_dir);
+    void destroy(VulkanContext& ctx);
+
+    // (Re)creates the pyramid for a new depth buffer; the device must be
+    // idle. The depth image needs SAMPLED usage.
+    bool resize(VulkanContext& ctx, VkCommandPool pool, VkImageView depth_view, VkExtent2D extent);
+
+    // Expects depth in DEPTH_STENCIL_READ_ONLY_OPTIMAL with the pass's
+    // writes visible to compute, as a render graph pass sampling it in
+    // compute leaves it. The finished pyramid is made visible by the
+    // reader's own compute barrier.
+    void build(VkCommandBuffer cmd);
+
+    bool        ready()   const { return pipeline_ != VK_NULL_HANDLE && image_ != VK_NULL_HANDLE; }
+    VkImageView view()    const { return view_; }
+    VkSampler   sampler() const { return sampler_; }
+    u32         width()   const { return width_; }
+    u32         height()  const { return height_; }
+
+private:
+    void destroy_image(VulkanContext& ctx);
+
+    VkDescriptorSetLayout set_layout_ = VK_NULL_HANDLE;
+    VkPipelineLayout      layout_     = VK_NULL_HANDLE;
+    VkPipeline            pipeline_   = VK_NULL_HANDLE;
+    VkSampler             sampler_    = VK_NULL_HANDLE;
+    DescriptorAllocator   descriptor_alloc_;
+
+    VkImage                      image_      = VK_NULL_HANDLE;
+    VmaAllocation                allocation_ = VK_NULL_HANDLE;
+    VkImageView                  view_       = VK_NULL_HANDLE; // all levels, for sampling
+    std::vector<VkImageView>     level_views_;
+    std::vector<VkDescriptorSet> level_sets_;  // level i reads level i - 1 (or depth) and writes i
+    VkExtent2D                   depth_extent_{};
+    u32 width_  = 0;
+    u32 height_ = 0;
+    u32 levels_ = 0;
+};
+
+} // namespace lumios
@@ -5,22 +5,36 @@ namespace lumios {
 // --- DescriptorLayoutBuilder ---
 
 DescriptorLayoutBuilder& DescriptorLayoutBuilder::add(u32 binding, VkDescriptorType type,
-                                                      VkShaderStageFlags stages, u32 count) {
+                                                      VkShaderStageFlags stages, u32 count,
+                                                      VkDescriptorBindingFlags flags) {
     VkDescriptorSetLayoutBinding b{};
     b.binding         = binding;
     b.descriptorType  = type;
     b.descriptorCount = count;
     b.stageFlags      = stages;
     bindings_.push_back(b);
+    binding_flags_.push_back(flags);
     return *this;
 }
 
-VkDescriptorSetLayout DescriptorLayoutBuilder::build(VkDevice device) {
+VkDescriptorSetLayout DescriptorLayoutBuilder::build(VkDevice device, VkDescriptorSetLayoutCreateFlags flags) {
     VkDescriptorSetLayoutCreateInfo ci{};
     ci.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    ci.flags        = flags;
     ci.bindingCount = static_cast<u32>(bindings_.size());
     ci.pBindings    = bindings_.data();
 
+    // Per-binding flags (partially bound, update after bind) need the 1.2 chain
+    VkDescriptorSetLayoutBindingFlagsCreateInfo flags_ci{};
+    bool any_flags = false;
+    for (auto f : binding_flags_) any_flags |= f != 0;
+    if (any_flags) {
+        flags_ci.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        flags_ci.bindingCount  = static_cast<u32>(binding_flags_.size());
+        flags_ci.pBindingFlags = binding_flags_.data();
+        ci.pNext = &flags_ci;
+    }
+
     VkDescriptorSetLayout layout;
     VK_CHECK(vkCreateDescriptorSetLayout(device, &ci, nullptr, &layout));
     return layout;
@@ -28,9 +42,11 @@ VkDescriptorSetLayout DescriptorLayoutBuilder::build(VkDevice device) {
 
 // --- DescriptorAllocator ---
 
-void DescriptorAllocator::init(VkDevice device, u32 max_sets, std::span<VkDescriptorPoolSize> sizes) {
+void DescriptorAllocator::init(VkDevice device, u32 max_sets, std::span<VkDescriptorPoolSize> sizes,
+                               VkDescriptorPoolCreateFlags flags) {
     VkDescriptorPoolCreateInfo ci{};
     ci.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    ci.flags         = flags;
     ci.maxSets       = max_sets;
     ci.poolSizeCount = static_cast<u32>(sizes.size());
     ci.pPoolSizes    = sizes.data();
@@ -73,14 +89,16 @@ DescriptorWriter& DescriptorWriter::write_buffer(u32 binding, VkBuffer buffer, V
 }
 
 DescriptorWriter& DescriptorWriter::write_image(u32 binding, VkImageView view,
-                                                 VkSampler sampler, VkImageLayout layout) {
+                                                 VkSampler sampler, VkImageLayout layout,
+                                                 u32 array_element, VkDescriptorType type) {
     image_infos_.push_back({sampler, view, layout});
 
     VkWriteDescriptorSet w{};
     w.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
     w.dstBinding      = binding;
+    w.dstArrayElement = array_element;
     w.descriptorCount = 1;
-    w.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    w.descriptorType  = type;
     writes_.push_back(w);
     return *this;
 }
@@ -89,7 +107,9 @@ void DescriptorWriter::update(VkDevice device, VkDescriptorSet set) {
     u32 buf_idx = 0, img_idx = 0;
     for (auto& w : writes_) {
         w.dstSet = set;
-        if (w.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER) {
+        if (w.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ||
+            w.descriptorType == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE ||
+            w.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE) {
             w.pImageInfo = &image_infos_[img_idx++];
         } else {
             w.pBufferInfo = &buffer_infos_[buf_idx++];
@@ -7,16 +7,19 @@ namespace lumios {
 
 class DescriptorLayoutBuilder {
     std::vector<VkDescriptorSetLayoutBinding> bindings_;
+    std::vector<VkDescriptorBindingFlags>     binding_flags_;
 public:
     DescriptorLayoutBuilder& add(u32 binding, VkDescriptorType type,
-                                 VkShaderStageFlags stages, u32 count = 1);
-    VkDescriptorSetLayout build(VkDevice device);
+                                 VkShaderStageFlags stages, u32 count = 1,
+                                 VkDescriptorBindingFlags flags = 0);
+    VkDescriptorSetLayout build(VkDevice device, VkDescriptorSetLayoutCreateFlags flags = 0);
 };
 
 class DescriptorAllocator {
     VkDescriptorPool pool_ = VK_NULL_HANDLE;
 public:
-    void init(VkDevice device, u32 max_sets, std::span<VkDescriptorPoolSize> sizes);
+    void init(VkDevice device, u32 max_sets, std::span<VkDescriptorPoolSize> sizes,
+              VkDescriptorPoolCreateFlags flags = 0);
     VkDescriptorSet allocate(VkDevice device, VkDescriptorSetLayout layout);
     void reset(VkDevice device);
     void destroy(VkDevice device);
@@ -30,7 +33,8 @@ public:
     DescriptorWriter& write_buffer(u32 binding, VkBuffer buffer, VkDeviceSize size,
                                    VkDeviceSize offset, VkDescriptorType type);
     DescriptorWriter& write_image(u32 binding, VkImageView view, VkSampler sampler,
-                                  VkImageLayout layout);
+                                  VkImageLayout layout, u32 array_element = 0,
+                                  VkDescriptorType type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
     void update(VkDevice device, VkDescriptorSet set);
 };
 
@@ -0,0 +1,83 @@
+#include "vk_geometry.h"
+#include "vk_buffer.h"
+#include "vk_init.h"
+#include "vk_upload.h"
+#include "../gpu_types.h"
+#include <algorithm>
+
+namespace lumios {
+
+static constexpr VkBufferUsageFlags VERTEX_USAGE = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+    VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+static constexpr VkBufferUsageFlags INDEX_USAGE = VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+    VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+
+void GeometryPool::init(VulkanContext& ctx, const UploadManager& upload, u32 vertex_capacity, u32 index_capacity) {
+    auto families = upload.sharing_families();
+    families_.assign(families.begin(), families.end());
+    vertices_ = create_buffer(ctx.allocator, VkDeviceSize(vertex_capacity) * sizeof(Vertex),
+                              VERTEX_USAGE, VMA_MEMORY_USAGE_GPU_ONLY, families_);
+    indices_  = create_buffer(ctx.allocator, VkDeviceSize(index_capacity) * sizeof(u32),
+                              INDEX_USAGE, VMA_MEMORY_USAGE_GPU_ONLY, families_);
+    vertex_count_ = 0;
+    index_count_  = 0;
+}
+
+void GeometryPool::destroy(VulkanContext& ctx) {
+    destroy_buffer(ctx.allocator, vertices_);
+    destroy_buffer(ctx.allocator, indices_);
+    vertex_count_ = index_count_ = 0;
+}
+
+bool GeometryPool::grow(VulkanContext& ctx, VkCommandPool pool, UploadManager& upload, GPUBuffer& buffer,
+                        VkBufferUsageFlags usage, VkDeviceSize used, VkDeviceSize needed) {
+    if (needed <= buffer.size) return true;
+
+    VkDeviceSize size = std::max<VkDeviceSize>(buffer.size, 1 << 16);
+    while (size < needed) size *= 2;
+
+    GPUBuffer bigger = create_buffer(ctx.allocator, size, usage, VMA_MEMORY_USAGE_GPU_ONLY, families_);
+    if (!bigger.buffer) {
+        LOG_ERROR("Geometry pool: failed to grow buffer to %llu bytes", static_cast<unsigned long long>(size));
+        return false;
+    }
+    // Queued uploads into the old buffer land first; copy_buffer waits for
+    // the graphics queue, so no frame still reads it afterwards
+    upload.wait(ctx, upload.flush(ctx));
+    if (used > 0) copy_buffer(ctx, pool, buffer, bigger, used);
+    destroy_buffer(ctx.allocator, buffer);
+    buffer = bigger;
+    return true;
+}
+
+bool GeometryPool::add(VulkanContext& ctx, VkCommandPool pool, UploadManager& upload, const MeshData& data,
+                       GPUMesh& out) {
+    VkDeviceSize vb_offset = VkDeviceSize(vertex_count_) * sizeof(Vertex);
+    VkDeviceSize ib_offset = VkDeviceSize(index_count_) * sizeof(u32);
+    VkDeviceSize vb_size   = data.vertices.size() * sizeof(Vertex);
+    VkDeviceSize ib_size   = data.indices.size() * sizeof(u32);
+
+    if (!grow(ctx, pool, upload, vertices_, VERTEX_USAGE, vb_offset, vb_offset + vb_size)) return false;
+    if (!grow(ctx, pool, upload, indices_, INDEX_USAGE, ib_offset, ib_offset + ib_size)) return false;
+
+    u64 vb_ticket = upload.upload_buffer(ctx, vertices_, data.vertices.data(), vb_size, vb_offset);
+    u64 ib_ticket = upload.upload_buffer(ctx, indices_, data.indices.data(), ib_size, ib_offset);
+    out.upload_ticket = std::max(vb_ticket, ib_ticket);
+
+    out.vertex_offset = static_cast<i32>(vertex_count_);
+    out.first_index   = index_count_;
+    out.vertex_count  = static_cast<u32>(data.vertices.size());
+    out.index_count   = static_cast<u32>(data.indices.size());
+
+    vertex_count_ += out.vertex_count;
+    index_count_  += out.index_count;
+    return true;
+}
+
+void GeometryPool::bind(VkCommandBuffer cmd) const {
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(cmd, 0, 1, &vertices_.buffer, &offset);
+    vkCmdBindIndexBuffer(cmd, indices_.buffer, 0, VK_INDEX_TYPE_UINT32);
+}
+
+} // namespace lumios
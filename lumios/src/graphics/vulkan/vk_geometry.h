@@ -0,0 +1,45 @@
+#pragma once
+
+#include "vk_common.h"
+#include <vector>
+
+namespace lumios {
+
+struct VulkanContext;
+struct MeshData;
+class UploadManager;
+
+// One device-local vertex buffer and one index buffer that every mesh is
+// suballocated from, so a whole scene draws with a single pair of binds.
+// Meshes are appended and never freed; the buffers double when full (a
+// blocking copy, meant for load time). Uploads are streamed through the
+// UploadManager, so a mesh is drawable once its upload ticket completes.
+class GeometryPool {
+public:
+    void init(VulkanContext& ctx, const UploadManager& upload, u32 vertex_capacity, u32 index_capacity);
+    void destroy(VulkanContext& ctx);
+
+    // Queues the mesh upload and fills in its ranges and ticket; out's
+    // buffers stay empty since growing the pool replaces the shared ones
+    bool add(VulkanContext& ctx, VkCommandPool pool, UploadManager& upload, const MeshData& data, GPUMesh& out);
+
+    void bind(VkCommandBuffer cmd) const;
+
+    const VkBuffer& vertex_buffer() const { return vertices_.buffer; }
+    const VkBuffer& index_buffer()  const { return indices_.buffer; }
+
+    u32 vertex_count() const { return vertex_count_; }
+    u32 index_count()  const { return index_count_; }
+
+private:
+    bool grow(VulkanContext& ctx, VkCommandPool pool, UploadManager& upload, GPUBuffer& buffer,
+              VkBufferUsageFlags usage, VkDeviceSize used, VkDeviceSize needed);
+
+    std::vector<u32> families_; // shared with the transfer queue
+    GPUBuffer vertices_;
+    GPUBuffer indices_;
+    u32 vertex_count_ = 0;
+    u32 index_count_  = 0;
+};
+
+} // namespace lumios
@@ -2,6 +2,7 @@
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
+#include <algorithm>
 #include <vector>
 #include <set>
 #include <string>
@@ -180,8 +181,22 @@ bool VulkanContext::init(GLFWwindow* window) {
         }
     }
 
+    // Uploads go to a transfer-only family (a DMA engine) if there is one,
+    // else any non-graphics family that copies, else the graphics queue.
+    // Image copies need a transfer granularity of a single texel.
+    transfer_family = graphics_family;
+    int transfer_rank = 0;
+    for (u32 i = 0; i < qf_count; i++) {
+        VkQueueFlags flags = qf[i].queueFlags;
+        VkExtent3D   g     = qf[i].minImageTransferGranularity;
+        if (!(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT)) continue;
+        if (g.width != 1 || g.height != 1 || g.depth != 1) continue;
+        int rank = (flags & VK_QUEUE_COMPUTE_BIT) ? 1 : 2;
+        if (rank > transfer_rank) { transfer_family = i; transfer_rank = rank; }
+    }
+
     // --- Logical device ---
-    std::set<u32> unique_families = {graphics_family, present_family};
+    std::set<u32> unique_families = {graphics_family, present_family, transfer_family};
     std::vector<VkDeviceQueueCreateInfo> queue_cis;
     float priority = 1.0f;
     for (u32 fam : unique_families) {
@@ -193,9 +208,61 @@ bool VulkanContext::init(GLFWwindow* window) {
         queue_cis.push_back(qci);
     }
 
-    VkPhysicalDeviceFeatures features{};
-    features.samplerAnisotropy = VK_TRUE;
-    features.fillModeNonSolid = VK_TRUE;
+    // Query optional features; the 1.2 block is only valid on 1.2+ devices
+    VkPhysicalDeviceVulkan12Features supported12{};
+    supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceFeatures2 supported{};
+    supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    bool has_vk12 = device_properties.apiVersion >= VK_API_VERSION_1_2;
+    if (has_vk12) supported.pNext = &supported12;
+    vkGetPhysicalDeviceFeatures2(physical_device, &supported);
+
+    VkPhysicalDeviceFeatures2 enabled{};
+    enabled.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    enabled.features.samplerAnisotropy         = VK_TRUE;
+    enabled.features.fillModeNonSolid          = VK_TRUE;
+    enabled.features.multiDrawIndirect         = supported.features.multiDrawIndirect;
+    enabled.features.drawIndirectFirstInstance = supported.features.drawIndirectFirstInstance;
+    enabled.features.textureCompressionBC      = supported.features.textureCompressionBC;
+
+    VkPhysicalDeviceVulkan12Features enabled12{};
+    enabled12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    if (has_vk12) {
+        enabled12.drawIndirectCount = supported12.drawIndirectCount;
+        enabled12.timelineSemaphore = supported12.timelineSemaphore;
+        if (supported12.runtimeDescriptorArray &&
+            supported12.descriptorBindingPartiallyBound &&
+            supported12.descriptorBindingSampledImageUpdateAfterBind &&
+            supported12.shaderSampledImageArrayNonUniformIndexing) {
+            enabled12.runtimeDescriptorArray                       = VK_TRUE;
+            enabled12.descriptorBindingPartiallyBound              = VK_TRUE;
+            enabled12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+            enabled12.shaderSampledImageArrayNonUniformIndexing    = VK_TRUE;
+            features.bindless = true;
+        }
+        enabled.pNext = &enabled12;
+    }
+    features.multi_draw_indirect          = enabled.features.multiDrawIndirect;
+    features.draw_indirect_first_instance = enabled.features.drawIndirectFirstInstance;
+    features.draw_indirect_count          = enabled12.drawIndirectCount;
+    features.timeline_semaphore           = enabled12.timelineSemaphore;
+    features.texture_compression_bc       = enabled.features.textureCompressionBC;
+    features.max_draw_indirect_count      = enabled.features.multiDrawIndirect
+                                          ? device_properties.limits.maxDrawIndirectCount : 1;
+
+    if (features.bindless) {
+        VkPhysicalDeviceVulkan12Properties props12{};
+        props12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+        VkPhysicalDeviceProperties2 props{};
+        props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        props.pNext = &props12;
+        vkGetPhysicalDeviceProperties2(physical_device, &props);
+        // Combined image samplers count against both the sampler and image limits
+        features.max_bindless_textures = std::min({props12.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                                                   props12.maxPerStageDescriptorUpdateAfterBindSamplers,
+                                                   props12.maxDescriptorSetUpdateAfterBindSampledImages,
+                                                   props12.maxDescriptorSetUpdateAfterBindSamplers});
+    }
 
     VkDeviceCreateInfo dci{};
     dci.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -203,13 +270,15 @@ bool VulkanContext::init(GLFWwindow* window) {
     dci.pQueueCreateInfos = queue_cis.data();
     dci.enabledExtensionCount = static_cast<u32>(DEVICE_EXTENSIONS.size());
     dci.ppEnabledExtensionNames = DEVICE_EXTENSIONS.data();
-    dci.pEnabledFeatures = &features;
+    dci.pNext = &enabled;
 
     VK_CHECK(vkCreateDevice(physical_device, &dci, nullptr, &device));
 
     vkGetDeviceQueue(device, graphics_family, 0, &graphics_queue);
     vkGetDeviceQueue(device, present_family, 0, &present_queue);
-    LOG_INFO("Logical device created");
+    vkGetDeviceQueue(device, transfer_family, 0, &transfer_queue);
+    LOG_INFO("Logical device created (multi-draw indirect: %s, bindless: %s, transfer family: %u)",
+             features.multi_draw_indirect ? "yes" : "no", features.bindless ? "yes" : "no", transfer_family);
 
     // --- VMA ---
     VmaAllocatorCreateInfo alloc_ci{};
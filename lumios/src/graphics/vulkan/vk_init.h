@@ -6,6 +6,18 @@ struct GLFWwindow;
 
 namespace lumios {
 
+// Optional device features, filled in by VulkanContext::init
+struct DeviceFeatures {
+    bool multi_draw_indirect          = false;
+    bool draw_indirect_first_instance = false;
+    bool draw_indirect_count          = false;
+    bool bindless                     = false; // descriptor indexing, update-after-bind sampler arrays
+    bool timeline_semaphore           = false;
+    bool texture_compression_bc       = false; // BC1-7 sampled images (KTX2 streaming)
+    u32  max_bindless_textures        = 0;
+    u32  max_draw_indirect_count      = 1;
+};
+
 struct VulkanContext {
     VkInstance               instance        = VK_NULL_HANDLE;
     VkDebugUtilsMessengerEXT debug_messenger = VK_NULL_HANDLE;
@@ -16,10 +28,13 @@ struct VulkanContext {
 
     VkQueue graphics_queue = VK_NULL_HANDLE;
     VkQueue present_queue  = VK_NULL_HANDLE;
+    VkQueue transfer_queue = VK_NULL_HANDLE; // the graphics queue when there is no separate family
     u32     graphics_family = 0;
     u32     present_family  = 0;
+    u32     transfer_family = 0;
 
     VkPhysicalDeviceProperties device_properties{};
+    DeviceFeatures             features;
 
     bool init(GLFWwindow* window);
     void shutdown();
@@ -0,0 +1,365 @@
+#include "vk_particles.h"
+#include "vk_init.h"
+#include "vk_pipeline.h"
+#include "vk_buffer.h"
+#include "vk_transient.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace lumios {
+
+static constexpr u32 LOCAL_SIZE = 256; // of particle.comp
+
+static u32 groups(u32 threads) { return (threads + LOCAL_SIZE - 1) / LOCAL_SIZE; }
+
+// --- Setup ---
+
+bool ParticleSystem::init(VulkanContext& ctx, PipelineRegistry& pipelines, VkRenderPass pass,
+                          const std::string& shader_dir) {
+    constexpr VkShaderStageFlags SIM_AND_DRAW = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT;
+    set_layout_ = DescriptorLayoutBuilder()
+        .add(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, SIM_AND_DRAW)
+        .add(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+        .add(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, SIM_AND_DRAW)
+        .add(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+        .add(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+        .add(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+        .build(ctx.device);
+
+    VkPushConstantRange push{};
+    push.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    push.size       = sizeof(ComputePush);
+
+    VkPipelineLayoutCreateInfo li{};
+    li.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    li.setLayoutCount         = 1;
+    li.pSetLayouts            = &set_layout_;
+    li.pushConstantRangeCount = 1;
+    li.pPushConstantRanges    = &push;
+    VK_CHECK(vkCreatePipelineLayout(ctx.device, &li, nullptr, &compute_layout_));
+
+    push.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    push.size       = sizeof(DrawPush);
+    VK_CHECK(vkCreatePipelineLayout(ctx.device, &li, nullptr, &draw_layout_));
+
+    VkDescriptorPoolSize sizes[] = {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 6 * MAX_FRAMES_IN_FLIGHT}};
+    descriptor_alloc_.init(ctx.device, MAX_FRAMES_IN_FLIGHT, std::span<VkDescriptorPoolSize>(sizes, 1));
+    for (auto& set : sets_) set = descriptor_alloc_.allocate(ctx.device, set_layout_);
+
+    counters_  = create_buffer(ctx.allocator, MAX_EMITTERS * sizeof(i32), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                               VMA_MEMORY_USAGE_GPU_ONLY);
+    draw_args_ = create_buffer(ctx.allocator, sizeof(VkDrawIndirectCommand),
+                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                               VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    if (!counters_.buffer || !draw_args_.buffer || !create_buffers(ctx, INITIAL_CAPACITY)) return false;
+    free_.push_back({0, capacity_});
+
+    compute_pipeline_ = pipelines.compute(compute_layout_, shader_dir + "/particle.comp.spv");
+    VkShaderModule vert = pipelines.shader(shader_dir + "/particle.vert.spv");
+    VkShaderModule frag = pipelines.shader(shader_dir + "/particle.frag.spv");
+    if (!compute_pipeline_ || !vert || !frag) return false;
+
+    // Tested against the scene's depth without writing it; additive, so
+    // the alive list needs no sorting
+    PipelineBuilder builder;
+    builder.set_shaders(vert, frag)
+           .set_cull_mode(VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE)
+           .enable_depth_test(false, VK_COMPARE_OP_LESS_OR_EQUAL)
+           .enable_blending_additive()
+           .set_layout(draw_layout_);
+    draw_pipeline_ = pipelines.graphics(builder, pass);
+    if (!draw_pipeline_) return false;
+
+    last_update_ = std::chrono::steady_clock::now();
+    LOG_INFO("Particles: %u slots, up to %u emitters", capacity_, MAX_EMITTERS);
+    return true;
+}
+
+bool ParticleSystem::create_buffers(VulkanContext& ctx, u32 capacity) {
+    particles_ = create_buffer(ctx.allocator, VkDeviceSize(capacity) * sizeof(GPUParticle),
+                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    dead_      = create_buffer(ctx.allocator, VkDeviceSize(capacity) * sizeof(u32),
+                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    alive_     = create_buffer(ctx.allocator, VkDeviceSize(capacity) * sizeof(u32),
+                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    if (!particles_.buffer || !dead_.buffer || !alive_.buffer) {
+        LOG_ERROR("Particles: failed to allocate %u slots", capacity);
+        destroy_buffers(ctx);
+        return false;
+    }
+    capacity_ = capacity;
+    write_sets(ctx);
+    return true;
+}
+
+void ParticleSystem::destroy_buffers(VulkanContext& ctx) {
+    destroy_buffer(ctx.allocator, particles_);
+    destroy_buffer(ctx.allocator, dead_);
+    destroy_buffer(ctx.allocator, alive_);
+    capacity_ = 0;
+}
+
+// Everything but the emitter table, written by record() for its frame
+void ParticleSystem::write_sets(VulkanContext& ctx) {
+    for (auto set : sets_) {
+        DescriptorWriter writer;
+        writer.write_buffer(0, particles_.buffer, VK_WHOLE_SIZE, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+              .write_buffer(1, dead_.buffer, VK_WHOLE_SIZE, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+              .write_buffer(2, alive_.buffer, VK_WHOLE_SIZE, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+              .write_buffer(3, counters_.buffer, VK_WHOLE_SIZE, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+              .write_buffer(4, draw_args_.buffer, VK_WHOLE_SIZE, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+        writer.update(ctx.device, set);
+    }
+}
+
+void ParticleSystem::destroy(VulkanContext& ctx) {
+    destroy_buffers(ctx);
+    destroy_buffer(ctx.allocator, counters_);
+    destroy_buffer(ctx.allocator, draw_args_);
+    descriptor_alloc_.destroy(ctx.device);
+    for (auto& set : sets_) set = VK_NULL_HANDLE;
+    compute_pipeline_ = VK_NULL_HANDLE;
+    draw_pipeline_    = VK_NULL_HANDLE;
+    if (compute_layout_) { vkDestroyPipelineLayout(ctx.device, compute_layout_, nullptr); compute_layout_ = VK_NULL_HANDLE; }
+    if (draw_layout_)    { vkDestroyPipelineLayout(ctx.device, draw_layout_, nullptr); draw_layout_ = VK_NULL_HANDLE; }
+    if (set_layout_)     { vkDestroyDescriptorSetLayout(ctx.device, set_layout_, nullptr); set_layout_ = VK_NULL_HANDLE; }
+    pools_.clear();
+    pool_of_.clear();
+    free_.clear();
+    gpu_emitters_.clear();
+}
+
+// --- Pools ---
+
+bool ParticleSystem::allocate(Pool& pool) {
+    for (size_t i = 0; i < free_.size(); i++) {
+        Range& r = free_[i];
+        if (r.count < pool.capacity) continue;
+        pool.first = r.first;
+        r.first += pool.capacity;
+        r.count -= pool.capacity;
+        if (r.count == 0) free_.erase(free_.begin() + static_cast<std::ptrdiff_t>(i));
+        pool.placed = true;
+        pool.reset  = true;
+        return true;
+    }
+    return false;
+}
+
+// Back onto the free list, merged with its neighbours
+void ParticleSystem::release(Pool& pool) {
+    if (!pool.placed) return;
+    pool.placed = false;
+    Range range{pool.first, pool.capacity};
+    auto it = std::lower_bound(free_.begin(), free_.end(), range,
+                               [](const Range& a, const Range& b) { return a.first < b.first; });
+    it = free_.insert(it, range);
+    if (it + 1 != free_.end() && it->first + it->count == (it + 1)->first) {
+        it->count += (it + 1)->count;
+        free_.erase(it + 1);
+    }
+    if (it != free_.begin() && (it - 1)->first + (it - 1)->count == it->first) {
+        (it - 1)->count += it->count;
+        free_.erase(it);
+    }
+}
+
+// Every live pool from the start of the buffer, in pool order. Their
+// particles are dropped, since the slots move.
+void ParticleSystem::repack(VulkanContext& ctx) {
+    u64 needed = 0;
+    for (auto& pool : pools_)
+        if (pool.id != UINT32_MAX) needed += pool.capacity;
+
+    if (needed > capacity_) {
+        u32 capacity = std::max(capacity_, INITIAL_CAPACITY);
+        while (capacity < needed) capacity *= 2;
+        vkDeviceWaitIdle(ctx.device);
+        destroy_buffers(ctx);
+        if (!create_buffers(ctx, capacity) && !create_buffers(ctx, INITIAL_CAPACITY)) {
+            // Out of memory either way; drop every emitter until the next update
+            for (auto& pool : pools_) pool.placed = false;
+            free_.clear();
+            return;
+        }
+        LOG_INFO("Particles: grown to %u slots", capacity_);
+    }
+
+    free_.assign(1, Range{0, capacity_});
+    for (auto& pool : pools_) {
+        pool.placed = false;
+        if (pool.id != UINT32_MAX) allocate(pool);
+    }
+}
+
+void ParticleSystem::update(VulkanContext& ctx, const std::vector<Emitter>& emitters) {
+    auto now = std::chrono::steady_clock::now();
+    step_ = std::min(std::chrono::duration<float>(now - last_update_).count(), MAX_STEP);
+    last_update_ = now;
+
+    // Match emitters to pools; a changed size means a new pool
+    for (auto& pool : pools_) pool.seen = false;
+    for (const Emitter& e : emitters) {
+        auto it = pool_of_.find(e.id);
+        u32 index;
+        if (it != pool_of_.end()) {
+            index = it->second;
+        } else {
+            auto unused = std::find_if(pools_.begin(), pools_.end(), [](const Pool& p) { return p.id == UINT32_MAX; });
+            if (unused != pools_.end()) {
+                index = static_cast<u32>(unused - pools_.begin());
+            } else if (pools_.size() < MAX_EMITTERS) {
+                index = static_cast<u32>(pools_.size());
+                pools_.emplace_back();
+            } else {
+                if (!warned_) LOG_WARN("Particles: more than %u emitters, the rest are skipped", MAX_EMITTERS);
+                warned_ = true;
+                continue;
+            }
+            pools_[index].id      = e.id;
+            pools_[index].pending = 0.0f;
+            pool_of_[e.id] = index;
+        }
+
+        Pool& pool = pools_[index];
+        u32 capacity = std::max(e.settings->max_particles, 1u);
+        if (pool.capacity != capacity) {
+            release(pool);
+            pool.capacity = capacity;
+        }
+        pool.seen     = true;
+        pool.origin   = e.origin;
+        pool.settings = *e.settings;
+    }
+
+    // Emitters gone give their pools back
+    for (auto& pool : pools_) {
+        if (pool.id == UINT32_MAX || pool.seen) continue;
+        release(pool);
+        pool_of_.erase(pool.id);
+        pool.id = UINT32_MAX;
+    }
+
+    bool packed = true;
+    for (auto& pool : pools_)
+        if (pool.id != UINT32_MAX && !pool.placed) packed &= allocate(pool);
+    if (!packed) repack(ctx);
+
+    // Emitter table in pool order, with each one's first thread of both steps
+    gpu_emitters_.clear();
+    sim_threads_  = 0;
+    emit_threads_ = 0;
+    for (u32 i = 0; i < pools_.size(); i++) {
+        Pool& pool = pools_[i];
+        if (pool.id == UINT32_MAX || !pool.placed) continue;
+        const ParticleEmitterComponent& s = pool.settings;
+
+        pool.pending += std::max(s.emit_rate, 0.0f) * step_;
+        u32 emit = static_cast<u32>(std::floor(pool.pending));
+        pool.pending -= static_cast<float>(emit);
+        emit = std::min(emit, pool.capacity);
+
+        GPUEmitter g{};
+        g.origin       = glm::vec4(pool.origin, std::max(s.lifetime, 0.001f));
+        g.velocity_min = glm::vec4(s.velocity_min, s.size_start);
+        g.velocity_max = glm::vec4(s.velocity_max, s.size_end);
+        g.color_start  = s.color_start;
+        g.color_end    = s.color_end;
+        g.gravity      = glm::vec4(s.gravity, 0.0f);
+        g.first        = pool.first;
+        g.capacity     = pool.capacity;
+        g.sim_first    = sim_threads_;
+        g.emit_first   = emit_threads_;
+        g.emit_count   = emit;
+        g.pool         = i;
+        g.reset        = pool.reset ? 1u : 0u;
+        g.seed         = seed_ * 0x9e3779b9u + i;
+        gpu_emitters_.push_back(g);
+
+        sim_threads_  += pool.capacity;
+        emit_threads_ += emit;
+    }
+    seed_++;
+}
+
+// --- Recording ---
+
+void ParticleSystem::record(VulkanContext& ctx, VkCommandBuffer cmd, u32 frame, TransientAllocator& transient) {
+    recorded_ = false;
+    if (!compute_pipeline_ || gpu_emitters_.empty()) return;
+
+    // The table is sized by this frame, so the slot's set is pointed at it
+    // anew; its last use has completed
+    auto table = transient.push(gpu_emitters_.data(), gpu_emitters_.size() * sizeof(GPUEmitter));
+    if (!table.data) return;
+    DescriptorWriter writer;
+    writer.write_buffer(5, transient.buffer(), table.size, table.offset, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+    writer.update(ctx.device, sets_[frame]);
+    current_set_ = frame;
+
+    // The previous frame's steps and draw are done with the buffers
+    VkMemoryBarrier barrier{};
+    barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                         VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    VkDrawIndirectCommand args{6, 0, 0, 0};
+    vkCmdUpdateBuffer(cmd, draw_args_.buffer, 0, sizeof(args), &args);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, compute_pipeline_);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, compute_layout_, 0, 1, &sets_[frame], 0, nullptr);
+
+    ComputePush pc{step_, 0, emitters(), sim_threads_};
+    vkCmdPushConstants(cmd, compute_layout_, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pc), &pc);
+    vkCmdDispatch(cmd, groups(sim_threads_), 1, 1);
+
+    // Dead lists complete before anything is taken off them
+    if (emit_threads_ > 0) {
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+        pc.mode         = 1;
+        pc.thread_count = emit_threads_;
+        vkCmdPushConstants(cmd, compute_layout_, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pc), &pc);
+        vkCmdDispatch(cmd, groups(emit_threads_), 1, 1);
+    }
+
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    // Reset pools start out empty from now on
+    for (auto& pool : pools_) pool.reset = false;
+    recorded_ = true;
+}
+
+void ParticleSystem::draw(VkCommandBuffer cmd, const glm::mat4& view, const glm::mat4& projection) {
+    if (!recorded_ || !draw_pipeline_) return;
+
+    DrawPush pc{};
+    pc.view_projection = projection * view;
+    pc.camera_right    = glm::vec4(view[0][0], view[1][0], view[2][0], 0.0f);
+    pc.camera_up       = glm::vec4(view[0][1], view[1][1], view[2][1], 0.0f);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, draw_pipeline_);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, draw_layout_, 0, 1, &sets_[current_set_],
+                            0, nullptr);
+    vkCmdPushConstants(cmd, draw_layout_, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pc), &pc);
+    vkCmdDrawIndirect(cmd, draw_args_.buffer, 0, 1, sizeof(VkDrawIndirectCommand));
+}
+
+} // namespace lumios
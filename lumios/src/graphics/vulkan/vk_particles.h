@@ -0,0 +1,131 @@
+#pragma once
+
+#include "vk_common.h"
+#include "vk_descriptors.h"
+#include "../gpu_types.h"
+#include "../../scene/components.h"
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lumios {
+
+struct VulkanContext;
+class PipelineRegistry;
+class TransientAllocator;
+
+// GPU particles of every ParticleEmitterComponent. Each emitter owns a pool
+// of max_particles slots in one particle buffer, with a dead list of free
+// slots over the same range. particle.comp runs two dispatches a frame,
+// each over all emitters at once: one steps every slot and rebuilds the
+// alive list, one spawns the frame's particles off the dead lists. The
+// alive list is drawn as billboards with a single indirect draw, so the
+// CPU cost is per emitter, not per particle.
+//
+// Pools are first-fit ranges of the buffer. When no range fits, every
+// pool is packed again from the start, growing the buffers if needed;
+// repacked pools restart empty.
+class ParticleSystem {
+public:
+    static constexpr u32   MAX_EMITTERS     = 256;
+    static constexpr u32   INITIAL_CAPACITY = 1u << 16; // particle slots
+    static constexpr float MAX_STEP         = 0.1f;     // seconds simulated per frame at most
+
+    // A live emitter of this frame
+    struct Emitter {
+        u32                             id; // stable while the emitter lives, such as its entity
+        glm::vec3                       origin;
+        const ParticleEmitterComponent* settings;
+    };
+
+    // The draw pipeline is built against pass; both pipelines come from,
+    // and stay owned by, the registry
+    bool init(VulkanContext& ctx, PipelineRegistry& pipelines, VkRenderPass pass, const std::string& shader_dir);
+    void destroy(VulkanContext& ctx);
+
+    // Gives new emitters pools, frees those of emitters gone and counts
+    // what each spawns over the time since the last call. Growing the
+    // buffers idles the device, so this goes before anything of the frame
+    // is recorded.
+    void update(VulkanContext& ctx, const std::vector<Emitter>& emitters);
+
+    // Outside a render pass. Pushes the emitter table, simulates and spawns;
+    // the alive list and draw arguments are left visible to draw().
+    void record(VulkanContext& ctx, VkCommandBuffer cmd, u32 frame, TransientAllocator& transient);
+
+    // Inside the main pass, additively blended over what is there
+    void draw(VkCommandBuffer cmd, const glm::mat4& view, const glm::mat4& projection);
+
+    bool ready()    const { return draw_pipeline_ != VK_NULL_HANDLE; }
+    u32  emitters() const { return static_cast<u32>(gpu_emitters_.size()); }
+    u32  slots()    const { return sim_threads_; } // of the emitters of this frame
+
+private:
+    struct Pool {
+        u32                      id = UINT32_MAX; // UINT32_MAX when unused
+        u32                      first = 0, capacity = 0;
+        bool                     placed = false;  // owns [first, first + capacity)
+        bool                     reset  = false;  // placed since the last record()
+        bool                     seen   = false;  // by this update()
+        float                    pending = 0.0f;  // fraction of a particle carried to the next frame
+        glm::vec3                origin{0.0f};
+        ParticleEmitterComponent settings;
+    };
+
+    struct Range {
+        u32 first, count;
+    };
+
+    struct ComputePush {
+        float delta_time;
+        u32   mode;          // 0 simulate, 1 emit
+        u32   emitter_count;
+        u32   thread_count;
+    };
+
+    struct DrawPush {
+        glm::mat4 view_projection;
+        glm::vec4 camera_right;
+        glm::vec4 camera_up;
+    };
+
+    bool create_buffers(VulkanContext& ctx, u32 capacity);
+    void destroy_buffers(VulkanContext& ctx);
+    void write_sets(VulkanContext& ctx);
+    bool allocate(Pool& pool);
+    void release(Pool& pool);
+    void repack(VulkanContext& ctx);
+
+    GPUBuffer             particles_;  // GPUParticle per slot
+    GPUBuffer             dead_;       // free slots of each pool
+    GPUBuffer             alive_;      // slots to draw this frame
+    GPUBuffer             counters_;   // dead list size per pool
+    GPUBuffer             draw_args_;  // VkDrawIndirectCommand, instances counted by particle.comp
+    u32                   capacity_ = 0;
+
+    VkDescriptorSetLayout set_layout_       = VK_NULL_HANDLE;
+    VkPipelineLayout      compute_layout_   = VK_NULL_HANDLE;
+    VkPipelineLayout      draw_layout_      = VK_NULL_HANDLE;
+    VkPipeline            compute_pipeline_ = VK_NULL_HANDLE;
+    VkPipeline            draw_pipeline_    = VK_NULL_HANDLE;
+    DescriptorAllocator   descriptor_alloc_;
+    VkDescriptorSet       sets_[MAX_FRAMES_IN_FLIGHT] = {}; // per frame slot, for the emitter table
+
+    std::vector<Pool>                 pools_;   // index = counter slot
+    std::unordered_map<u32, u32>      pool_of_; // emitter id -> pool
+    std::vector<Range>                free_;    // sorted by first
+    std::vector<GPUEmitter>           gpu_emitters_;
+    u32                               sim_threads_  = 0;
+    u32                               emit_threads_ = 0;
+    float                             step_         = 0.0f;
+    u32                               seed_         = 0;
+    bool                              warned_       = false; // about emitters past MAX_EMITTERS
+    std::chrono::steady_clock::time_point last_update_{};
+
+    // Of the record() in progress, for draw()
+    u32  current_set_ = 0;
+    bool recorded_    = false;
+};
+
+} // namespace lumios
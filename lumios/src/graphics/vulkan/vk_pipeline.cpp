@@ -1,5 +1,9 @@
 #include "vk_pipeline.h"
+#include "vk_init.h"
 #include "../../graphics/gpu_types.h"
+#include "../../core/hash.h"
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 
 namespace lumios {
@@ -129,6 +133,17 @@ PipelineBuilder& PipelineBuilder::enable_blending_alpha() {
     return *this;
 }
 
+PipelineBuilder& PipelineBuilder::enable_blending_additive() {
+    blend_attachment_.blendEnable         = VK_TRUE;
+    blend_attachment_.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    blend_attachment_.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    blend_attachment_.colorBlendOp        = VK_BLEND_OP_ADD;
+    blend_attachment_.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    blend_attachment_.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    blend_attachment_.alphaBlendOp        = VK_BLEND_OP_ADD;
+    return *this;
+}
+
 PipelineBuilder& PipelineBuilder::disable_blending() {
     blend_attachment_.blendEnable = VK_FALSE;
     return *this;
@@ -139,7 +154,62 @@ PipelineBuilder& PipelineBuilder::set_layout(VkPipelineLayout layout) {
     return *this;
 }
 
-VkPipeline PipelineBuilder::build(VkDevice device, VkRenderPass pass) {
+PipelineBuilder& PipelineBuilder::depth_only() {
+    color_output_ = false;
+    return *this;
+}
+
+PipelineBuilder& PipelineBuilder::set_depth_bias(float constant, float slope) {
+    rasterizer_.depthBiasEnable         = VK_TRUE;
+    rasterizer_.depthBiasConstantFactor = constant;
+    rasterizer_.depthBiasSlopeFactor    = slope;
+    return *this;
+}
+
+u64 PipelineBuilder::hash(VkRenderPass pass) const {
+    ByteHash h;
+    for (auto& st : shader_stages_) {
+        h.add(st.stage);
+        h.add(st.module);
+    }
+    for (auto& b : bindings_) {
+        h.add(b.binding);
+        h.add(b.stride);
+        h.add(b.inputRate);
+    }
+    for (auto& a : attributes_) {
+        h.add(a.location);
+        h.add(a.binding);
+        h.add(a.format);
+        h.add(a.offset);
+    }
+    h.add(input_assembly_.topology);
+    h.add(rasterizer_.polygonMode);
+    h.add(rasterizer_.cullMode);
+    h.add(rasterizer_.frontFace);
+    h.add(rasterizer_.lineWidth);
+    h.add(rasterizer_.depthBiasEnable);
+    h.add(rasterizer_.depthBiasConstantFactor);
+    h.add(rasterizer_.depthBiasSlopeFactor);
+    h.add(multisampling_.rasterizationSamples);
+    h.add(depth_stencil_.depthTestEnable);
+    h.add(depth_stencil_.depthWriteEnable);
+    h.add(depth_stencil_.depthCompareOp);
+    h.add(blend_attachment_.blendEnable);
+    h.add(blend_attachment_.srcColorBlendFactor);
+    h.add(blend_attachment_.dstColorBlendFactor);
+    h.add(blend_attachment_.colorBlendOp);
+    h.add(blend_attachment_.srcAlphaBlendFactor);
+    h.add(blend_attachment_.dstAlphaBlendFactor);
+    h.add(blend_attachment_.alphaBlendOp);
+    h.add(blend_attachment_.colorWriteMask);
+    h.add(color_output_);
+    h.add(layout_);
+    h.add(pass);
+    return h.value;
+}
+
+VkPipeline PipelineBuilder::build(VkDevice device, VkRenderPass pass, VkPipelineCache cache) const {
     VkPipelineViewportStateCreateInfo viewport_state{};
     viewport_state.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
     viewport_state.viewportCount = 1;
@@ -147,8 +217,8 @@ VkPipeline PipelineBuilder::build(VkDevice device, VkRenderPass pass) {
 
     VkPipelineColorBlendStateCreateInfo blend{};
     blend.sType           = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    blend.attachmentCount = 1;
-    blend.pAttachments    = &blend_attachment_;
+    blend.attachmentCount = color_output_ ? 1 : 0;
+    blend.pAttachments    = color_output_ ? &blend_attachment_ : nullptr;
 
     std::vector<VkDynamicState> dynamics = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
     VkPipelineDynamicStateCreateInfo dyn{};
@@ -172,9 +242,156 @@ VkPipeline PipelineBuilder::build(VkDevice device, VkRenderPass pass) {
     ci.renderPass          = pass;
     ci.subpass             = 0;
 
-    VkPipeline pipeline;
-    VK_CHECK(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &ci, nullptr, &pipeline));
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VK_CHECK(vkCreateGraphicsPipelines(device, cache, 1, &ci, nullptr, &pipeline));
     return pipeline;
 }
 
+// --- Pipeline registry ---
+
+// The header every VkPipelineCache blob starts with
+// (VkPipelineCacheHeaderVersionOne); data written by a different device or
+// driver build would be rejected or, on some drivers, misread
+static bool cache_matches(const std::vector<u8>& data, const VkPhysicalDeviceProperties& props) {
+    constexpr size_t HEADER_SIZE = 16 + VK_UUID_SIZE;
+    if (data.size() < HEADER_SIZE) return false;
+
+    u32 header[4];
+    std::memcpy(header, data.data(), sizeof(header));
+    return header[0] >= HEADER_SIZE &&
+           header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           header[2] == props.vendorID &&
+           header[3] == props.deviceID &&
+           std::memcmp(data.data() + 16, props.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+bool PipelineRegistry::init(VulkanContext& ctx, const std::string& cache_path) {
+    device_     = ctx.device;
+    cache_path_ = cache_path;
+    properties_ = ctx.device_properties;
+
+    std::vector<u8> data;
+    std::ifstream file(cache_path, std::ios::ate | std::ios::binary);
+    if (file.is_open()) {
+        data.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        if (!file || !cache_matches(data, properties_)) {
+            LOG_INFO("Pipeline cache %s is stale, starting empty", cache_path.c_str());
+            data.clear();
+        }
+    }
+
+    VkPipelineCacheCreateInfo ci{};
+    ci.sType           = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    ci.initialDataSize = data.size();
+    ci.pInitialData    = data.empty() ? nullptr : data.data();
+    if (vkCreatePipelineCache(device_, &ci, nullptr, &cache_) != VK_SUCCESS && !data.empty()) {
+        LOG_WARN("Pipeline cache %s rejected by the driver, starting empty", cache_path.c_str());
+        ci.initialDataSize = 0;
+        ci.pInitialData    = nullptr;
+        VK_CHECK(vkCreatePipelineCache(device_, &ci, nullptr, &cache_));
+    }
+    if (!cache_) return false;
+
+    if (!data.empty()) LOG_INFO("Pipeline cache loaded (%zu KB)", data.size() / 1024);
+    return true;
+}
+
+void PipelineRegistry::destroy(VulkanContext& ctx) {
+    if (!cache_) return;
+    save();
+
+    for (auto& [key, e] : pipelines_) vkDestroyPipeline(ctx.device, e.pipeline, nullptr);
+    pipelines_.clear();
+    for (auto& [path, mod] : shaders_) vkDestroyShaderModule(ctx.device, mod, nullptr);
+    shaders_.clear();
+
+    vkDestroyPipelineCache(ctx.device, cache_, nullptr);
+    cache_  = VK_NULL_HANDLE;
+    device_ = VK_NULL_HANDLE;
+}
+
+VkShaderModule PipelineRegistry::shader(const std::string& path) {
+    auto it = shaders_.find(path);
+    if (it != shaders_.end()) return it->second;
+
+    VkShaderModule mod = load_shader_module(device_, path);
+    if (mod) shaders_.emplace(path, mod);
+    return mod;
+}
+
+VkPipeline PipelineRegistry::graphics(const PipelineBuilder& builder, VkRenderPass pass) {
+    u64 key = builder.hash(pass);
+    auto it = pipelines_.find(key);
+    if (it != pipelines_.end()) return it->second.pipeline;
+
+    VkPipeline pipeline = builder.build(device_, pass, cache_);
+    if (pipeline) pipelines_.emplace(key, Entry{pipeline, builder.layout()});
+    return pipeline;
+}
+
+VkPipeline PipelineRegistry::compute(VkPipelineLayout layout, const std::string& path) {
+    ByteHash h;
+    h.add(VK_SHADER_STAGE_COMPUTE_BIT);
+    h.add(path);
+    h.add(layout);
+    auto it = pipelines_.find(h.value);
+    if (it != pipelines_.end()) return it->second.pipeline;
+
+    VkShaderModule mod = shader(path);
+    if (!mod) return VK_NULL_HANDLE;
+
+    VkComputePipelineCreateInfo ci{};
+    ci.sType        = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    ci.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    ci.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+    ci.stage.module = mod;
+    ci.stage.pName  = "main";
+    ci.layout       = layout;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VK_CHECK(vkCreateComputePipelines(device_, cache_, 1, &ci, nullptr, &pipeline));
+    if (pipeline) pipelines_.emplace(h.value, Entry{pipeline, layout});
+    return pipeline;
+}
+
+void PipelineRegistry::release(VkPipelineLayout layout) {
+    for (auto it = pipelines_.begin(); it != pipelines_.end();) {
+        if (it->second.layout == layout) {
+            vkDestroyPipeline(device_, it->second.pipeline, nullptr);
+            it = pipelines_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool PipelineRegistry::save() const {
+    if (!cache_ || cache_path_.empty()) return false;
+
+    size_t size = 0;
+    if (vkGetPipelineCacheData(device_, cache_, &size, nullptr) != VK_SUCCESS || size == 0) return false;
+    std::vector<u8> data(size);
+    if (vkGetPipelineCacheData(device_, cache_, &size, data.data()) != VK_SUCCESS) return false;
+
+    // Written beside the target and renamed over it, so a crash mid-write
+    // never leaves a truncated cache behind
+    std::string tmp = cache_path_ + ".tmp";
+    {
+        std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+        if (!file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(size))) {
+            LOG_WARN("Failed to write pipeline cache %s", tmp.c_str());
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, cache_path_, ec);
+    if (ec) {
+        LOG_WARN("Failed to replace pipeline cache %s: %s", cache_path_.c_str(), ec.message().c_str());
+        return false;
+    }
+    return true;
+}
+
 } // namespace lumios
@@ -3,9 +3,12 @@
 #include "vk_common.h"
 #include <vector>
 #include <string>
+#include <unordered_map>
 
 namespace lumios {
 
+struct VulkanContext;
+
 VkShaderModule load_shader_module(VkDevice device, const std::string& path);
 
 class PipelineBuilder {
@@ -17,6 +20,7 @@ class PipelineBuilder {
     VkPipelineDepthStencilStateCreateInfo           depth_stencil_{};
     VkPipelineColorBlendAttachmentState             blend_attachment_{};
     VkPipelineLayout                                layout_ = VK_NULL_HANDLE;
+    bool                                            color_output_ = true;
 
     std::vector<VkVertexInputBindingDescription>    bindings_;
     std::vector<VkVertexInputAttributeDescription>  attributes_;
@@ -31,10 +35,65 @@ public:
     PipelineBuilder& set_cull_mode(VkCullModeFlags cull, VkFrontFace front);
     PipelineBuilder& enable_depth_test(bool write, VkCompareOp op);
     PipelineBuilder& enable_blending_alpha();
+    // dst + src, for accumulating light
+    PipelineBuilder& enable_blending_additive();
     PipelineBuilder& disable_blending();
     PipelineBuilder& set_layout(VkPipelineLayout layout);
+    // For render passes without color attachments, such as shadow maps
+    PipelineBuilder& depth_only();
+    // Depth bias in the rasterizer; slope is scaled by the depth slope of the triangle
+    PipelineBuilder& set_depth_bias(float constant, float slope);
+
+    // Hash of everything build() reads, shader modules and layout by handle
+    u64 hash(VkRenderPass pass) const;
+    VkPipelineLayout layout() const { return layout_; }
+
+    VkPipeline build(VkDevice device, VkRenderPass pass, VkPipelineCache cache = VK_NULL_HANDLE) const;
+};
+
+// Owns the shader modules and pipelines of one device, so each SPIR-V file
+// is read once and each distinct pipeline is compiled once. Pipelines are
+// found by PipelineBuilder::hash(); new ones are compiled through a
+// VkPipelineCache that is loaded from cache_path at init and written back
+// at destroy, so later runs skip most of the driver's compile work. The
+// file is ignored when it was written by another device or driver; an
+// empty cache_path keeps the cache in memory only.
+//
+// Returned modules and pipelines belong to the registry; callers must not
+// destroy them. A consumer that destroys a pipeline layout calls release()
+// with it first.
+class PipelineRegistry {
+public:
+    bool init(VulkanContext& ctx, const std::string& cache_path);
+    void destroy(VulkanContext& ctx);
+
+    // The module for the SPIR-V file at path, VK_NULL_HANDLE if missing
+    VkShaderModule shader(const std::string& path);
+
+    VkPipeline graphics(const PipelineBuilder& builder, VkRenderPass pass);
+    VkPipeline compute(VkPipelineLayout layout, const std::string& path);
+
+    // Destroys every pipeline built with layout
+    void release(VkPipelineLayout layout);
+
+    // Writes the pipeline cache to cache_path; also done by destroy()
+    bool save() const;
+
+    VkPipelineCache cache() const { return cache_; }
+
+private:
+    struct Entry {
+        VkPipeline       pipeline;
+        VkPipelineLayout layout;
+    };
+
+    VkDevice        device_ = VK_NULL_HANDLE;
+    VkPipelineCache cache_  = VK_NULL_HANDLE;
+    std::string     cache_path_;
+    VkPhysicalDeviceProperties properties_{};
 
-    VkPipeline build(VkDevice device, VkRenderPass pass);
+    std::unordered_map<std::string, VkShaderModule> shaders_;
+    std::unordered_map<u64, Entry>                  pipelines_;
 };
 
 } // namespace lumios
@@ -0,0 +1,288 @@
+#include "vk_post_process.h"
+#include "vk_init.h"
+#include "vk_pipeline.h"
+#include "vk_buffer.h"
+#include <algorithm>
+#include <random>
+
+namespace lumios {
+
+static constexpr u32 KERNEL_CAPACITY = 64; // samples[] of ssao.frag
+static constexpr u32 PUSH_SIZE       = 32; // largest push block of the post shaders
+static_assert(PostProcess::SSAO_SAMPLES <= KERNEL_CAPACITY);
+
+struct SSAOPush {
+    glm::vec4 projection; // P[0][0], P[1][1], P[2][2], P[3][2]
+    float     radius;
+    float     bias;
+    i32       kernel_size;
+};
+
+struct TonemapPush {
+    float     exposure;
+    float     bloom_strength;
+    float     ao_strength;
+    float     gamma;
+    glm::vec2 depth_params; // P[2][2], P[3][2]
+};
+
+static_assert(sizeof(SSAOPush) <= PUSH_SIZE && sizeof(TonemapPush) <= PUSH_SIZE);
+
+static bool is_srgb(VkFormat format) {
+    return format == VK_FORMAT_B8G8R8A8_SRGB || format == VK_FORMAT_R8G8B8A8_SRGB ||
+           format == VK_FORMAT_A8B8G8R8_SRGB_PACK32;
+}
+
+static VkExtent2D scaled(VkExtent2D extent, u32 divisor) {
+    return {std::max(extent.width / divisor, 1u), std::max(extent.height / divisor, 1u)};
+}
+
+static VkSampler create_clamp_sampler(VulkanContext& ctx, VkFilter filter) {
+    VkSamplerCreateInfo si{};
+    si.sType        = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    si.magFilter    = filter;
+    si.minFilter    = filter;
+    si.mipmapMode   = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    si.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    si.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    si.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+
+    VkSampler sampler = VK_NULL_HANDLE;
+    VK_CHECK(vkCreateSampler(ctx.device, &si, nullptr, &sampler));
+    return sampler;
+}
+
+// --- Setup ---
+
+bool PostProcess::init(VulkanContext& ctx, PipelineRegistry& pipelines, RenderGraph& graph,
+                       const std::string& shader_dir, VkFormat output_format, u32 frames) {
+    device_ = ctx.device;
+    gamma_  = is_srgb(output_format) ? 1.0f : 1.0f / 2.2f;
+    linear_  = create_clamp_sampler(ctx, VK_FILTER_LINEAR);
+    nearest_ = create_clamp_sampler(ctx, VK_FILTER_NEAREST);
+
+    // Hemisphere around +Z, scaled so samples gather near the center; the
+    // seed is fixed so the occlusion looks the same every run
+    std::vector<glm::vec4> kernel(KERNEL_CAPACITY, glm::vec4(0.0f));
+    std::mt19937 rng(0x55a0u);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (u32 i = 0; i < SSAO_SAMPLES; i++) {
+        glm::vec3 s = glm::normalize(glm::vec3(unit(rng) * 2.0f - 1.0f, unit(rng) * 2.0f - 1.0f,
+                                               std::max(unit(rng), 0.05f)));
+        float scale = static_cast<float>(i) / static_cast<float>(SSAO_SAMPLES);
+        kernel[i] = glm::vec4(s * unit(rng) * (0.1f + 0.9f * scale * scale), 0.0f);
+    }
+    VkDeviceSize kernel_size = kernel.size() * sizeof(glm::vec4);
+    kernel_ = create_buffer(ctx.allocator, kernel_size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                            VMA_MEMORY_USAGE_CPU_TO_GPU);
+    upload_buffer_data(ctx.allocator, kernel_, kernel.data(), kernel_size);
+
+    // One layout for every pass: up to four inputs and the kernel
+    set_layout_ = DescriptorLayoutBuilder()
+        .add(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+        .add(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+        .add(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+        .add(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+        .add(4, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+        .build(ctx.device);
+
+    VkPushConstantRange push{};
+    push.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    push.size       = PUSH_SIZE;
+
+    VkPipelineLayoutCreateInfo li{};
+    li.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    li.setLayoutCount         = 1;
+    li.pSetLayouts            = &set_layout_;
+    li.pushConstantRangeCount = 1;
+    li.pPushConstantRanges    = &push;
+    VK_CHECK(vkCreatePipelineLayout(ctx.device, &li, nullptr, &layout_));
+
+    u32 set_count = frames * SET_COUNT;
+    VkDescriptorPoolSize sizes[] = {
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, set_count * MAX_INPUTS},
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, set_count},
+    };
+    descriptor_alloc_.init(ctx.device, set_count, std::span<VkDescriptorPoolSize>(sizes, 2));
+    sets_.resize(frames);
+    for (auto& frame : sets_) {
+        for (auto& bound : frame) {
+            bound.set = descriptor_alloc_.allocate(ctx.device, set_layout_);
+            DescriptorWriter()
+                .write_buffer(4, kernel_.buffer, kernel_size, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+                .update(ctx.device, bound.set);
+        }
+    }
+
+    VkShaderModule vert = pipelines.shader(shader_dir + "/tonemap.vert.spv");
+    if (!vert) return false;
+
+    // The fullscreen triangle winds clockwise under a positive viewport
+    auto build = [&](const char* frag_name, VkRenderPass pass, bool additive) -> VkPipeline {
+        VkShaderModule frag = pipelines.shader(shader_dir + "/" + frag_name);
+        if (!frag || !pass) return VK_NULL_HANDLE;
+        PipelineBuilder builder;
+        builder.set_shaders(vert, frag)
+               .set_cull_mode(VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE)
+               .set_layout(layout_);
+        if (additive) builder.enable_blending_additive();
+        return pipelines.graphics(builder, pass);
+    };
+
+    VkRenderPass ao_pass     = graph.compatible_pass(ctx, {AO_FORMAT});
+    VkRenderPass hdr_pass    = graph.compatible_pass(ctx, {HDR_FORMAT});
+    VkRenderPass output_pass = graph.compatible_pass(ctx, {output_format});
+    ssao_pipeline_      = build("ssao.frag.spv", ao_pass, false);
+    ssao_blur_pipeline_ = build("ssao_blur.frag.spv", ao_pass, false);
+    threshold_pipeline_ = build("bloom_threshold.frag.spv", hdr_pass, false);
+    down_pipeline_      = build("bloom_downsample.frag.spv", hdr_pass, false);
+    up_pipeline_        = build("bloom_blur.frag.spv", hdr_pass, true);
+    VkPipeline tonemap  = build("tonemap.frag.spv", output_pass, false);
+    if (!ssao_pipeline_ || !ssao_blur_pipeline_ || !threshold_pipeline_ || !down_pipeline_ ||
+        !up_pipeline_ || !tonemap)
+        return false;
+    tonemap_pipeline_ = tonemap;
+
+    LOG_INFO("Post-processing: %u bloom levels, SSAO at 1/%u resolution", BLOOM_LEVELS, settings_.ssao_divisor);
+    return true;
+}
+
+void PostProcess::destroy(VulkanContext& ctx) {
+    descriptor_alloc_.destroy(ctx.device);
+    sets_.clear();
+    destroy_buffer(ctx.allocator, kernel_);
+    if (linear_)  { vkDestroySampler(ctx.device, linear_, nullptr);  linear_  = VK_NULL_HANDLE; }
+    if (nearest_) { vkDestroySampler(ctx.device, nearest_, nullptr); nearest_ = VK_NULL_HANDLE; }
+    ssao_pipeline_ = ssao_blur_pipeline_ = threshold_pipeline_ = VK_NULL_HANDLE;
+    down_pipeline_ = up_pipeline_ = tonemap_pipeline_ = VK_NULL_HANDLE;
+    if (layout_)     { vkDestroyPipelineLayout(ctx.device, layout_, nullptr); layout_ = VK_NULL_HANDLE; }
+    if (set_layout_) { vkDestroyDescriptorSetLayout(ctx.device, set_layout_, nullptr); set_layout_ = VK_NULL_HANDLE; }
+}
+
+// --- Passes ---
+
+void PostProcess::add_passes(RenderGraph& graph, u32 frame, RGImage hdr, RGImage depth, RGImage output,
+                             VkExtent2D extent, const glm::mat4& projection) {
+    glm::vec4 proj(projection[0][0], projection[1][1], projection[2][2], projection[3][2]);
+
+    // Occlusion at reduced resolution, then blurred without crossing edges
+    RGImage ao = RG_NO_IMAGE;
+    if (settings_.ssao) {
+        VkExtent2D ao_extent = scaled(extent, std::max(settings_.ssao_divisor, 1u));
+        RGImage raw = graph.create_image("ssao raw", AO_FORMAT, ao_extent);
+        ao          = graph.create_image("ssao", AO_FORMAT, ao_extent);
+
+        SSAOPush push{proj, settings_.ssao_radius, settings_.ssao_bias, static_cast<i32>(SSAO_SAMPLES)};
+        graph.add_pass("ssao")
+            .color(raw, VK_ATTACHMENT_LOAD_OP_DONT_CARE)
+            .read(depth, RGUsage::SampledFragment)
+            .record([=, this, &graph](VkCommandBuffer cmd) {
+                draw(cmd, graph, frame, SET_SSAO, ssao_pipeline_, {{depth, nearest_, true}},
+                     ao_extent, &push, sizeof(push));
+            });
+        graph.add_pass("ssao blur")
+            .color(ao, VK_ATTACHMENT_LOAD_OP_DONT_CARE)
+            .read(raw, RGUsage::SampledFragment)
+            .read(depth, RGUsage::SampledFragment)
+            .record([=, this, &graph](VkCommandBuffer cmd) {
+                draw(cmd, graph, frame, SET_SSAO_BLUR, ssao_blur_pipeline_,
+                     {{raw, nearest_}, {depth, nearest_, true}}, ao_extent, &proj, sizeof(proj));
+            });
+    }
+
+    // Bloom pyramid: level 0 at half resolution, each next one halved
+    RGImage bloom = RG_NO_IMAGE;
+    if (settings_.bloom) {
+        std::array<RGImage, BLOOM_LEVELS>    levels;
+        std::array<VkExtent2D, BLOOM_LEVELS> extents;
+        for (u32 i = 0; i < BLOOM_LEVELS; i++) {
+            extents[i] = scaled(extent, 2u << i);
+            levels[i]  = graph.create_image(("bloom " + std::to_string(i)).c_str(), HDR_FORMAT, extents[i]);
+        }
+
+        float threshold[2] = {settings_.bloom_threshold, settings_.bloom_knee};
+        graph.add_pass("bloom threshold")
+            .color(levels[0], VK_ATTACHMENT_LOAD_OP_DONT_CARE)
+            .read(hdr, RGUsage::SampledFragment)
+            .record([=, this, &graph](VkCommandBuffer cmd) {
+                draw(cmd, graph, frame, SET_BLOOM_THRESHOLD, threshold_pipeline_, {{hdr, linear_}},
+                     extents[0], threshold, sizeof(threshold));
+            });
+        for (u32 i = 1; i < BLOOM_LEVELS; i++) {
+            graph.add_pass(("bloom down " + std::to_string(i)).c_str())
+                .color(levels[i], VK_ATTACHMENT_LOAD_OP_DONT_CARE)
+                .read(levels[i - 1], RGUsage::SampledFragment)
+                .record([=, this, &graph](VkCommandBuffer cmd) {
+                    draw(cmd, graph, frame, static_cast<Set>(SET_BLOOM_DOWN + i), down_pipeline_,
+                         {{levels[i - 1], linear_}}, extents[i], nullptr, 0);
+                });
+        }
+        // Each level adds the tent-filtered one below it onto itself
+        for (u32 i = BLOOM_LEVELS - 1; i-- > 0;) {
+            float radius = 1.0f;
+            graph.add_pass(("bloom up " + std::to_string(i)).c_str())
+                .color(levels[i], VK_ATTACHMENT_LOAD_OP_LOAD)
+                .read(levels[i + 1], RGUsage::SampledFragment)
+                .record([=, this, &graph](VkCommandBuffer cmd) {
+                    draw(cmd, graph, frame, static_cast<Set>(SET_BLOOM_UP + i), up_pipeline_,
+                         {{levels[i + 1], linear_}}, extents[i], &radius, sizeof(radius));
+                });
+        }
+        bloom = levels[0];
+    }
+
+    // Effects that are off get the HDR image as a stand-in and no strength
+    TonemapPush push{};
+    push.exposure       = settings_.exposure;
+    push.bloom_strength = bloom != RG_NO_IMAGE ? settings_.bloom_strength : 0.0f;
+    push.ao_strength    = ao != RG_NO_IMAGE ? settings_.ssao_strength : 0.0f;
+    push.gamma          = gamma_;
+    push.depth_params   = glm::vec2(proj.z, proj.w);
+
+    auto tonemap = graph.add_pass("tonemap");
+    tonemap.color(output, VK_ATTACHMENT_LOAD_OP_DONT_CARE)
+           .read(hdr, RGUsage::SampledFragment)
+           .read(depth, RGUsage::SampledFragment);
+    if (bloom != RG_NO_IMAGE) tonemap.read(bloom, RGUsage::SampledFragment);
+    if (ao != RG_NO_IMAGE)    tonemap.read(ao, RGUsage::SampledFragment);
+    RGImage bloom_input = bloom != RG_NO_IMAGE ? bloom : hdr;
+    RGImage ao_input    = ao != RG_NO_IMAGE ? ao : hdr;
+    tonemap.record([=, this, &graph](VkCommandBuffer cmd) {
+        draw(cmd, graph, frame, SET_TONEMAP, tonemap_pipeline_,
+             {{hdr, nearest_}, {bloom_input, linear_}, {ao_input, nearest_}, {depth, nearest_, true}},
+             extent, &push, sizeof(push));
+    });
+}
+
+void PostProcess::draw(VkCommandBuffer cmd, const RenderGraph& graph, u32 frame, Set set, VkPipeline pipeline,
+                       std::initializer_list<Input> inputs, VkExtent2D extent, const void* push, u32 push_size) {
+    // Only this slot's sets are touched, and its last submission is done
+    BoundSet& bound = sets_[frame][set];
+    bool stale = bound.generation != graph.generation();
+    u32  i = 0;
+    for (const Input& in : inputs) stale |= bound.views[i++] != graph.view(in.image);
+    if (stale) {
+        DescriptorWriter writer;
+        i = 0;
+        for (const Input& in : inputs) {
+            bound.views[i] = graph.view(in.image);
+            writer.write_image(i, bound.views[i], in.sampler,
+                               in.depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+                                        : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            i++;
+        }
+        writer.update(device_, bound.set);
+        bound.generation = graph.generation();
+    }
+
+    VkViewport vp{0.0f, 0.0f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.0f, 1.0f};
+    VkRect2D   scissor{{0, 0}, extent};
+    vkCmdSetViewport(cmd, 0, 1, &vp);
+    vkCmdSetScissor(cmd, 0, 1, &scissor);
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout_, 0, 1, &bound.set, 0, nullptr);
+    if (push_size) vkCmdPushConstants(cmd, layout_, VK_SHADER_STAGE_FRAGMENT_BIT, 0, push_size, push);
+    vkCmdDraw(cmd, 3, 1, 0, 0);
+}
+
+} // namespace lumios
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "vk_common.h"
+#include "vk_descriptors.h"
+#include "vk_render_graph.h"
+#include <array>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+namespace lumios {
+
+struct VulkanContext;
+class PipelineRegistry;
+
+// The HDR resolve of a frame, as render graph passes between the forward
+// pass and the swapchain:
+//   - SSAO from the depth buffer at 1/ssao_divisor resolution, blurred
+//     4x4 with depth-aware weights and upsampled bilaterally by the tonemap,
+//   - a bloom pyramid of BLOOM_LEVELS: a thresholded half-resolution copy,
+//     13-tap downsamples to 1/32, then tent upsamples added back level by
+//     level,
+//   - exposure and ACES tonemapping onto the output, with ambient
+//     occlusion and bloom applied.
+// Effects that are switched off are not declared and cost nothing. Every
+// image except the output is a graph transient, so the pyramid and the
+// occlusion targets share memory with each other where lifetimes allow.
+class PostProcess {
+public:
+    static constexpr VkFormat HDR_FORMAT   = VK_FORMAT_R16G16B16A16_SFLOAT;
+    static constexpr VkFormat AO_FORMAT    = VK_FORMAT_R8_UNORM;
+    static constexpr u32      BLOOM_LEVELS = 5;
+    static constexpr u32      SSAO_SAMPLES = 16;
+
+    struct Settings {
+        bool  bloom = true;
+        bool  ssao  = true;
+        u32   ssao_divisor    = 2;      // 2 for half, 4 for quarter resolution
+        float ssao_radius     = 0.5f;   // world units
+        float ssao_bias       = 0.025f;
+        float ssao_strength   = 1.0f;
+        float bloom_threshold = 1.0f;   // brightest channel, before exposure
+        float bloom_knee      = 0.5f;
+        float bloom_strength  = 0.05f;
+        float exposure        = 1.0f;
+    };
+
+    // Pipelines come from, and stay owned by, the registry, built against
+    // the graph's passes; the tonemap writes output_format. Descriptor
+    // sets are kept per frame slot, frames of them.
+    bool init(VulkanContext& ctx, PipelineRegistry& pipelines, RenderGraph& graph,
+              const std::string& shader_dir, VkFormat output_format, u32 frames);
+    void destroy(VulkanContext& ctx);
+
+    // Declares the passes reading hdr and depth (sampled in fragment
+    // shaders) and ending with the tonemap into output. frame is the slot
+    // being recorded, whose earlier submission has completed.
+    void add_passes(RenderGraph& graph, u32 frame, RGImage hdr, RGImage depth, RGImage output,
+                    VkExtent2D extent, const glm::mat4& projection);
+
+    bool            ready()    const { return tonemap_pipeline_ != VK_NULL_HANDLE; }
+    Settings&       settings()       { return settings_; }
+    const Settings& settings() const { return settings_; }
+
+private:
+    // Descriptor sets of one frame slot, one per pass
+    enum Set : u32 {
+        SET_SSAO,
+        SET_SSAO_BLUR,
+        SET_BLOOM_THRESHOLD,
+        SET_BLOOM_DOWN,                              // level i reads i - 1, for i >= 1
+        SET_BLOOM_UP   = SET_BLOOM_DOWN + BLOOM_LEVELS, // level i reads i + 1
+        SET_TONEMAP    = SET_BLOOM_UP + BLOOM_LEVELS,
+        SET_COUNT,
+    };
+    static constexpr u32 MAX_INPUTS = 4; // sampled images, bindings 0-3
+
+    struct Input {
+        RGImage   image;
+        VkSampler sampler;
+        bool      depth = false; // sampled in DEPTH_STENCIL_READ_ONLY_OPTIMAL
+    };
+    // A set is rewritten only when the views it should hold change
+    struct BoundSet {
+        VkDescriptorSet                     set = VK_NULL_HANDLE;
+        std::array<VkImageView, MAX_INPUTS> views{};
+        u32                                 generation = 0; // of the graph when written
+    };
+
+    void draw(VkCommandBuffer cmd, const RenderGraph& graph, u32 frame, Set set, VkPipeline pipeline,
+              std::initializer_list<Input> inputs, VkExtent2D extent, const void* push, u32 push_size);
+
+    VkDevice              device_     = VK_NULL_HANDLE;
+    VkDescriptorSetLayout set_layout_ = VK_NULL_HANDLE;
+    VkPipelineLayout      layout_     = VK_NULL_HANDLE;
+    VkPipeline            ssao_pipeline_      = VK_NULL_HANDLE;
+    VkPipeline            ssao_blur_pipeline_ = VK_NULL_HANDLE;
+    VkPipeline            threshold_pipeline_ = VK_NULL_HANDLE;
+    VkPipeline            down_pipeline_      = VK_NULL_HANDLE;
+    VkPipeline            up_pipeline_        = VK_NULL_HANDLE; // additive
+    VkPipeline            tonemap_pipeline_   = VK_NULL_HANDLE;
+    VkSampler             linear_  = VK_NULL_HANDLE;
+    VkSampler             nearest_ = VK_NULL_HANDLE;
+    GPUBuffer             kernel_;  // SSAO sample kernel, binding 4 of the SSAO sets
+    DescriptorAllocator   descriptor_alloc_;
+    std::vector<std::array<BoundSet, SET_COUNT>> sets_; // per frame slot
+    float                 gamma_ = 1.0f; // applied by the tonemap, 1 for sRGB outputs
+    Settings              settings_;
+};
+
+} // namespace lumios
@@ -0,0 +1,719 @@
+#include "vk_render_graph.h"
+#include "vk_init.h"
+#include "../../core/hash.h"
+#include <algorithm>
+
+namespace lumios {
+
+// --- Usages ---
+
+struct UsageInfo {
+    VkImageLayout        layout;
+    VkPipelineStageFlags stages;
+    VkAccessFlags        read;
+    VkAccessFlags        write;
+    VkImageUsageFlags    usage;
+};
+
+static bool is_depth_format(VkFormat format) {
+    switch (format) {
+        case VK_FORMAT_D16_UNORM:
+        case VK_FORMAT_X8_D24_UNORM_PACK32:
+        case VK_FORMAT_D32_SFLOAT:
+        case VK_FORMAT_D16_UNORM_S8_UINT:
+        case VK_FORMAT_D24_UNORM_S8_UINT:
+        case VK_FORMAT_D32_SFLOAT_S8_UINT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Present waits at COLOR_ATTACHMENT_OUTPUT, the stage frames wait on the
+// acquire semaphore at, so the first barrier on an acquired image chains
+// with that wait
+static UsageInfo usage_info(RGUsage usage, bool depth) {
+    VkImageLayout sampled = depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+                                  : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    switch (usage) {
+        case RGUsage::ColorAttachment:
+            return {VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                    VK_ACCESS_COLOR_ATTACHMENT_READ_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                    VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT};
+        case RGUsage::DepthAttachment:
+            return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                    VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                    VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                    VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT};
+        case RGUsage::SampledFragment:
+            return {sampled, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, 0,
+                    VK_IMAGE_USAGE_SAMPLED_BIT};
+        case RGUsage::SampledCompute:
+            return {sampled, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, 0,
+                    VK_IMAGE_USAGE_SAMPLED_BIT};
+        case RGUsage::StorageCompute:
+            return {VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                    VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_USAGE_STORAGE_BIT};
+        case RGUsage::TransferSrc:
+            return {VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    VK_ACCESS_TRANSFER_READ_BIT, 0, VK_IMAGE_USAGE_TRANSFER_SRC_BIT};
+        case RGUsage::TransferDst:
+            return {VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_USAGE_TRANSFER_DST_BIT};
+        case RGUsage::Present:
+            return {VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0, 0};
+        case RGUsage::None:
+            break;
+    }
+    return {VK_IMAGE_LAYOUT_UNDEFINED, 0, 0, 0, 0};
+}
+
+// --- Declarations ---
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::color(RGImage image, VkAttachmentLoadOp load,
+                                                          VkClearColorValue clear) {
+    Access a{image, RGUsage::ColorAttachment, true};
+    a.attachment  = true;
+    a.load        = load;
+    a.clear.color = clear;
+    graph_.passes_[pass_].accesses.push_back(a);
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::depth(RGImage image, VkAttachmentLoadOp load, float clear) {
+    Access a{image, RGUsage::DepthAttachment, true};
+    a.attachment         = true;
+    a.load               = load;
+    a.clear.depthStencil = {clear, 0};
+    graph_.passes_[pass_].accesses.push_back(a);
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::read(RGImage image, RGUsage usage) {
+    graph_.passes_[pass_].accesses.push_back({image, usage, false});
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::write(RGImage image, RGUsage usage) {
+    graph_.passes_[pass_].accesses.push_back({image, usage, true});
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::keep() {
+    graph_.passes_[pass_].keep = true;
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::record(Record fn) {
+    graph_.passes_[pass_].record = std::move(fn);
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::secondary() {
+    graph_.passes_[pass_].secondary = true;
+    return *this;
+}
+
+void RenderGraph::begin(u32 frame) {
+    images_.clear();
+    passes_.clear();
+    frame_ = frame;
+    if (!query_pool_ || frame >= timed_frames_) return;
+
+    // The slot's last submission has completed, so its queries are final
+    auto& names = timed_passes_[frame];
+    if (names.empty()) return;
+    u32 count = static_cast<u32>(names.size()) + 1;
+    query_scratch_.resize(count);
+    VkResult res = vkGetQueryPoolResults(device_, query_pool_, frame * (MAX_TIMED_PASSES + 1), count,
+                                         count * sizeof(u64), query_scratch_.data(), sizeof(u64),
+                                         VK_QUERY_RESULT_64_BIT);
+    if (res != VK_SUCCESS) return;
+
+    timings_.resize(names.size());
+    for (size_t i = 0; i < names.size(); i++) {
+        u64 ticks = (query_scratch_[i + 1] - query_scratch_[i]) & timestamp_mask_;
+        timings_[i].name = names[i];
+        timings_[i].ms   = static_cast<double>(ticks) * timestamp_period_ * 1e-6;
+    }
+}
+
+RGImage RenderGraph::import_image(const char* name, const RGImport& import, RGUsage last) {
+    Image img;
+    img.name       = name;
+    img.format     = import.format;
+    img.extent     = import.extent;
+    img.image      = import.image;
+    img.view       = import.view;
+    img.imported   = true;
+    img.last_usage = last;
+    images_.push_back(std::move(img));
+    return static_cast<RGImage>(images_.size() - 1);
+}
+
+RGImage RenderGraph::create_image(const char* name, VkFormat format, VkExtent2D extent) {
+    Image img;
+    img.name   = name;
+    img.format = format;
+    img.extent = {std::max(extent.width, 1u), std::max(extent.height, 1u)};
+    images_.push_back(std::move(img));
+    return static_cast<RGImage>(images_.size() - 1);
+}
+
+void RenderGraph::set_final(RGImage image, RGUsage usage) {
+    images_[image].final_usage = usage;
+}
+
+RenderGraph::PassBuilder RenderGraph::add_pass(const char* name) {
+    Pass pass;
+    pass.name = name;
+    passes_.push_back(std::move(pass));
+    return PassBuilder(*this, static_cast<u32>(passes_.size() - 1));
+}
+
+VkImageView RenderGraph::view(RGImage image) const {
+    const Image& img = images_[image];
+    if (img.imported) return img.view;
+    return img.physical != UINT32_MAX ? physical_[img.physical].view : VK_NULL_HANDLE;
+}
+
+bool RenderGraph::alive(RGImage image) const {
+    const Image& img = images_[image];
+    return img.imported || img.physical != UINT32_MAX;
+}
+
+VkCommandBufferInheritanceInfo RenderGraph::inheritance() const {
+    VkCommandBufferInheritanceInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    if (recording_) {
+        info.renderPass  = recording_->render_pass;
+        info.subpass     = 0;
+        info.framebuffer = recording_->framebuffer;
+    }
+    return info;
+}
+
+// --- Compile ---
+
+// Walks the passes backwards from what leaves the graph: a pass survives if
+// it is kept, writes an imported image or writes something a surviving
+// later pass reads. Attachments are stored only when such a reader exists.
+void RenderGraph::cull() {
+    for (auto& img : images_) {
+        img.needed    = false;
+        img.first     = UINT32_MAX;
+        img.last_pass = 0;
+        img.usage     = 0;
+        img.physical  = UINT32_MAX;
+    }
+
+    for (u32 p = static_cast<u32>(passes_.size()); p-- > 0;) {
+        Pass& pass = passes_[p];
+        pass.alive = pass.keep;
+        for (auto& a : pass.accesses) {
+            const Image& img = images_[a.image];
+            if (a.write && (img.imported || img.needed)) pass.alive = true;
+        }
+        if (!pass.alive) continue;
+
+        for (auto& a : pass.accesses) {
+            Image& img = images_[a.image];
+            if (!a.write) continue;
+            a.store = img.imported || img.needed;
+            if (a.attachment && a.load != VK_ATTACHMENT_LOAD_OP_LOAD) img.needed = false;
+        }
+        for (auto& a : pass.accesses) {
+            bool reads = !a.write || (a.attachment && a.load == VK_ATTACHMENT_LOAD_OP_LOAD);
+            if (reads) images_[a.image].needed = true;
+        }
+    }
+
+    passes_run_    = 0;
+    passes_culled_ = 0;
+    for (u32 p = 0; p < passes_.size(); p++) {
+        Pass& pass = passes_[p];
+        if (!pass.alive) { passes_culled_++; continue; }
+        passes_run_++;
+        for (auto& a : pass.accesses) {
+            Image& img = images_[a.image];
+            img.first     = std::min(img.first, p);
+            img.last_pass = p;
+            img.usage    |= usage_info(a.usage, is_depth_format(img.format)).usage;
+        }
+    }
+}
+
+void RenderGraph::destroy_transients(VulkanContext& ctx) {
+    for (auto& [key, fb] : framebuffers_) vkDestroyFramebuffer(ctx.device, fb, nullptr);
+    framebuffers_.clear();
+    for (auto& p : physical_) {
+        if (p.view)  vkDestroyImageView(ctx.device, p.view, nullptr);
+        if (p.image) vkDestroyImage(ctx.device, p.image, nullptr);
+    }
+    for (auto& b : blocks_) {
+        if (b.allocation) vmaFreeMemory(ctx.allocator, b.allocation);
+    }
+    physical_.clear();
+    blocks_.clear();
+    transient_key_   = 0;
+    transient_bytes_ = 0;
+    aliased_bytes_   = 0;
+}
+
+// Every surviving transient gets an image of its own, bound to a block of
+// memory shared with images whose pass ranges it does not overlap. Images
+// are placed by first use, each into the best fitting free block, which is
+// grown if none is large enough.
+bool RenderGraph::place_transients(VulkanContext& ctx) {
+    std::vector<u32> live;
+    ByteHash h;
+    for (u32 i = 0; i < images_.size(); i++) {
+        const Image& img = images_[i];
+        if (img.imported || img.first == UINT32_MAX) continue;
+        live.push_back(i);
+        h.add(img.format);
+        h.add(img.extent);
+        h.add(img.usage);
+        h.add(img.first);
+        h.add(img.last_pass);
+    }
+    h.add(live.size());
+
+    if (h.value == transient_key_ && physical_.size() == live.size()) {
+        for (u32 k = 0; k < live.size(); k++) images_[live[k]].physical = k;
+        return true;
+    }
+
+    // Frames in flight may still use the old images
+    vkDeviceWaitIdle(ctx.device);
+    destroy_transients(ctx);
+    generation_++;
+    if (live.empty()) {
+        transient_key_ = h.value;
+        return true;
+    }
+
+    struct Slot {
+        VkMemoryRequirements reqs{};
+        u32                  end = 0; // last pass of the image placed last
+    };
+    std::vector<Slot> slots;
+    std::vector<VkMemoryRequirements> image_reqs(live.size());
+    physical_.resize(live.size());
+
+    std::vector<u32> order(live.size());
+    for (u32 k = 0; k < order.size(); k++) order[k] = k;
+    std::stable_sort(order.begin(), order.end(),
+                     [&](u32 a, u32 b) { return images_[live[a]].first < images_[live[b]].first; });
+
+    VkDeviceSize unaliased = 0;
+    for (u32 k : order) {
+        Image&    img  = images_[live[k]];
+        Physical& phys = physical_[k];
+
+        VkImageCreateInfo ici{};
+        ici.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        ici.imageType     = VK_IMAGE_TYPE_2D;
+        ici.format        = img.format;
+        ici.extent        = {img.extent.width, img.extent.height, 1};
+        ici.mipLevels     = 1;
+        ici.arrayLayers   = 1;
+        ici.samples       = VK_SAMPLE_COUNT_1_BIT;
+        ici.tiling        = VK_IMAGE_TILING_OPTIMAL;
+        ici.usage         = img.usage;
+        ici.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VK_CHECK(vkCreateImage(ctx.device, &ici, nullptr, &phys.image));
+        if (!phys.image) {
+            LOG_ERROR("Render graph: failed to create transient image '%s'", img.name.c_str());
+            destroy_transients(ctx);
+            return false;
+        }
+
+        VkMemoryRequirements reqs;
+        vkGetImageMemoryRequirements(ctx.device, phys.image, &reqs);
+        unaliased += reqs.size;
+
+        // Prefer the smallest free slot that fits, else the largest to grow
+        auto better = [&](const Slot& a, const Slot& b) {
+            bool a_fits = a.reqs.size >= reqs.size, b_fits = b.reqs.size >= reqs.size;
+            if (a_fits != b_fits) return a_fits;
+            return a_fits ? a.reqs.size < b.reqs.size : a.reqs.size > b.reqs.size;
+        };
+        u32 best = UINT32_MAX;
+        for (u32 s = 0; s < slots.size(); s++) {
+            const Slot& slot = slots[s];
+            if (slot.end >= img.first || !(slot.reqs.memoryTypeBits & reqs.memoryTypeBits)) continue;
+            if (best == UINT32_MAX || better(slot, slots[best])) best = s;
+        }
+        if (best == UINT32_MAX) {
+            best = static_cast<u32>(slots.size());
+            slots.push_back({reqs, 0});
+        }
+
+        Slot& slot = slots[best];
+        slot.reqs.size           = std::max(slot.reqs.size, reqs.size);
+        slot.reqs.alignment      = std::max(slot.reqs.alignment, reqs.alignment);
+        slot.reqs.memoryTypeBits &= reqs.memoryTypeBits;
+        slot.end                 = img.last_pass;
+        phys.block               = best;
+    }
+
+    blocks_.resize(slots.size());
+    VmaAllocationCreateInfo aci{};
+    aci.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    for (u32 s = 0; s < slots.size(); s++) {
+        VK_CHECK(vmaAllocateMemory(ctx.allocator, &slots[s].reqs, &aci, &blocks_[s].allocation, nullptr));
+        if (!blocks_[s].allocation) {
+            LOG_ERROR("Render graph: failed to allocate %llu KB of transient memory",
+                      static_cast<unsigned long long>(slots[s].reqs.size >> 10));
+            destroy_transients(ctx);
+            return false;
+        }
+        transient_bytes_ += slots[s].reqs.size;
+    }
+
+    for (u32 k = 0; k < live.size(); k++) {
+        Image&    img  = images_[live[k]];
+        Physical& phys = physical_[k];
+        VK_CHECK(vmaBindImageMemory(ctx.allocator, blocks_[phys.block].allocation, phys.image));
+
+        VkImageViewCreateInfo vi{};
+        vi.sType    = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        vi.image    = phys.image;
+        vi.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        vi.format   = img.format;
+        vi.subresourceRange = {is_depth_format(img.format) ? VkImageAspectFlags(VK_IMAGE_ASPECT_DEPTH_BIT)
+                                                           : VkImageAspectFlags(VK_IMAGE_ASPECT_COLOR_BIT),
+                               0, 1, 0, 1};
+        VK_CHECK(vkCreateImageView(ctx.device, &vi, nullptr, &phys.view));
+        img.physical = k;
+    }
+
+    transient_key_ = h.value;
+    aliased_bytes_ = unaliased - std::min(unaliased, transient_bytes_);
+    LOG_INFO("Render graph: %zu transient images in %zu blocks, %llu KB (%llu KB saved by aliasing)",
+             live.size(), blocks_.size(), static_cast<unsigned long long>(transient_bytes_ >> 10),
+             static_cast<unsigned long long>(aliased_bytes_ >> 10));
+    return true;
+}
+
+VkRenderPass RenderGraph::render_pass(VulkanContext& ctx, const std::vector<AttachmentDesc>& attachments) {
+    ByteHash h;
+    for (auto& a : attachments) {
+        h.add(a.format);
+        h.add(a.load);
+        h.add(a.store);
+        h.add(a.depth);
+    }
+    auto it = render_passes_.find(h.value);
+    if (it != render_passes_.end()) return it->second;
+
+    // Layouts stay put inside the pass; the graph's barriers move them
+    std::vector<VkAttachmentDescription> descs;
+    std::vector<VkAttachmentReference>   colors;
+    VkAttachmentReference depth_ref{};
+    bool has_depth = false;
+    for (auto& a : attachments) {
+        VkImageLayout layout = a.depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL
+                                       : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        VkAttachmentDescription d{};
+        d.format         = a.format;
+        d.samples        = VK_SAMPLE_COUNT_1_BIT;
+        d.loadOp         = a.load;
+        d.storeOp        = a.store;
+        d.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        d.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        d.initialLayout  = layout;
+        d.finalLayout    = layout;
+
+        VkAttachmentReference ref{static_cast<u32>(descs.size()), layout};
+        if (a.depth) { depth_ref = ref; has_depth = true; }
+        else         colors.push_back(ref);
+        descs.push_back(d);
+    }
+
+    VkSubpassDescription sub{};
+    sub.pipelineBindPoint       = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    sub.colorAttachmentCount    = static_cast<u32>(colors.size());
+    sub.pColorAttachments       = colors.data();
+    sub.pDepthStencilAttachment = has_depth ? &depth_ref : nullptr;
+
+    VkRenderPassCreateInfo ci{};
+    ci.sType           = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    ci.attachmentCount = static_cast<u32>(descs.size());
+    ci.pAttachments    = descs.data();
+    ci.subpassCount    = 1;
+    ci.pSubpasses      = &sub;
+
+    VkRenderPass pass = VK_NULL_HANDLE;
+    VK_CHECK(vkCreateRenderPass(ctx.device, &ci, nullptr, &pass));
+    if (pass) render_passes_[h.value] = pass;
+    return pass;
+}
+
+VkRenderPass RenderGraph::compatible_pass(VulkanContext& ctx, std::initializer_list<VkFormat> colors,
+                                          VkFormat depth) {
+    std::vector<AttachmentDesc> attachments;
+    for (VkFormat f : colors)
+        attachments.push_back({f, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, false});
+    if (depth != VK_FORMAT_UNDEFINED)
+        attachments.push_back({depth, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, true});
+    return render_pass(ctx, attachments);
+}
+
+VkFramebuffer RenderGraph::framebuffer(VulkanContext& ctx, const Pass& pass) {
+    std::vector<VkImageView> views;
+    ByteHash h;
+    h.add(pass.render_pass);
+    h.add(pass.extent);
+    for (auto& a : pass.accesses) {
+        if (!a.attachment) continue;
+        views.push_back(view(a.image));
+        h.add(views.back());
+    }
+    auto it = framebuffers_.find(h.value);
+    if (it != framebuffers_.end()) return it->second;
+
+    VkFramebufferCreateInfo ci{};
+    ci.sType           = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    ci.renderPass      = pass.render_pass;
+    ci.attachmentCount = static_cast<u32>(views.size());
+    ci.pAttachments    = views.data();
+    ci.width           = pass.extent.width;
+    ci.height          = pass.extent.height;
+    ci.layers          = 1;
+
+    VkFramebuffer fb = VK_NULL_HANDLE;
+    VK_CHECK(vkCreateFramebuffer(ctx.device, &ci, nullptr, &fb));
+    if (fb) framebuffers_[h.value] = fb;
+    return fb;
+}
+
+bool RenderGraph::compile(VulkanContext& ctx) {
+    cull();
+    if (!place_transients(ctx)) return false;
+
+    for (auto& pass : passes_) {
+        pass.render_pass = VK_NULL_HANDLE;
+        pass.framebuffer = VK_NULL_HANDLE;
+        if (!pass.alive) continue;
+
+        std::vector<AttachmentDesc> attachments;
+        for (auto& a : pass.accesses) {
+            if (!a.attachment) continue;
+            const Image& img = images_[a.image];
+            if (attachments.empty()) pass.extent = img.extent;
+            attachments.push_back({img.format, a.load,
+                                   a.store ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                                   a.usage == RGUsage::DepthAttachment});
+        }
+        if (attachments.empty()) continue;
+
+        pass.render_pass = render_pass(ctx, attachments);
+        if (pass.render_pass) pass.framebuffer = framebuffer(ctx, pass);
+        if (!pass.framebuffer) {
+            LOG_ERROR("Render graph: no framebuffer for pass '%s'", pass.name.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+// --- Execute ---
+
+// A read in the layout the image is already in only needs a barrier when
+// the last write is not yet visible to its stages; anything else waits on
+// the last write and every read since, and may change the layout.
+void RenderGraph::transition(Image& img, RGUsage usage, bool write, bool discard,
+                             std::vector<VkImageMemoryBarrier>& out,
+                             VkPipelineStageFlags& src, VkPipelineStageFlags& dst) {
+    bool      depth = is_depth_format(img.format);
+    UsageInfo info  = usage_info(usage, depth);
+    State&    s     = img.state;
+
+    VkImageMemoryBarrier b{};
+    b.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    b.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    b.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    b.image               = img.imported ? img.image : physical_[img.physical].image;
+    b.subresourceRange    = {depth ? VkImageAspectFlags(VK_IMAGE_ASPECT_DEPTH_BIT)
+                                   : VkImageAspectFlags(VK_IMAGE_ASPECT_COLOR_BIT), 0, 1, 0, 1};
+    b.dstAccessMask       = info.read | info.write;
+
+    if (!write && !discard && info.layout == s.layout) {
+        s.readers |= info.stages;
+        if (!s.writer || (s.synced & info.stages) == info.stages) return;
+        b.srcAccessMask = s.written;
+        b.oldLayout     = s.layout;
+        b.newLayout     = s.layout;
+        src |= s.writer;
+        dst |= info.stages;
+        s.synced |= info.stages;
+        out.push_back(b);
+        return;
+    }
+
+    b.srcAccessMask = s.written;
+    b.oldLayout     = discard ? VK_IMAGE_LAYOUT_UNDEFINED : s.layout;
+    b.newLayout     = info.layout;
+    src |= s.writer | s.readers;
+    dst |= info.stages;
+    out.push_back(b);
+
+    // A layout change counts as a write by the stages it was made for
+    s.layout  = info.layout;
+    s.writer  = info.stages;
+    s.written = info.write;
+    s.readers = write ? 0 : info.stages;
+    s.synced  = info.stages;
+}
+
+void RenderGraph::execute(VkCommandBuffer cmd) {
+    for (auto& img : images_) {
+        img.started = false;
+        if (!img.imported) continue;
+        if (img.last_usage != RGUsage::None) {
+            UsageInfo info = usage_info(img.last_usage, is_depth_format(img.format));
+            img.state = {info.layout, 0, 0, info.stages, info.stages};
+        } else {
+            // Never seen: wait on everything before, which also chains the
+            // first barrier of a swapchain image to the acquire semaphore
+            auto it = imported_states_.find(img.image);
+            img.state = it != imported_states_.end()
+                ? it->second : State{VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, 0};
+        }
+    }
+
+    // Each timestamp waits for everything before it, so a pass's time
+    // includes its barriers
+    bool timed       = query_pool_ && frame_ < timed_frames_;
+    u32  first_query = frame_ * (MAX_TIMED_PASSES + 1);
+    if (timed) {
+        timed_passes_[frame_].clear();
+        vkCmdResetQueryPool(cmd, query_pool_, first_query, MAX_TIMED_PASSES + 1);
+        vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_pool_, first_query);
+    }
+    auto stamp = [&](const Pass& pass) {
+        if (!timed) return;
+        auto& names = timed_passes_[frame_];
+        if (names.size() == MAX_TIMED_PASSES) return;
+        names.push_back(pass.name);
+        vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_pool_,
+                            first_query + static_cast<u32>(names.size()));
+    };
+
+    barriers_ = 0;
+    auto flush = [&](VkPipelineStageFlags src, VkPipelineStageFlags dst) {
+        if (barrier_scratch_.empty()) return;
+        vkCmdPipelineBarrier(cmd, src ? src : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dst, 0,
+                             0, nullptr, 0, nullptr,
+                             static_cast<u32>(barrier_scratch_.size()), barrier_scratch_.data());
+        barriers_ += static_cast<u32>(barrier_scratch_.size());
+    };
+
+    std::vector<VkClearValue> clears;
+    for (auto& pass : passes_) {
+        if (!pass.alive) continue;
+
+        barrier_scratch_.clear();
+        VkPipelineStageFlags src = 0, dst = 0;
+        for (auto& a : pass.accesses) {
+            Image& img = images_[a.image];
+            bool first = !img.started;
+            if (first && !img.imported) img.state = blocks_[physical_[img.physical].block].state;
+
+            // Transients start undefined; cleared or discarded attachments may
+            bool discard = first && (!img.imported || (a.attachment && a.load != VK_ATTACHMENT_LOAD_OP_LOAD));
+            transition(img, a.usage, a.write, discard, barrier_scratch_, src, dst);
+            img.started = true;
+            if (!img.imported) blocks_[physical_[img.physical].block].state = img.state;
+        }
+        flush(src, dst);
+
+        if (!pass.render_pass) {
+            if (pass.record) pass.record(cmd);
+            stamp(pass);
+            continue;
+        }
+
+        clears.clear();
+        for (auto& a : pass.accesses)
+            if (a.attachment) clears.push_back(a.clear);
+
+        VkRenderPassBeginInfo rpbi{};
+        rpbi.sType           = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        rpbi.renderPass      = pass.render_pass;
+        rpbi.framebuffer     = pass.framebuffer;
+        rpbi.renderArea      = {{0, 0}, pass.extent};
+        rpbi.clearValueCount = static_cast<u32>(clears.size());
+        rpbi.pClearValues    = clears.data();
+        vkCmdBeginRenderPass(cmd, &rpbi, pass.secondary
+            ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+        recording_ = &pass;
+        if (pass.record) pass.record(cmd);
+        recording_ = nullptr;
+        vkCmdEndRenderPass(cmd);
+        stamp(pass);
+    }
+
+    barrier_scratch_.clear();
+    VkPipelineStageFlags src = 0, dst = 0;
+    for (auto& img : images_) {
+        if (!img.imported) continue;
+        if (img.final_usage != RGUsage::None) transition(img, img.final_usage, false, false, barrier_scratch_, src, dst);
+        imported_states_[img.image] = img.state;
+    }
+    flush(src, dst);
+}
+
+// --- Timing ---
+
+bool RenderGraph::enable_timing(VulkanContext& ctx, u32 frames) {
+    u32 family_count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(ctx.physical_device, &family_count, nullptr);
+    std::vector<VkQueueFamilyProperties> families(family_count);
+    vkGetPhysicalDeviceQueueFamilyProperties(ctx.physical_device, &family_count, families.data());
+    u32 valid_bits = ctx.graphics_family < family_count ? families[ctx.graphics_family].timestampValidBits : 0;
+    if (valid_bits == 0 || ctx.device_properties.limits.timestampPeriod <= 0.0f) {
+        LOG_WARN("Render graph: no timestamps on the graphics queue, GPU timings disabled");
+        return false;
+    }
+
+    VkQueryPoolCreateInfo ci{};
+    ci.sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    ci.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+    ci.queryCount = frames * (MAX_TIMED_PASSES + 1);
+    VK_CHECK(vkCreateQueryPool(ctx.device, &ci, nullptr, &query_pool_));
+    if (!query_pool_) return false;
+
+    device_           = ctx.device;
+    timed_frames_     = frames;
+    timestamp_period_ = ctx.device_properties.limits.timestampPeriod;
+    timestamp_mask_   = valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1;
+    timed_passes_.assign(frames, {});
+    return true;
+}
+
+// --- Teardown ---
+
+void RenderGraph::invalidate(VulkanContext& ctx) {
+    for (auto& [key, fb] : framebuffers_) vkDestroyFramebuffer(ctx.device, fb, nullptr);
+    framebuffers_.clear();
+    imported_states_.clear();
+    generation_++;
+}
+
+void RenderGraph::destroy(VulkanContext& ctx) {
+    destroy_transients(ctx);
+    if (query_pool_) { vkDestroyQueryPool(ctx.device, query_pool_, nullptr); query_pool_ = VK_NULL_HANDLE; }
+    timed_frames_ = 0;
+    timed_passes_.clear();
+    timings_.clear();
+    for (auto& [key, pass] : render_passes_) vkDestroyRenderPass(ctx.device, pass, nullptr);
+    render_passes_.clear();
+    imported_states_.clear();
+    images_.clear();
+    passes_.clear();
+}
+
+} // namespace lumios
@@ -0,0 +1,259 @@
+#pragma once
+
+#include "vk_common.h"
+#include "../renderer.h"
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lumios {
+
+struct VulkanContext;
+
+// How a pass touches an image. Each usage stands for one layout and the
+// pipeline stages and accesses that go with it; sampled depth images use
+// DEPTH_STENCIL_READ_ONLY_OPTIMAL instead of SHADER_READ_ONLY_OPTIMAL.
+enum class RGUsage : u8 {
+    None,            // not touched yet, contents undefined
+    ColorAttachment,
+    DepthAttachment,
+    SampledFragment,
+    SampledCompute,
+    StorageCompute,  // GENERAL, read and written by compute
+    TransferSrc,
+    TransferDst,
+    Present,
+};
+
+using RGImage = u32;
+constexpr RGImage RG_NO_IMAGE = UINT32_MAX;
+
+// An image the graph does not own, such as a swapchain image
+struct RGImport {
+    VkImage    image  = VK_NULL_HANDLE;
+    VkImageView view  = VK_NULL_HANDLE;
+    VkFormat   format = VK_FORMAT_UNDEFINED;
+    VkExtent2D extent{};
+};
+
+// A frame of passes declared in submission order. Each pass lists the
+// images it renders to and reads; at execute() the graph
+//   - culls passes whose writes nothing later reads, unless they write an
+//     imported image or are marked keep(),
+//   - places one batched barrier before each pass, only where a layout
+//     changes or a write has to be made visible, with stages and accesses
+//     taken from the usages on either side,
+//   - gives transient images memory shared with others whose lifetimes do
+//     not overlap, and stores attachments only when something reads them.
+//
+// The graph is declared anew every frame; render passes, framebuffers and
+// transient images are cached and only rebuilt when the declarations
+// change shape (the device is waited on then, as for a resize). Imported
+// images keep their last usage across frames, so the first barrier of a
+// frame waits on the last access of the one before. A transient's memory
+// is shared by every frame in flight; its first barrier waits on whatever
+// used that memory last, in this frame or an earlier one.
+//
+// With timing enabled every surviving pass is bracketed by timestamps,
+// read back when its frame slot comes round again.
+class RenderGraph {
+public:
+    using Record = std::function<void(VkCommandBuffer)>;
+
+    static constexpr u32 MAX_TIMED_PASSES = 32; // later passes run untimed
+
+    class PassBuilder {
+    public:
+        // Render targets; a pass with any becomes a render pass over their
+        // extent. LOAD keeps the contents, anything else discards them.
+        PassBuilder& color(RGImage image, VkAttachmentLoadOp load = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                           VkClearColorValue clear = {});
+        PassBuilder& depth(RGImage image, VkAttachmentLoadOp load = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                           float clear = 1.0f);
+        PassBuilder& read(RGImage image, RGUsage usage);
+        PassBuilder& write(RGImage image, RGUsage usage);
+        // Has effects outside the graph (buffers, readbacks), never culled
+        PassBuilder& keep();
+        // Called between the pass's barriers, inside its render pass if any
+        PassBuilder& record(Record fn);
+        // The render pass is begun for secondary command buffers, which
+        // record() may only execute; they are begun with inheritance()
+        PassBuilder& secondary();
+
+    private:
+        friend class RenderGraph;
+        PassBuilder(RenderGraph& graph, u32 pass) : graph_(graph), pass_(pass) {}
+        RenderGraph& graph_;
+        u32          pass_;
+    };
+
+    void destroy(VulkanContext& ctx);
+
+    // Timestamp queries for that many frame slots; false when the
+    // graphics queue has no timestamps
+    bool enable_timing(VulkanContext& ctx, u32 frames);
+
+    // Starts the declarations of a frame. frame is the slot being recorded,
+    // whose previous submission must have completed; its timings are
+    // collected here.
+    void begin(u32 frame = 0);
+
+    // last overrides the remembered usage, for images whose layout was
+    // changed outside the graph since it last saw them
+    RGImage import_image(const char* name, const RGImport& image, RGUsage last = RGUsage::None);
+    // Single-level, device-local, usage flags inferred from the passes
+    RGImage create_image(const char* name, VkFormat format, VkExtent2D extent);
+    // The usage an imported image is left in, with the access made visible
+    void set_final(RGImage image, RGUsage usage);
+
+    PassBuilder add_pass(const char* name);
+
+    // Culls, places transient images and prepares render passes; view()
+    // is valid for every image that survived afterwards
+    bool compile(VulkanContext& ctx);
+    void execute(VkCommandBuffer cmd);
+
+    VkImageView view(RGImage image) const;
+    bool        alive(RGImage image) const;
+
+    // For secondary command buffers executed by the render pass being
+    // recorded; only valid inside its record()
+    VkCommandBufferInheritanceInfo inheritance() const;
+
+    // Bumped whenever transient images are recreated or imported ones
+    // invalidated, so sets holding their views know to be rewritten
+    u32 generation() const { return generation_; }
+
+    // A render pass compatible with the ones the graph begins for these
+    // formats, to build pipelines against; owned by the graph
+    VkRenderPass compatible_pass(VulkanContext& ctx, std::initializer_list<VkFormat> colors,
+                                 VkFormat depth = VK_FORMAT_UNDEFINED);
+
+    // Forgets framebuffers and remembered usages of imported images; call
+    // with the device idle once imported images or views are destroyed
+    void invalidate(VulkanContext& ctx);
+
+    // Of the last frame
+    u32          passes()         const { return passes_run_; }
+    u32          culled()         const { return passes_culled_; }
+    u32          barriers()       const { return barriers_; }
+    VkDeviceSize transient_bytes() const { return transient_bytes_; } // memory allocated
+    VkDeviceSize aliased_bytes()   const { return aliased_bytes_; }   // saved by sharing it
+
+    // GPU time of each pass of the last frame collected by begin(), which
+    // trails the recorded one by the frames in flight
+    const std::vector<PassTiming>& timings() const { return timings_; }
+
+private:
+    // Where the last accesses of an image left it
+    struct State {
+        VkImageLayout        layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags writer = 0;  // stages of the last write or layout change
+        VkAccessFlags        written = 0; // accesses of that write, to make visible
+        VkPipelineStageFlags readers = 0; // stages reading since, waited on by the next write
+        VkPipelineStageFlags synced  = 0; // stages the write is already visible to
+    };
+
+    struct Image {
+        std::string name;
+        VkFormat    format = VK_FORMAT_UNDEFINED;
+        VkExtent2D  extent{};
+        VkImage     image = VK_NULL_HANDLE;
+        VkImageView view  = VK_NULL_HANDLE;
+        bool        imported = false;
+        RGUsage     last_usage  = RGUsage::None; // import_image() override
+        RGUsage     final_usage = RGUsage::None;
+
+        // Of the current frame
+        VkImageUsageFlags usage = 0;          // of the surviving passes
+        u32         first = UINT32_MAX, last_pass = 0;
+        u32         physical = UINT32_MAX;    // transients: index into physical_
+        bool        needed  = false;          // read by a surviving later pass, during the cull
+        bool        started = false;          // accessed by execute() yet
+        State       state;
+    };
+
+    struct Access {
+        RGImage            image;
+        RGUsage            usage;
+        bool               write;
+        bool               attachment = false;
+        VkAttachmentLoadOp load  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        bool               store = true; // decided by the cull
+        VkClearValue       clear{};
+    };
+
+    struct Pass {
+        std::string         name;
+        std::vector<Access> accesses;
+        Record              record;
+        bool                keep  = false;
+        bool                alive = false;
+        bool                secondary = false;
+        VkRenderPass        render_pass = VK_NULL_HANDLE;
+        VkFramebuffer       framebuffer = VK_NULL_HANDLE;
+        VkExtent2D          extent{};
+    };
+
+    // A transient image and the block of memory it is bound to
+    struct Physical {
+        VkImage     image = VK_NULL_HANDLE;
+        VkImageView view  = VK_NULL_HANDLE;
+        u32         block = 0;
+    };
+    struct Block {
+        VmaAllocation allocation = VK_NULL_HANDLE;
+        State         state; // left by the last image using the memory
+    };
+
+    struct AttachmentDesc {
+        VkFormat            format;
+        VkAttachmentLoadOp  load;
+        VkAttachmentStoreOp store;
+        bool                depth;
+    };
+
+    void cull();
+    bool place_transients(VulkanContext& ctx);
+    void destroy_transients(VulkanContext& ctx);
+    VkRenderPass  render_pass(VulkanContext& ctx, const std::vector<AttachmentDesc>& attachments);
+    VkFramebuffer framebuffer(VulkanContext& ctx, const Pass& pass);
+    void transition(Image& image, RGUsage usage, bool write, bool discard,
+                    std::vector<VkImageMemoryBarrier>& out, VkPipelineStageFlags& src, VkPipelineStageFlags& dst);
+
+    std::vector<Image> images_;
+    std::vector<Pass>  passes_;
+
+    std::vector<Physical>                       physical_;
+    std::vector<Block>                          blocks_;
+    u64                                         transient_key_ = 0; // shape the transients were placed for
+    u32                                         generation_    = 0;
+    std::unordered_map<u64, VkRenderPass>       render_passes_;
+    std::unordered_map<u64, VkFramebuffer>      framebuffers_;
+    std::unordered_map<VkImage, State>          imported_states_;
+
+    std::vector<VkImageMemoryBarrier> barrier_scratch_;
+    const Pass*                       recording_ = nullptr; // render pass inside execute()
+
+    // Timestamps: MAX_TIMED_PASSES + 1 queries per frame slot, one before
+    // the first pass and one after each
+    VkDevice                              device_           = VK_NULL_HANDLE;
+    VkQueryPool                           query_pool_       = VK_NULL_HANDLE;
+    u32                                   timed_frames_     = 0;
+    u32                                   frame_            = 0;
+    float                                 timestamp_period_ = 1.0f; // ns per tick
+    u64                                   timestamp_mask_   = ~0ull;
+    std::vector<std::vector<std::string>> timed_passes_;  // per slot, names of the passes written
+    std::vector<PassTiming>               timings_;
+    std::vector<u64>                      query_scratch_;
+
+    u32          passes_run_      = 0;
+    u32          passes_culled_   = 0;
+    u32          barriers_        = 0;
+    VkDeviceSize transient_bytes_ = 0;
+    VkDeviceSize aliased_bytes_   = 0;
+};
+
+} // namespace lumios
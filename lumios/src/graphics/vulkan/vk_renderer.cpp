@@ -8,9 +8,19 @@
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <thread>
 
 namespace lumios {
 
+static constexpr u32 MAX_MATERIALS         = 4096; // material table slots, including the default
+static constexpr u32 MAX_BINDLESS_TEXTURES = 4096;
+static constexpr u32 MIN_INSTANCE_CAPACITY = 1024;
+static constexpr VkDeviceSize TRANSIENT_REGION_SIZE = VkDeviceSize(1) << 20; // per frame, grows on demand
+static constexpr u32 MIN_RECORD_CHUNK      = 256;  // draws per secondary command buffer, fewer go inline
+
 // --- Renderer factory ---
 
 Unique<Renderer> Renderer::create() {
@@ -19,24 +29,41 @@ Unique<Renderer> Renderer::create() {
 
 // --- Init / shutdown ---
 
-bool VulkanRenderer::init(Window& window, const std::string& shader_dir) {
+bool VulkanRenderer::init(Window& window, const std::string& shader_dir, const std::string& pipeline_cache) {
     window_ = &window;
     shader_dir_ = shader_dir;
 
     if (!ctx_.init(window.handle())) return false;
+    if (!pipelines_.init(ctx_, pipeline_cache)) return false;
+    if (!upload_.init(ctx_)) return false;
 
     int w, h;
     window.get_framebuffer_size(w, h);
     if (!swapchain_.create(ctx_, w, h)) return false;
     images_in_flight_.resize(swapchain_.images.size(), VK_NULL_HANDLE);
-    if (!create_render_pass()) return false;
-    if (!create_framebuffers()) return false;
+    // The forward pass renders in HDR when the post chain is there to resolve it
+    if (!post_.init(ctx_, pipelines_, graph_, shader_dir, swapchain_.image_format, MAX_FRAMES_IN_FLIGHT))
+        LOG_WARN("Post-processing unavailable, rendering straight to the swapchain");
+    VkFormat color_format = post_.ready() ? PostProcess::HDR_FORMAT : swapchain_.image_format;
+    main_pass_ = graph_.compatible_pass(ctx_, {color_format}, swapchain_.depth_format);
+    if (!main_pass_) return false;
+    if (!create_present_semaphores()) return false;
     if (!create_descriptors()) return false;
     if (!create_pipeline()) return false;
     if (!create_frame_resources()) return false;
+    graph_.enable_timing(ctx_, frame_count_);
     if (!create_default_resources()) return false;
+    if (!create_indirect_resources()) return false;
+    if (!create_gpu_cull_resources()) return false;
+    if (!particles_.init(ctx_, pipelines_, main_pass_, shader_dir))
+        LOG_WARN("GPU particles unavailable");
+    if (!streamer_.init(ctx_, frame_count_)) return false;
+
+    // The recording thread takes a chunk too
+    u32 hardware = std::max(1u, std::thread::hardware_concurrency());
+    jobs_ = std::make_unique<JobSystem>(std::min(hardware, MAX_RECORD_CHUNKS) - 1);
 
-    LOG_INFO("Vulkan renderer initialized");
+    LOG_INFO("Vulkan renderer initialized (%s draw path)", draw_path_name(draw_path_));
     return true;
 }
 
@@ -47,112 +74,76 @@ void VulkanRenderer::shutdown() {
     destroy_buffer(ctx_.allocator, default_material_.ubo);
 
     for (auto& m : materials_) destroy_buffer(ctx_.allocator, m.ubo);
-    for (auto& t : textures_) destroy_texture(ctx_, t);
-    for (auto& m : meshes_) {
-        destroy_buffer(ctx_.allocator, m.vertex_buffer);
-        destroy_buffer(ctx_.allocator, m.index_buffer);
-    }
+    streamer_.destroy(ctx_);
+    geometry_.destroy(ctx_);
+    upload_.destroy(ctx_);
+    destroy_buffer(ctx_.allocator, material_table_);
 
     for (auto& f : frames_) {
-        destroy_buffer(ctx_.allocator, f.global_ubo);
-        destroy_buffer(ctx_.allocator, f.light_ubo);
+        destroy_buffer(ctx_.allocator, f.visible_buffer);
+        destroy_buffer(ctx_.allocator, f.compact_buffer);
+        destroy_buffer(ctx_.allocator, f.count_buffer);
         vkDestroyFence(ctx_.device, f.in_flight, nullptr);
-        vkDestroySemaphore(ctx_.device, f.render_finished, nullptr);
         vkDestroySemaphore(ctx_.device, f.image_available, nullptr);
         vkDestroyCommandPool(ctx_.device, f.command_pool, nullptr);
+        for (auto pool : f.record_pools)
+            if (pool) vkDestroyCommandPool(ctx_.device, pool, nullptr);
     }
+    transient_.destroy(ctx_);
+    jobs_.reset();
 
     descriptor_alloc_.destroy(ctx_.device);
-    if (pipeline_)        vkDestroyPipeline(ctx_.device, pipeline_, nullptr);
+    bindless_alloc_.destroy(ctx_.device);
+    pipelines_.destroy(ctx_);
     if (pipeline_layout_) vkDestroyPipelineLayout(ctx_.device, pipeline_layout_, nullptr);
+    if (indirect_layout_) vkDestroyPipelineLayout(ctx_.device, indirect_layout_, nullptr);
+    if (cull_layout_)     vkDestroyPipelineLayout(ctx_.device, cull_layout_, nullptr);
+    if (cull_set_layout_)  vkDestroyDescriptorSetLayout(ctx_.device, cull_set_layout_, nullptr);
+    depth_pyramid_.destroy(ctx_);
+    shadows_.destroy(ctx_);
+    post_.destroy(ctx_);
+    particles_.destroy(ctx_);
+    if (bindless_set_layout_) vkDestroyDescriptorSetLayout(ctx_.device, bindless_set_layout_, nullptr);
     if (material_set_layout_) vkDestroyDescriptorSetLayout(ctx_.device, material_set_layout_, nullptr);
     if (global_set_layout_)   vkDestroyDescriptorSetLayout(ctx_.device, global_set_layout_, nullptr);
 
     cleanup_swapchain_dependent();
+    graph_.destroy(ctx_);
     swapchain_.cleanup(ctx_);
     ctx_.shutdown();
 
     LOG_INFO("Vulkan renderer shut down");
 }
 
-// --- Render pass ---
-
-bool VulkanRenderer::create_render_pass() {
-    VkAttachmentDescription color_att{};
-    color_att.format         = swapchain_.image_format;
-    color_att.samples        = VK_SAMPLE_COUNT_1_BIT;
-    color_att.loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    color_att.storeOp        = VK_ATTACHMENT_STORE_OP_STORE;
-    color_att.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    color_att.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    color_att.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
-    color_att.finalLayout    = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-    VkAttachmentDescription depth_att{};
-    depth_att.format         = swapchain_.depth_format;
-    depth_att.samples        = VK_SAMPLE_COUNT_1_BIT;
-    depth_att.loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    depth_att.storeOp        = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    depth_att.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    depth_att.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    depth_att.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
-    depth_att.finalLayout    = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-    VkAttachmentReference color_ref{0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
-    VkAttachmentReference depth_ref{1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
-
-    VkSubpassDescription subpass{};
-    subpass.pipelineBindPoint       = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount    = 1;
-    subpass.pColorAttachments       = &color_ref;
-    subpass.pDepthStencilAttachment = &depth_ref;
-
-    VkSubpassDependency dep{};
-    dep.srcSubpass    = VK_SUBPASS_EXTERNAL;
-    dep.dstSubpass    = 0;
-    dep.srcStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dep.dstStageMask  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dep.srcAccessMask = 0;
-    dep.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
-    VkAttachmentDescription attachments[] = {color_att, depth_att};
-    VkRenderPassCreateInfo ci{};
-    ci.sType           = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    ci.attachmentCount = 2;
-    ci.pAttachments    = attachments;
-    ci.subpassCount    = 1;
-    ci.pSubpasses      = &subpass;
-    ci.dependencyCount = 1;
-    ci.pDependencies   = &dep;
-
-    VK_CHECK(vkCreateRenderPass(ctx_.device, &ci, nullptr, &render_pass_));
-    return render_pass_ != VK_NULL_HANDLE;
-}
-
-bool VulkanRenderer::create_framebuffers() {
-    framebuffers_.resize(swapchain_.image_views.size());
-    for (size_t i = 0; i < swapchain_.image_views.size(); i++) {
-        VkImageView views[] = {swapchain_.image_views[i], swapchain_.depth_view};
-        VkFramebufferCreateInfo ci{};
-        ci.sType           = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        ci.renderPass      = render_pass_;
-        ci.attachmentCount = 2;
-        ci.pAttachments    = views;
-        ci.width           = swapchain_.extent.width;
-        ci.height          = swapchain_.extent.height;
-        ci.layers          = 1;
-        VK_CHECK(vkCreateFramebuffer(ctx_.device, &ci, nullptr, &framebuffers_[i]));
-    }
+// --- Presentation ---
+
+// A present may still wait on its semaphore when the frame slot comes round
+// again, so they follow the swapchain images rather than the frames
+bool VulkanRenderer::create_present_semaphores() {
+    VkSemaphoreCreateInfo sci{};
+    sci.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    render_finished_.resize(swapchain_.images.size());
+    for (auto& sem : render_finished_)
+        VK_CHECK(vkCreateSemaphore(ctx_.device, &sci, nullptr, &sem));
     return true;
 }
 
 // --- Descriptors ---
 
 bool VulkanRenderer::create_descriptors() {
-    // Set 0: global UBO + light UBO
+    // Set 0: global UBO + light grid UBO + instance SSBO (batched paths) +
+    // visible instance ids (GPU-culled path) + lights and their froxel
+    // lists + shadow views and atlas. The UBOs live in the transient ring
+    // and move every frame, hence dynamic.
     global_set_layout_ = DescriptorLayoutBuilder()
-        .add(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
-        .add(1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+        .add(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT)
+        .add(1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_FRAGMENT_BIT)
+        .add(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+        .add(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
+        .add(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+        .add(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+        .add(6, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_FRAGMENT_BIT)
+        .add(7, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
         .build(ctx_.device);
 
     // Set 1: material UBO + albedo sampler
@@ -161,12 +152,15 @@ bool VulkanRenderer::create_descriptors() {
         .add(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
         .build(ctx_.device);
 
+    // Textured materials take two sets each, see MaterialTextures
     VkDescriptorPoolSize sizes[] = {
-        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 200},
-        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 100}
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 400},
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 16},
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 200},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 64}
     };
-    auto span = std::span<VkDescriptorPoolSize>(sizes, 2);
-    descriptor_alloc_.init(ctx_.device, 200, span);
+    auto span = std::span<VkDescriptorPoolSize>(sizes, 4);
+    descriptor_alloc_.init(ctx_.device, 400, span);
 
     return true;
 }
@@ -189,29 +183,33 @@ bool VulkanRenderer::create_pipeline() {
     li.pPushConstantRanges    = &push;
     VK_CHECK(vkCreatePipelineLayout(ctx_.device, &li, nullptr, &pipeline_layout_));
 
-    std::string vert_path = shader_dir_ + "/mesh.vert.spv";
-    std::string frag_path = shader_dir_ + "/mesh.frag.spv";
-
-    VkShaderModule vert_mod = load_shader_module(ctx_.device, vert_path);
-    VkShaderModule frag_mod = load_shader_module(ctx_.device, frag_path);
+    VkShaderModule vert_mod = pipelines_.shader(shader_dir_ + "/mesh.vert.spv");
+    VkShaderModule frag_mod = pipelines_.shader(shader_dir_ + "/mesh.frag.spv");
     if (!vert_mod || !frag_mod) {
         LOG_ERROR("Failed to load shaders from %s", shader_dir_.c_str());
         return false;
     }
 
-    pipeline_ = PipelineBuilder()
-        .set_shaders(vert_mod, frag_mod)
+    PipelineBuilder builder;
+    builder.set_shaders(vert_mod, frag_mod)
         .set_vertex_layout()
         .set_topology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
         .set_polygon_mode(VK_POLYGON_MODE_FILL)
         .set_cull_mode(VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE)
         .enable_depth_test(true, VK_COMPARE_OP_LESS)
         .disable_blending()
-        .set_layout(pipeline_layout_)
-        .build(ctx_.device, render_pass_);
-
-    vkDestroyShaderModule(ctx_.device, vert_mod, nullptr);
-    vkDestroyShaderModule(ctx_.device, frag_mod, nullptr);
+        .set_layout(pipeline_layout_);
+    pipeline_ = pipelines_.graphics(builder, main_pass_);
+
+    // Instanced variant: same fragment stage and layout, model matrices from
+    // the per-frame instance buffer instead of push constants
+    VkShaderModule inst_mod = pipelines_.shader(shader_dir_ + "/mesh_instanced.vert.spv");
+    if (inst_mod) {
+        instanced_pipeline_ = pipelines_.graphics(builder.set_shaders(inst_mod, frag_mod), main_pass_);
+    } else {
+        LOG_WARN("Instanced mesh shader missing from %s, using direct draws", shader_dir_.c_str());
+    }
+    if (instanced_pipeline_) draw_path_ = DrawPath::Instanced;
 
     LOG_INFO("Graphics pipeline created");
     return pipeline_ != VK_NULL_HANDLE;
@@ -220,7 +218,12 @@ bool VulkanRenderer::create_pipeline() {
 // --- Frame resources ---
 
 bool VulkanRenderer::create_frame_resources() {
-    frame_count_ = static_cast<u32>(swapchain_.images.size());
+    if (!transient_.init(ctx_, TRANSIENT_REGION_SIZE,
+                         VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                         VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT))
+        return false;
+
+    frame_count_ = MAX_FRAMES_IN_FLIGHT;
     frames_.resize(frame_count_);
     for (auto& f : frames_) {
         VkCommandPoolCreateInfo pci{};
@@ -236,35 +239,83 @@ bool VulkanRenderer::create_frame_resources() {
         ai.commandBufferCount = 1;
         VK_CHECK(vkAllocateCommandBuffers(ctx_.device, &ai, &f.command_buffer));
 
+        pci.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        ai.level  = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        for (u32 i = 0; i < MAX_RECORD_CHUNKS; i++) {
+            VK_CHECK(vkCreateCommandPool(ctx_.device, &pci, nullptr, &f.record_pools[i]));
+            ai.commandPool = f.record_pools[i];
+            VK_CHECK(vkAllocateCommandBuffers(ctx_.device, &ai, &f.secondaries[i]));
+        }
+
         VkSemaphoreCreateInfo sci{};
         sci.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
         VK_CHECK(vkCreateSemaphore(ctx_.device, &sci, nullptr, &f.image_available));
-        VK_CHECK(vkCreateSemaphore(ctx_.device, &sci, nullptr, &f.render_finished));
 
         VkFenceCreateInfo fci{};
         fci.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
         fci.flags = VK_FENCE_CREATE_SIGNALED_BIT;
         VK_CHECK(vkCreateFence(ctx_.device, &fci, nullptr, &f.in_flight));
+    }
 
-        f.global_ubo = create_buffer(ctx_.allocator, sizeof(GlobalUBO),
-            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-        f.light_ubo = create_buffer(ctx_.allocator, sizeof(LightUBO),
-            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+    // The global sets bind the shadow atlas
+    if (!shadows_.init(ctx_, pipelines_, frames_[0].command_pool, shader_dir_)) {
+        LOG_ERROR("Failed to create shadow maps");
+        return false;
+    }
 
+    for (auto& f : frames_) {
         f.global_descriptor = descriptor_alloc_.allocate(ctx_.device, global_set_layout_);
-
-        DescriptorWriter()
-            .write_buffer(0, f.global_ubo.buffer, sizeof(GlobalUBO), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
-            .write_buffer(1, f.light_ubo.buffer, sizeof(LightUBO), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
-            .update(ctx_.device, f.global_descriptor);
+        ensure_instance_capacity(f, MIN_INSTANCE_CAPACITY);
     }
     return true;
 }
 
+// Only called for a frame whose fence has been waited on, so its buffers and
+// descriptor set are not in use
+void VulkanRenderer::ensure_instance_capacity(FrameData& f, u32 count) {
+    if (count <= f.instance_capacity) return;
+
+    u32 capacity = std::max({count, f.instance_capacity * 2, MIN_INSTANCE_CAPACITY});
+    destroy_buffer(ctx_.allocator, f.visible_buffer);
+    destroy_buffer(ctx_.allocator, f.compact_buffer);
+
+    // Buckets never outnumber instances, so the draw buffer shares the capacity
+    f.visible_buffer = create_buffer(ctx_.allocator, VkDeviceSize(capacity) * sizeof(u32),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    f.compact_buffer = create_buffer(ctx_.allocator, VkDeviceSize(capacity) * sizeof(VkDrawIndexedIndirectCommand),
+        VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+    f.instance_capacity = capacity;
+
+    write_global_descriptor(f);
+    if (f.cull_descriptor) write_cull_descriptor(f);
+}
+
+// An empty slice (nothing uploaded yet) binds the whole ring
+static VkDeviceSize slice_range(const TransientAllocator::Allocation& a) {
+    return a.size ? a.size : VK_WHOLE_SIZE;
+}
+
+// Rewritten whenever the frame uploads lights or instances, its buffers grow
+// or the transient ring is replaced; the UBOs are placed by dynamic offsets
+void VulkanRenderer::write_global_descriptor(FrameData& f) {
+    DescriptorWriter()
+        .write_buffer(0, transient_.buffer(), sizeof(GlobalUBO), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC)
+        .write_buffer(1, transient_.buffer(), sizeof(LightGridUBO), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC)
+        .write_buffer(2, transient_.buffer(), slice_range(f.instances), f.instances.offset,
+                      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+        .write_buffer(3, f.visible_buffer.buffer, f.visible_buffer.size, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+        .write_buffer(4, transient_.buffer(), slice_range(f.lights), f.lights.offset, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+        .write_buffer(5, transient_.buffer(), slice_range(f.clusters), f.clusters.offset,
+                      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+        .write_buffer(6, transient_.buffer(), sizeof(ShadowUBO), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC)
+        .write_image(7, shadows_.view(), shadows_.sampler(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+        .update(ctx_.device, f.global_descriptor);
+}
+
 // --- Default resources ---
 
 bool VulkanRenderer::create_default_resources() {
-    default_texture_ = create_default_white_texture(ctx_, frames_[0].command_pool);
+    default_texture_ = create_default_white_texture(ctx_, upload_);
 
     MaterialUBOData mat_data{};
     mat_data.base_color = {1, 1, 1, 1};
@@ -276,21 +327,255 @@ bool VulkanRenderer::create_default_resources() {
         VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
     upload_buffer_data(ctx_.allocator, default_material_.ubo, &mat_data, sizeof(mat_data));
 
+    default_material_.upload_ticket = default_texture_.upload_ticket;
     default_material_.descriptor = descriptor_alloc_.allocate(ctx_.device, material_set_layout_);
     DescriptorWriter()
         .write_buffer(0, default_material_.ubo.buffer, sizeof(MaterialUBOData), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
         .write_image(1, default_texture_.view, default_texture_.sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
         .update(ctx_.device, default_material_.descriptor);
 
+    geometry_.init(ctx_, upload_, 1u << 16, 1u << 18);
     return true;
 }
 
+// --- Indirect path ---
+
+bool VulkanRenderer::create_indirect_resources() {
+    if (!ctx_.features.bindless || !ctx_.features.draw_indirect_first_instance) {
+        LOG_WARN("Device lacks descriptor indexing or indirect firstInstance, indirect draws disabled");
+        return true;
+    }
+
+    texture_slots_ = std::min(MAX_BINDLESS_TEXTURES, ctx_.features.max_bindless_textures);
+
+    // Set 1: material table + texture array, updated while frames are in flight
+    bindless_set_layout_ = DescriptorLayoutBuilder()
+        .add(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+        .add(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, texture_slots_,
+             VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT)
+        .build(ctx_.device, VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT);
+
+    VkDescriptorPoolSize sizes[] = {
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1},
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, texture_slots_}
+    };
+    bindless_alloc_.init(ctx_.device, 1, std::span<VkDescriptorPoolSize>(sizes, 2),
+                         VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT);
+    bindless_descriptor_ = bindless_alloc_.allocate(ctx_.device, bindless_set_layout_);
+
+    // Written from the host when a material is created, by vkCmdUpdateBuffer
+    // when a streamed texture moves to another slot
+    material_table_ = create_buffer(ctx_.allocator, VkDeviceSize(MAX_MATERIALS) * sizeof(MaterialTableEntry),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+
+    MaterialTableEntry def{};
+    def.base_color     = {1, 1, 1, 1};
+    def.metallic       = 0.0f;
+    def.roughness      = 0.5f;
+    def.ao             = 1.0f;
+    def.albedo_texture = 0;
+    upload_buffer_data(ctx_.allocator, material_table_, &def, sizeof(def));
+
+    DescriptorWriter()
+        .write_buffer(0, material_table_.buffer, material_table_.size, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+        .write_image(1, default_texture_.view, default_texture_.sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0)
+        .update(ctx_.device, bindless_descriptor_);
+
+    // No push constants: the model matrix comes from the instance buffer
+    VkDescriptorSetLayout layouts[] = {global_set_layout_, bindless_set_layout_};
+
+    VkPipelineLayoutCreateInfo li{};
+    li.sType          = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    li.setLayoutCount = 2;
+    li.pSetLayouts    = layouts;
+    VK_CHECK(vkCreatePipelineLayout(ctx_.device, &li, nullptr, &indirect_layout_));
+
+    VkShaderModule vert_mod = pipelines_.shader(shader_dir_ + "/mesh_instanced.vert.spv");
+    VkShaderModule frag_mod = pipelines_.shader(shader_dir_ + "/mesh_indirect.frag.spv");
+    if (!vert_mod || !frag_mod) {
+        LOG_WARN("Indirect mesh shaders missing from %s, indirect draws disabled", shader_dir_.c_str());
+        return true;
+    }
+
+    PipelineBuilder builder;
+    builder.set_shaders(vert_mod, frag_mod)
+        .set_vertex_layout()
+        .set_topology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
+        .set_polygon_mode(VK_POLYGON_MODE_FILL)
+        .set_cull_mode(VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE)
+        .enable_depth_test(true, VK_COMPARE_OP_LESS)
+        .disable_blending()
+        .set_layout(indirect_layout_);
+    indirect_pipeline_ = pipelines_.graphics(builder, main_pass_);
+
+    indirect_ready_ = indirect_pipeline_ != VK_NULL_HANDLE;
+    if (indirect_ready_) draw_path_ = DrawPath::Indirect;
+    return true;
+}
+
+// --- GPU-culled path ---
+
+bool VulkanRenderer::create_gpu_cull_resources() {
+    if (!indirect_ready_) return true;
+
+    cull_set_layout_ = DescriptorLayoutBuilder()
+        .add(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_COMPUTE_BIT) // CullUBO
+        .add(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)         // instances
+        .add(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)         // draw per bucket
+        .add(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)         // visible ids
+        .add(4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT) // depth pyramid
+        .add(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)         // compacted draws
+        .add(6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)         // counts
+        .build(ctx_.device);
+
+    VkPipelineLayoutCreateInfo li{};
+    li.sType          = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    li.setLayoutCount = 1;
+    li.pSetLayouts    = &cull_set_layout_;
+    VK_CHECK(vkCreatePipelineLayout(ctx_.device, &li, nullptr, &cull_layout_));
+
+    cull_pipeline_    = pipelines_.compute(cull_layout_, shader_dir_ + "/cull.comp.spv");
+    compact_pipeline_ = pipelines_.compute(cull_layout_, shader_dir_ + "/draw_compact.comp.spv");
+    bool pyramid      = depth_pyramid_.init(ctx_, pipelines_, shader_dir_) &&
+                        depth_pyramid_.resize(ctx_, frames_[0].command_pool, swapchain_.depth_view, swapchain_.extent);
+
+    VkShaderModule vert_mod = pipelines_.shader(shader_dir_ + "/mesh_culled.vert.spv");
+    VkShaderModule frag_mod = pipelines_.shader(shader_dir_ + "/mesh_indirect.frag.spv");
+    if (vert_mod && frag_mod) {
+        culled_pipeline_ = pipelines_.graphics(PipelineBuilder()
+            .set_shaders(vert_mod, frag_mod)
+            .set_vertex_layout()
+            .set_topology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST)
+            .set_polygon_mode(VK_POLYGON_MODE_FILL)
+            .set_cull_mode(VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE)
+            .enable_depth_test(true, VK_COMPARE_OP_LESS)
+            .disable_blending()
+            .set_layout(indirect_layout_), main_pass_);
+    }
+
+    if (!cull_pipeline_ || !compact_pipeline_ || !pyramid || !culled_pipeline_) {
+        LOG_WARN("Culling shaders missing from %s, GPU-culled draws disabled", shader_dir_.c_str());
+        return true;
+    }
+
+    for (auto& f : frames_) {
+        f.count_buffer = create_buffer(ctx_.allocator, 2 * sizeof(u32),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VMA_MEMORY_USAGE_GPU_TO_CPU);
+        f.cull_descriptor = descriptor_alloc_.allocate(ctx_.device, cull_set_layout_);
+        write_cull_descriptor(f);
+    }
+
+    gpu_cull_ready_ = true;
+    return true;
+}
+
+// Rewritten every culled frame for its transient slices, and whenever the
+// instance buffers grow or the pyramid is recreated
+void VulkanRenderer::write_cull_descriptor(FrameData& f) {
+    DescriptorWriter()
+        .write_buffer(0, transient_.buffer(), sizeof(CullUBO), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC)
+        .write_buffer(1, transient_.buffer(), slice_range(f.instances), f.instances.offset,
+                      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+        .write_buffer(2, transient_.buffer(), slice_range(f.draws), f.draws.offset,
+                      VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+        .write_buffer(3, f.visible_buffer.buffer, f.visible_buffer.size, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+        .write_image(4, depth_pyramid_.view(), depth_pyramid_.sampler(), VK_IMAGE_LAYOUT_GENERAL)
+        .write_buffer(5, f.compact_buffer.buffer, f.compact_buffer.size, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+        .write_buffer(6, f.count_buffer.buffer, f.count_buffer.size, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+        .update(ctx_.device, f.cull_descriptor);
+}
+
+void VulkanRenderer::set_frustum_culling(bool enabled) {
+    frustum_culling_ = enabled;
+}
+
+void VulkanRenderer::set_draw_path(DrawPath path) {
+    if ((path == DrawPath::Indirect && !indirect_ready_) ||
+        (path == DrawPath::GpuCulled && !gpu_cull_ready_) ||
+        (path == DrawPath::Instanced && !instanced_pipeline_)) {
+        LOG_WARN("%s draw path unavailable on this device", draw_path_name(path));
+        return;
+    }
+    draw_path_ = path;
+}
+
+u32 VulkanRenderer::material_slot(MaterialHandle handle) const {
+    if (!handle.valid() || handle.index >= materials_.size() || handle.index + 1 >= MAX_MATERIALS) return 0;
+    return handle.index + 1;
+}
+
+// Texture i alternates between slots 2i + 1 and 2i + 2; past the end of
+// the array, and before its first mips arrive, it samples the default
+u32 VulkanRenderer::texture_slot(u32 texture) const {
+    u32 version = bindless_versions_[texture];
+    if (version == 0) return 0;
+    u32 slot = 1 + 2 * texture + (version & 1);
+    return slot < texture_slots_ ? slot : 0;
+}
+
+// Points the texture array and the materials at the images the streamer
+// swapped in this frame. Recorded before any draw reads the material table.
+void VulkanRenderer::refresh_streamed_textures(VkCommandBuffer cmd) {
+    for (u32 t = 0; t < bindless_versions_.size(); t++) {
+        u32 version = streamer_.version(t);
+        if (version == bindless_versions_[t]) continue;
+        bindless_versions_[t] = version;
+
+        u32 slot = texture_slot(t);
+        if (bindless_descriptor_ && slot != 0) {
+            const GPUTexture* tex = streamer_.resident(t);
+            DescriptorWriter()
+                .write_image(1, tex->view, tex->sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, slot)
+                .update(ctx_.device, bindless_descriptor_);
+        }
+    }
+
+    bool table_written = false;
+    for (u32 m = 0; m < material_textures_.size(); m++) {
+        auto& mt = material_textures_[m];
+        if (mt.texture == UINT32_MAX) continue;
+        u32 version = streamer_.version(mt.texture);
+        if (version == mt.version) continue;
+        mt.version = version;
+
+        const GPUTexture* tex = streamer_.resident(mt.texture);
+        VkDescriptorSet set = mt.sets[version & 1];
+        DescriptorWriter()
+            .write_image(1, tex->view, tex->sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+            .update(ctx_.device, set);
+        materials_[m].descriptor = set;
+
+        if (!material_table_.buffer || m + 1 >= MAX_MATERIALS) continue;
+        if (!table_written) {
+            // Earlier frames may still be reading the table
+            VkMemoryBarrier war{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+            vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 0, 1, &war, 0, nullptr, 0, nullptr);
+            table_written = true;
+        }
+        u32 slot = texture_slot(mt.texture);
+        vkCmdUpdateBuffer(cmd, material_table_.buffer,
+                          VkDeviceSize(m + 1) * sizeof(MaterialTableEntry) + offsetof(MaterialTableEntry, albedo_texture),
+                          sizeof(slot), &slot);
+    }
+
+    if (table_written) {
+        VkMemoryBarrier mb{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+        mb.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        mb.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                             0, 1, &mb, 0, nullptr, 0, nullptr);
+    }
+}
+
 // --- Swapchain management ---
 
+// The graph's framebuffers and remembered layouts refer to the old images
 void VulkanRenderer::cleanup_swapchain_dependent() {
-    for (auto fb : framebuffers_) vkDestroyFramebuffer(ctx_.device, fb, nullptr);
-    framebuffers_.clear();
-    if (render_pass_) { vkDestroyRenderPass(ctx_.device, render_pass_, nullptr); render_pass_ = VK_NULL_HANDLE; }
+    graph_.invalidate(ctx_);
+    for (auto sem : render_finished_) vkDestroySemaphore(ctx_.device, sem, nullptr);
+    render_finished_.clear();
 }
 
 void VulkanRenderer::recreate_swapchain() {
@@ -320,8 +605,14 @@ void VulkanRenderer::recreate_swapchain() {
     images_in_flight_.clear();
     images_in_flight_.resize(swapchain_.images.size(), VK_NULL_HANDLE);
 
-    create_render_pass();
-    create_framebuffers();
+    create_present_semaphores();
+
+    // The pyramid follows the depth buffer; its old contents are meaningless
+    if (gpu_cull_ready_) {
+        depth_pyramid_.resize(ctx_, frames_[0].command_pool, swapchain_.depth_view, swapchain_.extent);
+        for (auto& f : frames_) write_cull_descriptor(f);
+    }
+    pyramid_valid_ = false;
 }
 
 // --- Frame lifecycle ---
@@ -345,34 +636,58 @@ bool VulkanRenderer::begin_frame() {
 
     vkResetFences(ctx_.device, 1, &f.in_flight);
     vkResetCommandBuffer(f.command_buffer, 0);
+    transient_.begin_frame(current_frame_);
+    frame_number_++;
 
     VkCommandBufferBeginInfo bi{};
     bi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     VK_CHECK(vkBeginCommandBuffer(f.command_buffer, &bi));
+
+    // Everything queued since the last frame goes out in one transfer
+    // submit; uploads that already finished become usable in this one
+    upload_.flush(ctx_);
+    upload_complete_ = upload_.acquire(ctx_, f.command_buffer);
+
+    // Textures whose new mips finished uploading are sampled from this frame on
+    streamer_.update(ctx_, upload_, upload_complete_);
+    refresh_streamed_textures(f.command_buffer);
     return true;
 }
 
 void VulkanRenderer::end_frame() {
     auto& f = frames_[current_frame_];
     VK_CHECK(vkEndCommandBuffer(f.command_buffer));
+    transient_.flush(ctx_);
+
+    // The upload timeline value is already signaled, the wait only orders
+    // the acquired images and streamed geometry before this frame
+    VkSemaphore          wait_semaphores[] = {f.image_available, upload_.semaphore()};
+    VkPipelineStageFlags wait_stages[]     = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                                              VK_PIPELINE_STAGE_ALL_COMMANDS_BIT};
+    u64                  wait_values[]     = {0, upload_complete_};
+
+    VkTimelineSemaphoreSubmitInfo tsi{};
+    tsi.sType                   = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    tsi.waitSemaphoreValueCount = 2;
+    tsi.pWaitSemaphoreValues    = wait_values;
 
-    VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
     VkSubmitInfo si{};
     si.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    si.waitSemaphoreCount   = 1;
-    si.pWaitSemaphores      = &f.image_available;
-    si.pWaitDstStageMask    = &wait_stage;
+    si.pNext                = &tsi;
+    si.waitSemaphoreCount   = 2;
+    si.pWaitSemaphores      = wait_semaphores;
+    si.pWaitDstStageMask    = wait_stages;
     si.commandBufferCount   = 1;
     si.pCommandBuffers      = &f.command_buffer;
     si.signalSemaphoreCount = 1;
-    si.pSignalSemaphores    = &f.render_finished;
+    si.pSignalSemaphores    = &render_finished_[image_index_];
 
     VK_CHECK(vkQueueSubmit(ctx_.graphics_queue, 1, &si, f.in_flight));
 
     VkPresentInfoKHR pi{};
     pi.sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     pi.waitSemaphoreCount = 1;
-    pi.pWaitSemaphores    = &f.render_finished;
+    pi.pWaitSemaphores    = &render_finished_[image_index_];
     pi.swapchainCount     = 1;
     pi.pSwapchains        = &swapchain_.handle;
     pi.pImageIndices      = &image_index_;
@@ -391,31 +706,19 @@ void VulkanRenderer::end_frame() {
 
 MeshHandle VulkanRenderer::upload_mesh(const MeshData& data) {
     GPUMesh mesh;
-    mesh.vertex_count = static_cast<u32>(data.vertices.size());
-    mesh.index_count  = static_cast<u32>(data.indices.size());
-
-    VkDeviceSize vb_size = data.vertices.size() * sizeof(Vertex);
-    VkDeviceSize ib_size = data.indices.size() * sizeof(u32);
-
-    mesh.vertex_buffer = create_buffer(ctx_.allocator, vb_size,
-        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-        VMA_MEMORY_USAGE_GPU_ONLY);
-    mesh.index_buffer = create_buffer(ctx_.allocator, ib_size,
-        VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-        VMA_MEMORY_USAGE_GPU_ONLY);
-
-    upload_to_gpu(ctx_, frames_[0].command_pool, mesh.vertex_buffer, data.vertices.data(), vb_size);
-    upload_to_gpu(ctx_, frames_[0].command_pool, mesh.index_buffer, data.indices.data(), ib_size);
+    if (!geometry_.add(ctx_, frames_[0].command_pool, upload_, data, mesh)) return MeshHandle{};
 
     u32 idx = static_cast<u32>(meshes_.size());
     meshes_.push_back(mesh);
+    mesh_bounds_.push_back(compute_mesh_bounds(data));
     return MeshHandle{idx};
 }
 
+// Returns at once; materials draw with the default texture until the
+// streamer has the first mips on the GPU
 TextureHandle VulkanRenderer::load_texture(const std::string& path) {
-    GPUTexture tex = load_texture_from_file(ctx_, frames_[0].command_pool, path);
-    u32 idx = static_cast<u32>(textures_.size());
-    textures_.push_back(tex);
+    u32 idx = streamer_.load(path);
+    bindless_versions_.push_back(0);
     return TextureHandle{idx};
 }
 
@@ -432,23 +735,54 @@ MaterialHandle VulkanRenderer::create_material(const MaterialData& data) {
         VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
     upload_buffer_data(ctx_.allocator, mat.ubo, &ubo_data, sizeof(ubo_data));
 
-    mat.descriptor = descriptor_alloc_.allocate(ctx_.device, material_set_layout_);
+    // Streamed textures are swapped in once uploaded, only the default
+    // texture has to be there before the material draws
+    mat.upload_ticket = default_texture_.upload_ticket;
+
+    MaterialTextures mt;
+    if (data.albedo_texture.valid() && data.albedo_texture.index < streamer_.count()) {
+        mt.texture = data.albedo_texture.index;
+        mt.version = streamer_.version(mt.texture);
+    }
 
-    GPUTexture* tex = data.albedo_texture.valid() ? &textures_[data.albedo_texture.index] : &default_texture_;
+    u32 set_count = mt.texture != UINT32_MAX ? 2 : 1;
+    for (u32 i = 0; i < set_count; i++) {
+        const GPUTexture* tex = mt.texture != UINT32_MAX && i == (mt.version & 1)
+                              ? streamer_.resident(mt.texture) : nullptr;
+        if (!tex) tex = &default_texture_;
 
-    DescriptorWriter()
-        .write_buffer(0, mat.ubo.buffer, sizeof(MaterialUBOData), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
-        .write_image(1, tex->view, tex->sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
-        .update(ctx_.device, mat.descriptor);
+        mt.sets[i] = descriptor_alloc_.allocate(ctx_.device, material_set_layout_);
+        DescriptorWriter()
+            .write_buffer(0, mat.ubo.buffer, sizeof(MaterialUBOData), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+            .write_image(1, tex->view, tex->sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+            .update(ctx_.device, mt.sets[i]);
+    }
+    mat.descriptor = mt.sets[mt.texture != UINT32_MAX ? mt.version & 1 : 0];
 
     u32 idx = static_cast<u32>(materials_.size());
     materials_.push_back(mat);
+    material_textures_.push_back(mt);
+
+    // Table slots past the end fall back to the default material
+    if (material_table_.buffer && idx + 1 < MAX_MATERIALS) {
+        MaterialTableEntry entry{};
+        entry.base_color     = data.base_color;
+        entry.metallic       = data.metallic;
+        entry.roughness      = data.roughness;
+        entry.ao             = data.ao;
+        entry.albedo_texture = mt.texture != UINT32_MAX ? texture_slot(mt.texture) : 0;
+        upload_buffer_data(ctx_.allocator, material_table_, &entry, sizeof(entry),
+                           VkDeviceSize(idx + 1) * sizeof(MaterialTableEntry));
+    } else if (material_table_.buffer) {
+        LOG_WARN("Material table full, material %u draws with defaults on the indirect path", idx);
+    }
     return MaterialHandle{idx};
 }
 
 // --- Scene rendering ---
 
 void VulkanRenderer::render_scene(Scene& scene, const Camera& camera) {
+    auto record_start = std::chrono::steady_clock::now();
     auto& f = frames_[current_frame_];
     VkCommandBuffer cmd = f.command_buffer;
 
@@ -459,47 +793,165 @@ void VulkanRenderer::render_scene(Scene& scene, const Camera& camera) {
     global.camera_pos  = glm::vec4(camera.position(), 1.0f);
     global.ambient_color = glm::vec4(0.08f, 0.08f, 0.12f, 0.3f);
 
-    // Gather lights
-    LightUBO light_data{};
-    int light_count = 0;
-    auto light_view = scene.view<Transform, LightComponent>();
-    for (auto entity : light_view) {
-        if (light_count >= 16) break;
-        auto& t = light_view.get<Transform>(entity);
-        auto& l = light_view.get<LightComponent>(entity);
-
-        auto& gl = light_data.lights[light_count];
-        gl.position  = glm::vec4(t.position, l.type == LightType::Directional ? 0.0f : 1.0f);
-        gl.color     = glm::vec4(l.color, l.intensity);
-        gl.direction = glm::vec4(glm::normalize(glm::vec3(
-            cos(glm::radians(t.rotation.y)) * cos(glm::radians(t.rotation.x)),
-            sin(glm::radians(t.rotation.x)),
-            sin(glm::radians(t.rotation.y)) * cos(glm::radians(t.rotation.x))
-        )), 0.0f);
-        gl.params = glm::vec4(l.range, cos(glm::radians(l.spot_angle)), static_cast<float>(static_cast<int>(l.type)), 0.0f);
-        light_count++;
-    }
-    global.num_lights = light_count;
-
-    upload_buffer_data(ctx_.allocator, f.global_ubo, &global, sizeof(global));
-    upload_buffer_data(ctx_.allocator, f.light_ubo, &light_data, sizeof(light_data));
-
-    // Begin render pass
-    VkRenderPassBeginInfo rpbi{};
-    rpbi.sType       = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    rpbi.renderPass  = render_pass_;
-    rpbi.framebuffer = framebuffers_[image_index_];
-    rpbi.renderArea  = {{0, 0}, swapchain_.extent};
-
-    VkClearValue clears[2];
-    clears[0].color = {{0.02f, 0.02f, 0.03f, 1.0f}};
-    clears[1].depthStencil = {1.0f, 0};
-    rpbi.clearValueCount = 2;
-    rpbi.pClearValues    = clears;
-
-    vkCmdBeginRenderPass(cmd, &rpbi, VK_SUBPASS_CONTENTS_INLINE);
-
-    // Negative viewport height flips Y for Vulkan (core since 1.1)
+    // Lights, bucketed into the froxels of this camera
+    light_clusters_.gather(scene);
+    light_clusters_.build(camera);
+    const auto& lights = light_clusters_.lights();
+    const auto& lists  = light_clusters_.lists();
+    global.num_lights = static_cast<int>(lights.size());
+
+    stats_ = {};
+    stats_.path       = draw_path_;
+    stats_.lights     = static_cast<u32>(lights.size());
+    stats_.light_refs = light_clusters_.references();
+    gather_draw_items(scene, camera);
+    gather_emitters(scene);
+    if (draw_path_ != DrawPath::Direct) build_batches();
+
+    // Shadowed lights are pointed at their views before the upload
+    if (shadows_enabled_ && shadows_.ready())
+        shadows_.update(camera, light_clusters_, shadow_casters_, static_caster_hash_);
+    else
+        shadows_.clear();
+
+    // Grow the transient ring before anything of this frame lands in it
+    bool gpu_culled = draw_path_ == DrawPath::GpuCulled;
+    VkDeviceSize transient_bytes = transient_.aligned(sizeof(GlobalUBO)) + transient_.aligned(sizeof(LightGridUBO)) +
+                                   transient_.aligned(lights.size() * sizeof(GPULight)) +
+                                   transient_.aligned(lists.size() * sizeof(u32));
+    if (draw_path_ != DrawPath::Direct) {
+        transient_bytes += transient_.aligned(instance_scratch_.size() * sizeof(GPUInstance)) +
+                           transient_.aligned(batches_.size() * sizeof(VkDrawIndexedIndirectCommand));
+    }
+    if (gpu_culled) transient_bytes += transient_.aligned(sizeof(CullUBO));
+    transient_bytes += transient_.aligned(particles_.emitters() * sizeof(GPUEmitter));
+    transient_bytes += transient_.aligned(sizeof(ShadowUBO)) + shadows_.views() * transient_.aligned(sizeof(glm::mat4));
+    if (transient_.reserve(ctx_, transient_bytes)) {
+        for (auto& other : frames_) {
+            other.instances = {};
+            other.draws     = {};
+            other.lights    = {};
+            other.clusters  = {};
+            write_global_descriptor(other);
+            if (other.cull_descriptor) write_cull_descriptor(other);
+        }
+    }
+
+    f.ubo_offsets[0] = static_cast<u32>(transient_.push(&global, sizeof(global)).offset);
+    f.ubo_offsets[1] = static_cast<u32>(transient_.push(&light_clusters_.grid(), sizeof(LightGridUBO)).offset);
+    f.ubo_offsets[2] = static_cast<u32>(transient_.push(&shadows_.ubo(), sizeof(ShadowUBO)).offset);
+    f.lights   = transient_.push(lights.data(), lights.size() * sizeof(GPULight));
+    f.clusters = transient_.push(lists.data(), lists.size() * sizeof(u32));
+    write_global_descriptor(f);
+
+    // The swapchain image and depth through the graph. Culling and the
+    // shadow passes place barriers of their own and are kept; the shadow
+    // atlas is left readable by fragment shaders.
+    glm::mat4 view_projection = camera.projection() * camera.view();
+    graph_.begin(current_frame_);
+    RGImage target = graph_.import_image("swapchain", {swapchain_.images[image_index_],
+        swapchain_.image_views[image_index_], swapchain_.image_format, swapchain_.extent});
+    RGImage depth  = graph_.import_image("depth", {swapchain_.depth_image, swapchain_.depth_view,
+        swapchain_.depth_format, swapchain_.extent});
+    RGImage atlas  = graph_.import_image("shadow atlas", {shadows_.image(), shadows_.view(), VK_FORMAT_D32_SFLOAT,
+        {ShadowMaps::ATLAS_SIZE, ShadowMaps::ATLAS_SIZE}}, RGUsage::SampledFragment);
+    graph_.set_final(target, RGUsage::Present);
+
+    // Lit in HDR when post-processing resolves it onto the swapchain
+    bool    post  = post_.ready();
+    RGImage color = post ? graph_.create_image("hdr", PostProcess::HDR_FORMAT, swapchain_.extent) : target;
+
+    if (gpu_culled) {
+        graph_.add_pass("cull")
+            .keep()
+            .record([&](VkCommandBuffer pass_cmd) { record_gpu_cull(f, pass_cmd, view_projection); });
+    }
+    graph_.add_pass("shadows")
+        .keep()
+        .record([&](VkCommandBuffer pass_cmd) {
+            shadows_.record(ctx_, pass_cmd, current_frame_, transient_, geometry_, meshes_);
+        });
+    if (particles_.emitters() > 0) {
+        graph_.add_pass("particles")
+            .keep()
+            .record([&](VkCommandBuffer pass_cmd) { particles_.record(ctx_, pass_cmd, current_frame_, transient_); });
+    }
+
+    // The batched instances are uploaded up front, as the set they are
+    // bound through cannot be written while other threads record with it
+    if (draw_path_ == DrawPath::Instanced && !instance_scratch_.empty()) upload_instances(f);
+
+    u32 chunks = record_chunk_count();
+    RenderGraph::PassBuilder forward = graph_.add_pass("forward");
+    forward.color(color, VK_ATTACHMENT_LOAD_OP_CLEAR, {{0.02f, 0.02f, 0.03f, 1.0f}})
+        .depth(depth)
+        .read(atlas, RGUsage::SampledFragment);
+    if (chunks > 1) {
+        forward.secondary().record([&](VkCommandBuffer pass_cmd) { record_parallel(f, pass_cmd, chunks, camera); });
+    } else {
+        forward.record([&](VkCommandBuffer pass_cmd) {
+            set_main_viewport(pass_cmd);
+            switch (draw_path_) {
+                case DrawPath::Direct:
+                    stats_.draw_calls += record_direct(f, pass_cmd, 0, static_cast<u32>(draw_items_.size()));
+                    break;
+                case DrawPath::Instanced:
+                    stats_.draw_calls += record_instanced(f, pass_cmd, 0, static_cast<u32>(batches_.size()));
+                    break;
+                case DrawPath::Indirect:  record_indirect(f, pass_cmd); break;
+                case DrawPath::GpuCulled: record_culled(f, pass_cmd); break;
+            }
+            particles_.draw(pass_cmd, camera.view(), camera.projection());
+        });
+    }
+
+    // This frame's depth holds the occluders for the next one; the pyramid
+    // lives outside the graph, so the pass is kept
+    if (gpu_culled) {
+        graph_.add_pass("depth pyramid")
+            .read(depth, RGUsage::SampledCompute)
+            .keep()
+            .record([&](VkCommandBuffer pass_cmd) { depth_pyramid_.build(pass_cmd); });
+        pyramid_view_projection_ = view_projection;
+    }
+    pyramid_valid_ = gpu_culled;
+
+    if (post) post_.add_passes(graph_, current_frame_, color, depth, target, swapchain_.extent, camera.projection());
+
+    if (graph_.compile(ctx_)) graph_.execute(cmd);
+    stats_.passes        = graph_.passes();
+    stats_.passes_culled = graph_.culled();
+    stats_.barriers      = graph_.barriers();
+    stats_.shadow_views  = shadows_.views();
+    stats_.shadow_cached = shadows_.views() - shadows_.refreshed();
+    stats_.shadow_draws  = shadows_.draw_calls();
+    stats_.emitters      = particles_.emitters();
+    stats_.particles     = particles_.slots();
+    for (const auto& t : graph_.timings()) stats_.gpu_ms += t.ms;
+
+    stats_.record_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - record_start).count();
+}
+
+// Emitters go to the particle system by entity; their pools live on the
+// GPU, so the CPU work here is per emitter
+void VulkanRenderer::gather_emitters(Scene& scene) {
+    particle_emitters_.clear();
+    if (!particles_.ready()) return;
+
+    auto view = scene.registry().view<WorldMatrix, ParticleEmitterComponent>();
+    for (auto entity : view) {
+        const auto& world = view.get<WorldMatrix>(entity);
+        particle_emitters_.push_back({static_cast<u32>(entity), glm::vec3(world.matrix[3]),
+                                      &view.get<ParticleEmitterComponent>(entity)});
+    }
+    particles_.update(ctx_, particle_emitters_);
+}
+
+// --- Main pass recording ---
+
+// Negative viewport height flips Y for Vulkan (core since 1.1)
+void VulkanRenderer::set_main_viewport(VkCommandBuffer cmd) const {
     VkViewport vp{};
     vp.x        = 0.0f;
     vp.y        = static_cast<float>(swapchain_.extent.height);
@@ -511,41 +963,371 @@ void VulkanRenderer::render_scene(Scene& scene, const Camera& camera) {
 
     VkRect2D scissor{{0, 0}, swapchain_.extent};
     vkCmdSetScissor(cmd, 0, 1, &scissor);
+}
+
+// Secondary command buffers the main pass is split over this frame, 0 to
+// record it inline. Only the direct and instanced paths record a command
+// list that grows with the scene.
+u32 VulkanRenderer::record_chunk_count() const {
+    if (!parallel_recording()) return 0;
+    u32 items = 0;
+    if (draw_path_ == DrawPath::Direct)         items = static_cast<u32>(draw_items_.size());
+    else if (draw_path_ == DrawPath::Instanced) items = static_cast<u32>(batches_.size());
+    u32 chunks = std::min(items / MIN_RECORD_CHUNK, jobs_->thread_count());
+    return chunks > 1 ? chunks : 0;
+}
+
+// Splits the draw list evenly over chunks secondary command buffers, each
+// recorded on the job system from a pool of its own, and executes them in
+// order. Each secondary starts from no state, so it sets the viewport and
+// binds everything again. The particles go last in the last one, after
+// every opaque draw as on the inline path.
+void VulkanRenderer::record_parallel(FrameData& f, VkCommandBuffer cmd, u32 chunks, const Camera& camera) {
+    VkCommandBufferInheritanceInfo inheritance = graph_.inheritance();
+    bool direct = draw_path_ == DrawPath::Direct;
+    u32  items  = static_cast<u32>(direct ? draw_items_.size() : batches_.size());
+    u32  per_chunk = (items + chunks - 1) / chunks;
+
+    std::array<u32, MAX_RECORD_CHUNKS> draw_calls{};
+    jobs_->parallel_for(chunks, 1, [&](u32 begin, u32 end) {
+        for (u32 c = begin; c < end; c++) {
+            VK_CHECK(vkResetCommandPool(ctx_.device, f.record_pools[c], 0));
+            VkCommandBuffer sec = f.secondaries[c];
+
+            VkCommandBufferBeginInfo bi{};
+            bi.sType            = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            bi.flags            = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+                                  VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+            bi.pInheritanceInfo = &inheritance;
+            VK_CHECK(vkBeginCommandBuffer(sec, &bi));
+
+            set_main_viewport(sec);
+            u32 first = std::min(items, c * per_chunk);
+            u32 last  = std::min(items, first + per_chunk);
+            draw_calls[c] = direct ? record_direct(f, sec, first, last) : record_instanced(f, sec, first, last);
+            if (c == chunks - 1) particles_.draw(sec, camera.view(), camera.projection());
+
+            VK_CHECK(vkEndCommandBuffer(sec));
+        }
+    });
+
+    vkCmdExecuteCommands(cmd, chunks, f.secondaries.data());
+    for (u32 c = 0; c < chunks; c++) stats_.draw_calls += draw_calls[c];
+    stats_.record_chunks = chunks;
+}
 
+// One push, one set bind, two buffer binds and one draw per entity
+u32 VulkanRenderer::record_direct(const FrameData& f, VkCommandBuffer cmd, u32 begin, u32 end) const {
     // Bind pipeline and global descriptors
     vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_);
     vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_,
-                            0, 1, &f.global_descriptor, 0, nullptr);
+                            0, 1, &f.global_descriptor, 3, f.ubo_offsets);
 
-    // Draw each mesh entity
-    auto mesh_view = scene.view<Transform, MeshComponent>();
-    for (auto entity : mesh_view) {
-        auto& transform = mesh_view.get<Transform>(entity);
-        auto& mc = mesh_view.get<MeshComponent>(entity);
-
-        if (!mc.mesh.valid() || mc.mesh.index >= meshes_.size()) continue;
-        auto& gpu_mesh = meshes_[mc.mesh.index];
+    // Draw each visible mesh entity
+    for (u32 i = begin; i < end; i++) {
+        const auto& item     = draw_items_[i];
+        const auto& gpu_mesh = meshes_[item.mesh];
 
         // Push model matrix
         PushConstants pc{};
-        pc.model = transform.matrix();
+        pc.model = *item.model;
         vkCmdPushConstants(cmd, pipeline_layout_, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pc), &pc);
 
         // Bind material
-        VkDescriptorSet mat_set = default_material_.descriptor;
-        if (mc.material.valid() && mc.material.index < materials_.size())
-            mat_set = materials_[mc.material.index].descriptor;
+        VkDescriptorSet mat_set = item.material != UINT32_MAX ? materials_[item.material].descriptor
+                                                              : default_material_.descriptor;
         vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_,
                                 1, 1, &mat_set, 0, nullptr);
 
         // Draw
         VkDeviceSize offset = 0;
-        vkCmdBindVertexBuffers(cmd, 0, 1, &gpu_mesh.vertex_buffer.buffer, &offset);
-        vkCmdBindIndexBuffer(cmd, gpu_mesh.index_buffer.buffer, 0, VK_INDEX_TYPE_UINT32);
-        vkCmdDrawIndexed(cmd, gpu_mesh.index_count, 1, 0, 0, 0);
+        vkCmdBindVertexBuffers(cmd, 0, 1, &geometry_.vertex_buffer(), &offset);
+        vkCmdBindIndexBuffer(cmd, geometry_.index_buffer(), 0, VK_INDEX_TYPE_UINT32);
+        vkCmdDrawIndexed(cmd, gpu_mesh.index_count, 1, gpu_mesh.first_index, gpu_mesh.vertex_offset, 0);
     }
+    return end - begin;
+}
+
+// Brings the scene's world matrices up to date, refreshes the bounding
+// sphere of every mesh entity whose matrix or mesh changed, then drops the
+// ones outside the camera frustum. Leaves the survivors in draw_items_. The GPU-culled path
+// skips the CPU test, cull.comp does it. Every ready entity goes into
+// shadow_casters_ beforehand, since shadows reach in from off screen.
+void VulkanRenderer::gather_draw_items(Scene& scene, const Camera& camera) {
+    auto& registry = scene.registry();
+    scene.update_world_matrices();
+
+    // First sighting: the empty cache entry never matches, so it is filled below
+    uncached_.clear();
+    for (auto entity : registry.view<WorldMatrix, MeshComponent>(entt::exclude<RenderBounds>))
+        uncached_.push_back(entity);
+    for (auto entity : uncached_) registry.emplace<RenderBounds>(entity);
+
+    draw_items_.clear();
+    culling_.clear();
+    shadow_casters_.clear();
+    static_caster_hash_ = 0;
+
+    auto mesh_view = registry.view<WorldMatrix, MeshComponent, RenderBounds>();
+    for (auto entity : mesh_view) {
+        auto& mc = mesh_view.get<MeshComponent>(entity);
+        if (!mc.mesh.valid() || mc.mesh.index >= meshes_.size()) continue;
+        u32 material = mc.material.valid() && mc.material.index < materials_.size() ? mc.material.index : UINT32_MAX;
+
+        // Still streaming in
+        const GPUMaterial& mat = material == UINT32_MAX ? default_material_ : materials_[material];
+        if (meshes_[mc.mesh.index].upload_ticket > upload_complete_ || mat.upload_ticket > upload_complete_)
+            continue;
+
+        auto& world_matrix = mesh_view.get<WorldMatrix>(entity);
+        auto& rb = mesh_view.get<RenderBounds>(entity);
+        if (rb.mesh != mc.mesh || rb.version != world_matrix.version) {
+            rb.mesh    = mc.mesh;
+            rb.version = world_matrix.version;
+            BoundingSphere world = transform_sphere(mesh_bounds_[mc.mesh.index].sphere, world_matrix.matrix);
+            rb.center = world.center;
+            rb.radius = world.radius;
+            rb.moved_frame = frame_number_;
+            stats_.bounds_updated++;
+        }
+
+        draw_items_.push_back({&world_matrix.matrix, &rb, mc.mesh.index, material});
+        culling_.add({rb.center, rb.radius});
+
+        if (shadows_enabled_) {
+            bool is_static = frame_number_ - rb.moved_frame >= ShadowMaps::STATIC_FRAMES;
+            shadow_casters_.push_back({&world_matrix.matrix, {rb.center, rb.radius}, mc.mesh.index, is_static});
+            if (is_static) {
+                // splitmix64 finalizer; a sum does not depend on view order
+                u64 h = (u64(entt::to_integral(entity)) << 32) ^ (u64(rb.version) << 8) ^ mc.mesh.index;
+                h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+                h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+                static_caster_hash_ += h ^ (h >> 31);
+            }
+        }
+    }
+
+    if (frustum_culling_ && draw_path_ != DrawPath::GpuCulled) {
+        culling_.cull(Frustum::from_view_projection(camera.projection() * camera.view()), visible_);
+        u32 kept = 0;
+        for (u32 i = 0; i < draw_items_.size(); i++)
+            if (visible_[i]) draw_items_[kept++] = draw_items_[i];
+        stats_.culled = static_cast<u32>(draw_items_.size()) - kept;
+        draw_items_.resize(kept);
+    }
+    stats_.objects = static_cast<u32>(draw_items_.size());
+
+    // Screen-space demand for the streamer: the projected diameter of the
+    // bounding sphere, taking the texture to span the object once
+    float pixels_per_unit = std::abs(camera.projection()[1][1]) * static_cast<float>(swapchain_.extent.height);
+    glm::vec3 eye = camera.position();
+    for (const auto& item : draw_items_) {
+        if (item.material == UINT32_MAX) continue;
+        u32 texture = material_textures_[item.material].texture;
+        if (texture == UINT32_MAX) continue;
+        float distance = std::max(glm::length(item.bounds->center - eye), item.bounds->radius);
+        streamer_.request(texture, item.bounds->radius * pixels_per_unit / std::max(distance, 1e-4f));
+    }
+    stats_.texture_mb = static_cast<double>(streamer_.resident_bytes()) / (1024.0 * 1024.0);
+}
+
+// Buckets the visible items by (mesh, material) in first-seen order and
+// writes their instances contiguously per bucket. Two passes keep it
+// linear: count per bucket, then scatter into the prefix offsets.
+void VulkanRenderer::build_batches() {
+    batches_.clear();
+    batch_lookup_.clear();
+    batch_of_.clear();
+    instance_scratch_.clear();
+
+    for (const auto& item : draw_items_) {
+        u64 key = (u64(item.mesh) << 32) | item.material;
+        auto [it, added] = batch_lookup_.try_emplace(key, static_cast<u32>(batches_.size()));
+        if (added) batches_.push_back({item.mesh, item.material, 0, 0});
+        batches_[it->second].instance_count++;
+        batch_of_.push_back(it->second);
+    }
+
+    u32 total = 0;
+    for (auto& b : batches_) {
+        b.first_instance = total;
+        total += b.instance_count;
+        b.instance_count = 0; // reused as the scatter cursor
+    }
+    instance_scratch_.resize(total);
+
+    for (size_t i = 0; i < draw_items_.size(); i++) {
+        auto& b = batches_[batch_of_[i]];
+        const RenderBounds& rb = *draw_items_[i].bounds;
+        GPUInstance& inst = instance_scratch_[b.first_instance + b.instance_count++];
+        inst.model    = *draw_items_[i].model;
+        inst.material = material_slot(MaterialHandle{b.material});
+        inst.batch    = batch_of_[i];
+        inst.sphere   = glm::vec4(rb.center, rb.radius);
+    }
+
+    stats_.batches = static_cast<u32>(batches_.size());
+}
 
-    vkCmdEndRenderPass(cmd);
+// One instanced vkCmdDrawIndexed per bucket; the material set is rebound
+// only when it changes. The instances are uploaded by then.
+u32 VulkanRenderer::record_instanced(const FrameData& f, VkCommandBuffer cmd, u32 begin, u32 end) const {
+    if (begin >= end) return 0;
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, instanced_pipeline_);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_,
+                            0, 1, &f.global_descriptor, 3, f.ubo_offsets);
+    geometry_.bind(cmd);
+
+    VkDescriptorSet bound = VK_NULL_HANDLE;
+    for (u32 i = begin; i < end; i++) {
+        const auto& b = batches_[i];
+        VkDescriptorSet mat_set = b.material != UINT32_MAX ? materials_[b.material].descriptor
+                                                           : default_material_.descriptor;
+        if (mat_set != bound) {
+            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout_,
+                                    1, 1, &mat_set, 0, nullptr);
+            bound = mat_set;
+        }
+        const auto& gpu_mesh = meshes_[b.mesh];
+        vkCmdDrawIndexed(cmd, gpu_mesh.index_count, b.instance_count, gpu_mesh.first_index,
+                         gpu_mesh.vertex_offset, b.first_instance);
+    }
+    return end - begin;
+}
+
+// Copies the bucketed instances into the transient ring and points set 0
+// binding 2 at them
+void VulkanRenderer::upload_instances(FrameData& f) {
+    u32 count = static_cast<u32>(instance_scratch_.size());
+    ensure_instance_capacity(f, count);
+    f.instances = transient_.push(instance_scratch_.data(), count * sizeof(GPUInstance));
+    write_global_descriptor(f);
+}
+
+// Uploads the bucketed instances and one indirect command per bucket.
+// With empty_draws the commands start at zero instances for cull.comp to
+// fill in. Returns the command count.
+u32 VulkanRenderer::upload_indirect(FrameData& f, bool empty_draws) {
+    draw_scratch_.clear();
+    for (const auto& b : batches_) {
+        const auto& gpu_mesh = meshes_[b.mesh];
+        draw_scratch_.push_back({gpu_mesh.index_count, empty_draws ? 0u : b.instance_count,
+                                 gpu_mesh.first_index, gpu_mesh.vertex_offset, b.first_instance});
+    }
+    u32 draws = static_cast<u32>(draw_scratch_.size());
+
+    upload_instances(f);
+    f.draws = transient_.push(draw_scratch_.data(), draws * sizeof(VkDrawIndexedIndirectCommand));
+    return draws;
+}
+
+// Same buckets, one indirect command each; the GPU reads the model matrix
+// and material slot through gl_InstanceIndex
+void VulkanRenderer::record_indirect(FrameData& f, VkCommandBuffer cmd) {
+    if (instance_scratch_.empty()) return;
+    u32 draws = upload_indirect(f, false);
+
+    VkDescriptorSet sets[] = {f.global_descriptor, bindless_descriptor_};
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, indirect_pipeline_);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, indirect_layout_, 0, 2, sets, 3, f.ubo_offsets);
+    geometry_.bind(cmd);
+
+    // One call unless multiDrawIndirect is missing or the device caps the count
+    u32 batch = std::max(1u, ctx_.features.max_draw_indirect_count);
+    for (u32 first = 0; first < draws; first += batch) {
+        vkCmdDrawIndexedIndirect(cmd, transient_.buffer(),
+                                 f.draws.offset + VkDeviceSize(first) * sizeof(VkDrawIndexedIndirectCommand),
+                                 std::min(batch, draws - first), sizeof(VkDrawIndexedIndirectCommand));
+        stats_.draw_calls++;
+    }
+}
+
+// Every candidate goes to the GPU: cull.comp keeps the instances inside the
+// frustum and not hidden behind last frame's depth, then draw_compact.comp
+// packs the commands that kept any. Objects that come out from behind an
+// occluder show up one frame late.
+void VulkanRenderer::record_gpu_cull(FrameData& f, VkCommandBuffer cmd, const glm::mat4& view_projection) {
+    // This slot's fence has been waited on, so its last result is final
+    if (f.cull_pending) {
+        u32 counts[2];
+        read_buffer_data(ctx_.allocator, f.count_buffer, counts, sizeof(counts));
+        stats_.gpu_visible = counts[1];
+        f.cull_pending = false;
+    }
+
+    u32 count = static_cast<u32>(instance_scratch_.size());
+    if (count == 0) return;
+    u32 draws = upload_indirect(f, true);
+
+    CullUBO cull{};
+    cull.view_projection = pyramid_view_projection_;
+    Frustum frustum = Frustum::from_view_projection(view_projection);
+    for (int i = 0; i < 6; i++) cull.planes[i] = frustum.planes[i];
+    cull.pyramid_size   = glm::vec2(depth_pyramid_.width(), depth_pyramid_.height());
+    cull.instance_count = count;
+    cull.draw_count     = draws;
+    cull.occlusion      = pyramid_valid_ ? 1u : 0u;
+    f.cull_offset = static_cast<u32>(transient_.push(&cull, sizeof(cull)).offset);
+    write_cull_descriptor(f);
+
+    vkCmdFillBuffer(cmd, f.count_buffer.buffer, 0, VK_WHOLE_SIZE, 0);
+
+    // The fill, and the previous frame's pyramid writes, before culling
+    VkMemoryBarrier barrier{};
+    barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cull_layout_, 0, 1, &f.cull_descriptor,
+                            1, &f.cull_offset);
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, cull_pipeline_);
+    vkCmdDispatch(cmd, (count + 63) / 64, 1, 1);
+
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, compact_pipeline_);
+    vkCmdDispatch(cmd, (draws + 63) / 64, 1, 1);
+
+    // Commands and counts to the draw, visible ids to the vertex shader and
+    // the counts to the host for the stats read back later
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                         VK_PIPELINE_STAGE_HOST_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+    f.cull_pending = true;
+}
+
+// Draws what record_gpu_cull left. Without drawIndirectCount the per-bucket
+// commands are drawn as they are, the culled ones with zero instances.
+void VulkanRenderer::record_culled(FrameData& f, VkCommandBuffer cmd) {
+    if (instance_scratch_.empty()) return;
+    u32 draws = static_cast<u32>(batches_.size());
+
+    VkDescriptorSet sets[] = {f.global_descriptor, bindless_descriptor_};
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, culled_pipeline_);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, indirect_layout_, 0, 2, sets, 3, f.ubo_offsets);
+    geometry_.bind(cmd);
+
+    constexpr u32 stride = sizeof(VkDrawIndexedIndirectCommand);
+    u32 batch = std::max(1u, ctx_.features.max_draw_indirect_count);
+    if (ctx_.features.draw_indirect_count && draws <= batch) {
+        vkCmdDrawIndexedIndirectCount(cmd, f.compact_buffer.buffer, 0, f.count_buffer.buffer, 0, draws, stride);
+        stats_.draw_calls++;
+        return;
+    }
+    for (u32 first = 0; first < draws; first += batch) {
+        vkCmdDrawIndexedIndirect(cmd, transient_.buffer(), f.draws.offset + VkDeviceSize(first) * stride,
+                                 std::min(batch, draws - first), stride);
+        stats_.draw_calls++;
+    }
 }
 
 } // namespace lumios
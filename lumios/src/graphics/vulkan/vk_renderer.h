@@ -5,61 +5,224 @@
 #include "vk_init.h"
 #include "vk_swapchain.h"
 #include "vk_descriptors.h"
+#include "vk_geometry.h"
+#include "vk_pipeline.h"
+#include "vk_upload.h"
+#include "vk_transient.h"
+#include "vk_texture_streamer.h"
+#include "vk_depth_pyramid.h"
+#include "vk_shadows.h"
+#include "vk_render_graph.h"
+#include "vk_post_process.h"
+#include "vk_particles.h"
+#include "../culling.h"
+#include "../light_clusters.h"
+#include "../../core/job_system.h"
+#include <entt/entt.hpp>
 #include <array>
 
 namespace lumios {
 
+struct RenderBounds;
+
 class VulkanRenderer : public Renderer {
+public:
+    // Forward draws split over at most this many secondary command buffers
+    static constexpr u32 MAX_RECORD_CHUNKS = 16;
+
+private:
     VulkanContext    ctx_;
     VulkanSwapchain  swapchain_;
-    VkRenderPass     render_pass_ = VK_NULL_HANDLE;
-    std::vector<VkFramebuffer> framebuffers_;
+    std::vector<VkSemaphore>   render_finished_; // per swapchain image, waited on by its present
+
+    // Passes of a frame, declared again each render_scene. The main pass's
+    // pipelines are built against main_pass_, owned by the graph; it
+    // renders to an HDR target resolved by post_, or straight to the
+    // swapchain when post-processing is unavailable.
+    RenderGraph  graph_;
+    VkRenderPass main_pass_ = VK_NULL_HANDLE;
+    PostProcess  post_;
 
     struct FrameData {
         VkCommandPool   command_pool   = VK_NULL_HANDLE;
         VkCommandBuffer command_buffer = VK_NULL_HANDLE;
         VkSemaphore     image_available = VK_NULL_HANDLE;
-        VkSemaphore     render_finished = VK_NULL_HANDLE;
         VkFence         in_flight       = VK_NULL_HANDLE;
-        GPUBuffer       global_ubo;
-        GPUBuffer       light_ubo;
         VkDescriptorSet global_descriptor = VK_NULL_HANDLE;
+        u32             instance_capacity = 0; // of the GPU-culled buffers below
+
+        // This frame's slices of transient_
+        u32                            ubo_offsets[3] = {}; // GlobalUBO, LightGridUBO, ShadowUBO: set 0 dynamic offsets
+        TransientAllocator::Allocation instances;           // GPUInstance[], set 0 binding 2
+        TransientAllocator::Allocation lights;              // GPULight[], set 0 binding 4
+        TransientAllocator::Allocation clusters;            // LightClusters::lists(), set 0 binding 5
+        TransientAllocator::Allocation draws;               // VkDrawIndexedIndirectCommand[]
+        u32                            cull_offset = 0;     // CullUBO: cull set dynamic offset
+
+        // GPU-culled path
+        GPUBuffer       visible_buffer;    // u32[] instance ids kept by cull.comp, set 0 binding 3
+        GPUBuffer       compact_buffer;    // draws with instances left, packed by draw_compact.comp
+        GPUBuffer       count_buffer;      // {draw count, visible instances}, read back for stats
+        VkDescriptorSet cull_descriptor = VK_NULL_HANDLE;
+        bool            cull_pending    = false; // count_buffer holds a result not read yet
+
+        // Parallel forward recording: one pool per chunk, so no two threads
+        // ever record from the same pool; each pool is reset whole per frame
+        std::array<VkCommandPool, MAX_RECORD_CHUNKS>   record_pools{};
+        std::array<VkCommandBuffer, MAX_RECORD_CHUNKS> secondaries{};
     };
 
+    // MAX_FRAMES_IN_FLIGHT slots, independent of the swapchain image count
     std::vector<FrameData> frames_;
+    TransientAllocator     transient_; // everything a frame rebuilds: uniforms, instances, draws
     u32 frame_count_   = 0;
     u32 current_frame_ = 0;
     u32 image_index_   = 0;
+    u64 frame_number_  = 0; // frames begun, dates RenderBounds::moved_frame
 
+    // Every pipeline below is owned by the registry
+    PipelineRegistry pipelines_;
     VkPipelineLayout pipeline_layout_ = VK_NULL_HANDLE;
     VkPipeline       pipeline_        = VK_NULL_HANDLE;
+    VkPipeline       instanced_pipeline_ = VK_NULL_HANDLE;
+
+    VkPipelineLayout indirect_layout_   = VK_NULL_HANDLE;
+    VkPipeline       indirect_pipeline_ = VK_NULL_HANDLE;
 
     DescriptorAllocator descriptor_alloc_;
     VkDescriptorSetLayout global_set_layout_   = VK_NULL_HANDLE;
     VkDescriptorSetLayout material_set_layout_ = VK_NULL_HANDLE;
 
+    // Indirect path: one material table and one texture array for every draw.
+    // Slot 0 holds the defaults, handle i lives in slot i + 1.
+    DescriptorAllocator   bindless_alloc_;
+    VkDescriptorSetLayout bindless_set_layout_ = VK_NULL_HANDLE;
+    VkDescriptorSet       bindless_descriptor_ = VK_NULL_HANDLE;
+    GPUBuffer             material_table_;
+    u32                   texture_slots_  = 0;
+    bool                  indirect_ready_ = false;
+
+    // GPU-culled path: cull.comp tests every instance against the frustum
+    // and the depth pyramid of the previous frame, draw_compact.comp packs
+    // the draws that kept instances for vkCmdDrawIndexedIndirectCount
+    VkDescriptorSetLayout cull_set_layout_  = VK_NULL_HANDLE;
+    VkPipelineLayout      cull_layout_      = VK_NULL_HANDLE;
+    VkPipeline            cull_pipeline_    = VK_NULL_HANDLE;
+    VkPipeline            compact_pipeline_ = VK_NULL_HANDLE;
+    VkPipeline            culled_pipeline_  = VK_NULL_HANDLE; // indirect layout, reads the visible list
+    DepthPyramid          depth_pyramid_;
+    glm::mat4             pyramid_view_projection_{1.0f};     // camera the pyramid was rendered with
+    bool                  pyramid_valid_  = false;
+    bool                  gpu_cull_ready_ = false;
+
     GPUTexture  default_texture_;
     GPUMaterial default_material_;
 
     std::vector<GPUMesh>     meshes_;
-    std::vector<GPUTexture>  textures_;
     std::vector<GPUMaterial> materials_;
     std::vector<VkFence>     images_in_flight_;
 
+    UploadManager upload_;
+    u64           upload_complete_ = 0; // uploads up to this ticket are usable this frame
+
+    // Streamed textures change image as mips come and go. A textured
+    // material owns two sets and a texture two bindless slots, picked by
+    // streamer version parity, so the one rewritten on a swap is never the
+    // one a frame in flight reads. Version 0 draws with the default texture.
+    struct MaterialTextures {
+        u32             texture = UINT32_MAX; // streamer index, UINT32_MAX when untextured
+        u32             version = 0;          // streamer version bound in the material
+        VkDescriptorSet sets[2] = {};
+    };
+    TextureStreamer               streamer_;
+    std::vector<MaterialTextures> material_textures_; // parallel to materials_
+    std::vector<u32>              bindless_versions_; // per texture, bound in the texture array
+
+    GeometryPool geometry_;
+    std::vector<MeshBounds> mesh_bounds_; // parallel to meshes_
+
+    // Visible mesh entities of the current frame
+    struct DrawItem {
+        const glm::mat4*    model;  // the entity's WorldMatrix
+        const RenderBounds* bounds; // cached world sphere
+        u32 mesh;
+        u32 material;        // material handle index, UINT32_MAX for the default
+    };
+    std::vector<DrawItem>     draw_items_;
+    std::vector<entt::entity> uncached_;
+    CullingSet                culling_;
+    std::vector<u8>           visible_;
+    bool                      frustum_culling_ = true;
+    LightClusters             light_clusters_;
+
+    // Every ready mesh entity, culled per shadow view; static_caster_hash_
+    // sums the ones at rest, so any of them moving or appearing changes it
+    ShadowMaps                      shadows_;
+    std::vector<ShadowMaps::Caster> shadow_casters_;
+    u64                             static_caster_hash_ = 0;
+    bool                            shadows_enabled_    = true;
+
+    // Particle emitters of the scene, simulated and drawn on the GPU
+    ParticleSystem                          particles_;
+    std::vector<ParticleSystem::Emitter>    particle_emitters_;
+
+    // Entities bucketed by (mesh, material), rebuilt every frame
+    struct DrawBatch {
+        u32 mesh;
+        u32 material;
+        u32 first_instance;
+        u32 instance_count;
+    };
+    std::vector<DrawBatch>                    batches_;
+    std::unordered_map<u64, u32>              batch_lookup_;
+    std::vector<u32>                          batch_of_;
+    std::vector<GPUInstance>                  instance_scratch_;
+    std::vector<VkDrawIndexedIndirectCommand> draw_scratch_;
+
+    // Records the direct and instanced draw lists in chunks when they are
+    // long enough to be worth it; the other paths issue a handful of commands
+    Unique<JobSystem> jobs_;
+    bool              parallel_recording_ = true;
+
+    DrawPath    draw_path_ = DrawPath::Direct;
+    RenderStats stats_;
+
     Window* window_  = nullptr;
     std::string shader_dir_;
 
-    bool create_render_pass();
-    bool create_framebuffers();
+    bool create_present_semaphores();
     bool create_pipeline();
     bool create_frame_resources();
     bool create_descriptors();
     bool create_default_resources();
+    bool create_indirect_resources();
+    bool create_gpu_cull_resources();
+    void ensure_instance_capacity(FrameData& f, u32 count);
+    void write_global_descriptor(FrameData& f);
+    void write_cull_descriptor(FrameData& f);
+    u32  material_slot(MaterialHandle handle) const;
+    u32  texture_slot(u32 texture) const;
+    void refresh_streamed_textures(VkCommandBuffer cmd);
+    void gather_draw_items(Scene& scene, const Camera& camera);
+    void gather_emitters(Scene& scene);
+    void build_batches();
+    void upload_instances(FrameData& f);
+    u32  upload_indirect(FrameData& f, bool empty_draws);
+    void set_main_viewport(VkCommandBuffer cmd) const;
+    // Draw draw_items_ / batches_ [begin, end) and return the draw calls
+    // recorded; safe to call from several threads on different buffers
+    u32  record_direct(const FrameData& f, VkCommandBuffer cmd, u32 begin, u32 end) const;
+    u32  record_instanced(const FrameData& f, VkCommandBuffer cmd, u32 begin, u32 end) const;
+    u32  record_chunk_count() const;
+    void record_parallel(FrameData& f, VkCommandBuffer cmd, u32 chunks, const Camera& camera);
+    void record_indirect(FrameData& f, VkCommandBuffer cmd);
+    void record_gpu_cull(FrameData& f, VkCommandBuffer cmd, const glm::mat4& view_projection);
+    void record_culled(FrameData& f, VkCommandBuffer cmd);
     void cleanup_swapchain_dependent();
     void recreate_swapchain();
 
 public:
-    bool init(Window& window, const std::string& shader_dir) override;
+    bool init(Window& window, const std::string& shader_dir, const std::string& pipeline_cache) override;
     void shutdown() override;
     bool begin_frame() override;
     void end_frame() override;
@@ -68,6 +231,21 @@ public:
     TextureHandle  load_texture(const std::string& path) override;
     MaterialHandle create_material(const MaterialData& data) override;
     void           render_scene(Scene& scene, const Camera& camera) override;
+
+    void     set_draw_path(DrawPath path) override;
+    DrawPath draw_path() const override { return draw_path_; }
+    const RenderStats& stats() const override { return stats_; }
+    void     set_frustum_culling(bool enabled) override;
+    bool     frustum_culling() const override { return frustum_culling_; }
+    void     set_shadows(bool enabled) override { shadows_enabled_ = enabled; }
+    bool     shadows() const override { return shadows_enabled_; }
+    void     set_bloom(bool enabled) override { post_.settings().bloom = enabled; }
+    bool     bloom() const override { return post_.ready() && post_.settings().bloom; }
+    void     set_ssao(bool enabled) override { post_.settings().ssao = enabled; }
+    bool     ssao() const override { return post_.ready() && post_.settings().ssao; }
+    void     set_parallel_recording(bool enabled) override { parallel_recording_ = enabled; }
+    bool     parallel_recording() const override { return parallel_recording_ && jobs_ && jobs_->worker_count() > 0; }
+    const std::vector<PassTiming>& gpu_timings() const override { return graph_.timings(); }
 };
 
 } // namespace lumios
@@ -0,0 +1,517 @@
+#include "vk_shadows.h"
+#include "vk_init.h"
+#include "vk_pipeline.h"
+#include "vk_transient.h"
+#include "vk_geometry.h"
+#include "vk_texture.h"
+#include "../camera.h"
+#include "../light_clusters.h"
+#include <algorithm>
+#include <cmath>
+
+namespace lumios {
+
+static constexpr VkFormat SHADOW_FORMAT = VK_FORMAT_D32_SFLOAT;
+static constexpr float    LOCAL_NEAR    = 0.05f;
+static constexpr float    NORMAL_OFFSET = 1.5f;  // texels
+static constexpr float    SPLIT_LAMBDA  = 0.75f; // logarithmic vs uniform cascade splits
+
+static void transition(VkCommandBuffer cmd, VkImage image, VkImageLayout from, VkImageLayout to,
+                       VkAccessFlags src_access, VkAccessFlags dst_access,
+                       VkPipelineStageFlags src_stage, VkPipelineStageFlags dst_stage) {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask       = src_access;
+    barrier.dstAccessMask       = dst_access;
+    barrier.oldLayout           = from;
+    barrier.newLayout           = to;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image               = image;
+    barrier.subresourceRange    = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1};
+    vkCmdPipelineBarrier(cmd, src_stage, dst_stage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+static glm::vec3 up_for(const glm::vec3& direction) {
+    return std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+}
+
+// --- Setup ---
+
+bool ShadowMaps::init(VulkanContext& ctx, PipelineRegistry& pipelines, VkCommandPool pool,
+                      const std::string& shader_dir) {
+    constexpr VkPipelineStageFlags TESTS = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                                           VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    constexpr VkAccessFlags DEPTH_RW = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                                       VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    // Static atlas: rests in TRANSFER_SRC between its copies out
+    const VkSubpassDependency static_deps[2] = {
+        {VK_SUBPASS_EXTERNAL, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, TESTS,
+         0, DEPTH_RW, 0},
+        {0, VK_SUBPASS_EXTERNAL, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+         VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, 0},
+    };
+    // Live atlas: filled by the copy, then sampled by the main pass
+    const VkSubpassDependency live_deps[2] = {
+        {VK_SUBPASS_EXTERNAL, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, TESTS,
+         VK_ACCESS_TRANSFER_WRITE_BIT, DEPTH_RW, 0},
+        {0, VK_SUBPASS_EXTERNAL, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+         VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, 0},
+    };
+
+    if (!create_atlas(ctx, static_, VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                      VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, static_deps) ||
+        !create_atlas(ctx, live_, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, live_deps))
+        return false;
+
+    VkCommandBuffer cmd = ctx.begin_single_command(pool);
+    transition(cmd, static_.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+               0, 0, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    transition(cmd, live_.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+               0, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+               VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    ctx.end_single_command(pool, cmd);
+
+    sampler_ = create_shadow_sampler(ctx);
+
+    set_layout_ = DescriptorLayoutBuilder()
+        .add(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT)
+        .build(ctx.device);
+
+    VkPushConstantRange push{};
+    push.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    push.size       = sizeof(PushConstants);
+
+    VkPipelineLayoutCreateInfo li{};
+    li.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    li.setLayoutCount         = 1;
+    li.pSetLayouts            = &set_layout_;
+    li.pushConstantRangeCount = 1;
+    li.pPushConstantRanges    = &push;
+    VK_CHECK(vkCreatePipelineLayout(ctx.device, &li, nullptr, &layout_));
+
+    VkDescriptorPoolSize sizes[] = {{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, MAX_FRAMES_IN_FLIGHT}};
+    descriptor_alloc_.init(ctx.device, MAX_FRAMES_IN_FLIGHT, std::span<VkDescriptorPoolSize>(sizes, 1));
+    for (auto& set : sets_) set = descriptor_alloc_.allocate(ctx.device, set_layout_);
+
+    VkShaderModule vert = pipelines.shader(shader_dir + "/shadow.vert.spv");
+    VkShaderModule frag = pipelines.shader(shader_dir + "/shadow.frag.spv");
+    if (!vert || !frag) return false;
+
+    // Both sides of thin geometry cast; the bias keeps lit faces off
+    // their own depth, the normal offset in mesh.frag does the rest
+    PipelineBuilder builder;
+    builder.set_shaders(vert, frag)
+           .set_vertex_layout()
+           .set_cull_mode(VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE)
+           .enable_depth_test(true, VK_COMPARE_OP_LESS_OR_EQUAL)
+           .depth_only()
+           .set_depth_bias(1.25f, 1.75f)
+           .set_layout(layout_);
+    pipeline_ = pipelines.graphics(builder, static_.pass);
+    if (!pipeline_) return false;
+
+    clear();
+    LOG_INFO("Shadow atlas: %ux%u, %u cascades, %u tiles", ATLAS_SIZE, ATLAS_SIZE, CASCADES, TILES);
+    return true;
+}
+
+bool ShadowMaps::create_atlas(VulkanContext& ctx, Atlas& atlas, VkImageUsageFlags usage,
+                              VkImageLayout initial, VkImageLayout final_layout,
+                              const VkSubpassDependency (&dependencies)[2]) {
+    VkImageCreateInfo ici{};
+    ici.sType       = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    ici.imageType   = VK_IMAGE_TYPE_2D;
+    ici.format      = SHADOW_FORMAT;
+    ici.extent      = {ATLAS_SIZE, ATLAS_SIZE, 1};
+    ici.mipLevels   = 1;
+    ici.arrayLayers = 1;
+    ici.samples     = VK_SAMPLE_COUNT_1_BIT;
+    ici.tiling      = VK_IMAGE_TILING_OPTIMAL;
+    ici.usage       = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | usage;
+
+    VmaAllocationCreateInfo aci{};
+    aci.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    VK_CHECK(vmaCreateImage(ctx.allocator, &ici, &aci, &atlas.image, &atlas.allocation, nullptr));
+    if (!atlas.image) return false;
+
+    VkImageViewCreateInfo vi{};
+    vi.sType    = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    vi.image    = atlas.image;
+    vi.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    vi.format   = SHADOW_FORMAT;
+    vi.subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1};
+    VK_CHECK(vkCreateImageView(ctx.device, &vi, nullptr, &atlas.view));
+
+    // Views are drawn over what is there: cleared per rect, or copied in
+    VkAttachmentDescription depth{};
+    depth.format         = SHADOW_FORMAT;
+    depth.samples        = VK_SAMPLE_COUNT_1_BIT;
+    depth.loadOp         = VK_ATTACHMENT_LOAD_OP_LOAD;
+    depth.storeOp        = VK_ATTACHMENT_STORE_OP_STORE;
+    depth.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depth.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depth.initialLayout  = initial;
+    depth.finalLayout    = final_layout;
+
+    VkAttachmentReference depth_ref{0, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint       = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.pDepthStencilAttachment = &depth_ref;
+
+    VkRenderPassCreateInfo rpi{};
+    rpi.sType           = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    rpi.attachmentCount = 1;
+    rpi.pAttachments    = &depth;
+    rpi.subpassCount    = 1;
+    rpi.pSubpasses      = &subpass;
+    rpi.dependencyCount = 2;
+    rpi.pDependencies   = dependencies;
+    VK_CHECK(vkCreateRenderPass(ctx.device, &rpi, nullptr, &atlas.pass));
+    if (!atlas.pass) return false;
+
+    VkFramebufferCreateInfo fi{};
+    fi.sType           = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    fi.renderPass      = atlas.pass;
+    fi.attachmentCount = 1;
+    fi.pAttachments    = &atlas.view;
+    fi.width           = ATLAS_SIZE;
+    fi.height          = ATLAS_SIZE;
+    fi.layers          = 1;
+    VK_CHECK(vkCreateFramebuffer(ctx.device, &fi, nullptr, &atlas.framebuffer));
+    return atlas.framebuffer != VK_NULL_HANDLE;
+}
+
+void ShadowMaps::destroy_atlas(VulkanContext& ctx, Atlas& atlas) {
+    if (atlas.framebuffer) vkDestroyFramebuffer(ctx.device, atlas.framebuffer, nullptr);
+    if (atlas.pass)        vkDestroyRenderPass(ctx.device, atlas.pass, nullptr);
+    if (atlas.view)        vkDestroyImageView(ctx.device, atlas.view, nullptr);
+    if (atlas.image)       vmaDestroyImage(ctx.allocator, atlas.image, atlas.allocation);
+    atlas = {};
+}
+
+void ShadowMaps::destroy(VulkanContext& ctx) {
+    destroy_atlas(ctx, live_);
+    destroy_atlas(ctx, static_);
+    descriptor_alloc_.destroy(ctx.device);
+    for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        sets_[i]        = VK_NULL_HANDLE;
+        set_buffers_[i] = VK_NULL_HANDLE;
+    }
+    if (sampler_)    { vkDestroySampler(ctx.device, sampler_, nullptr); sampler_ = VK_NULL_HANDLE; }
+    pipeline_ = VK_NULL_HANDLE;
+    if (layout_)     { vkDestroyPipelineLayout(ctx.device, layout_, nullptr); layout_ = VK_NULL_HANDLE; }
+    if (set_layout_) { vkDestroyDescriptorSetLayout(ctx.device, set_layout_, nullptr); set_layout_ = VK_NULL_HANDLE; }
+}
+
+// --- Views ---
+
+void ShadowMaps::clear() {
+    active_.clear();
+    draws_.clear();
+    ubo_.splits = glm::vec4(0.0f);
+    ubo_.params = glm::vec4(0.0f, 1.0f / static_cast<float>(ATLAS_SIZE), 0.0f, 0.0f);
+}
+
+void ShadowMaps::activate(u32 view, const glm::mat4& view_projection, u32 x, u32 y, u32 size, glm::vec4 bias) {
+    View& v = views_[view];
+    v.view_projection = view_projection;
+    v.x    = x;
+    v.y    = y;
+    v.size = size;
+
+    float scale = 1.0f / static_cast<float>(ATLAS_SIZE);
+    GPUShadowView& gv = ubo_.views[view];
+    gv.view_projection = view_projection;
+    gv.rect = glm::vec4(x * scale, y * scale, size * scale, size * scale);
+    gv.bias = bias;
+    active_.push_back(view);
+}
+
+// Splits between logarithmic and uniform; every cascade is the bounding
+// sphere of its slice, which does not change size as the camera turns,
+// and its center moves in whole texels of the light's rotation
+void ShadowMaps::fit_cascades(const Camera& camera, const glm::vec3& direction) {
+    float near_z = camera.near_plane();
+    float far_z  = std::min(camera.far_plane(), SHADOW_DISTANCE);
+    float tan_y  = std::tan(glm::radians(camera.fov()) * 0.5f);
+    float tan_x  = tan_y * camera.aspect();
+    glm::mat4 inverse_view = glm::inverse(camera.view());
+
+    glm::vec3 up = up_for(direction);
+    glm::mat4 light_rotation = glm::lookAt(glm::vec3(0.0f), direction, up);
+    glm::mat4 inverse_rotation = glm::inverse(light_rotation);
+
+    float begin = near_z;
+    for (u32 c = 0; c < CASCADES; c++) {
+        float p   = static_cast<float>(c + 1) / static_cast<float>(CASCADES);
+        float end = SPLIT_LAMBDA * near_z * std::pow(far_z / near_z, p) +
+                    (1.0f - SPLIT_LAMBDA) * (near_z + (far_z - near_z) * p);
+
+        glm::vec3 corners[8];
+        glm::vec3 center(0.0f);
+        for (int i = 0; i < 8; i++) {
+            float d = (i & 4) ? end : begin;
+            glm::vec4 vs((i & 1 ? 1.0f : -1.0f) * tan_x * d, (i & 2 ? 1.0f : -1.0f) * tan_y * d, -d, 1.0f);
+            corners[i] = glm::vec3(inverse_view * vs);
+            center += corners[i];
+        }
+        center /= 8.0f;
+
+        float radius = 0.0f;
+        for (const auto& corner : corners) radius = std::max(radius, glm::length(corner - center));
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+
+        float texel = 2.0f * radius / static_cast<float>(CASCADE_SIZE);
+        glm::vec3 ls = glm::vec3(light_rotation * glm::vec4(center, 1.0f));
+        ls.x = std::floor(ls.x / texel) * texel;
+        ls.y = std::floor(ls.y / texel) * texel;
+        center = glm::vec3(inverse_rotation * glm::vec4(ls, 1.0f));
+
+        glm::vec3 eye  = center - direction * (radius + CASTER_MARGIN);
+        glm::mat4 view = glm::lookAt(eye, center, up);
+        glm::mat4 proj = glm::ortho(-radius, radius, -radius, radius, 0.0f, 2.0f * radius + CASTER_MARGIN);
+
+        activate(c, proj * view, (c & 1) * CASCADE_SIZE, (c >> 1) * CASCADE_SIZE, CASCADE_SIZE,
+                 glm::vec4(NORMAL_OFFSET * texel, 0.0f, 0.0f, 0.0f));
+        ubo_.splits[c] = end;
+        begin = end;
+    }
+    ubo_.params.x = static_cast<float>(CASCADES);
+}
+
+void ShadowMaps::update(const Camera& camera, LightClusters& lights, const std::vector<Caster>& casters,
+                        u64 static_hash) {
+    clear();
+    static_hash_ = static_hash;
+    const auto& gathered = lights.lights();
+
+    for (u32 i = 0; i < lights.directional(); i++) {
+        if (!lights.casts_shadows(i)) continue;
+        fit_cascades(camera, glm::normalize(glm::vec3(gathered[i].direction)));
+        lights.set_shadow_view(i, 0);
+        break;
+    }
+
+    // Point and spot lights that light something on screen, nearest first
+    Frustum frustum = Frustum::from_view_projection(camera.projection() * camera.view());
+    candidates_.clear();
+    for (u32 i = lights.directional(); i < static_cast<u32>(gathered.size()); i++) {
+        if (!lights.casts_shadows(i)) continue;
+        const GPULight& l = gathered[i];
+        glm::vec3 position(l.position);
+        float range    = l.params.x;
+        float distance = glm::length(position - camera.position()) - range;
+        if (range <= 0.0f || distance > SHADOW_DISTANCE) continue;
+
+        bool inside = true;
+        for (const auto& plane : frustum.planes)
+            if (glm::dot(glm::vec3(plane), position) + plane.w < -range) { inside = false; break; }
+        if (!inside) continue;
+
+        u32 tiles = static_cast<int>(l.params.z) == static_cast<int>(LightType::Point) ? 6 : 1;
+        candidates_.push_back({i, distance, tiles});
+    }
+    std::sort(candidates_.begin(), candidates_.end(),
+              [](const Candidate& a, const Candidate& b) { return a.distance < b.distance; });
+
+    u32 tiles_left = TILES;
+    auto kept = std::remove_if(candidates_.begin(), candidates_.end(), [&](const Candidate& c) {
+        if (c.tiles > tiles_left) return true;
+        tiles_left -= c.tiles;
+        return false;
+    });
+    candidates_.erase(kept, candidates_.end());
+
+    // Tiles in light order, so a light keeps its tiles (and their static
+    // cache) for as long as the same lights are shadowed
+    std::sort(candidates_.begin(), candidates_.end(),
+              [](const Candidate& a, const Candidate& b) { return a.light < b.light; });
+
+    static const glm::vec3 FACE_DIRECTIONS[6] = {
+        { 1, 0, 0}, {-1, 0, 0}, {0,  1, 0}, {0, -1, 0}, {0, 0,  1}, {0, 0, -1}
+    };
+    // Faces a little wider than 90 degrees, so filter taps on an edge
+    // still land inside the face's tile
+    const float face_tan = 1.0f + 4.0f / static_cast<float>(TILE_SIZE);
+    const float face_fov = 2.0f * std::atan(face_tan);
+
+    u32 tile = 0;
+    for (const Candidate& c : candidates_) {
+        const GPULight& l = gathered[c.light];
+        glm::vec3 position(l.position);
+        float range = l.params.x;
+        lights.set_shadow_view(c.light, static_cast<i32>(CASCADES + tile));
+
+        auto place = [&](const glm::mat4& view_projection, float tan_half) {
+            u32 quadrant = 1 + tile / 16;
+            u32 x = (quadrant & 1) * (ATLAS_SIZE / 2) + (tile % 4) * TILE_SIZE;
+            u32 y = (quadrant >> 1) * (ATLAS_SIZE / 2) + ((tile / 4) % 4) * TILE_SIZE;
+            float texel = 2.0f * tan_half / static_cast<float>(TILE_SIZE); // at unit distance
+            activate(CASCADES + tile, view_projection, x, y, TILE_SIZE,
+                     glm::vec4(NORMAL_OFFSET * texel, 1.0f, 0.0f, 0.0f));
+            tile++;
+        };
+
+        if (c.tiles == 6) {
+            glm::mat4 proj = glm::perspective(face_fov, 1.0f, LOCAL_NEAR, range);
+            for (const auto& dir : FACE_DIRECTIONS)
+                place(proj * glm::lookAt(position, position + dir, up_for(dir)), face_tan);
+        } else {
+            glm::vec3 dir  = glm::normalize(glm::vec3(l.direction));
+            float half     = std::min(std::acos(std::clamp(l.params.y, -1.0f, 1.0f)), glm::radians(85.0f));
+            float tan_half = std::tan(half) * face_tan;
+            glm::mat4 proj = glm::perspective(2.0f * std::atan(tan_half), 1.0f, LOCAL_NEAR, range);
+            place(proj * glm::lookAt(position, position + dir, up_for(dir)), tan_half);
+        }
+    }
+
+    // File the casters of every view: moving ones always, static ones only
+    // where the cached depth is out of date
+    culling_.clear();
+    for (const auto& caster : casters) culling_.add(caster.sphere);
+
+    for (u32 index : active_) {
+        View& v = views_[index];
+        v.refresh = !v.cached || v.cached_hash != static_hash_ || v.cached_view_projection != v.view_projection;
+        v.first   = static_cast<u32>(draws_.size());
+        v.static_count = v.dynamic_count = 0;
+        if (casters.empty()) continue;
+
+        culling_.cull(Frustum::from_view_projection(v.view_projection), visible_);
+        if (v.refresh) {
+            for (u32 i = 0; i < static_cast<u32>(casters.size()); i++) {
+                if (!visible_[i] || !casters[i].is_static) continue;
+                draws_.push_back({casters[i].model, casters[i].mesh});
+                v.static_count++;
+            }
+        }
+        for (u32 i = 0; i < static_cast<u32>(casters.size()); i++) {
+            if (!visible_[i] || casters[i].is_static) continue;
+            draws_.push_back({casters[i].model, casters[i].mesh});
+            v.dynamic_count++;
+        }
+    }
+}
+
+// --- Recording ---
+
+void ShadowMaps::draw(VkCommandBuffer cmd, const View& view, u32 first, u32 count, u32 offset) {
+    if (!count) return;
+
+    VkViewport viewport{};
+    viewport.x        = static_cast<float>(view.x);
+    viewport.y        = static_cast<float>(view.y);
+    viewport.width    = static_cast<float>(view.size);
+    viewport.height   = static_cast<float>(view.size);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+    VkRect2D scissor{{static_cast<i32>(view.x), static_cast<i32>(view.y)}, {view.size, view.size}};
+    vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout_, 0, 1, &sets_[current_set_], 1, &offset);
+    for (u32 i = first; i < first + count; i++) {
+        const Draw& d = draws_[i];
+        PushConstants pc{};
+        pc.model = *d.model;
+        vkCmdPushConstants(cmd, layout_, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pc), &pc);
+        const GPUMesh& mesh = (*meshes_)[d.mesh];
+        vkCmdDrawIndexed(cmd, mesh.index_count, 1, mesh.first_index, mesh.vertex_offset, 0);
+        draw_calls_++;
+    }
+}
+
+void ShadowMaps::record(VulkanContext& ctx, VkCommandBuffer cmd, u32 frame, TransientAllocator& transient,
+                        const GeometryPool& geometry, const std::vector<GPUMesh>& meshes) {
+    refreshed_  = 0;
+    draw_calls_ = 0;
+    if (!ready() || active_.empty()) return;
+
+    current_set_ = frame;
+    meshes_      = &meshes;
+    if (set_buffers_[frame] != transient.buffer()) {
+        DescriptorWriter writer;
+        writer.write_buffer(0, transient.buffer(), sizeof(glm::mat4), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
+        writer.update(ctx.device, sets_[frame]);
+        set_buffers_[frame] = transient.buffer();
+    }
+
+    u32 offsets[MAX_VIEWS] = {};
+    bool any_refresh = false;
+    for (u32 index : active_) {
+        offsets[index] = static_cast<u32>(transient.push(&views_[index].view_projection, sizeof(glm::mat4)).offset);
+        any_refresh |= views_[index].refresh;
+    }
+
+    VkRenderPassBeginInfo rp{};
+    rp.sType             = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    rp.renderArea.extent = {ATLAS_SIZE, ATLAS_SIZE};
+
+    // Stale static views: cleared and redrawn in place
+    if (any_refresh) {
+        rp.renderPass  = static_.pass;
+        rp.framebuffer = static_.framebuffer;
+        vkCmdBeginRenderPass(cmd, &rp, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_);
+        geometry.bind(cmd);
+
+        for (u32 index : active_) {
+            View& v = views_[index];
+            if (!v.refresh) continue;
+
+            VkClearAttachment depth{};
+            depth.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+            depth.clearValue.depthStencil = {1.0f, 0};
+            VkClearRect rect{};
+            rect.rect       = {{static_cast<i32>(v.x), static_cast<i32>(v.y)}, {v.size, v.size}};
+            rect.layerCount = 1;
+            vkCmdClearAttachments(cmd, 1, &depth, 1, &rect);
+
+            draw(cmd, v, v.first, v.static_count, offsets[index]);
+            v.cached_view_projection = v.view_projection;
+            v.cached_hash = static_hash_;
+            v.cached      = true;
+            refreshed_++;
+        }
+        vkCmdEndRenderPass(cmd);
+    }
+
+    // Static depth of every view in use into the sampled atlas; the
+    // barrier also waits for the previous frame's shadow lookups
+    transition(cmd, live_.image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+               VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+               VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    copies_.clear();
+    for (u32 index : active_) {
+        const View& v = views_[index];
+        VkImageCopy copy{};
+        copy.srcSubresource = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1};
+        copy.dstSubresource = copy.srcSubresource;
+        copy.srcOffset      = {static_cast<i32>(v.x), static_cast<i32>(v.y), 0};
+        copy.dstOffset      = copy.srcOffset;
+        copy.extent         = {v.size, v.size, 1};
+        copies_.push_back(copy);
+    }
+    vkCmdCopyImage(cmd, static_.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                   live_.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                   static_cast<u32>(copies_.size()), copies_.data());
+
+    // Moving casters on top; the pass ends in SHADER_READ_ONLY
+    rp.renderPass  = live_.pass;
+    rp.framebuffer = live_.framebuffer;
+    vkCmdBeginRenderPass(cmd, &rp, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_);
+    geometry.bind(cmd);
+    for (u32 index : active_) {
+        const View& v = views_[index];
+        draw(cmd, v, v.first + v.static_count, v.dynamic_count, offsets[index]);
+    }
+    vkCmdEndRenderPass(cmd);
+}
+
+} // namespace lumios
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "vk_common.h"
+#include "vk_descriptors.h"
+#include "../gpu_types.h"
+#include "../culling.h"
+#include <array>
+#include <string>
+#include <vector>
+
+namespace lumios {
+
+struct VulkanContext;
+class PipelineRegistry;
+class TransientAllocator;
+class GeometryPool;
+class LightClusters;
+class Camera;
+
+// Shadow maps of every shadowed light in one depth atlas, sampled by
+// mesh.frag through ShadowUBO. The top-left quadrant holds the cascades of
+// the first shadowed directional light; the other three are cut into
+// TILE_SIZE tiles, one per spot light and six per point light (a cube as
+// +X -X +Y -Y +Z -Z faces). Lights nearest the camera get tiles first.
+//
+// Cascades are fitted stably: each one is a bounding sphere of its slice
+// of the view frustum, snapped to whole texels in light space, so the map
+// only shifts by texels as the camera moves and edges do not shimmer.
+//
+// Casters that have not moved for STATIC_FRAMES frames are rendered into
+// a second atlas that persists across frames. A view's static depth is
+// re-rendered only when its matrix or the set of static casters changes;
+// otherwise it is copied over and just the moving casters are drawn on top.
+class ShadowMaps {
+public:
+    static constexpr u32   ATLAS_SIZE      = 4096;
+    static constexpr u32   CASCADES        = 4;
+    static constexpr u32   CASCADE_SIZE    = 1024;  // 2x2 in the top-left quadrant
+    static constexpr u32   TILE_SIZE       = 512;   // 4x4 in each other quadrant
+    static constexpr u32   TILES           = 48;
+    static constexpr u32   MAX_VIEWS       = MAX_SHADOW_VIEWS;
+    static constexpr u32   STATIC_FRAMES   = 60;
+    static constexpr float SHADOW_DISTANCE = 120.0f; // cascades end here, farther lights get no tiles
+    static constexpr float CASTER_MARGIN   = 60.0f;  // cascade depth kept towards the light, for off-screen casters
+
+    // A mesh that may cast shadows this frame
+    struct Caster {
+        const glm::mat4* model;
+        BoundingSphere   sphere;
+        u32              mesh;      // index into the meshes given to record()
+        bool             is_static; // at rest for STATIC_FRAMES
+    };
+
+    // The pipeline comes from, and stays owned by, the registry
+    bool init(VulkanContext& ctx, PipelineRegistry& pipelines, VkCommandPool pool, const std::string& shader_dir);
+    void destroy(VulkanContext& ctx);
+
+    // Picks the shadowed lights, fits their views around camera, points
+    // the lights at them and files the casters of every view. static_hash
+    // identifies the set of static casters.
+    void update(const Camera& camera, LightClusters& lights, const std::vector<Caster>& casters, u64 static_hash);
+
+    // Drops every view; lights gathered afterwards stay unshadowed
+    void clear();
+
+    // Outside a render pass. Refreshes stale static views, copies them into
+    // the sampled atlas and draws the moving casters over them. The atlas
+    // is left in SHADER_READ_ONLY_OPTIMAL, made visible to fragment shaders.
+    void record(VulkanContext& ctx, VkCommandBuffer cmd, u32 frame, TransientAllocator& transient,
+                const GeometryPool& geometry, const std::vector<GPUMesh>& meshes);
+
+    bool             ready()   const { return pipeline_ != VK_NULL_HANDLE; }
+    const ShadowUBO& ubo()     const { return ubo_; }
+    VkImage          image()   const { return live_.image; }
+    VkImageView      view()    const { return live_.view; }
+    VkSampler        sampler() const { return sampler_; }
+
+    // Of the current frame
+    u32 views()      const { return static_cast<u32>(active_.size()); }
+    u32 refreshed()  const { return refreshed_; }
+    u32 draw_calls() const { return draw_calls_; }
+
+private:
+    struct Atlas {
+        VkImage       image       = VK_NULL_HANDLE;
+        VmaAllocation allocation  = VK_NULL_HANDLE;
+        VkImageView   view        = VK_NULL_HANDLE;
+        VkRenderPass  pass        = VK_NULL_HANDLE;
+        VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    };
+
+    struct View {
+        glm::mat4 view_projection{1.0f};
+        u32       x = 0, y = 0, size = 0; // texels in the atlas
+        u32       first = 0;              // draws_ of this frame: static ones when refreshing, then moving ones
+        u32       static_count  = 0;
+        u32       dynamic_count = 0;
+        bool      refresh = false;        // static depth re-rendered this frame
+
+        // What the static atlas holds for this view
+        glm::mat4 cached_view_projection{0.0f};
+        u64       cached_hash = 0;
+        bool      cached      = false;
+    };
+
+    struct Draw {
+        const glm::mat4* model;
+        u32              mesh;
+    };
+
+    bool create_atlas(VulkanContext& ctx, Atlas& atlas, VkImageUsageFlags usage,
+                      VkImageLayout initial, VkImageLayout final_layout,
+                      const VkSubpassDependency (&dependencies)[2]);
+    void destroy_atlas(VulkanContext& ctx, Atlas& atlas);
+
+    void fit_cascades(const Camera& camera, const glm::vec3& direction);
+    void activate(u32 view, const glm::mat4& view_projection, u32 x, u32 y, u32 size, glm::vec4 bias);
+    void draw(VkCommandBuffer cmd, const View& view, u32 first, u32 count, u32 offset);
+
+    Atlas                 live_;    // sampled by the main pass
+    Atlas                 static_;  // static casters only, kept across frames
+    VkSampler             sampler_    = VK_NULL_HANDLE;
+    VkDescriptorSetLayout set_layout_ = VK_NULL_HANDLE;
+    VkPipelineLayout      layout_     = VK_NULL_HANDLE;
+    VkPipeline            pipeline_   = VK_NULL_HANDLE;
+    DescriptorAllocator   descriptor_alloc_;
+    VkDescriptorSet       sets_[MAX_FRAMES_IN_FLIGHT] = {};        // shadow.vert light matrices, in the transient buffer
+    VkBuffer              set_buffers_[MAX_FRAMES_IN_FLIGHT] = {}; // the buffer each set points at
+
+    std::array<View, MAX_VIEWS> views_;
+    std::vector<u32>            active_;  // views in use this frame
+    std::vector<Draw>           draws_;
+    CullingSet                  culling_; // of the casters
+    std::vector<u8>             visible_;
+    std::vector<VkImageCopy>    copies_;
+    ShadowUBO                   ubo_{};
+    u64                         static_hash_ = 0;
+    u32                         refreshed_   = 0;
+    u32                         draw_calls_  = 0;
+    u32                         current_set_ = 0;       // frame slot being recorded
+    const std::vector<GPUMesh>* meshes_      = nullptr; // of the record() in progress
+
+    // Scratch of update()
+    struct Candidate {
+        u32   light;
+        float distance;
+        u32   tiles;
+    };
+    std::vector<Candidate> candidates_;
+};
+
+} // namespace lumios
@@ -1,12 +1,54 @@
 #include "vk_texture.h"
 #include "vk_init.h"
 #include "vk_buffer.h"
+#include "vk_upload.h"
 #include <stb_image.h>
+#include <algorithm>
 
 namespace lumios {
 
+// The stages and accesses an image in a layout is used with, as the source
+// (last use before the barrier) or the destination (first use after it)
+static void layout_sync(VkImageLayout layout, bool source, VkPipelineStageFlags& stage, VkAccessFlags& access) {
+    switch (layout) {
+        case VK_IMAGE_LAYOUT_UNDEFINED:
+            stage  = source ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+            access = 0;
+            break;
+        case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+            stage  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            access = VK_ACCESS_TRANSFER_WRITE_BIT;
+            break;
+        case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+            stage  = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            access = source ? 0 : VK_ACCESS_TRANSFER_READ_BIT;
+            break;
+        case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+            stage  = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+            access = source ? 0 : VK_ACCESS_SHADER_READ_BIT;
+            break;
+        case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+            stage  = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+            access = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | (source ? 0 : VK_ACCESS_COLOR_ATTACHMENT_READ_BIT);
+            break;
+        case VK_IMAGE_LAYOUT_GENERAL:
+            stage  = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+            access = VK_ACCESS_SHADER_WRITE_BIT | (source ? 0 : VK_ACCESS_SHADER_READ_BIT);
+            break;
+        case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+            stage  = source ? VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+            access = 0;
+            break;
+        default:
+            // Not used with color images here; wait for everything
+            stage  = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+            access = source ? VK_ACCESS_MEMORY_WRITE_BIT : VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+            break;
+    }
+}
+
 void transition_image_layout(VkCommandBuffer cmd, VkImage image,
-                             VkImageLayout old_layout, VkImageLayout new_layout) {
+                             VkImageLayout old_layout, VkImageLayout new_layout, u32 levels) {
     VkImageMemoryBarrier barrier{};
     barrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
     barrier.oldLayout           = old_layout;
@@ -15,101 +57,118 @@ void transition_image_layout(VkCommandBuffer cmd, VkImage image,
     barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     barrier.image               = image;
     barrier.subresourceRange.aspectMask   = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.levelCount   = 1;
+    barrier.subresourceRange.levelCount   = levels;
     barrier.subresourceRange.layerCount   = 1;
 
     VkPipelineStageFlags src_stage, dst_stage;
-
-    if (old_layout == VK_IMAGE_LAYOUT_UNDEFINED && new_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-        barrier.srcAccessMask = 0;
-        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        src_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        dst_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-    } else if (old_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL &&
-               new_layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-        src_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        dst_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    } else {
-        barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-        src_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
-        dst_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
-    }
+    layout_sync(old_layout, true, src_stage, barrier.srcAccessMask);
+    layout_sync(new_layout, false, dst_stage, barrier.dstAccessMask);
 
     vkCmdPipelineBarrier(cmd, src_stage, dst_stage, 0,
                          0, nullptr, 0, nullptr, 1, &barrier);
 }
 
-GPUTexture create_texture_from_data(VulkanContext& ctx, VkCommandPool pool,
-                                    const u8* pixels, u32 width, u32 height, u32 channels) {
-    GPUTexture tex;
-    tex.width  = width;
-    tex.height = height;
+void generate_mipmaps(VkCommandBuffer cmd, VkImage image, u32 width, u32 height, u32 levels) {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image               = image;
+    barrier.subresourceRange    = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
 
-    VkDeviceSize img_size = width * height * 4;
+    i32 w = static_cast<i32>(width), h = static_cast<i32>(height);
+    for (u32 i = 1; i < levels; i++) {
+        // Level i - 1 is complete: make it the blit source
+        barrier.subresourceRange.baseMipLevel = i - 1;
+        barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
 
-    // Staging buffer
-    GPUBuffer staging = create_buffer(ctx.allocator, img_size,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+        i32 nw = std::max(1, w / 2), nh = std::max(1, h / 2);
+        VkImageBlit blit{};
+        blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i - 1, 0, 1};
+        blit.srcOffsets[1]  = {w, h, 1};
+        blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 1};
+        blit.dstOffsets[1]  = {nw, nh, 1};
+        vkCmdBlitImage(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
 
-    void* mapped;
-    vmaMapMemory(ctx.allocator, staging.allocation, &mapped);
+        barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+        w = nw;
+        h = nh;
+    }
+
+    // The last level was only written
+    barrier.subresourceRange.baseMipLevel = levels - 1;
+    barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+u32 mip_level_count(u32 width, u32 height) {
+    u32 levels = 1;
+    while ((std::max(width, height) >> levels) > 0) levels++;
+    return levels;
+}
+
+// RGBA8 copy of pixels with missing channels filled in
+static void expand_rgba(u8* dst, const u8* pixels, u32 width, u32 height, u32 channels) {
     if (channels == 4) {
-        memcpy(mapped, pixels, img_size);
-    } else {
-        auto* dst = static_cast<u8*>(mapped);
-        for (u32 i = 0; i < width * height; i++) {
-            dst[i*4+0] = channels > 0 ? pixels[i*channels+0] : 255;
-            dst[i*4+1] = channels > 1 ? pixels[i*channels+1] : 255;
-            dst[i*4+2] = channels > 2 ? pixels[i*channels+2] : 255;
-            dst[i*4+3] = 255;
-        }
+        memcpy(dst, pixels, VkDeviceSize(width) * height * 4);
+        return;
     }
-    vmaUnmapMemory(ctx.allocator, staging.allocation);
+    for (u32 i = 0; i < width * height; i++) {
+        dst[i*4+0] = channels > 0 ? pixels[i*channels+0] : 255;
+        dst[i*4+1] = channels > 1 ? pixels[i*channels+1] : 255;
+        dst[i*4+2] = channels > 2 ? pixels[i*channels+2] : 255;
+        dst[i*4+3] = 255;
+    }
+}
+
+bool create_texture_image(VulkanContext& ctx, GPUTexture& tex, u32 width, u32 height,
+                          VkFormat format, u32 levels, VkImageUsageFlags extra_usage) {
+    tex.width  = width;
+    tex.height = height;
+    tex.levels = levels;
+    tex.format = format;
 
-    // Image
     VkImageCreateInfo ici{};
     ici.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     ici.imageType     = VK_IMAGE_TYPE_2D;
-    ici.format        = VK_FORMAT_R8G8B8A8_SRGB;
+    ici.format        = format;
     ici.extent        = {width, height, 1};
-    ici.mipLevels     = 1;
+    ici.mipLevels     = levels;
     ici.arrayLayers   = 1;
     ici.samples       = VK_SAMPLE_COUNT_1_BIT;
     ici.tiling        = VK_IMAGE_TILING_OPTIMAL;
-    ici.usage         = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    ici.usage         = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | extra_usage;
 
     VmaAllocationCreateInfo aci{};
     aci.usage = VMA_MEMORY_USAGE_GPU_ONLY;
     VK_CHECK(vmaCreateImage(ctx.allocator, &ici, &aci, &tex.image, &tex.allocation, nullptr));
+    return tex.image != VK_NULL_HANDLE;
+}
 
-    // Copy staging -> image
-    VkCommandBuffer cmd = ctx.begin_single_command(pool);
-    transition_image_layout(cmd, tex.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-
-    VkBufferImageCopy region{};
-    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.layerCount = 1;
-    region.imageExtent = {width, height, 1};
-    vkCmdCopyBufferToImage(cmd, staging.buffer, tex.image,
-                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-    transition_image_layout(cmd, tex.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                           VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-    ctx.end_single_command(pool, cmd);
-
-    destroy_buffer(ctx.allocator, staging);
-
+void create_texture_view_sampler(VulkanContext& ctx, GPUTexture& tex) {
     // Image view
     VkImageViewCreateInfo vi{};
     vi.sType    = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
     vi.image    = tex.image;
     vi.viewType = VK_IMAGE_VIEW_TYPE_2D;
-    vi.format   = VK_FORMAT_R8G8B8A8_SRGB;
+    vi.format   = tex.format;
     vi.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    vi.subresourceRange.levelCount = 1;
+    vi.subresourceRange.levelCount = tex.levels;
     vi.subresourceRange.layerCount = 1;
     VK_CHECK(vkCreateImageView(ctx.device, &vi, nullptr, &tex.view));
 
@@ -124,8 +183,70 @@ GPUTexture create_texture_from_data(VulkanContext& ctx, VkCommandPool pool,
     si.anisotropyEnable = VK_TRUE;
     si.maxAnisotropy    = ctx.device_properties.limits.maxSamplerAnisotropy;
     si.mipmapMode       = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    si.maxLod           = VK_LOD_CLAMP_NONE;
     VK_CHECK(vkCreateSampler(ctx.device, &si, nullptr, &tex.sampler));
+}
 
+GPUTexture create_texture_from_data(VulkanContext& ctx, VkCommandPool pool,
+                                    const u8* pixels, u32 width, u32 height, u32 channels) {
+    GPUTexture tex;
+    VkDeviceSize img_size = VkDeviceSize(width) * height * 4;
+
+    // Staging buffer
+    GPUBuffer staging = create_buffer(ctx.allocator, img_size,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+
+    void* mapped;
+    vmaMapMemory(ctx.allocator, staging.allocation, &mapped);
+    expand_rgba(static_cast<u8*>(mapped), pixels, width, height, channels);
+    vmaUnmapMemory(ctx.allocator, staging.allocation);
+
+    u32 levels = mip_level_count(width, height);
+    create_texture_image(ctx, tex, width, height, VK_FORMAT_R8G8B8A8_SRGB, levels, VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+
+    // Copy staging -> image
+    VkCommandBuffer cmd = ctx.begin_single_command(pool);
+    transition_image_layout(cmd, tex.image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, levels);
+
+    VkBufferImageCopy region{};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = {width, height, 1};
+    vkCmdCopyBufferToImage(cmd, staging.buffer, tex.image,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    generate_mipmaps(cmd, tex.image, width, height, levels);
+    ctx.end_single_command(pool, cmd);
+
+    destroy_buffer(ctx.allocator, staging);
+
+    create_texture_view_sampler(ctx, tex);
+    return tex;
+}
+
+GPUTexture create_texture_from_data(VulkanContext& ctx, UploadManager& upload,
+                                    const u8* pixels, u32 width, u32 height, u32 channels) {
+    GPUTexture tex;
+    VkDeviceSize img_size = VkDeviceSize(width) * height * 4;
+
+    u32 levels = mip_level_count(width, height);
+    if (!create_texture_image(ctx, tex, width, height, VK_FORMAT_R8G8B8A8_SRGB, levels,
+                              VK_IMAGE_USAGE_TRANSFER_SRC_BIT))
+        return tex;
+
+    VkBufferImageCopy region{};
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageExtent      = {width, height, 1};
+
+    if (channels == 4) {
+        tex.upload_ticket = upload.upload_image(ctx, tex.image, levels, {&region, 1}, pixels, img_size, true);
+    } else {
+        std::vector<u8> rgba(img_size);
+        expand_rgba(rgba.data(), pixels, width, height, channels);
+        tex.upload_ticket = upload.upload_image(ctx, tex.image, levels, {&region, 1}, rgba.data(), img_size, true);
+    }
+
+    create_texture_view_sampler(ctx, tex);
     return tex;
 }
 
@@ -143,15 +264,99 @@ GPUTexture load_texture_from_file(VulkanContext& ctx, VkCommandPool pool, const
     return tex;
 }
 
+GPUTexture load_texture_from_file(VulkanContext& ctx, UploadManager& upload, const std::string& path) {
+    int w, h, ch;
+    u8* pixels = stbi_load(path.c_str(), &w, &h, &ch, STBI_rgb_alpha);
+    if (!pixels) {
+        LOG_ERROR("Failed to load texture: %s", path.c_str());
+        return create_default_white_texture(ctx, upload);
+    }
+
+    GPUTexture tex = create_texture_from_data(ctx, upload, pixels, w, h, 4);
+    stbi_image_free(pixels);
+    LOG_INFO("Loaded texture: %s (%dx%d)", path.c_str(), w, h);
+    return tex;
+}
+
 GPUTexture create_default_white_texture(VulkanContext& ctx, VkCommandPool pool) {
     u8 white[] = {255, 255, 255, 255};
     return create_texture_from_data(ctx, pool, white, 1, 1, 4);
 }
 
+GPUTexture create_default_white_texture(VulkanContext& ctx, UploadManager& upload) {
+    u8 white[] = {255, 255, 255, 255};
+    return create_texture_from_data(ctx, upload, white, 1, 1, 4);
+}
+
 void destroy_texture(VulkanContext& ctx, GPUTexture& tex) {
     if (tex.sampler) { vkDestroySampler(ctx.device, tex.sampler, nullptr); tex.sampler = VK_NULL_HANDLE; }
     if (tex.view)    { vkDestroyImageView(ctx.device, tex.view, nullptr); tex.view = VK_NULL_HANDLE; }
     if (tex.image)   { vmaDestroyImage(ctx.allocator, tex.image, tex.allocation); tex.image = VK_NULL_HANDLE; }
 }
 
+VkSampler create_shadow_sampler(VulkanContext& ctx) {
+    VkSamplerCreateInfo si{};
+    si.sType         = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    si.magFilter     = VK_FILTER_LINEAR;
+    si.minFilter     = VK_FILTER_LINEAR;
+    si.mipmapMode    = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    si.addressModeU  = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    si.addressModeV  = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    si.addressModeW  = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    si.compareEnable = VK_TRUE;
+    si.compareOp     = VK_COMPARE_OP_LESS_OR_EQUAL;
+    si.borderColor   = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+
+    VkSampler sampler = VK_NULL_HANDLE;
+    VK_CHECK(vkCreateSampler(ctx.device, &si, nullptr, &sampler));
+    return sampler;
+}
+
+GPUTexture create_shadow_placeholder(VulkanContext& ctx, VkCommandPool pool) {
+    GPUTexture tex;
+    tex.width  = 1;
+    tex.height = 1;
+    tex.format = VK_FORMAT_D32_SFLOAT;
+
+    VkImageCreateInfo ici{};
+    ici.sType       = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    ici.imageType   = VK_IMAGE_TYPE_2D;
+    ici.format      = tex.format;
+    ici.extent      = {1, 1, 1};
+    ici.mipLevels   = 1;
+    ici.arrayLayers = 1;
+    ici.samples     = VK_SAMPLE_COUNT_1_BIT;
+    ici.tiling      = VK_IMAGE_TILING_OPTIMAL;
+    ici.usage       = VK_IMAGE_USAGE_SAMPLED_BIT;
+
+    VmaAllocationCreateInfo aci{};
+    aci.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+    VK_CHECK(vmaCreateImage(ctx.allocator, &ici, &aci, &tex.image, &tex.allocation, nullptr));
+    if (!tex.image) return tex;
+
+    VkImageViewCreateInfo vi{};
+    vi.sType    = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    vi.image    = tex.image;
+    vi.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    vi.format   = tex.format;
+    vi.subresourceRange = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1};
+    VK_CHECK(vkCreateImageView(ctx.device, &vi, nullptr, &tex.view));
+    tex.sampler = create_shadow_sampler(ctx);
+
+    VkCommandBuffer cmd = ctx.begin_single_command(pool);
+    VkImageMemoryBarrier barrier{};
+    barrier.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.dstAccessMask       = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout           = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image               = tex.image;
+    barrier.subresourceRange    = {VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1};
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+    ctx.end_single_command(pool, cmd);
+    return tex;
+}
+
 } // namespace lumios
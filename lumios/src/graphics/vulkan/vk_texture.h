@@ -6,17 +6,51 @@
 namespace lumios {
 
 struct VulkanContext;
+class UploadManager;
 
+// The pool variants upload synchronously on the graphics queue. The
+// UploadManager ones queue the copy and return with upload_ticket set;
+// the texture may not be sampled before that ticket completes. Both give
+// the image a full mip chain blitted on the GPU.
 GPUTexture create_texture_from_data(VulkanContext& ctx, VkCommandPool pool,
                                     const u8* pixels, u32 width, u32 height, u32 channels);
+GPUTexture create_texture_from_data(VulkanContext& ctx, UploadManager& upload,
+                                    const u8* pixels, u32 width, u32 height, u32 channels);
 
 GPUTexture load_texture_from_file(VulkanContext& ctx, VkCommandPool pool, const std::string& path);
+GPUTexture load_texture_from_file(VulkanContext& ctx, UploadManager& upload, const std::string& path);
 
 GPUTexture create_default_white_texture(VulkanContext& ctx, VkCommandPool pool);
+GPUTexture create_default_white_texture(VulkanContext& ctx, UploadManager& upload);
 
 void destroy_texture(VulkanContext& ctx, GPUTexture& tex);
 
+// Linear depth compare sampler (LESS_OR_EQUAL, clamped), the hardware 2x2
+// PCF that shadow maps are read through
+VkSampler create_shadow_sampler(VulkanContext& ctx);
+
+// A 1x1 D32 texture in SHADER_READ_ONLY_OPTIMAL with a shadow sampler,
+// for binding a shadow map where none is rendered; never sampled as long
+// as no light points at a shadow view
+GPUTexture create_shadow_placeholder(VulkanContext& ctx, VkCommandPool pool);
+
+// Building blocks for callers that fill the image themselves: an image
+// with TRANSFER_DST | SAMPLED usage (plus extra_usage) left UNDEFINED,
+// then a view over all its levels and a trilinear repeat sampler.
+bool create_texture_image(VulkanContext& ctx, GPUTexture& tex, u32 width, u32 height,
+                          VkFormat format = VK_FORMAT_R8G8B8A8_SRGB, u32 levels = 1,
+                          VkImageUsageFlags extra_usage = 0);
+void create_texture_view_sampler(VulkanContext& ctx, GPUTexture& tex);
+
 void transition_image_layout(VkCommandBuffer cmd, VkImage image,
-                             VkImageLayout old_layout, VkImageLayout new_layout);
+                             VkImageLayout old_layout, VkImageLayout new_layout, u32 levels = 1);
+
+// Blits every level from the one above on a graphics queue. Expects all
+// levels in TRANSFER_DST_OPTIMAL with level 0 written and leaves them
+// SHADER_READ_ONLY_OPTIMAL; the format must support linear blits.
+void generate_mipmaps(VkCommandBuffer cmd, VkImage image, u32 width, u32 height, u32 levels);
+
+// Levels in a full chain down to 1x1
+u32 mip_level_count(u32 width, u32 height);
 
 } // namespace lumios
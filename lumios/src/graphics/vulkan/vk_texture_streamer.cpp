@@ -0,0 +1,504 @@
+#include "vk_texture_streamer.h"
+#include "vk_init.h"
+#include "vk_texture.h"
+#include "vk_upload.h"
+#include <stb_image.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace lumios {
+
+static constexpr u32          BASE_MIP_SIZE    = 128;          // first loads stop at this many texels
+static constexpr u32          MAX_READS        = 8;            // jobs queued or decoding at once
+static constexpr u64          IDLE_FRAMES      = 120;          // unseen this long, fall back to the base mips
+static constexpr VkDeviceSize UPLOAD_PER_FRAME = 16ull << 20;  // staged per update, at least one image
+
+// --- Formats ---
+
+struct BlockInfo {
+    u32 dim;   // texels per block side
+    u32 bytes; // bytes per block
+};
+
+static bool block_info(VkFormat format, BlockInfo& out) {
+    switch (format) {
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:       out = {1, 4};  return true;
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK: out = {4, 8};  return true;
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:      out = {4, 16}; return true;
+        default:                            return false;
+    }
+}
+
+static VkDeviceSize level_bytes(const BlockInfo& block, u32 width, u32 height) {
+    return VkDeviceSize((width + block.dim - 1) / block.dim) *
+           ((height + block.dim - 1) / block.dim) * block.bytes;
+}
+
+static VkDeviceSize image_bytes(VkFormat format, u32 width, u32 height, u32 levels) {
+    BlockInfo block{1, 4};
+    block_info(format, block);
+    VkDeviceSize total = 0;
+    for (u32 i = 0; i < levels; i++)
+        total += level_bytes(block, std::max(1u, width >> i), std::max(1u, height >> i));
+    return total;
+}
+
+static VkDeviceSize texture_bytes(const GPUTexture& tex) {
+    return tex.image ? image_bytes(tex.format, tex.width, tex.height, tex.levels) : 0;
+}
+
+// The first mip no larger than BASE_MIP_SIZE, or the last one there is
+static u32 base_mip(u32 width, u32 height, u32 levels) {
+    u32 mip = 0;
+    while (mip + 1 < levels && (std::max(width, height) >> mip) > BASE_MIP_SIZE) mip++;
+    return mip;
+}
+
+static VkDeviceSize align16(VkDeviceSize v) { return (v + 15) & ~VkDeviceSize(15); }
+
+// --- Decoding (worker threads) ---
+
+// 2x2 box filter of RGBA8 texels, averaged in linear space for sRGB data.
+// Odd edges reuse the last row or column.
+static void downsample(std::vector<u8>& pixels, u32& width, u32& height, bool srgb) {
+    static const std::array<float, 256> to_linear = [] {
+        std::array<float, 256> t{};
+        for (u32 i = 0; i < 256; i++) {
+            float c = i / 255.0f;
+            t[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return t;
+    }();
+
+    u32 nw = std::max(1u, width / 2), nh = std::max(1u, height / 2);
+    std::vector<u8> out(size_t(nw) * nh * 4);
+    for (u32 y = 0; y < nh; y++) {
+        const u8* r0 = &pixels[size_t(std::min(2 * y, height - 1)) * width * 4];
+        const u8* r1 = &pixels[size_t(std::min(2 * y + 1, height - 1)) * width * 4];
+        for (u32 x = 0; x < nw; x++) {
+            u32 x0 = std::min(2 * x, width - 1) * 4, x1 = std::min(2 * x + 1, width - 1) * 4;
+            u8* dst = &out[(size_t(y) * nw + x) * 4];
+            for (u32 c = 0; c < 4; c++) {
+                if (srgb && c < 3) {
+                    float v = 0.25f * (to_linear[r0[x0 + c]] + to_linear[r0[x1 + c]] +
+                                       to_linear[r1[x0 + c]] + to_linear[r1[x1 + c]]);
+                    v = v <= 0.0031308f ? v * 12.92f : 1.055f * std::pow(v, 1.0f / 2.4f) - 0.055f;
+                    dst[c] = static_cast<u8>(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+                } else {
+                    dst[c] = static_cast<u8>((r0[x0 + c] + r0[x1 + c] + r1[x0 + c] + r1[x1 + c] + 2) / 4);
+                }
+            }
+        }
+    }
+    pixels.swap(out);
+    width  = nw;
+    height = nh;
+}
+
+// A single RGBA8 level: shrink to the first mip on the CPU, the GPU
+// blits the rest of the chain from it
+static void finish_rgba(TextureStreamer::Decoded& out, std::vector<u8> pixels, u32 width, u32 height,
+                        u32 first_mip, VkFormat format) {
+    out.full_width  = width;
+    out.full_height = height;
+    out.full_levels = mip_level_count(width, height);
+
+    u32 mip = first_mip == UINT32_MAX ? base_mip(width, height, out.full_levels)
+                                      : std::min(first_mip, out.full_levels - 1);
+    for (u32 i = 0; i < mip; i++) downsample(pixels, width, height, format == VK_FORMAT_R8G8B8A8_SRGB);
+
+    out.first_mip = mip;
+    out.format    = format;
+    out.levels    = out.full_levels - mip;
+    out.generate  = out.levels > 1;
+    out.data      = std::move(pixels);
+
+    VkBufferImageCopy region{};
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageExtent      = {width, height, 1};
+    out.regions.assign(1, region);
+}
+
+static u32 read_u32(const u8* p) { u32 v; memcpy(&v, p, sizeof(v)); return v; }
+static u64 read_u64(const u8* p) { u64 v; memcpy(&v, p, sizeof(v)); return v; }
+
+// KTX2 with the levels stored as-is (no supercompression) in a format the
+// renderer samples directly. Only levels first_mip and below are read.
+static bool decode_ktx2(std::ifstream& file, const u8* header, u32 first_mip, bool bc_supported,
+                        TextureStreamer::Decoded& out) {
+    VkFormat format           = static_cast<VkFormat>(read_u32(header + 12));
+    u32      width            = read_u32(header + 20);
+    u32      height           = read_u32(header + 24);
+    u32      depth            = read_u32(header + 28);
+    u32      layers           = read_u32(header + 32);
+    u32      faces            = read_u32(header + 36);
+    u32      file_levels      = std::max(read_u32(header + 40), 1u); // 0 asks for generated mips
+    u32      supercompression = read_u32(header + 44);
+
+    BlockInfo block;
+    if (!block_info(format, block) || width == 0 || height == 0 || depth > 1 || layers > 1 ||
+        faces != 1 || supercompression != 0)
+        return false;
+    bool compressed = block.dim > 1;
+    if (compressed && !bc_supported) return false;
+    if (file_levels > mip_level_count(width, height)) return false;
+
+    // Level index: {byteOffset, byteLength, uncompressedByteLength} per level,
+    // checked against the file length before anything is allocated for it
+    file.seekg(0, std::ios::end);
+    std::streamoff file_size = file.tellg();
+    if (file_size < 80 + static_cast<std::streamoff>(file_levels) * 24) return false;
+
+    std::vector<u8> index(size_t(file_levels) * 24);
+    file.seekg(80);
+    file.read(reinterpret_cast<char*>(index.data()), static_cast<std::streamsize>(index.size()));
+    if (file.gcount() != static_cast<std::streamsize>(index.size())) return false;
+
+    // A level is only read (or allocated for) once the file is known to hold
+    // all of it, so a tiny file cannot claim a huge image
+    auto level_fits = [&](u32 level, VkDeviceSize size) {
+        u64 offset = read_u64(&index[level * 24]);
+        u64 length = read_u64(&index[level * 24 + 8]);
+        u64 end    = static_cast<u64>(file_size);
+        return length >= size && length <= end && offset <= end - length;
+    };
+    auto read_level = [&](u32 level, u8* dst, VkDeviceSize size) {
+        file.seekg(static_cast<std::streamoff>(read_u64(&index[level * 24])));
+        file.read(reinterpret_cast<char*>(dst), static_cast<std::streamsize>(size));
+        return file.gcount() == static_cast<std::streamsize>(size);
+    };
+
+    if (!compressed && file_levels == 1) {
+        if (!level_fits(0, level_bytes(block, width, height))) return false;
+        std::vector<u8> pixels(level_bytes(block, width, height));
+        if (!read_level(0, pixels.data(), pixels.size())) return false;
+        finish_rgba(out, std::move(pixels), width, height, first_mip, format);
+        return true;
+    }
+
+    u32 mip = first_mip == UINT32_MAX ? base_mip(width, height, file_levels)
+                                      : std::min(first_mip, file_levels - 1);
+    out.full_width  = width;
+    out.full_height = height;
+    out.full_levels = file_levels;
+    out.first_mip   = mip;
+    out.levels      = file_levels - mip;
+    out.format      = format;
+
+    VkDeviceSize total = 0;
+    for (u32 i = mip; i < file_levels; i++) {
+        VkDeviceSize size = level_bytes(block, std::max(1u, width >> i), std::max(1u, height >> i));
+        if (!level_fits(i, size)) return false;
+        total = align16(total) + size;
+    }
+    out.data.resize(total);
+
+    VkDeviceSize offset = 0;
+    for (u32 i = mip; i < file_levels; i++) {
+        u32 w = std::max(1u, width >> i), h = std::max(1u, height >> i);
+        VkDeviceSize size = level_bytes(block, w, h);
+        offset = align16(offset);
+        if (!read_level(i, out.data.data() + offset, size)) return false;
+
+        VkBufferImageCopy region{};
+        region.bufferOffset     = offset;
+        region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, i - mip, 0, 1};
+        region.imageExtent      = {w, h, 1};
+        out.regions.push_back(region);
+        offset += size;
+    }
+    return true;
+}
+
+void TextureStreamer::decode(const Job& job, Decoded& out) const {
+    out.texture = job.texture;
+
+    static constexpr u8 KTX2_IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+    std::ifstream file(job.path, std::ios::binary);
+    u8 header[80] = {};
+    file.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (file.gcount() == sizeof(header) && memcmp(header, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0) {
+        out.failed = !decode_ktx2(file, header, job.first_mip, bc_supported_, out);
+        return;
+    }
+    file.close();
+
+    // stb_image fills in alpha itself
+    int w, h, channels;
+    u8* pixels = stbi_load(job.path.c_str(), &w, &h, &channels, STBI_rgb_alpha);
+    if (!pixels) {
+        out.failed = true;
+        return;
+    }
+    std::vector<u8> rgba(pixels, pixels + size_t(w) * h * 4);
+    stbi_image_free(pixels);
+    finish_rgba(out, std::move(rgba), w, h, job.first_mip, VK_FORMAT_R8G8B8A8_SRGB);
+}
+
+void TextureStreamer::worker_loop() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock lock(mutex_);
+            wake_.wait(lock, [&] { return stop_ || !jobs_.empty(); });
+            if (stop_) return;
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+
+        Decoded out;
+        decode(job, out);
+
+        std::lock_guard lock(mutex_);
+        results_.push_back(std::move(out));
+    }
+}
+
+// --- Init / shutdown ---
+
+bool TextureStreamer::init(VulkanContext& ctx, u32 frames_in_flight, VkDeviceSize budget, u32 workers) {
+    frames_in_flight_ = frames_in_flight;
+    budget_           = budget;
+    bc_supported_     = ctx.features.texture_compression_bc;
+
+    if (workers == 0) workers = std::clamp(std::thread::hardware_concurrency() / 2, 1u, 4u);
+    stop_ = false;
+    for (u32 i = 0; i < workers; i++) workers_.emplace_back(&TextureStreamer::worker_loop, this);
+
+    LOG_INFO("Texture streamer: %u workers, %llu MB budget, BC formats %s", workers,
+             static_cast<unsigned long long>(budget_ >> 20), bc_supported_ ? "supported" : "unsupported");
+    return true;
+}
+
+void TextureStreamer::destroy(VulkanContext& ctx) {
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+        jobs_.clear();
+    }
+    wake_.notify_all();
+    for (auto& t : workers_) t.join();
+    workers_.clear();
+    results_.clear();
+    ready_.clear();
+
+    for (auto& e : entries_) {
+        destroy_texture(ctx, e.live);
+        destroy_texture(ctx, e.next);
+    }
+    for (auto& r : retired_) destroy_texture(ctx, r.texture);
+    entries_.clear();
+    retired_.clear();
+    resident_bytes_ = 0;
+    reserved_bytes_ = 0;
+    reading_        = 0;
+}
+
+// --- Requests ---
+
+u32 TextureStreamer::load(const std::string& path) {
+    u32 idx = static_cast<u32>(entries_.size());
+    Entry e;
+    e.path      = path;
+    e.last_seen = frame_;
+    entries_.push_back(std::move(e));
+    queue_read(idx, UINT32_MAX);
+    return idx;
+}
+
+void TextureStreamer::request(u32 texture, float screen_pixels) {
+    Entry& e = entries_[texture];
+    if (e.last_seen != frame_) {
+        e.last_seen = frame_;
+        e.demand    = 0.0f;
+    }
+    e.demand = std::max(e.demand, screen_pixels);
+}
+
+const GPUTexture* TextureStreamer::resident(u32 texture) const {
+    const Entry& e = entries_[texture];
+    return e.live.image ? &e.live : nullptr;
+}
+
+void TextureStreamer::queue_read(u32 texture, u32 first_mip) {
+    Entry& e = entries_[texture];
+    e.reading = true;
+    reading_++;
+    {
+        std::lock_guard lock(mutex_);
+        jobs_.push_back({texture, first_mip, e.path});
+    }
+    wake_.notify_one();
+}
+
+// --- Per frame ---
+
+void TextureStreamer::update(VulkanContext& ctx, UploadManager& upload, u64 upload_complete) {
+    frame_++;
+
+    // Nothing older than frames_in_flight can still be sampled
+    size_t kept = 0;
+    for (auto& r : retired_) {
+        if (frame_ >= r.frame + frames_in_flight_) destroy_texture(ctx, r.texture);
+        else retired_[kept++] = r;
+    }
+    retired_.resize(kept);
+
+    for (auto& e : entries_) {
+        if (!e.next.image || e.next.upload_ticket > upload_complete) continue;
+        if (e.live.image && frame_ < e.last_swap + frames_in_flight_) continue;
+
+        if (e.live.image) {
+            resident_bytes_ -= texture_bytes(e.live);
+            retired_.push_back({e.live, frame_});
+        }
+        e.live      = e.next;
+        e.live_mip  = e.next_mip;
+        e.next      = {};
+        e.last_swap = frame_;
+        e.version++;
+    }
+
+    // Finished reads become images, a bounded amount per frame so one burst
+    // of loads does not stall on the staging ring
+    {
+        std::lock_guard lock(mutex_);
+        for (auto& d : results_) ready_.push_back(std::move(d));
+        results_.clear();
+    }
+    VkDeviceSize staged = 0;
+    size_t done = 0;
+    for (; done < ready_.size() && staged < UPLOAD_PER_FRAME; done++) {
+        staged += ready_[done].data.size();
+        create_next(ctx, upload, ready_[done]);
+    }
+    ready_.erase(ready_.begin(), ready_.begin() + done);
+
+    schedule();
+}
+
+void TextureStreamer::create_next(VulkanContext& ctx, UploadManager& upload, Decoded& d) {
+    Entry& e = entries_[d.texture];
+    e.reading = false;
+    reading_--;
+    reserved_bytes_ -= e.reserved;
+    e.reserved = 0;
+
+    if (d.failed) {
+        LOG_ERROR("Failed to load texture: %s", e.path.c_str());
+        e.failed = true;
+        if (e.live.image) return; // keep the mips already there
+        e.full_width = e.full_height = e.full_levels = 1;
+        e.next     = create_default_white_texture(ctx, upload);
+        e.next_mip = 0;
+        resident_bytes_ += texture_bytes(e.next);
+        return;
+    }
+
+    bool first = e.full_levels == 0;
+    e.full_width  = d.full_width;
+    e.full_height = d.full_height;
+    e.full_levels = d.full_levels;
+
+    GPUTexture tex;
+    const VkExtent3D& extent = d.regions[0].imageExtent;
+    if (!create_texture_image(ctx, tex, extent.width, extent.height, d.format, d.levels,
+                              d.generate ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT : 0)) {
+        LOG_ERROR("Texture streamer: could not create a %ux%u image for %s", extent.width, extent.height,
+                  e.path.c_str());
+        e.failed = true;
+        return;
+    }
+    tex.upload_ticket = upload.upload_image(ctx, tex.image, d.levels, d.regions, d.data.data(),
+                                            d.data.size(), d.generate);
+    create_texture_view_sampler(ctx, tex);
+
+    e.next     = tex;
+    e.next_mip = d.first_mip;
+    resident_bytes_ += texture_bytes(tex);
+
+    if (first) {
+        LOG_INFO("Loaded texture: %s (%ux%u, %u mips, from mip %u)", e.path.c_str(),
+                 d.full_width, d.full_height, d.full_levels, d.first_mip);
+    }
+}
+
+// --- Residency ---
+
+// Coarsest mip that still gives every covered pixel a texel, never
+// coarser than the base mips
+u32 TextureStreamer::wanted_mip(const Entry& e) const {
+    u32 base = base_mip(e.full_width, e.full_height, e.full_levels);
+    if (frame_ - e.last_seen > IDLE_FRAMES || e.demand <= 0.0f) return base;
+
+    float ratio = static_cast<float>(std::max(e.full_width, e.full_height)) / e.demand;
+    u32 mip = ratio > 1.0f ? static_cast<u32>(std::log2(ratio)) : 0;
+    return std::min(mip, base);
+}
+
+VkDeviceSize TextureStreamer::chain_bytes(const Entry& e, u32 first_mip) const {
+    return image_bytes(e.live.format, std::max(1u, e.full_width >> first_mip),
+                       std::max(1u, e.full_height >> first_mip), e.full_levels - first_mip);
+}
+
+void TextureStreamer::schedule() {
+    if (reading_ >= MAX_READS) return;
+
+    candidates_.clear();
+    for (u32 i = 0; i < entries_.size(); i++) {
+        const Entry& e = entries_[i];
+        if (e.reading || e.next.image || !e.live.image || e.failed) continue;
+        float texels = static_cast<float>(std::max(1u, std::max(e.full_width, e.full_height) >> e.live_mip));
+        candidates_.push_back({i, wanted_mip(e), e.demand / texels});
+    }
+    std::sort(candidates_.begin(), candidates_.end(),
+              [](const Candidate& a, const Candidate& b) { return a.priority > b.priority; });
+
+    VkDeviceSize committed = resident_bytes_ + reserved_bytes_;
+    bool over = committed > budget_;
+
+    // Oversampled (by two mips, so it does not flicker) or idle textures give
+    // their top mips back. Over budget, the least needed give up one more,
+    // lowest demand per texel first.
+    for (auto it = candidates_.rbegin(); it != candidates_.rend() && reading_ < MAX_READS; ++it) {
+        const Entry& e = entries_[it->texture];
+        bool idle = frame_ - e.last_seen > IDLE_FRAMES;
+        u32 mip = it->mip;
+        if (mip <= e.live_mip + (idle ? 0u : 1u)) {
+            if (!over || e.live_mip >= base_mip(e.full_width, e.full_height, e.full_levels)) continue;
+            mip = e.live_mip + 1;
+        }
+        VkDeviceSize saved = texture_bytes(e.live) - chain_bytes(e, mip);
+        committed = committed > saved ? committed - saved : 0;
+        over = committed > budget_;
+        queue_read(it->texture, mip);
+        it->mip = UINT32_MAX;
+    }
+
+    // Undersampled textures get the finest mips that fit, highest demand
+    // per texel first
+    for (auto& c : candidates_) {
+        if (reading_ >= MAX_READS) break;
+        Entry& e = entries_[c.texture];
+        VkDeviceSize live = texture_bytes(e.live);
+        for (u32 mip = c.mip; mip < e.live_mip && c.mip != UINT32_MAX; mip++) {
+            VkDeviceSize cost = chain_bytes(e, mip) - live;
+            if (committed + cost > budget_) continue;
+            committed       += cost;
+            reserved_bytes_ += cost;
+            e.reserved       = cost;
+            queue_read(c.texture, mip);
+            break;
+        }
+    }
+}
+
+} // namespace lumios
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "vk_common.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace lumios {
+
+struct VulkanContext;
+class UploadManager;
+
+// Loads textures in the background and keeps only the mips the screen needs.
+//
+// load() returns at once; worker threads read and decode the file (KTX2
+// with BC1/BC7/RGBA8 levels, or anything stb_image reads) and update()
+// creates and uploads the image on the calling thread. A texture first
+// arrives with its mip chain cut at 128 texels; after that, request()
+// reports how many pixels it covers on screen and update() re-reads it
+// with more or fewer top mips to match, highest demand first, within a
+// VRAM budget. Each new image replaces the old one whole: the version
+// bumps and the old image is destroyed once no frame can use it.
+class TextureStreamer {
+public:
+    bool init(VulkanContext& ctx, u32 frames_in_flight, VkDeviceSize budget = VkDeviceSize(256) << 20,
+              u32 workers = 0);
+    void destroy(VulkanContext& ctx);
+
+    u32  load(const std::string& path);
+
+    // Screen-space demand for this frame: the projected size in pixels of
+    // the surface the texture spans. The largest request of a frame wins.
+    void request(u32 texture, float screen_pixels);
+
+    // Once per frame, after UploadManager::acquire(): swaps in the images
+    // whose upload completed, frees retired ones and queues new reads
+    void update(VulkanContext& ctx, UploadManager& upload, u64 upload_complete);
+
+    // The image to sample, null until the first mips arrive. The version
+    // changes each time the image does; 0 means none yet. Successive
+    // versions are at least frames_in_flight frames apart, so a caller
+    // alternating between two descriptors by version parity never
+    // rewrites one a pending frame still reads.
+    const GPUTexture* resident(u32 texture) const;
+    u32          version(u32 texture) const { return entries_[texture].version; }
+    u32          count() const { return static_cast<u32>(entries_.size()); }
+    VkDeviceSize resident_bytes() const { return resident_bytes_; }
+
+    // A worker's output, ready for vkCmdCopyBufferToImage
+    struct Decoded {
+        u32      texture     = 0;
+        u32      first_mip   = 0; // source mip that becomes level 0
+        u32      full_width  = 1;
+        u32      full_height = 1;
+        u32      full_levels = 1; // mip count of the full-size source
+        u32      levels      = 1;
+        VkFormat format      = VK_FORMAT_R8G8B8A8_SRGB;
+        bool     generate    = false; // only level 0 given, blit the rest
+        bool     failed      = false;
+        std::vector<u8>                data;
+        std::vector<VkBufferImageCopy> regions;
+    };
+
+private:
+    struct Job {
+        u32         texture;
+        u32         first_mip; // UINT32_MAX for the initial, size-capped load
+        std::string path;
+    };
+
+    struct Entry {
+        std::string  path;
+        u32          full_width  = 0;      // known once the first read finished
+        u32          full_height = 0;
+        u32          full_levels = 0;
+        GPUTexture   live;                 // being sampled
+        u32          live_mip = UINT32_MAX; // source mip at level 0 of live
+        GPUTexture   next;                 // uploaded, waiting for its ticket
+        u32          next_mip = 0;
+        bool         reading  = false;     // a job is queued or decoding
+        bool         failed   = false;     // unreadable, never streamed again
+        u32          version  = 0;
+        float        demand    = 0.0f;     // screen pixels, largest of the last frame seen
+        u64          last_seen = 0;        // frame of the last request
+        u64          last_swap = 0;
+        VkDeviceSize reserved  = 0;        // growth the queued read was admitted with
+    };
+
+    struct Candidate {
+        u32   texture;
+        u32   mip;      // wanted first mip, UINT32_MAX once handled
+        float priority; // screen pixels per resident texel
+    };
+
+    struct Retired {
+        GPUTexture texture;
+        u64        frame;
+    };
+
+    void worker_loop();
+    void decode(const Job& job, Decoded& out) const;
+    void create_next(VulkanContext& ctx, UploadManager& upload, Decoded& d);
+    void queue_read(u32 texture, u32 first_mip);
+    void schedule();
+    u32  wanted_mip(const Entry& e) const;
+    VkDeviceSize chain_bytes(const Entry& e, u32 first_mip) const;
+
+    std::vector<Entry>     entries_;
+    std::vector<Retired>   retired_;
+    std::vector<Decoded>   ready_;      // read, waiting for upload bandwidth
+    std::vector<Candidate> candidates_; // scratch for schedule()
+    u64          frame_            = 0;
+    u32          frames_in_flight_ = 2;
+    VkDeviceSize budget_           = 0;
+    VkDeviceSize resident_bytes_   = 0; // live and next images
+    VkDeviceSize reserved_bytes_   = 0; // admitted growth of reads in flight
+    u32          reading_          = 0; // jobs not yet turned into images
+    bool         bc_supported_     = false;
+
+    // Shared with the workers
+    std::vector<std::thread> workers_;
+    std::mutex               mutex_;
+    std::condition_variable  wake_;
+    std::deque<Job>          jobs_;
+    std::vector<Decoded>     results_;
+    bool                     stop_ = false;
+};
+
+} // namespace lumios
@@ -0,0 +1,94 @@
+#include "vk_transient.h"
+#include "vk_buffer.h"
+#include "vk_init.h"
+#include <algorithm>
+#include <cstring>
+
+namespace lumios {
+
+bool TransientAllocator::init(VulkanContext& ctx, VkDeviceSize region_size, VkBufferUsageFlags usage) {
+    const auto& limits = ctx.device_properties.limits;
+    alignment_ = std::max({VkDeviceSize(16), limits.minUniformBufferOffsetAlignment,
+                           limits.minStorageBufferOffsetAlignment});
+    usage_ = usage;
+    return create(ctx, region_size);
+}
+
+bool TransientAllocator::create(VulkanContext& ctx, VkDeviceSize region_size) {
+    region_size_ = aligned(region_size);
+    buffer_ = create_buffer(ctx.allocator, region_size_ * MAX_FRAMES_IN_FLIGHT, usage_, VMA_MEMORY_USAGE_CPU_TO_GPU);
+    if (!buffer_.buffer || !buffer_.mapped) {
+        LOG_ERROR("Failed to create %llu KB transient buffer",
+                  static_cast<unsigned long long>(region_size_ * MAX_FRAMES_IN_FLIGHT >> 10));
+        destroy_buffer(ctx.allocator, buffer_);
+        return false;
+    }
+    return true;
+}
+
+void TransientAllocator::destroy(VulkanContext& ctx) {
+    destroy_buffer(ctx.allocator, buffer_);
+    region_size_ = 0;
+    base_        = 0;
+    cursor_      = 0;
+}
+
+void TransientAllocator::begin_frame(u32 frame) {
+    base_   = VkDeviceSize(frame) * region_size_;
+    cursor_ = 0;
+}
+
+TransientAllocator::Allocation TransientAllocator::allocate(VkDeviceSize size) {
+    VkDeviceSize bytes = aligned(std::max<VkDeviceSize>(size, 1));
+    if (!buffer_.mapped || cursor_ + bytes > region_size_) {
+        LOG_ERROR("Transient region full (%llu of %llu bytes)",
+                  static_cast<unsigned long long>(cursor_ + bytes),
+                  static_cast<unsigned long long>(region_size_));
+        return {};
+    }
+
+    Allocation a;
+    a.offset = base_ + cursor_;
+    a.size   = size;
+    a.data   = buffer_.mapped + a.offset;
+    cursor_ += bytes;
+    return a;
+}
+
+TransientAllocator::Allocation TransientAllocator::push(const void* data, VkDeviceSize size) {
+    Allocation a = allocate(size);
+    if (a.data && size) memcpy(a.data, data, size);
+    return a;
+}
+
+void TransientAllocator::flush(VulkanContext& ctx) {
+    if (cursor_) vmaFlushAllocation(ctx.allocator, buffer_.allocation, base_, cursor_);
+}
+
+bool TransientAllocator::reserve(VulkanContext& ctx, VkDeviceSize bytes) {
+    if (bytes <= region_size_) return false;
+
+    VkDeviceSize size = region_size_;
+    while (size < bytes) size *= 2;
+
+    // The old buffer stays live until its replacement exists, so a failed
+    // grow leaves the allocator usable at its current size
+    u32          frame    = static_cast<u32>(base_ / region_size_);
+    GPUBuffer    previous = buffer_;
+    VkDeviceSize old_size = region_size_;
+    if (!create(ctx, size)) {
+        buffer_      = previous;
+        region_size_ = old_size;
+        return false;
+    }
+
+    vkDeviceWaitIdle(ctx.device);
+    destroy_buffer(ctx.allocator, previous);
+    base_   = VkDeviceSize(frame) * region_size_;
+    cursor_ = 0;
+
+    LOG_INFO("Transient buffer grown to %llu KB per frame", static_cast<unsigned long long>(region_size_ >> 10));
+    return true;
+}
+
+} // namespace lumios
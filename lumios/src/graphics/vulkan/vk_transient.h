@@ -0,0 +1,58 @@
+#pragma once
+
+#include "vk_common.h"
+
+namespace lumios {
+
+struct VulkanContext;
+
+// Per-frame scratch memory for data rebuilt every frame (uniforms,
+// instances, indirect commands). One persistently mapped host-visible
+// buffer is split into MAX_FRAMES_IN_FLIGHT regions; a frame bumps a
+// cursor through its region and starts over when the slot comes round
+// again, after its fence. Offsets are absolute in buffer() and aligned
+// for uniform and storage descriptors, so they can be used directly as
+// dynamic offsets.
+class TransientAllocator {
+public:
+    struct Allocation {
+        VkDeviceSize offset = 0;
+        VkDeviceSize size   = 0;
+        u8*          data   = nullptr; // null when the region is full
+    };
+
+    bool init(VulkanContext& ctx, VkDeviceSize region_size, VkBufferUsageFlags usage);
+    void destroy(VulkanContext& ctx);
+
+    // Rewinds the region of the given frame slot; the GPU must be done with it
+    void begin_frame(u32 frame);
+
+    Allocation allocate(VkDeviceSize size);
+    Allocation push(const void* data, VkDeviceSize size);
+
+    // Makes the host writes of the current frame visible to the device
+    void flush(VulkanContext& ctx);
+
+    // Grows every region to hold at least bytes. Idles the device and
+    // replaces the buffer, so it goes between begin_frame() and the first
+    // allocation. Returns true when the buffer changed and descriptors
+    // pointing at it must be rewritten.
+    bool reserve(VulkanContext& ctx, VkDeviceSize bytes);
+
+    VkDeviceSize aligned(VkDeviceSize size) const { return (size + alignment_ - 1) & ~(alignment_ - 1); }
+    VkBuffer     buffer()      const { return buffer_.buffer; }
+    VkDeviceSize used()        const { return cursor_; }
+    VkDeviceSize region_size() const { return region_size_; }
+
+private:
+    bool create(VulkanContext& ctx, VkDeviceSize region_size);
+
+    GPUBuffer          buffer_;
+    VkBufferUsageFlags usage_       = 0;
+    VkDeviceSize       region_size_ = 0;
+    VkDeviceSize       alignment_   = 256;
+    VkDeviceSize       base_        = 0; // start of the current frame's region
+    VkDeviceSize       cursor_      = 0; // bytes used in it
+};
+
+} // namespace lumios
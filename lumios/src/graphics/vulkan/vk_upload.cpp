@@ -0,0 +1,262 @@
+#include "vk_upload.h"
+#include "vk_init.h"
+#include "vk_buffer.h"
+#include "vk_texture.h"
+#include <algorithm>
+
+namespace lumios {
+
+static u64 align_up(u64 v, u64 a) { return (v + a - 1) / a * a; }
+
+bool UploadManager::init(VulkanContext& ctx, VkDeviceSize staging_size) {
+    if (!ctx.features.timeline_semaphore) {
+        LOG_ERROR("Upload manager: device lacks timeline semaphores");
+        return false;
+    }
+
+    queue_           = ctx.transfer_queue;
+    family_          = ctx.transfer_family;
+    graphics_family_ = ctx.graphics_family;
+    families_[0]     = graphics_family_;
+    families_[1]     = family_;
+
+    VkCommandPoolCreateInfo pci{};
+    pci.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pci.flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    pci.queueFamilyIndex = family_;
+    VK_CHECK(vkCreateCommandPool(ctx.device, &pci, nullptr, &pool_));
+
+    VkSemaphoreTypeCreateInfo type{};
+    type.sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    type.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    VkSemaphoreCreateInfo sci{};
+    sci.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    sci.pNext = &type;
+    VK_CHECK(vkCreateSemaphore(ctx.device, &sci, nullptr, &timeline_));
+
+    // Buffer-to-image copies need offsets aligned to 4 and the texel size
+    alignment_ = std::max<VkDeviceSize>(16, ctx.device_properties.limits.optimalBufferCopyOffsetAlignment);
+    ring_size_ = staging_size / alignment_ * alignment_;
+    ring_ = create_buffer(ctx.allocator, ring_size_, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+    if (!ring_.buffer || !pool_ || !timeline_) return false;
+
+    void* mapped = nullptr;
+    VK_CHECK(vmaMapMemory(ctx.allocator, ring_.allocation, &mapped));
+    ring_data_ = static_cast<u8*>(mapped);
+
+    LOG_INFO("Upload manager: %llu MB staging ring, %s transfer queue (family %u)",
+             static_cast<unsigned long long>(ring_size_ >> 20),
+             dedicated_queue() ? "dedicated" : "graphics", family_);
+    return true;
+}
+
+void UploadManager::destroy(VulkanContext& ctx) {
+    for (auto& b : in_flight_)
+        for (auto& buf : b.oversized) destroy_buffer(ctx.allocator, buf);
+    for (auto& buf : open_.oversized) destroy_buffer(ctx.allocator, buf);
+    in_flight_.clear();
+    open_ = {};
+    free_cmds_.clear();
+    acquires_.clear();
+
+    if (ring_data_) { vmaUnmapMemory(ctx.allocator, ring_.allocation); ring_data_ = nullptr; }
+    destroy_buffer(ctx.allocator, ring_);
+    if (timeline_) { vkDestroySemaphore(ctx.device, timeline_, nullptr); timeline_ = VK_NULL_HANDLE; }
+    if (pool_)     { vkDestroyCommandPool(ctx.device, pool_, nullptr); pool_ = VK_NULL_HANDLE; }
+}
+
+// Copies data into staging memory and returns its offset in buffer. Space
+// comes back as the oldest batches finish; when the ring is full this
+// waits for them, submitting the open batch first if it alone fills it.
+VkDeviceSize UploadManager::stage(VulkanContext& ctx, const void* data, VkDeviceSize size, VkBuffer& buffer) {
+    if (size > ring_size_) {
+        GPUBuffer big = create_buffer(ctx.allocator, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+        upload_buffer_data(ctx.allocator, big, data, size);
+        open_.oversized.push_back(big);
+        buffer = big.buffer;
+        return 0;
+    }
+
+    u64 start;
+    for (;;) {
+        start = align_up(head_, alignment_);
+        u64 offset = start % ring_size_;
+        if (offset + size > ring_size_) start += ring_size_ - offset; // no copy wraps around
+        if (start + size - tail_ <= ring_size_) break;
+
+        if (in_flight_.empty()) {
+            if (!open_.cmd) { head_ = tail_ = 0; continue; } // idle, start over
+            flush(ctx);
+        }
+        wait(ctx, in_flight_.front().ticket);
+    }
+
+    VkDeviceSize offset = start % ring_size_;
+    memcpy(ring_data_ + offset, data, size);
+    vmaFlushAllocation(ctx.allocator, ring_.allocation, offset, size);
+    head_  = start + size;
+    buffer = ring_.buffer;
+    return offset;
+}
+
+VkCommandBuffer UploadManager::recording(VulkanContext& ctx) {
+    if (open_.cmd) return open_.cmd;
+
+    if (!free_cmds_.empty()) {
+        open_.cmd = free_cmds_.back();
+        free_cmds_.pop_back();
+    } else {
+        VkCommandBufferAllocateInfo ai{};
+        ai.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        ai.commandPool        = pool_;
+        ai.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        ai.commandBufferCount = 1;
+        VK_CHECK(vkAllocateCommandBuffers(ctx.device, &ai, &open_.cmd));
+    }
+
+    VkCommandBufferBeginInfo bi{};
+    bi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    bi.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VK_CHECK(vkBeginCommandBuffer(open_.cmd, &bi));
+    return open_.cmd;
+}
+
+u64 UploadManager::upload_buffer(VulkanContext& ctx, const GPUBuffer& dst, const void* data,
+                                 VkDeviceSize size, VkDeviceSize dst_offset) {
+    if (size == 0) return 0;
+
+    VkBuffer src;
+    VkDeviceSize src_offset = stage(ctx, data, size, src);
+
+    VkBufferCopy region{};
+    region.srcOffset = src_offset;
+    region.dstOffset = dst_offset;
+    region.size      = size;
+    vkCmdCopyBuffer(recording(ctx), src, dst.buffer, 1, &region);
+    return submitted_ + 1;
+}
+
+u64 UploadManager::upload_image(VulkanContext& ctx, VkImage image, u32 levels,
+                                std::span<const VkBufferImageCopy> regions,
+                                const void* data, VkDeviceSize size, bool generate_mips) {
+    VkBuffer src;
+    VkDeviceSize src_offset = stage(ctx, data, size, src);
+    VkCommandBuffer cmd = recording(ctx);
+
+    transition_image_layout(cmd, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, levels);
+
+    copy_regions_.assign(regions.begin(), regions.end());
+    for (auto& r : copy_regions_) r.bufferOffset += src_offset;
+    vkCmdCopyBufferToImage(cmd, src, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           static_cast<u32>(copy_regions_.size()), copy_regions_.data());
+
+    u64 ticket = submitted_ + 1;
+    VkExtent3D extent = regions.empty() ? VkExtent3D{1, 1, 1} : regions[0].imageExtent;
+    bool generate = generate_mips && levels > 1;
+    if (!dedicated_queue()) {
+        // Already on the graphics queue
+        if (generate) generate_mipmaps(cmd, image, extent.width, extent.height, levels);
+        else transition_image_layout(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, levels);
+        return ticket;
+    }
+
+    // Release to the graphics family, which records the matching acquire;
+    // the pair performs the layout transition. Blits need a graphics queue,
+    // so images still to be mipmapped cross over in TRANSFER_DST.
+    VkImageMemoryBarrier release{};
+    release.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    release.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+    release.oldLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    release.newLayout           = generate ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+                                           : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    release.srcQueueFamilyIndex = family_;
+    release.dstQueueFamilyIndex = graphics_family_;
+    release.image               = image;
+    release.subresourceRange    = {VK_IMAGE_ASPECT_COLOR_BIT, 0, levels, 0, 1};
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &release);
+
+    VkImageMemoryBarrier acquire = release;
+    acquire.srcAccessMask = 0;
+    acquire.dstAccessMask = generate ? VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT
+                                     : VK_ACCESS_SHADER_READ_BIT;
+    acquires_.push_back({ticket, acquire, extent, generate});
+    return ticket;
+}
+
+u64 UploadManager::flush(VulkanContext& ctx) {
+    if (!open_.cmd) return submitted_;
+    VK_CHECK(vkEndCommandBuffer(open_.cmd));
+
+    open_.ticket   = submitted_ + 1;
+    open_.ring_end = head_;
+
+    VkTimelineSemaphoreSubmitInfo tsi{};
+    tsi.sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    tsi.signalSemaphoreValueCount = 1;
+    tsi.pSignalSemaphoreValues    = &open_.ticket;
+
+    VkSubmitInfo si{};
+    si.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    si.pNext                = &tsi;
+    si.commandBufferCount   = 1;
+    si.pCommandBuffers      = &open_.cmd;
+    si.signalSemaphoreCount = 1;
+    si.pSignalSemaphores    = &timeline_;
+    VK_CHECK(vkQueueSubmit(queue_, 1, &si, VK_NULL_HANDLE));
+
+    submitted_ = open_.ticket;
+    in_flight_.push_back(std::move(open_));
+    open_ = {};
+    return submitted_;
+}
+
+void UploadManager::wait(VulkanContext& ctx, u64 ticket) {
+    if (ticket <= completed_) return;
+    if (ticket > submitted_) flush(ctx);
+
+    VkSemaphoreWaitInfo wi{};
+    wi.sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    wi.semaphoreCount = 1;
+    wi.pSemaphores    = &timeline_;
+    wi.pValues        = &ticket;
+    VK_CHECK(vkWaitSemaphores(ctx.device, &wi, UINT64_MAX));
+    retire(ctx, ticket);
+}
+
+void UploadManager::retire(VulkanContext& ctx, u64 completed) {
+    completed_ = std::max(completed_, completed);
+    while (!in_flight_.empty() && in_flight_.front().ticket <= completed_) {
+        Batch& b = in_flight_.front();
+        tail_ = b.ring_end;
+        for (auto& buf : b.oversized) destroy_buffer(ctx.allocator, buf);
+        vkResetCommandBuffer(b.cmd, 0);
+        free_cmds_.push_back(b.cmd);
+        in_flight_.pop_front();
+    }
+}
+
+u64 UploadManager::acquire(VulkanContext& ctx, VkCommandBuffer cmd) {
+    u64 value = 0;
+    VK_CHECK(vkGetSemaphoreCounterValue(ctx.device, timeline_, &value));
+    retire(ctx, value);
+
+    if (acquires_.empty()) return completed_;
+
+    auto ready = std::stable_partition(acquires_.begin(), acquires_.end(),
+        [&](const PendingAcquire& a) { return a.ticket > completed_; });
+    for (auto it = ready; it != acquires_.end(); ++it) {
+        VkPipelineStageFlags dst = it->generate ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, dst,
+                             0, 0, nullptr, 0, nullptr, 1, &it->barrier);
+        if (it->generate) {
+            generate_mipmaps(cmd, it->barrier.image, it->extent.width, it->extent.height,
+                             it->barrier.subresourceRange.levelCount);
+        }
+    }
+    acquires_.erase(ready, acquires_.end());
+    return completed_;
+}
+
+} // namespace lumios
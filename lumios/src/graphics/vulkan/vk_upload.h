@@ -0,0 +1,107 @@
+#pragma once
+
+#include "vk_common.h"
+#include <deque>
+#include <vector>
+
+namespace lumios {
+
+struct VulkanContext;
+
+// Streams data to device-local buffers and images without stalling the
+// graphics queue. Uploads are copied into a persistently mapped staging
+// ring right away and recorded into one command buffer; flush() submits
+// that batch to the transfer queue (a dedicated one when the device has
+// it) and signals a timeline semaphore. Every upload returns the ticket
+// (timeline value) after which its destination is safe to use.
+//
+// Buffers written here must be created with sharing_families() when there
+// is a dedicated queue; images are handed over to the graphics family by
+// acquire(), which the frame records before anything samples them.
+class UploadManager {
+public:
+    bool init(VulkanContext& ctx, VkDeviceSize staging_size = VkDeviceSize(32) << 20);
+    void destroy(VulkanContext& ctx);
+
+    // Queues a copy of size bytes into dst at dst_offset
+    u64 upload_buffer(VulkanContext& ctx, const GPUBuffer& dst, const void* data,
+                      VkDeviceSize size, VkDeviceSize dst_offset = 0);
+
+    // Queues the regions of a 2D color image with the given level count,
+    // created in UNDEFINED layout with TRANSFER_DST usage; bufferOffset is
+    // relative to data and must be aligned to the texel block. With
+    // generate_mips only level 0 is given and the others are blitted from
+    // it on the graphics queue (the image needs TRANSFER_SRC usage). The
+    // image ends up SHADER_READ_ONLY_OPTIMAL.
+    u64 upload_image(VulkanContext& ctx, VkImage image, u32 levels, std::span<const VkBufferImageCopy> regions,
+                     const void* data, VkDeviceSize size, bool generate_mips = false);
+
+    // Submits the batch recorded since the last flush, if any, and returns
+    // the last submitted ticket. Called once per frame.
+    u64 flush(VulkanContext& ctx);
+
+    // Blocks until the ticket is signaled, flushing first if needed
+    void wait(VulkanContext& ctx, u64 ticket);
+
+    // Retires finished batches and records the queue family acquires (and
+    // mip generation) of the images they uploaded. Returns the completed
+    // ticket: the submit of cmd
+    // must wait on semaphore() for that value (already signaled, so free),
+    // and everything with a ticket up to it is usable in cmd.
+    u64 acquire(VulkanContext& ctx, VkCommandBuffer cmd);
+
+    VkSemaphore semaphore()       const { return timeline_; }
+    u64         completed()       const { return completed_; }
+    bool        dedicated_queue() const { return family_ != graphics_family_; }
+
+    // Queue families for VK_SHARING_MODE_CONCURRENT buffers; a single
+    // family (exclusive) without a dedicated transfer queue
+    std::span<const u32> sharing_families() const {
+        return {families_, dedicated_queue() ? 2u : 1u};
+    }
+
+private:
+    struct Batch {
+        VkCommandBuffer        cmd      = VK_NULL_HANDLE;
+        u64                    ticket   = 0;
+        u64                    ring_end = 0; // ring head when submitted
+        std::vector<GPUBuffer> oversized;    // staging too big for the ring
+    };
+
+    struct PendingAcquire {
+        u64                  ticket;
+        VkImageMemoryBarrier barrier;
+        VkExtent3D           extent;   // of level 0, for generate_mips
+        bool                 generate;
+    };
+
+    VkDeviceSize stage(VulkanContext& ctx, const void* data, VkDeviceSize size, VkBuffer& buffer);
+    VkCommandBuffer recording(VulkanContext& ctx);
+    void retire(VulkanContext& ctx, u64 completed);
+
+    VkQueue       queue_           = VK_NULL_HANDLE;
+    u32           family_          = 0;
+    u32           graphics_family_ = 0;
+    u32           families_[2]     = {};
+    VkCommandPool pool_            = VK_NULL_HANDLE;
+    VkSemaphore   timeline_        = VK_NULL_HANDLE;
+
+    // Ring positions are byte counters that only grow; the offset is the
+    // counter modulo the size, and head - tail is the space in flight
+    GPUBuffer    ring_;
+    u8*          ring_data_ = nullptr;
+    VkDeviceSize ring_size_ = 0;
+    VkDeviceSize alignment_ = 16;
+    u64          head_      = 0;
+    u64          tail_      = 0;
+
+    Batch                        open_;      // recording, not submitted
+    std::deque<Batch>            in_flight_; // submitted, oldest first
+    std::vector<VkCommandBuffer> free_cmds_;
+    std::vector<PendingAcquire>  acquires_;
+    std::vector<VkBufferImageCopy> copy_regions_; // scratch
+    u64 submitted_ = 0;
+    u64 completed_ = 0;
+};
+
+} // namespace lumios
@@ -16,7 +16,7 @@ bool Engine::init(const EngineConfig& config, Application& app) {
     timer_.reset();
 
     renderer_ = Renderer::create();
-    if (!renderer_->init(window_, config.shader_dir)) {
+    if (!renderer_->init(window_, config.shader_dir, config.pipeline_cache)) {
         LOG_FATAL("Renderer initialization failed");
         return false;
     }
@@ -20,6 +20,7 @@ namespace lumios {
 struct EngineConfig {
     WindowConfig window;
     std::string  shader_dir;
+    std::string  pipeline_cache; // written on shutdown; empty for none
 };
 
 class Application {
@@ -0,0 +1,94 @@
+#include "client_prediction.h"
+#include <algorithm>
+#include <cmath>
+
+namespace lumios::net {
+
+// --- InputHistory ---
+
+void InputHistory::push(const ClientInput& input) {
+    inputs_[head_] = input;
+    head_ = (head_ + 1) % CAPACITY;
+    count_ = std::min(count_ + 1, CAPACITY); // when full the oldest is overwritten
+}
+
+void InputHistory::drop_through(u32 sequence) {
+    while (count_ > 0 && at(0).sequence <= sequence) count_--;
+}
+
+// --- ClientPrediction ---
+
+void ClientPrediction::reset(const EntityState& state) {
+    predicted_    = state;
+    server_state_ = state;
+    correction_   = glm::vec3(0.0f);
+    history_.clear();
+    last_acked_   = 0;
+}
+
+NetworkMessage ClientPrediction::apply_input(ClientInput input) {
+    input.sequence = next_sequence_++;
+    if (move_) move_(predicted_, input, dt_);
+    history_.push(input);
+
+    u32 count = std::min(std::max(redundancy_, 1u), history_.size());
+    NetworkMessage msg;
+    msg.type = MessageType::Input;
+    msg.write(count);
+    for (u32 i = history_.size() - count; i < history_.size(); i++)
+        msg.write(history_.at(i));
+    return msg;
+}
+
+bool ClientPrediction::on_snapshot(const NetworkMessage& msg) {
+    if (msg.payload.size() < sizeof(SnapshotHeader)) return false;
+    auto header = msg.read<SnapshotHeader>(0);
+
+    bool found = false;
+    size_t offset = sizeof(SnapshotHeader);
+    for (u32 i = 0; i < header.entity_count && offset + sizeof(EntityState) <= msg.payload.size(); i++) {
+        EntityState state = msg.read<EntityState>(offset);
+        offset += sizeof(EntityState);
+        if (state.id == entity_) {
+            server_state_ = state;
+            found = true;
+            break;
+        }
+    }
+
+    if (header.input_ack < last_acked_) return false;
+    if (!found) {
+        // The server sends our entity with every advanced ack; an ack without
+        // it confirms nothing about its state (the cached one may predate a
+        // lost delta), so only retire the acknowledged inputs
+        history_.drop_through(header.input_ack);
+        last_acked_ = header.input_ack;
+        return false;
+    }
+
+    reconcile(server_state_, header.input_ack);
+    return true;
+}
+
+void ClientPrediction::reconcile(const EntityState& authoritative, u32 ack) {
+    history_.drop_through(ack);
+    last_acked_ = ack;
+
+    glm::vec3 before = predicted_.position;
+    predicted_ = authoritative;
+    if (move_) {
+        for (u32 i = 0; i < history_.size(); i++)
+            move_(predicted_, history_.at(i), dt_);
+    }
+
+    glm::vec3 error = before - predicted_.position;
+    last_error_ = glm::length(error);
+    if (last_error_ > snap_distance_) correction_ = glm::vec3(0.0f);
+    else                              correction_ += error;
+}
+
+void ClientPrediction::update(float frame_dt) {
+    correction_ *= std::exp(-10.0f * frame_dt);
+}
+
+} // namespace lumios::net
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "net_types.h"
+#include <array>
+
+namespace lumios::net {
+
+// Deterministic movement step shared by the client (prediction) and the
+// server (authority). Both sides must run the same function with the same
+// fixed dt for reconciliation to converge.
+using MoveFn = std::function<void(EntityState& state, const ClientInput& input, float dt)>;
+
+// Fixed-capacity ring of inputs the server has not acknowledged yet
+class InputHistory {
+public:
+    static constexpr u32 CAPACITY = 128;
+
+    void push(const ClientInput& input);
+    void drop_through(u32 sequence); // discard everything acked by the server
+    void clear() { count_ = 0; }
+
+    u32  size()  const { return count_; }
+    bool full()  const { return count_ == CAPACITY; }
+    const ClientInput& at(u32 i) const { return inputs_[(head_ + CAPACITY - count_ + i) % CAPACITY]; }
+
+private:
+    std::array<ClientInput, CAPACITY> inputs_{};
+    u32 head_  = 0; // next write
+    u32 count_ = 0;
+};
+
+// Client side of prediction: applies local inputs immediately, sends them
+// with redundancy, and on every acknowledged server state rewinds to it and
+// replays the inputs the server has not seen yet.
+class ClientPrediction {
+public:
+    void set_move_fn(MoveFn fn)                { move_ = std::move(fn); }
+    void set_tick_rate(float hz)               { dt_ = 1.0f / hz; }
+    void set_controlled_entity(EntityNetID id) { entity_ = id; }
+    // Number of unacked inputs repeated in each Input message
+    void set_redundancy(u32 count)             { redundancy_ = count; }
+    // Corrections smaller than this are blended out over time, larger ones snap
+    void set_snap_distance(float distance)     { snap_distance_ = distance; }
+
+    void reset(const EntityState& state);
+
+    // Stamps a sequence number, predicts one tick and returns the Input
+    // message to send for it
+    NetworkMessage apply_input(ClientInput input);
+
+    // Feeds a StateSnapshot/StateDelta. Returns true if it reconciled.
+    bool on_snapshot(const NetworkMessage& msg);
+
+    // Decays the visual correction offset; call once per frame
+    void update(float frame_dt);
+
+    const EntityState& predicted()       const { return predicted_; }
+    glm::vec3          render_position() const { return predicted_.position + correction_; }
+    u32                last_acked()      const { return last_acked_; }
+    u32                unacked_count()   const { return history_.size(); }
+    float              last_error()      const { return last_error_; }
+
+private:
+    void reconcile(const EntityState& authoritative, u32 ack);
+
+    MoveFn       move_;
+    InputHistory history_;
+    EntityState  predicted_{};
+    EntityState  server_state_{};
+    glm::vec3    correction_{0.0f};
+    EntityNetID  entity_        = 0;
+    float        dt_            = 1.0f / 60.0f;
+    float        snap_distance_ = 2.0f;
+    float        last_error_    = 0.0f;
+    u32          redundancy_    = 4;
+    u32          next_sequence_ = 1;
+    u32          last_acked_    = 0;
+};
+
+} // namespace lumios::net
@@ -0,0 +1,51 @@
+#include "input_queue.h"
+
+namespace lumios::net {
+
+void InputQueue::on_receive(ClientID client, const NetworkMessage& msg) {
+    if (msg.type != MessageType::Input) return;
+
+    auto& rec = clients_[client];
+    u32 count = msg.read<u32>(0);
+    size_t offset = sizeof(u32);
+
+    for (u32 i = 0; i < count && offset + sizeof(ClientInput) <= msg.payload.size(); i++) {
+        ClientInput input = msg.read<ClientInput>(offset);
+        offset += sizeof(ClientInput);
+
+        // Redundant copies of applied or already queued inputs are expected
+        if (input.sequence <= rec.last_applied) continue;
+        u32 newest = rec.pending.empty() ? rec.last_applied : rec.pending.back().sequence;
+        if (input.sequence <= newest) continue;
+        rec.pending.push_back(input);
+    }
+
+    // Dropped inputs count as applied so the client stops replaying them
+    while (rec.pending.size() > max_pending_) {
+        rec.last_applied = rec.pending.front().sequence;
+        rec.pending.pop_front();
+    }
+}
+
+bool InputQueue::pop(ClientID client, ClientInput& out) {
+    auto it = clients_.find(client);
+    if (it == clients_.end() || it->second.pending.empty()) return false;
+
+    auto& rec = it->second;
+    out = rec.pending.front();
+    rec.pending.pop_front();
+    rec.last_applied = out.sequence;
+    return true;
+}
+
+u32 InputQueue::last_applied(ClientID client) const {
+    auto it = clients_.find(client);
+    return it != clients_.end() ? it->second.last_applied : 0;
+}
+
+u32 InputQueue::pending(ClientID client) const {
+    auto it = clients_.find(client);
+    return it != clients_.end() ? static_cast<u32>(it->second.pending.size()) : 0;
+}
+
+} // namespace lumios::net
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "net_types.h"
+#include <deque>
+#include <unordered_map>
+
+namespace lumios::net {
+
+// Server side of client prediction. Input messages carry the client's most
+// recent unacknowledged inputs (redundantly, to survive loss); the queue keeps
+// the ones not applied yet in sequence order and remembers the last applied
+// sequence so snapshots can acknowledge it.
+class InputQueue {
+public:
+    void on_receive(ClientID client, const NetworkMessage& msg);
+
+    // Pops the next input for this tick and marks it applied
+    bool pop(ClientID client, ClientInput& out);
+
+    u32  last_applied(ClientID client) const;
+    u32  pending(ClientID client) const;
+    void remove_client(ClientID client) { clients_.erase(client); }
+
+    // Older inputs are dropped when a client floods the queue
+    void set_max_pending(u32 count) { max_pending_ = count; }
+
+private:
+    struct ClientRecord {
+        std::deque<ClientInput> pending;
+        u32 last_applied = 0;
+    };
+
+    std::unordered_map<ClientID, ClientRecord> clients_;
+    u32 max_pending_ = 32;
+};
+
+} // namespace lumios::net
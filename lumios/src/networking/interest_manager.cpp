@@ -1,67 +1,196 @@
 #include "interest_manager.h"
+#include <algorithm>
 #include <cmath>
+#include <iterator>
+#include <limits>
 
 namespace lumios::net {
 
+static const VisibilityDiff           s_empty_diff;
+static const std::vector<EntityNetID> s_empty_set;
+
+// Distance from p to cell c along one axis. Border cells also hold everything
+// clamped in from outside the world bounds, so they extend to infinity.
+static float axis_gap(float p, u32 c, float origin, float cell_size, u32 dim) {
+    constexpr float inf = std::numeric_limits<float>::infinity();
+    float lo = (c == 0)       ? -inf : origin + static_cast<float>(c) * cell_size;
+    float hi = (c + 1 == dim) ?  inf : origin + static_cast<float>(c + 1) * cell_size;
+    if (p < lo) return lo - p;
+    if (p > hi) return p - hi;
+    return 0.0f;
+}
+
+InterestManager::InterestManager() {
+    rebuild_grid();
+}
+
+void InterestManager::set_cell_size(float size) {
+    // Zero, negative and NaN sizes would divide by zero or size the grid
+    // from garbage; keep the current layout instead
+    if (!(size > 0.0f) || !std::isfinite(size)) return;
+    cell_size_ = size;
+    rebuild_grid();
+}
+
+void InterestManager::set_world_bounds(const glm::vec3& min, const glm::vec3& max) {
+    world_min_ = min;
+    world_max_ = max;
+    rebuild_grid();
+}
+
+void InterestManager::set_grid_mode(GridMode mode) {
+    mode_ = mode;
+    rebuild_grid();
+}
+
+u32 InterestManager::cell_coord(float v, float origin, u32 dim) const {
+    // NaN positions land in cell 0 instead of reaching the integer cast
+    float c = std::floor((v - origin) * inv_cell_size_);
+    if (!(c > 0.0f)) return 0;
+    if (c >= static_cast<float>(dim - 1)) return dim - 1;
+    return static_cast<u32>(c);
+}
+
+u32 InterestManager::cell_index(const glm::vec3& pos) const {
+    u32 x = cell_coord(pos.x, world_min_.x, dim_x_);
+    u32 y = cell_coord(pos.y, world_min_.y, dim_y_);
+    u32 z = cell_coord(pos.z, world_min_.z, dim_z_);
+    return (z * dim_y_ + y) * dim_x_ + x;
+}
+
+void InterestManager::rebuild_grid() {
+    std::vector<CellEntry> all;
+    all.reserve(entities_.size());
+    for (auto& cell : cells_)
+        all.insert(all.end(), cell.begin(), cell.end());
+
+    inv_cell_size_ = 1.0f / cell_size_;
+    glm::vec3 extent = world_max_ - world_min_;
+    auto dim = [this](float e) {
+        return std::max(1u, static_cast<u32>(std::ceil(e * inv_cell_size_)));
+    };
+    dim_x_ = dim(extent.x);
+    dim_y_ = (mode_ == GridMode::Planar) ? 1u : dim(extent.y);
+    dim_z_ = dim(extent.z);
+
+    cells_.clear();
+    cells_.resize(static_cast<size_t>(dim_x_) * dim_y_ * dim_z_);
+    entities_.clear();
+    for (auto& e : all) update_entity(e.id, e.position);
+}
+
+void InterestManager::remove_from_cell(u32 cell, u32 slot) {
+    auto& entries = cells_[cell];
+    if (slot + 1 != entries.size()) {
+        entries[slot] = entries.back();
+        entities_.find(entries[slot].id)->second.slot = slot;
+    }
+    entries.pop_back();
+}
+
 void InterestManager::update_entity(EntityNetID id, const glm::vec3& position) {
-    auto old_it = entity_positions_.find(id);
-    if (old_it != entity_positions_.end()) {
-        Cell old_cell = to_cell(old_it->second);
-        spatial_grid_[old_cell].erase(id);
+    u32 cell = cell_index(position);
+
+    auto it = entities_.find(id);
+    if (it != entities_.end()) {
+        auto& rec = it->second;
+        if (rec.cell == cell) {
+            cells_[cell][rec.slot].position = position;
+            return;
+        }
+        remove_from_cell(rec.cell, rec.slot);
+        rec.cell = cell;
+        rec.slot = static_cast<u32>(cells_[cell].size());
+        cells_[cell].push_back({id, position});
+        return;
     }
 
-    entity_positions_[id] = position;
-    Cell cell = to_cell(position);
-    spatial_grid_[cell].insert(id);
+    entities_.emplace(id, EntityRecord{cell, static_cast<u32>(cells_[cell].size())});
+    cells_[cell].push_back({id, position});
 }
 
 void InterestManager::remove_entity(EntityNetID id) {
-    auto it = entity_positions_.find(id);
-    if (it != entity_positions_.end()) {
-        Cell cell = to_cell(it->second);
-        spatial_grid_[cell].erase(id);
-        entity_positions_.erase(it);
-    }
+    auto it = entities_.find(id);
+    if (it == entities_.end()) return;
+    EntityRecord rec = it->second;
+    entities_.erase(it);
+    remove_from_cell(rec.cell, rec.slot);
 }
 
 void InterestManager::update_client(ClientID id, const glm::vec3& position) {
-    client_positions_[id] = position;
+    clients_[id].position = position;
 }
 
 void InterestManager::remove_client(ClientID id) {
-    client_positions_.erase(id);
+    clients_.erase(id);
 }
 
-std::vector<EntityNetID> InterestManager::get_visible_entities(ClientID client) const {
-    std::vector<EntityNetID> result;
-    auto it = client_positions_.find(client);
-    if (it == client_positions_.end()) return result;
-
-    const glm::vec3& client_pos = it->second;
-    float radius_sq = interest_radius_ * interest_radius_;
-    int cell_range = static_cast<int>(std::ceil(interest_radius_ / cell_size_));
-    Cell center = to_cell(client_pos);
-
-    for (int dx = -cell_range; dx <= cell_range; dx++) {
-        for (int dy = -cell_range; dy <= cell_range; dy++) {
-            for (int dz = -cell_range; dz <= cell_range; dz++) {
-                Cell check{center.x + dx, center.y + dy, center.z + dz};
-                auto grid_it = spatial_grid_.find(check);
-                if (grid_it == spatial_grid_.end()) continue;
-
-                for (EntityNetID eid : grid_it->second) {
-                    auto pos_it = entity_positions_.find(eid);
-                    if (pos_it == entity_positions_.end()) continue;
-                    glm::vec3 diff = pos_it->second - client_pos;
-                    if (glm::dot(diff, diff) <= radius_sq) {
-                        result.push_back(eid);
-                    }
+void InterestManager::gather(const glm::vec3& center, std::vector<EntityNetID>& out) const {
+    float r  = interest_radius_;
+    float r2 = r * r;
+
+    u32 x0 = cell_coord(center.x - r, world_min_.x, dim_x_), x1 = cell_coord(center.x + r, world_min_.x, dim_x_);
+    u32 y0 = cell_coord(center.y - r, world_min_.y, dim_y_), y1 = cell_coord(center.y + r, world_min_.y, dim_y_);
+    u32 z0 = cell_coord(center.z - r, world_min_.z, dim_z_), z1 = cell_coord(center.z + r, world_min_.z, dim_z_);
+
+    for (u32 z = z0; z <= z1; z++) {
+        float gz = axis_gap(center.z, z, world_min_.z, cell_size_, dim_z_);
+        float dz2 = gz * gz;
+        if (dz2 > r2) continue;
+
+        for (u32 y = y0; y <= y1; y++) {
+            float gy = axis_gap(center.y, y, world_min_.y, cell_size_, dim_y_);
+            float dzy2 = dz2 + gy * gy;
+            if (dzy2 > r2) continue;
+
+            u32 row = (z * dim_y_ + y) * dim_x_;
+            for (u32 x = x0; x <= x1; x++) {
+                float gx = axis_gap(center.x, x, world_min_.x, cell_size_, dim_x_);
+                if (dzy2 + gx * gx > r2) continue;
+
+                for (const auto& e : cells_[row + x]) {
+                    glm::vec3 diff = e.position - center;
+                    if (glm::dot(diff, diff) <= r2)
+                        out.push_back(e.id);
                 }
             }
         }
     }
+}
 
+std::vector<EntityNetID> InterestManager::get_visible_entities(ClientID client) const {
+    std::vector<EntityNetID> result;
+    auto it = clients_.find(client);
+    if (it == clients_.end()) return result;
+    gather(it->second.position, result);
     return result;
 }
 
+const VisibilityDiff& InterestManager::refresh_client(ClientID client) {
+    auto it = clients_.find(client);
+    if (it == clients_.end()) return s_empty_diff;
+
+    auto& rec = it->second;
+    rec.scratch.clear();
+    gather(rec.position, rec.scratch);
+    std::sort(rec.scratch.begin(), rec.scratch.end());
+
+    rec.diff.entered.clear();
+    rec.diff.left.clear();
+    std::set_difference(rec.scratch.begin(), rec.scratch.end(),
+                        rec.visible.begin(), rec.visible.end(),
+                        std::back_inserter(rec.diff.entered));
+    std::set_difference(rec.visible.begin(), rec.visible.end(),
+                        rec.scratch.begin(), rec.scratch.end(),
+                        std::back_inserter(rec.diff.left));
+
+    std::swap(rec.visible, rec.scratch);
+    return rec.diff;
+}
+
+const std::vector<EntityNetID>& InterestManager::visible_set(ClientID client) const {
+    auto it = clients_.find(client);
+    return it != clients_.end() ? it->second.visible : s_empty_set;
+}
+
 } // namespace lumios::net
@@ -2,13 +2,27 @@
 
 #include "net_types.h"
 #include <unordered_map>
-#include <unordered_set>
 
 namespace lumios::net {
 
+enum class GridMode {
+    Planar,     // cells span the full world height (XZ only)
+    Volumetric, // cells are cubes in XYZ
+};
+
+struct VisibilityDiff {
+    std::vector<EntityNetID> entered;
+    std::vector<EntityNetID> left;
+};
+
 class InterestManager {
 public:
-    void set_cell_size(float size) { cell_size_ = size; }
+    InterestManager();
+
+    // Changing the grid layout re-buckets every tracked entity.
+    void set_cell_size(float size);
+    void set_world_bounds(const glm::vec3& min, const glm::vec3& max);
+    void set_grid_mode(GridMode mode);
 
     void update_entity(EntityNetID id, const glm::vec3& position);
     void remove_entity(EntityNetID id);
@@ -18,38 +32,55 @@ public:
 
     std::vector<EntityNetID> get_visible_entities(ClientID client) const;
 
+    // Re-queries the client's area and diffs it against the previous refresh.
+    // The returned reference stays valid until the next refresh of that client.
+    // Distinct clients may be refreshed concurrently as long as no entity or
+    // client is added, moved or removed meanwhile.
+    const VisibilityDiff& refresh_client(ClientID client);
+    const std::vector<EntityNetID>& visible_set(ClientID client) const;
+
     void set_interest_radius(float radius) { interest_radius_ = radius; }
 
+    u32 entity_count() const { return static_cast<u32>(entities_.size()); }
+    u32 client_count() const { return static_cast<u32>(clients_.size()); }
+    u32 cell_count()   const { return static_cast<u32>(cells_.size()); }
+
 private:
-    struct Cell {
-        i32 x, y, z;
-        bool operator==(const Cell& o) const { return x == o.x && y == o.y && z == o.z; }
+    // Entries keep a copy of the position so queries never leave the cell array
+    struct CellEntry {
+        EntityNetID id;
+        glm::vec3   position;
+    };
+
+    struct EntityRecord {
+        u32 cell;
+        u32 slot;
     };
 
-    struct CellHash {
-        size_t operator()(const Cell& c) const {
-            size_t h = 0;
-            h ^= std::hash<i32>()(c.x) + 0x9e3779b9 + (h << 6) + (h >> 2);
-            h ^= std::hash<i32>()(c.y) + 0x9e3779b9 + (h << 6) + (h >> 2);
-            h ^= std::hash<i32>()(c.z) + 0x9e3779b9 + (h << 6) + (h >> 2);
-            return h;
-        }
+    struct ClientRecord {
+        glm::vec3                position{0.0f};
+        std::vector<EntityNetID> visible; // sorted
+        std::vector<EntityNetID> scratch;
+        VisibilityDiff           diff;
     };
 
-    Cell to_cell(const glm::vec3& pos) const {
-        return {
-            static_cast<i32>(std::floor(pos.x / cell_size_)),
-            static_cast<i32>(std::floor(pos.y / cell_size_)),
-            static_cast<i32>(std::floor(pos.z / cell_size_))
-        };
-    }
+    u32  cell_coord(float v, float origin, u32 dim) const;
+    u32  cell_index(const glm::vec3& pos) const;
+    void rebuild_grid();
+    void remove_from_cell(u32 cell, u32 slot);
+    void gather(const glm::vec3& center, std::vector<EntityNetID>& out) const;
 
-    float cell_size_       = 50.0f;
-    float interest_radius_ = 200.0f;
+    GridMode  mode_            = GridMode::Volumetric;
+    float     cell_size_       = 50.0f;
+    float     inv_cell_size_   = 1.0f / 50.0f;
+    float     interest_radius_ = 200.0f;
+    glm::vec3 world_min_{-2048.0f, -512.0f, -2048.0f};
+    glm::vec3 world_max_{ 2048.0f,  512.0f,  2048.0f};
+    u32       dim_x_ = 1, dim_y_ = 1, dim_z_ = 1;
 
-    std::unordered_map<EntityNetID, glm::vec3> entity_positions_;
-    std::unordered_map<ClientID, glm::vec3>    client_positions_;
-    std::unordered_map<Cell, std::unordered_set<EntityNetID>, CellHash> spatial_grid_;
+    std::vector<std::vector<CellEntry>>           cells_;
+    std::unordered_map<EntityNetID, EntityRecord> entities_;
+    std::unordered_map<ClientID, ClientRecord>    clients_;
 };
 
 } // namespace lumios::net
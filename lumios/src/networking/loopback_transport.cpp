@@ -0,0 +1,146 @@
+#include "loopback_transport.h"
+#include "message_log.h"
+#include "net_stats.h"
+#include "packet_codec.h"
+
+namespace lumios::net {
+
+// --- LoopbackHub ---
+
+bool LoopbackHub::listen(u16 port, LoopbackTransport* server) {
+    return listeners_.emplace(port, server).second;
+}
+
+void LoopbackHub::unlisten(u16 port) {
+    listeners_.erase(port);
+}
+
+LoopbackTransport* LoopbackHub::find(u16 port) const {
+    auto it = listeners_.find(port);
+    return it != listeners_.end() ? it->second : nullptr;
+}
+
+// --- LoopbackTransport ---
+
+LoopbackTransport::~LoopbackTransport() {
+    disconnect();
+    if (port_ != 0) hub_.unlisten(port_);
+}
+
+bool LoopbackTransport::start_server(u16 port) {
+    if (port_ != 0 || !hub_.listen(port, this)) return false;
+    port_ = port;
+    return true;
+}
+
+bool LoopbackTransport::connect(const std::string& /*host*/, u16 port) {
+    LoopbackTransport* server = hub_.find(port);
+    if (!server || server == this) return false;
+
+    ClientID local_id = next_id_++;
+    ClientID remote_id = server->accept(this, local_id);
+    links_[local_id] = {server, remote_id};
+    inbox_.push_back({Event::Kind::Connect, local_id, {}});
+    return true;
+}
+
+ClientID LoopbackTransport::accept(LoopbackTransport* peer, ClientID id_on_peer) {
+    ClientID id = next_id_++;
+    links_[id] = {peer, id_on_peer};
+    inbox_.push_back({Event::Kind::Connect, id, {}});
+    return id;
+}
+
+void LoopbackTransport::drop_link(ClientID id) {
+    if (links_.erase(id))
+        inbox_.push_back({Event::Kind::Disconnect, id, {}});
+}
+
+void LoopbackTransport::disconnect() {
+    for (auto& [id, link] : links_)
+        link.peer->drop_link(link.id_on_peer);
+    links_.clear();
+}
+
+void LoopbackTransport::deliver(ClientID target, const NetworkMessage& msg, bool lost) {
+    auto it = links_.find(target);
+    if (it == links_.end()) return;
+
+    if (recorder_) recorder_->record(LogEvent::Outbound, target, msg);
+
+    const Link& link = it->second;
+    Event ev{Event::Kind::Message, link.id_on_peer, {}};
+    ev.msg.type   = msg.type;
+    ev.msg.sender = link.id_on_peer;
+    if (codec_) codec_->encode(msg, ev.msg.payload);
+    else        ev.msg.payload = msg.payload;
+    bytes_sent_ += ev.msg.payload.size();
+    if (stats_) stats_->on_send(target, msg.type, ev.msg.payload.size());
+    if (!lost) link.peer->inbox_.push_back(std::move(ev));
+}
+
+void LoopbackTransport::send_reliable(ClientID target, const NetworkMessage& msg) {
+    deliver(target, msg);
+}
+
+void LoopbackTransport::send_unreliable(ClientID target, const NetworkMessage& msg) {
+    // Lost on the wire, but the sender still sent it
+    bool lost = drop_rate_ > 0.0f && std::uniform_real_distribution<float>(0.0f, 1.0f)(rng_) < drop_rate_;
+    deliver(target, msg, lost);
+}
+
+void LoopbackTransport::broadcast_reliable(const NetworkMessage& msg) {
+    for (auto& [id, link] : links_) send_reliable(id, msg);
+}
+
+void LoopbackTransport::broadcast_unreliable(const NetworkMessage& msg) {
+    for (auto& [id, link] : links_) send_unreliable(id, msg);
+}
+
+void LoopbackTransport::poll() {
+    // Only drain what was queued before this call; handlers may send replies
+    size_t pending = inbox_.size();
+    if (stats_) stats_->set_inbox_depth(static_cast<u32>(pending));
+    for (size_t i = 0; i < pending; i++) {
+        Event ev = std::move(inbox_.front());
+        inbox_.pop_front();
+
+        switch (ev.kind) {
+            case Event::Kind::Connect:
+                if (recorder_) recorder_->record(LogEvent::Connect, ev.from);
+                if (stats_)    stats_->on_connect(ev.from);
+                if (on_connect_) on_connect_(ev.from);
+                break;
+            case Event::Kind::Disconnect:
+                if (recorder_) recorder_->record(LogEvent::Disconnect, ev.from);
+                if (stats_)    stats_->on_disconnect(ev.from);
+                if (on_disconnect_) on_disconnect_(ev.from);
+                break;
+            case Event::Kind::Message:
+                if (stats_) stats_->on_receive(ev.from, ev.msg.type, ev.msg.payload.size());
+                if (codec_) {
+                    std::vector<u8> decoded;
+                    if (!codec_->decode(ev.msg.type, ev.msg.payload.data(), ev.msg.payload.size(), decoded))
+                        break; // corrupt datagram, dropped like a bad checksum
+                    ev.msg.payload = std::move(decoded);
+                }
+                if (recorder_) recorder_->record(LogEvent::Inbound, ev.from, ev.msg);
+                if (ev.msg.type == MessageType::Ping) {
+                    // Answered at the transport so application stalls do not inflate RTT
+                    NetworkMessage pong;
+                    pong.type    = MessageType::Pong;
+                    pong.payload = std::move(ev.msg.payload);
+                    send_unreliable(ev.from, pong);
+                    break;
+                }
+                if (ev.msg.type == MessageType::Pong && stats_) {
+                    stats_->on_pong(ev.from, ev.msg);
+                    break;
+                }
+                if (on_message_) on_message_(ev.from, ev.msg);
+                break;
+        }
+    }
+}
+
+} // namespace lumios::net
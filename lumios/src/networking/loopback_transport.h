@@ -0,0 +1,78 @@
+#pragma once
+
+#include "net_transport.h"
+#include <deque>
+#include <random>
+
+namespace lumios::net {
+
+class LoopbackTransport;
+
+// In-process "network" that LoopbackTransports listen on and connect
+// through. Lets servers, zone peers and bot clients run in one process for
+// tools and local testing. Not thread-safe.
+class LoopbackHub {
+public:
+    bool listen(u16 port, LoopbackTransport* server);
+    void unlisten(u16 port);
+    LoopbackTransport* find(u16 port) const;
+
+private:
+    std::unordered_map<u16, LoopbackTransport*> listeners_;
+};
+
+class LoopbackTransport : public NetworkTransport {
+public:
+    explicit LoopbackTransport(LoopbackHub& hub) : hub_(hub) {}
+    ~LoopbackTransport() override;
+
+    bool start_server(u16 port) override;
+    bool connect(const std::string& host, u16 port) override;
+    void disconnect() override;
+
+    void send_reliable(ClientID target, const NetworkMessage& msg) override;
+    void send_unreliable(ClientID target, const NetworkMessage& msg) override;
+    void broadcast_reliable(const NetworkMessage& msg) override;
+    void broadcast_unreliable(const NetworkMessage& msg) override;
+
+    // Delivers connection events and queued messages through the callbacks
+    void poll() override;
+
+    bool is_server()    const override { return port_ != 0; }
+    bool is_connected() const override { return !links_.empty(); }
+    u32  client_count() const override { return static_cast<u32>(links_.size()); }
+
+    // Fraction of unreliable messages silently dropped, for loss testing
+    void set_drop_rate(float rate) { drop_rate_ = rate; }
+
+    // Bytes put on the "wire", i.e. after compression when a codec is set
+    u64 bytes_sent() const { return bytes_sent_; }
+
+private:
+    struct Link {
+        LoopbackTransport* peer;
+        ClientID           id_on_peer; // how the peer addresses us
+    };
+
+    struct Event {
+        enum class Kind : u8 { Connect, Disconnect, Message } kind;
+        ClientID       from;
+        NetworkMessage msg;
+    };
+
+    ClientID accept(LoopbackTransport* peer, ClientID id_on_peer);
+    void     drop_link(ClientID id);
+    // A lost message is encoded and counted as sent, but never arrives
+    void     deliver(ClientID target, const NetworkMessage& msg, bool lost = false);
+
+    LoopbackHub&                       hub_;
+    u16                                port_       = 0;
+    ClientID                           next_id_    = 0;
+    std::unordered_map<ClientID, Link> links_;
+    std::deque<Event>                  inbox_;
+    float                              drop_rate_  = 0.0f;
+    std::minstd_rand                   rng_{7};
+    u64                                bytes_sent_ = 0;
+};
+
+} // namespace lumios::net
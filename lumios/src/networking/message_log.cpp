@@ -0,0 +1,218 @@
+#include "message_log.h"
+#include "../core/log.h"
+#include <algorithm>
+#include <fstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace lumios::net {
+
+static constexpr u32 LOG_MAGIC   = 0x474C4E4C; // "LNLG"
+static constexpr u32 LOG_VERSION = 1;
+
+// --- MessageRecorder ---
+
+MessageRecorder::~MessageRecorder() {
+    close();
+}
+
+bool MessageRecorder::open(const std::string& path, u64 initial_capacity) {
+    close();
+    path_ = path;
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                              CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        LOG_ERROR("Failed to create message log: %s", path.c_str());
+        return false;
+    }
+    file_ = file;
+#else
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+        LOG_ERROR("Failed to create message log: %s", path.c_str());
+        return false;
+    }
+#endif
+
+    if (!map(std::max<u64>(initial_capacity, sizeof(MessageLogHeader) + 4096))) {
+        close();
+        return false;
+    }
+
+    MessageLogHeader header{};
+    header.magic   = LOG_MAGIC;
+    header.version = LOG_VERSION;
+    header.start_unix_us = static_cast<u64>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    header.end = sizeof(MessageLogHeader);
+    memcpy(base_, &header, sizeof(header));
+
+    end_   = sizeof(MessageLogHeader);
+    count_ = 0;
+    start_ = std::chrono::steady_clock::now();
+    return true;
+}
+
+void MessageRecorder::close() {
+    unmap();
+#ifdef _WIN32
+    if (file_) {
+        LARGE_INTEGER size;
+        size.QuadPart = static_cast<LONGLONG>(end_);
+        SetFilePointerEx(file_, size, nullptr, FILE_BEGIN);
+        SetEndOfFile(file_);
+        CloseHandle(file_);
+        file_ = nullptr;
+    }
+#else
+    if (fd_ >= 0) {
+        if (ftruncate(fd_, static_cast<off_t>(end_)) != 0)
+            LOG_WARN("Failed to trim message log: %s", path_.c_str());
+        ::close(fd_);
+        fd_ = -1;
+    }
+#endif
+}
+
+bool MessageRecorder::map(u64 capacity) {
+#ifdef _WIN32
+    // Creating the mapping extends the file to its size
+    HANDLE mapping = CreateFileMappingA(file_, nullptr, PAGE_READWRITE, static_cast<DWORD>(capacity >> 32),
+                                       static_cast<DWORD>(capacity & 0xFFFFFFFF), nullptr);
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, static_cast<SIZE_T>(capacity)) : nullptr;
+    if (!view) {
+        if (mapping) CloseHandle(mapping);
+        LOG_ERROR("Failed to map message log: %s", path_.c_str());
+        return false;
+    }
+    mapping_ = mapping;
+#else
+    if (ftruncate(fd_, static_cast<off_t>(capacity)) != 0) {
+        LOG_ERROR("Failed to grow message log: %s", path_.c_str());
+        return false;
+    }
+    void* view = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (view == MAP_FAILED) {
+        LOG_ERROR("Failed to map message log: %s", path_.c_str());
+        return false;
+    }
+#endif
+    base_     = static_cast<u8*>(view);
+    capacity_ = capacity;
+    return true;
+}
+
+void MessageRecorder::unmap() {
+    if (!base_) return;
+#ifdef _WIN32
+    UnmapViewOfFile(base_);
+    CloseHandle(mapping_);
+    mapping_ = nullptr;
+#else
+    munmap(base_, capacity_);
+#endif
+    base_     = nullptr;
+    capacity_ = 0;
+}
+
+u8* MessageRecorder::reserve(u64 bytes) {
+    if (end_ + bytes > capacity_) {
+        u64 capacity = capacity_;
+        while (end_ + bytes > capacity) capacity *= 2;
+        unmap();
+        if (!map(capacity)) {
+            // Keep what was recorded; further records are dropped
+            map(end_);
+            return nullptr;
+        }
+    }
+    return base_ + end_;
+}
+
+void MessageRecorder::record(LogEvent event, ClientID peer, const NetworkMessage& msg) {
+    if (!base_) return;
+
+    u32 size = static_cast<u32>(msg.payload.size());
+    u8* dst  = reserve(sizeof(MessageLogRecord) + size);
+    if (!dst) return;
+
+    MessageLogRecord rec{};
+    rec.time_us = static_cast<u64>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start_).count());
+    rec.peer  = peer;
+    rec.size  = size;
+    rec.type  = static_cast<u16>(msg.type);
+    rec.event = event;
+    memcpy(dst, &rec, sizeof(rec));
+    if (size) memcpy(dst + sizeof(rec), msg.payload.data(), size);
+
+    end_ += sizeof(rec) + size;
+    count_++;
+
+    // Publish the record only once it is complete
+    auto* header = reinterpret_cast<MessageLogHeader*>(base_);
+    header->end          = end_;
+    header->record_count = count_;
+}
+
+void MessageRecorder::record(LogEvent event, ClientID peer) {
+    NetworkMessage msg;
+    msg.type = event == LogEvent::Connect ? MessageType::Connect : MessageType::Disconnect;
+    record(event, peer, msg);
+}
+
+// --- MessageLogReader ---
+
+bool MessageLogReader::open(const std::string& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        LOG_ERROR("Failed to open message log: %s", path.c_str());
+        return false;
+    }
+
+    data_.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(data_.data()), static_cast<std::streamsize>(data_.size()));
+
+    if (!file || data_.size() < sizeof(MessageLogHeader)) {
+        LOG_ERROR("Invalid message log: %s", path.c_str());
+        return false;
+    }
+    memcpy(&header_, data_.data(), sizeof(header_));
+    if (header_.magic != LOG_MAGIC || header_.version != LOG_VERSION || header_.end > data_.size()) {
+        LOG_ERROR("Invalid message log: %s", path.c_str());
+        return false;
+    }
+
+    offset_ = sizeof(MessageLogHeader);
+    return true;
+}
+
+bool MessageLogReader::next(MessageLogEntry& out) {
+    if (offset_ + sizeof(MessageLogRecord) > header_.end) return false;
+
+    MessageLogRecord rec;
+    memcpy(&rec, data_.data() + offset_, sizeof(rec));
+    if (offset_ + sizeof(rec) + rec.size > header_.end) return false;
+
+    const u8* payload = data_.data() + offset_ + sizeof(rec);
+    out.time_us    = rec.time_us;
+    out.event      = rec.event;
+    out.peer       = rec.peer;
+    out.msg.type   = static_cast<MessageType>(rec.type);
+    out.msg.sender = rec.peer;
+    out.msg.payload.assign(payload, payload + rec.size);
+
+    offset_ += sizeof(rec) + rec.size;
+    return true;
+}
+
+} // namespace lumios::net
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "net_types.h"
+#include <chrono>
+
+namespace lumios::net {
+
+// Binary message log: a fixed header followed by records, each a
+// MessageLogRecord and `size` payload bytes. Payloads are stored as the
+// application sees them (before compression / after decompression), so a log
+// replays the same whatever codec was on the wire.
+enum class LogEvent : u8 {
+    Connect,    // peer connected, no payload
+    Disconnect, // peer disconnected, no payload
+    Inbound,    // message received from peer
+    Outbound,   // message sent to peer
+};
+
+struct MessageLogHeader {
+    u32 magic;
+    u32 version;
+    u64 start_unix_us; // wall clock when recording started
+    u64 end;           // file offset one past the last complete record
+    u64 record_count;
+};
+
+struct MessageLogRecord {
+    u64      time_us; // since recording started
+    ClientID peer;
+    u32      size;
+    u16      type;    // MessageType
+    LogEvent event;
+    u8       reserved[5] = {};
+};
+static_assert(sizeof(MessageLogRecord) == 24);
+
+struct MessageLogEntry {
+    u64            time_us = 0;
+    LogEvent       event   = LogEvent::Inbound;
+    ClientID       peer    = INVALID_CLIENT;
+    NetworkMessage msg;
+};
+
+// Append-only writer over a memory-mapped file. The mapping grows by doubling;
+// the header's end offset is bumped after every record, so a log cut short by
+// a crash still reads up to its last complete record. Not thread-safe: record
+// from the thread that drives the transport.
+class MessageRecorder {
+public:
+    MessageRecorder() = default;
+    ~MessageRecorder();
+
+    MessageRecorder(const MessageRecorder&) = delete;
+    MessageRecorder& operator=(const MessageRecorder&) = delete;
+
+    bool open(const std::string& path, u64 initial_capacity = 16ull << 20);
+    // Trims the file to the recorded size
+    void close();
+    bool is_open() const { return base_ != nullptr; }
+
+    void record(LogEvent event, ClientID peer, const NetworkMessage& msg);
+    void record(LogEvent event, ClientID peer);
+
+    u64 bytes_written() const { return end_; }
+    u64 record_count() const  { return count_; }
+
+private:
+    bool map(u64 capacity);
+    void unmap();
+    u8*  reserve(u64 bytes);
+
+    u8* base_     = nullptr;
+    u64 capacity_ = 0;
+    u64 end_      = 0;
+    u64 count_    = 0;
+    std::chrono::steady_clock::time_point start_;
+    std::string path_;
+
+#ifdef _WIN32
+    void* file_    = nullptr; // HANDLE
+    void* mapping_ = nullptr; // HANDLE
+#else
+    int   fd_      = -1;
+#endif
+};
+
+// Sequential reader for logs written by MessageRecorder
+class MessageLogReader {
+public:
+    bool open(const std::string& path);
+    bool next(MessageLogEntry& out);
+
+    u64 start_unix_us() const { return header_.start_unix_us; }
+    u64 record_count() const  { return header_.record_count; }
+
+private:
+    std::vector<u8>  data_;
+    MessageLogHeader header_{};
+    u64              offset_ = 0;
+};
+
+} // namespace lumios::net
@@ -0,0 +1,162 @@
+#include "net_stats.h"
+#include "net_transport.h"
+#include <algorithm>
+#include <cmath>
+
+namespace lumios::net {
+
+static constexpr double RATE_WINDOW = 0.25; // seconds between bandwidth samples
+static constexpr float  RATE_SMOOTH = 0.25f;
+static constexpr float  LOSS_SMOOTH = 1.0f / 16.0f;
+static constexpr size_t MAX_PENDING_PINGS = 32;
+
+struct PingPayload {
+    u32    sequence;
+    u32    reserved;
+    double sent_at; // sender's clock, echoed back untouched
+};
+
+NetStats::NetStats() : epoch_(std::chrono::steady_clock::now()) {}
+
+double NetStats::now() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - epoch_).count();
+}
+
+// --- Transport hooks ---
+
+void NetStats::on_connect(ClientID client) {
+    clients_[client].stats.client = client;
+}
+
+void NetStats::on_disconnect(ClientID client) {
+    clients_.erase(client);
+}
+
+void NetStats::on_send(ClientID client, MessageType type, size_t wire_bytes) {
+    auto& t = by_type_[type];
+    t.sent_count++;
+    t.sent_bytes += wire_bytes;
+    sent_bytes_  += wire_bytes;
+
+    auto it = clients_.find(client);
+    if (it == clients_.end()) return;
+    it->second.stats.sent_packets++;
+    it->second.stats.sent_bytes += wire_bytes;
+}
+
+void NetStats::on_receive(ClientID client, MessageType type, size_t wire_bytes) {
+    auto& t = by_type_[type];
+    t.recv_count++;
+    t.recv_bytes += wire_bytes;
+    recv_bytes_  += wire_bytes;
+
+    auto it = clients_.find(client);
+    if (it == clients_.end()) return;
+    it->second.stats.recv_packets++;
+    it->second.stats.recv_bytes += wire_bytes;
+}
+
+void NetStats::on_pong(ClientID client, const NetworkMessage& pong) {
+    auto it = clients_.find(client);
+    if (it == clients_.end() || pong.payload.size() < sizeof(PingPayload)) return;
+    Client& c = it->second;
+
+    // Only answers to pings still pending count; late or duplicate pongs
+    // were already scored as lost
+    PingPayload ping = pong.read<PingPayload>(0);
+    auto p = std::find_if(c.pings.begin(), c.pings.end(),
+                          [&](const PendingPing& pp) { return pp.sequence == ping.sequence; });
+    if (p == c.pings.end()) return;
+
+    add_rtt_sample(c, static_cast<float>((now() - p->sent_at) * 1000.0));
+    add_loss_sample(c, false);
+    c.pings.erase(p);
+}
+
+void NetStats::set_queue_depth(ClientID client, u32 send, u32 recv) {
+    auto it = clients_.find(client);
+    if (it == clients_.end()) return;
+    it->second.stats.send_queue = send;
+    it->second.stats.recv_queue = recv;
+}
+
+// --- Estimators ---
+
+void NetStats::add_rtt_sample(Client& c, float rtt_ms) {
+    ClientStats& s = c.stats;
+    s.last_rtt_ms = rtt_ms;
+    if (!c.has_rtt) {
+        s.rtt_ms     = rtt_ms;
+        s.rtt_var_ms = rtt_ms * 0.5f;
+        c.has_rtt    = true;
+        return;
+    }
+    s.rtt_var_ms = 0.75f * s.rtt_var_ms + 0.25f * std::abs(s.rtt_ms - rtt_ms);
+    s.rtt_ms     = 0.875f * s.rtt_ms + 0.125f * rtt_ms;
+}
+
+void NetStats::add_loss_sample(Client& c, bool lost) {
+    c.stats.loss += LOSS_SMOOTH * ((lost ? 1.0f : 0.0f) - c.stats.loss);
+}
+
+// --- Per-frame update ---
+
+void NetStats::update(NetworkTransport& transport) {
+    double t = now();
+
+    for (auto& [id, c] : clients_) {
+        // Expire pings; the timeout stretches for links that are just slow
+        double timeout = ping_timeout_;
+        if (c.has_rtt) timeout = std::max(timeout, (c.stats.rtt_ms + 4.0 * c.stats.rtt_var_ms) / 1000.0);
+        auto expired = std::remove_if(c.pings.begin(), c.pings.end(), [&](const PendingPing& p) {
+            if (t - p.sent_at < timeout) return false;
+            add_loss_sample(c, true);
+            return true;
+        });
+        c.pings.erase(expired, c.pings.end());
+
+        if (t - c.last_ping >= ping_interval_ && c.pings.size() < MAX_PENDING_PINGS) {
+            PingPayload ping{c.next_ping++, 0, t};
+            NetworkMessage msg;
+            msg.type = MessageType::Ping;
+            msg.write(ping);
+            c.pings.push_back({ping.sequence, t});
+            c.last_ping = t;
+            transport.send_unreliable(id, msg);
+        }
+    }
+
+    double dt = t - last_rate_;
+    if (dt < RATE_WINDOW) return;
+
+    auto smooth = [&](float& rate, u64 total, u64& mark) {
+        float sample = static_cast<float>((total - mark) / dt);
+        rate += RATE_SMOOTH * (sample - rate);
+        mark = total;
+    };
+    for (auto& [id, c] : clients_) {
+        smooth(c.stats.send_bps, c.stats.sent_bytes, c.rate_sent);
+        smooth(c.stats.recv_bps, c.stats.recv_bytes, c.rate_recv);
+    }
+    smooth(send_bps_, sent_bytes_, rate_sent_);
+    smooth(recv_bps_, recv_bytes_, rate_recv_);
+    last_rate_ = t;
+}
+
+NetStatsSnapshot NetStats::snapshot() const {
+    NetStatsSnapshot snap;
+    snap.clients.reserve(clients_.size());
+    for (const auto& [id, c] : clients_) snap.clients.push_back(c.stats);
+    std::sort(snap.clients.begin(), snap.clients.end(),
+              [](const ClientStats& a, const ClientStats& b) { return a.client < b.client; });
+
+    snap.by_type     = by_type_;
+    snap.send_bps    = send_bps_;
+    snap.recv_bps    = recv_bps_;
+    snap.sent_bytes  = sent_bytes_;
+    snap.recv_bytes  = recv_bytes_;
+    snap.inbox_depth = inbox_depth_;
+    return snap;
+}
+
+} // namespace lumios::net
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "net_types.h"
+#include <chrono>
+#include <map>
+#include <unordered_map>
+
+namespace lumios::net {
+
+class NetworkTransport;
+
+struct TypeCounters {
+    u64 sent_count = 0;
+    u64 sent_bytes = 0;
+    u64 recv_count = 0;
+    u64 recv_bytes = 0;
+};
+
+struct ClientStats {
+    ClientID client = INVALID_CLIENT;
+    float rtt_ms     = 0.0f; // smoothed round-trip time
+    float rtt_var_ms = 0.0f; // smoothed mean deviation
+    float last_rtt_ms = 0.0f;
+    float loss       = 0.0f; // fraction of pings that went unanswered
+    float send_bps   = 0.0f; // bytes per second
+    float recv_bps   = 0.0f;
+    u64   sent_bytes = 0, recv_bytes = 0;
+    u64   sent_packets = 0, recv_packets = 0;
+    u32   send_queue = 0; // reported by the owner, see set_queue_depth
+    u32   recv_queue = 0;
+};
+
+// Copyable view of NetStats for tools and the editor
+struct NetStatsSnapshot {
+    std::vector<ClientStats>              clients; // sorted by client id
+    std::map<MessageType, TypeCounters>   by_type;
+    float send_bps    = 0.0f;
+    float recv_bps    = 0.0f;
+    u64   sent_bytes  = 0;
+    u64   recv_bytes  = 0;
+    u32   inbox_depth = 0; // messages waiting in the transport
+};
+
+// Per-connection traffic and latency accounting. A transport with stats
+// attached (NetworkTransport::set_stats) reports connections and every
+// datagram at its wire size, answers Pings and hands Pongs back here. The
+// owner calls update() once per frame to send pings and roll the bandwidth
+// averages. RTT uses the TCP estimator (RFC 6298); a ping unanswered after
+// ping_timeout counts as lost. Not thread-safe: use from the transport's
+// thread.
+class NetStats {
+public:
+    NetStats();
+
+    void set_ping_interval(float seconds) { ping_interval_ = seconds; }
+    void set_ping_timeout(float seconds)  { ping_timeout_ = seconds; }
+
+    void update(NetworkTransport& transport);
+    NetStatsSnapshot snapshot() const;
+
+    // Application-side queue depths, e.g. unacked reliable messages or
+    // pending inputs for the client
+    void set_queue_depth(ClientID client, u32 send, u32 recv);
+
+    // --- Transport hooks ---
+    void on_connect(ClientID client);
+    void on_disconnect(ClientID client);
+    void on_send(ClientID client, MessageType type, size_t wire_bytes);
+    void on_receive(ClientID client, MessageType type, size_t wire_bytes);
+    void on_pong(ClientID client, const NetworkMessage& pong);
+    void set_inbox_depth(u32 depth) { inbox_depth_ = depth; }
+
+private:
+    struct PendingPing {
+        u32    sequence;
+        double sent_at;
+    };
+
+    struct Client {
+        ClientStats stats;
+        std::vector<PendingPing> pings;
+        u32    next_ping   = 1;
+        double last_ping   = -1.0e9;
+        u64    rate_sent   = 0; // byte counters at the last rate sample
+        u64    rate_recv   = 0;
+        bool   has_rtt     = false;
+    };
+
+    double now() const;
+    void   add_rtt_sample(Client& c, float rtt_ms);
+    void   add_loss_sample(Client& c, bool lost);
+
+    std::chrono::steady_clock::time_point epoch_;
+    std::unordered_map<ClientID, Client>  clients_;
+    std::map<MessageType, TypeCounters>   by_type_;
+
+    float  ping_interval_ = 1.0f;
+    float  ping_timeout_  = 2.0f;
+    double last_rate_     = 0.0;
+    u64    sent_bytes_    = 0, recv_bytes_ = 0;
+    u64    rate_sent_     = 0, rate_recv_  = 0;
+    float  send_bps_      = 0.0f, recv_bps_ = 0.0f;
+    u32    inbox_depth_   = 0;
+};
+
+} // namespace lumios::net
@@ -4,6 +4,10 @@
 
 namespace lumios::net {
 
+class PacketCodec;
+class MessageRecorder;
+class NetStats;
+
 class NetworkTransport {
 public:
     virtual ~NetworkTransport() = default;
@@ -31,10 +35,25 @@ public:
     virtual bool is_connected() const = 0;
     virtual u32  client_count() const = 0;
 
+    // Optional per-datagram compression; both ends must use the same
+    // dictionary. Implementations encode on send and decode on receive.
+    void set_codec(const PacketCodec* codec) { codec_ = codec; }
+
+    // Optional capture of connection events and every message sent or
+    // delivered, with uncompressed payloads, for offline replay
+    void set_recorder(MessageRecorder* recorder) { recorder_ = recorder; }
+
+    // Optional traffic/latency accounting. With stats attached the transport
+    // reports wire sizes and connections, and consumes Pong replies.
+    void set_stats(NetStats* stats) { stats_ = stats; }
+
 protected:
-    OnConnect    on_connect_;
-    OnDisconnect on_disconnect_;
-    OnMessage    on_message_;
+    OnConnect          on_connect_;
+    OnDisconnect       on_disconnect_;
+    OnMessage          on_message_;
+    const PacketCodec* codec_    = nullptr;
+    MessageRecorder*   recorder_ = nullptr;
+    NetStats*          stats_    = nullptr;
 };
 
 } // namespace lumios::net
@@ -29,6 +29,23 @@ enum class MessageType : u16 {
     Custom         = 200,
 };
 
+inline const char* message_type_name(MessageType type) {
+    switch (type) {
+        case MessageType::Connect:       return "Connect";
+        case MessageType::Disconnect:    return "Disconnect";
+        case MessageType::Input:         return "Input";
+        case MessageType::StateSnapshot: return "StateSnapshot";
+        case MessageType::StateDelta:    return "StateDelta";
+        case MessageType::EntitySpawn:   return "EntitySpawn";
+        case MessageType::EntityDestroy: return "EntityDestroy";
+        case MessageType::ZoneTransfer:  return "ZoneTransfer";
+        case MessageType::Ping:          return "Ping";
+        case MessageType::Pong:          return "Pong";
+        case MessageType::Custom:        return "Custom";
+    }
+    return "Unknown";
+}
+
 struct NetworkMessage {
     MessageType type;
     ClientID    sender = INVALID_CLIENT;
@@ -57,6 +74,17 @@ struct EntityState {
     u32         component_mask;
 };
 
+// Leads every StateSnapshot / StateDelta payload, followed by entity_count
+// EntityStates and then left_count EntityNetIDs that dropped out of the
+// receiver's interest set and should be removed. input_ack is the last
+// ClientInput sequence the server applied for the receiving client (0 if none).
+struct SnapshotHeader {
+    u32 server_tick;
+    u32 input_ack;
+    u32 entity_count;
+    u32 left_count;
+};
+
 struct ClientInput {
     float     move_x, move_y;
     float     look_yaw, look_pitch;
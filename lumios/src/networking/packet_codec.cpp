@@ -0,0 +1,282 @@
+#include "packet_codec.h"
+#include "../core/log.h"
+#include <algorithm>
+#include <fstream>
+
+namespace lumios::net {
+
+static constexpr u8  MODE_STORED  = 0;
+static constexpr u8  MODE_RANS    = 1;
+static constexpr u32 RANS_L       = 1u << 23;   // lower bound of the normalized state
+static constexpr u32 DICT_MAGIC   = 0x4349444C; // "LDIC"
+static constexpr u32 DICT_VERSION = 1;
+
+static void write_varint(std::vector<u8>& out, u32 v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<u8>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<u8>(v));
+}
+
+static bool read_varint(const u8*& p, const u8* end, u32& v) {
+    v = 0;
+    for (u32 shift = 0; shift < 35 && p < end; shift += 7) {
+        u8 b = *p++;
+        v |= static_cast<u32>(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+PacketCodec::Layout PacketCodec::default_layout(MessageType type) {
+    switch (type) {
+        case MessageType::StateSnapshot:
+        case MessageType::StateDelta:
+            return {sizeof(SnapshotHeader), sizeof(EntityState)};
+        case MessageType::Input:
+            return {sizeof(u32), sizeof(ClientInput)};
+        case MessageType::EntitySpawn:
+            return {0, sizeof(EntityState)};
+        default:
+            return {0, 1};
+    }
+}
+
+// --- Trainer ---
+
+void PacketCodec::Trainer::add(const NetworkMessage& msg) {
+    add(msg.type, msg.payload.data(), msg.payload.size());
+}
+
+void PacketCodec::Trainer::add(MessageType type, const u8* data, size_t size) {
+    auto& t = types_[type];
+    if (t.counts.empty()) {
+        t.layout = default_layout(type);
+        t.counts.assign(static_cast<size_t>(t.layout.header_size + t.layout.stride) * 256, 0);
+    }
+
+    Model shape{t.layout, {}};
+    for (size_t i = 0; i < size; i++)
+        t.counts[shape.context(i) * 256 + data[i]]++;
+    t.messages++;
+    messages_++;
+}
+
+void PacketCodec::Trainer::build(PacketCodec& codec, u32 min_messages) const {
+    for (const auto& [type, t] : types_) {
+        if (t.messages < min_messages) continue;
+
+        u32 contexts = t.layout.header_size + t.layout.stride;
+        std::vector<u16> freqs(static_cast<size_t>(contexts) * 256);
+
+        for (u32 c = 0; c < contexts; c++) {
+            const u32* counts = &t.counts[c * 256];
+            u16*       freq   = &freqs[c * 256];
+
+            u64 total = 0;
+            for (u32 s = 0; s < 256; s++) total += counts[s];
+
+            // Every byte keeps a frequency of at least 1 so any payload stays
+            // encodable; the rest of the range is shared out by count
+            u32 sum = 0, top = 0;
+            for (u32 s = 0; s < 256; s++) {
+                u64 share = total ? counts[s] * static_cast<u64>(PROB_SCALE - 256) / total : 0;
+                freq[s] = static_cast<u16>(1 + share);
+                sum += freq[s];
+                if (counts[s] > counts[top]) top = s;
+            }
+            freq[top] = static_cast<u16>(freq[top] + (PROB_SCALE - sum));
+        }
+        codec.set_model(type, t.layout, freqs);
+    }
+}
+
+// --- Model ---
+
+void PacketCodec::finalize(Context& ctx) {
+    ctx.start[0] = 0;
+    for (u32 s = 0; s < 256; s++) {
+        ctx.start[s + 1] = static_cast<u16>(ctx.start[s] + ctx.freq[s]);
+        std::fill(ctx.symbol.begin() + ctx.start[s], ctx.symbol.begin() + ctx.start[s] + ctx.freq[s],
+                  static_cast<u8>(s));
+    }
+}
+
+void PacketCodec::set_model(MessageType type, const Layout& layout, const std::vector<u16>& freqs) {
+    Model model;
+    model.layout = layout;
+    model.contexts.resize(layout.header_size + layout.stride);
+    for (size_t c = 0; c < model.contexts.size(); c++) {
+        std::copy_n(freqs.begin() + c * 256, 256, model.contexts[c].freq.begin());
+        finalize(model.contexts[c]);
+    }
+    models_[type] = std::move(model);
+}
+
+// --- Coding ---
+
+void PacketCodec::encode(const NetworkMessage& msg, std::vector<u8>& out) const {
+    encode(msg.type, msg.payload.data(), msg.payload.size(), out);
+}
+
+void PacketCodec::encode(MessageType type, const u8* data, size_t size, std::vector<u8>& out) const {
+    out.clear();
+    auto it = models_.find(type);
+
+    if (it != models_.end() && size > 0 && size <= MAX_CODED_SIZE) {
+        const Model& model = it->second;
+
+        // rANS codes in reverse, so the stream is built backwards from the
+        // end of a worst-case buffer (12 bits per byte plus the final state)
+        size_t bound = size * 2 + 8;
+        out.resize(1 + 5 + bound);
+        u8* end = out.data() + out.size();
+        u8* ptr = end;
+
+        u32 x = RANS_L;
+        for (size_t i = size; i-- > 0;) {
+            const Context& ctx = model.contexts[model.context(i)];
+            u32 freq  = ctx.freq[data[i]];
+            u32 start = ctx.start[data[i]];
+            u32 x_max = ((RANS_L >> PROB_BITS) << 8) * freq;
+            while (x >= x_max) {
+                *--ptr = static_cast<u8>(x & 0xFF);
+                x >>= 8;
+            }
+            x = ((x / freq) << PROB_BITS) + (x % freq) + start;
+        }
+        // Final state, most significant byte first in the stream
+        for (int b = 0; b < 4; b++) {
+            *--ptr = static_cast<u8>(x & 0xFF);
+            x >>= 8;
+        }
+
+        size_t coded = static_cast<size_t>(end - ptr);
+        std::vector<u8> prefix;
+        prefix.push_back(MODE_RANS);
+        write_varint(prefix, static_cast<u32>(size));
+
+        if (prefix.size() + coded < 1 + size) {
+            std::memmove(out.data() + prefix.size(), ptr, coded);
+            std::copy(prefix.begin(), prefix.end(), out.begin());
+            out.resize(prefix.size() + coded);
+            return;
+        }
+        out.clear();
+    }
+
+    out.reserve(1 + size);
+    out.push_back(MODE_STORED);
+    out.insert(out.end(), data, data + size);
+}
+
+bool PacketCodec::decode(MessageType type, const u8* data, size_t size, std::vector<u8>& out) const {
+    out.clear();
+    if (size == 0) return false;
+
+    const u8* p   = data + 1;
+    const u8* end = data + size;
+
+    if (data[0] == MODE_STORED) {
+        out.assign(p, end);
+        return true;
+    }
+    if (data[0] != MODE_RANS) return false;
+
+    auto it = models_.find(type);
+    if (it == models_.end()) return false;
+    const Model& model = it->second;
+
+    u32 raw_size = 0;
+    if (!read_varint(p, end, raw_size) || raw_size > MAX_CODED_SIZE || end - p < 4) return false;
+
+    u32 x = 0;
+    for (int b = 0; b < 4; b++) x = (x << 8) | *p++;
+
+    out.resize(raw_size);
+    for (u32 i = 0; i < raw_size; i++) {
+        const Context& ctx = model.contexts[model.context(i)];
+        u32 slot = x & (PROB_SCALE - 1);
+        u8  sym  = ctx.symbol[slot];
+        out[i] = sym;
+        x = ctx.freq[sym] * (x >> PROB_BITS) + slot - ctx.start[sym];
+        while (x < RANS_L) {
+            if (p >= end) return false;
+            x = (x << 8) | *p++;
+        }
+    }
+    return x == RANS_L;
+}
+
+// --- Dictionary file ---
+
+bool PacketCodec::save(const std::string& path) const {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        LOG_ERROR("Failed to open codec dictionary for writing: %s", path.c_str());
+        return false;
+    }
+
+    auto put = [&](const auto& v) { file.write(reinterpret_cast<const char*>(&v), sizeof(v)); };
+    put(DICT_MAGIC);
+    put(DICT_VERSION);
+    put(static_cast<u32>(models_.size()));
+    for (const auto& [type, model] : models_) {
+        put(static_cast<u16>(type));
+        put(model.layout.header_size);
+        put(model.layout.stride);
+        for (const auto& ctx : model.contexts)
+            file.write(reinterpret_cast<const char*>(ctx.freq.data()), sizeof(ctx.freq));
+    }
+    return file.good();
+}
+
+bool PacketCodec::load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        LOG_ERROR("Failed to open codec dictionary: %s", path.c_str());
+        return false;
+    }
+
+    auto get = [&](auto& v) { return static_cast<bool>(file.read(reinterpret_cast<char*>(&v), sizeof(v))); };
+    u32 magic = 0, version = 0, count = 0;
+    if (!get(magic) || !get(version) || !get(count) || magic != DICT_MAGIC || version != DICT_VERSION) {
+        LOG_ERROR("Invalid codec dictionary: %s", path.c_str());
+        return false;
+    }
+
+    models_.clear();
+    for (u32 m = 0; m < count; m++) {
+        u16 type = 0;
+        Layout layout;
+        if (!get(type) || !get(layout.header_size) || !get(layout.stride) || layout.stride == 0) {
+            LOG_ERROR("Truncated codec dictionary: %s", path.c_str());
+            return false;
+        }
+
+        std::vector<u16> freqs(static_cast<size_t>(layout.header_size + layout.stride) * 256);
+        file.read(reinterpret_cast<char*>(freqs.data()), freqs.size() * sizeof(u16));
+        if (!file) {
+            LOG_ERROR("Truncated codec dictionary: %s", path.c_str());
+            return false;
+        }
+        // encode() divides by every frequency, so none may be zero
+        for (size_t c = 0; c < freqs.size() / 256; c++) {
+            u32  sum  = 0;
+            bool zero = false;
+            for (u32 s = 0; s < 256; s++) {
+                sum  += freqs[c * 256 + s];
+                zero |= freqs[c * 256 + s] == 0;
+            }
+            if (sum != PROB_SCALE || zero) {
+                LOG_ERROR("Corrupt codec dictionary: %s", path.c_str());
+                return false;
+            }
+        }
+        set_model(static_cast<MessageType>(type), layout, freqs);
+    }
+    return true;
+}
+
+} // namespace lumios::net
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "net_types.h"
+#include <unordered_map>
+
+namespace lumios::net {
+
+// Optional per-datagram entropy coder. Each message type has a static model
+// trained offline from captured traffic: one byte-frequency table per byte
+// position within the type's fixed layout (header bytes, then the offset
+// inside each repeated record). Payloads are coded with a static rANS coder,
+// so there is no per-connection state and datagrams decode independently.
+//
+// Encoded payloads start with a mode byte: stored (raw copy) or coded,
+// followed by the raw length and the rANS stream. Types without a model are
+// always stored.
+class PacketCodec {
+public:
+    static constexpr u32 PROB_BITS  = 12;
+    static constexpr u32 PROB_SCALE = 1u << PROB_BITS;
+    // Larger payloads are always stored; decode() rejects coded ones
+    // claiming more, so a datagram cannot ask for an arbitrary allocation
+    static constexpr u32 MAX_CODED_SIZE = 1u << 20;
+
+    // Byte-position layout that selects the context for each payload byte
+    struct Layout {
+        u32 header_size = 0;
+        u32 stride      = 1;
+    };
+    static Layout default_layout(MessageType type);
+
+    class Trainer {
+    public:
+        void add(const NetworkMessage& msg);
+        void add(MessageType type, const u8* data, size_t size);
+        // Builds a model for every type seen at least min_messages times
+        void build(PacketCodec& codec, u32 min_messages = 16) const;
+        u64  message_count() const { return messages_; }
+
+    private:
+        struct Counts {
+            Layout           layout;
+            std::vector<u32> counts; // contexts * 256
+            u64              messages = 0;
+        };
+        std::unordered_map<MessageType, Counts> types_;
+        u64 messages_ = 0;
+    };
+
+    void encode(const NetworkMessage& msg, std::vector<u8>& out) const;
+    void encode(MessageType type, const u8* data, size_t size, std::vector<u8>& out) const;
+    bool decode(MessageType type, const u8* data, size_t size, std::vector<u8>& out) const;
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+    bool has_model(MessageType type) const { return models_.contains(type); }
+    u32  model_count() const { return static_cast<u32>(models_.size()); }
+
+private:
+    struct Context {
+        std::array<u16, 256>       freq;
+        std::array<u16, 257>       start;
+        std::array<u8, PROB_SCALE> symbol; // slot -> byte
+    };
+
+    struct Model {
+        Layout               layout;
+        std::vector<Context> contexts;
+
+        u32 context(size_t offset) const {
+            if (offset < layout.header_size) return static_cast<u32>(offset);
+            return layout.header_size + static_cast<u32>((offset - layout.header_size) % layout.stride);
+        }
+    };
+
+    static void finalize(Context& ctx);
+    void set_model(MessageType type, const Layout& layout, const std::vector<u16>& freqs);
+
+    std::unordered_map<MessageType, Model> models_;
+};
+
+} // namespace lumios::net
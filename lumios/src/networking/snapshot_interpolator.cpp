@@ -0,0 +1,177 @@
+#include "snapshot_interpolator.h"
+#include <algorithm>
+#include <cmath>
+
+namespace lumios::net {
+
+// Beyond this gap two samples are too far apart for the velocity tangents to
+// mean anything (e.g. the entity left and re-entered view), so blend linearly.
+static constexpr double MAX_HERMITE_SPAN = 1.0;
+
+static glm::vec3 lerp_degrees(const glm::vec3& a, const glm::vec3& b, float t) {
+    glm::vec3 d = b - a;
+    for (int i = 0; i < 3; i++)
+        d[i] -= 360.0f * std::round(d[i] / 360.0f);
+    return a + d * t;
+}
+
+void SnapshotInterpolator::History::push(u32 tick, const EntityState& state) {
+    if (count > 0) {
+        Sample& newest = samples[(head + HISTORY - 1) % HISTORY];
+        if (tick == newest.tick) { newest.state = state; return; }
+        if (tick <  newest.tick) return; // late delta, already superseded
+    }
+    samples[head] = {tick, state};
+    head = (head + 1) % HISTORY;
+    count = std::min(count + 1, HISTORY);
+}
+
+void SnapshotInterpolator::set_delay_limits(float min_delay, float max_delay) {
+    min_delay_ = min_delay;
+    max_delay_ = std::max(min_delay, max_delay);
+}
+
+void SnapshotInterpolator::clear() {
+    entities_.clear();
+    have_clock_  = false;
+    jitter_      = 0.0;
+    latest_tick_ = 0;
+    render_tick_ = 0.0;
+}
+
+void SnapshotInterpolator::on_receive(const NetworkMessage& msg, double now) {
+    if (msg.payload.size() < sizeof(SnapshotHeader)) return;
+    auto header = msg.read<SnapshotHeader>(0);
+
+    double transit = now - header.server_tick * tick_interval_;
+    if (!have_clock_) {
+        clock_offset_ = transit;
+        last_transit_ = transit;
+        latest_tick_  = header.server_tick;
+        render_tick_  = header.server_tick - delay_ / tick_interval_;
+        have_clock_   = true;
+    } else {
+        // Interarrival jitter as in RFC 3550
+        jitter_ += (std::abs(transit - last_transit_) - jitter_) / 16.0;
+        last_transit_ = transit;
+
+        // Follow the fastest observed transit, but let it creep up so
+        // clock drift and route changes are eventually absorbed
+        if (transit < clock_offset_) clock_offset_ = transit;
+        else                         clock_offset_ += (transit - clock_offset_) * 0.002;
+
+        if (header.server_tick > latest_tick_) {
+            double gap = (header.server_tick - latest_tick_) * tick_interval_;
+            spacing_ += (gap - spacing_) * 0.1;
+            latest_tick_ = header.server_tick;
+        }
+    }
+
+    size_t offset = sizeof(SnapshotHeader);
+    for (u32 i = 0; i < header.entity_count && offset + sizeof(EntityState) <= msg.payload.size(); i++) {
+        EntityState state = msg.read<EntityState>(offset);
+        offset += sizeof(EntityState);
+
+        // Deltas leave out entities at rest, so one whose last sample is
+        // older than the previous tick held still until then; without a
+        // sample there it would slide across the whole gap instead of
+        // starting to move now
+        History& history = entities_[state.id];
+        if (history.count > 0 && history.at(history.count - 1).tick + 1 < header.server_tick) {
+            EntityState hold = history.at(history.count - 1).state;
+            hold.velocity = glm::vec3(0.0f);
+            history.push(header.server_tick - 1, hold);
+        }
+        history.push(header.server_tick, state);
+    }
+
+    // Entities that left the interest set are gone until they enter again.
+    // A late packet must not remove one that has re-entered since.
+    for (u32 i = 0; i < header.left_count && offset + sizeof(EntityNetID) <= msg.payload.size(); i++) {
+        auto it = entities_.find(msg.read<EntityNetID>(offset));
+        offset += sizeof(EntityNetID);
+        if (it != entities_.end() && it->second.at(it->second.count - 1).tick < header.server_tick)
+            entities_.erase(it);
+    }
+}
+
+void SnapshotInterpolator::update(double now, float frame_dt) {
+    if (!have_clock_) return;
+
+    double target = std::clamp(spacing_ + jitter_scale_ * jitter_, min_delay_, max_delay_);
+    delay_ += (target - delay_) * std::min(1.0, frame_dt * 2.0);
+
+    // Run the render clock at local speed and ease it toward the target
+    // instead of jumping, unless it is far off (first packets, long stall)
+    double target_tick = (now - clock_offset_ - delay_) / tick_interval_;
+    render_tick_ += frame_dt / tick_interval_;
+    double error = target_tick - render_tick_;
+    if (std::abs(error) * tick_interval_ > 0.5) render_tick_ = target_tick;
+    else                                        render_tick_ += error * std::min(1.0, frame_dt * 4.0);
+}
+
+EntityState SnapshotInterpolator::interpolate(const Sample& a, const Sample& b, double tick) const {
+    double span = (b.tick - a.tick) * tick_interval_;
+    float  t    = static_cast<float>((tick - a.tick) / static_cast<double>(b.tick - a.tick));
+
+    EntityState out = b.state;
+    const auto& p0 = a.state.position; const auto& v0 = a.state.velocity;
+    const auto& p1 = b.state.position; const auto& v1 = b.state.velocity;
+
+    if (span <= MAX_HERMITE_SPAN) {
+        float T   = static_cast<float>(span);
+        float t2  = t * t, t3 = t2 * t;
+        float h00 =  2.0f * t3 - 3.0f * t2 + 1.0f;
+        float h10 =         t3 - 2.0f * t2 + t;
+        float h01 = -2.0f * t3 + 3.0f * t2;
+        float h11 =         t3 -        t2;
+        out.position = p0 * h00 + v0 * (h10 * T) + p1 * h01 + v1 * (h11 * T);
+    } else {
+        out.position = glm::mix(p0, p1, t);
+    }
+    out.velocity = glm::mix(v0, v1, t);
+    out.rotation = lerp_degrees(a.state.rotation, b.state.rotation, t);
+    return out;
+}
+
+EntityState SnapshotInterpolator::extrapolate(const Sample& s, double tick) const {
+    double ahead = std::min((tick - s.tick) * tick_interval_, static_cast<double>(max_extrapolation_));
+    EntityState out = s.state;
+    out.position += s.state.velocity * static_cast<float>(ahead);
+    return out;
+}
+
+bool SnapshotInterpolator::sample(EntityNetID id, EntityState& out) const {
+    auto it = entities_.find(id);
+    if (it == entities_.end() || it->second.count == 0) return false;
+    const History& h = it->second;
+
+    if (render_tick_ <= h.at(0).tick) {
+        out = h.at(0).state;
+        return true;
+    }
+
+    const Sample& newest = h.at(h.count - 1);
+    if (render_tick_ >= newest.tick) {
+        out = extrapolate(newest, render_tick_);
+        return true;
+    }
+
+    for (u32 i = h.count - 1; i > 0; i--) {
+        if (h.at(i - 1).tick <= render_tick_) {
+            out = interpolate(h.at(i - 1), h.at(i), render_tick_);
+            return true;
+        }
+    }
+    out = h.at(0).state;
+    return true;
+}
+
+void SnapshotInterpolator::sample_all(std::unordered_map<EntityNetID, EntityState>& out) const {
+    EntityState state;
+    for (const auto& [id, history] : entities_) {
+        if (sample(id, state)) out[id] = state;
+    }
+}
+
+} // namespace lumios::net
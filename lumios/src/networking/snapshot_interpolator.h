@@ -0,0 +1,85 @@
+#pragma once
+
+#include "net_types.h"
+#include <array>
+#include <unordered_map>
+
+namespace lumios::net {
+
+// Client-side buffer of tick-stamped entity states. Rendering runs a small,
+// jitter-adaptive delay behind the newest snapshot so remote entities can be
+// interpolated between two received states instead of snapping to each one.
+class SnapshotInterpolator {
+public:
+    // Server simulation rate; ticks in snapshot headers are converted with it
+    void set_tick_rate(float hz) { tick_interval_ = 1.0 / hz; }
+
+    // Bounds for the adaptive render delay, in seconds
+    void set_delay_limits(float min_delay, float max_delay);
+    // Jitter multiples added on top of the measured snapshot spacing
+    void set_jitter_scale(float scale) { jitter_scale_ = scale; }
+    // Past the newest sample entities extrapolate along their velocity for at
+    // most this long, then hold
+    void set_max_extrapolation(float seconds) { max_extrapolation_ = seconds; }
+
+    // Feeds a StateSnapshot/StateDelta received at local time `now` (seconds)
+    void on_receive(const NetworkMessage& msg, double now);
+
+    // Advances the render clock; call once per frame before sampling
+    void update(double now, float frame_dt);
+
+    bool sample(EntityNetID id, EntityState& out) const;
+    void sample_all(std::unordered_map<EntityNetID, EntityState>& out) const;
+
+    void remove_entity(EntityNetID id) { entities_.erase(id); }
+    void clear();
+
+    double render_tick()  const { return render_tick_; }
+    float  delay()        const { return static_cast<float>(delay_); }
+    float  jitter()       const { return static_cast<float>(jitter_); }
+    u32    latest_tick()  const { return latest_tick_; }
+    u32    entity_count() const { return static_cast<u32>(entities_.size()); }
+
+private:
+    static constexpr u32 HISTORY = 8;
+
+    struct Sample {
+        u32         tick;
+        EntityState state;
+    };
+
+    // Ring of the most recent samples, ordered by tick
+    struct History {
+        std::array<Sample, HISTORY> samples;
+        u32 head  = 0; // next write
+        u32 count = 0;
+
+        const Sample& at(u32 i) const { // 0 = oldest
+            return samples[(head + HISTORY - count + i) % HISTORY];
+        }
+        void push(u32 tick, const EntityState& state);
+    };
+
+    EntityState interpolate(const Sample& a, const Sample& b, double tick) const;
+    EntityState extrapolate(const Sample& s, double tick) const;
+
+    std::unordered_map<EntityNetID, History> entities_;
+
+    double tick_interval_     = 1.0 / 60.0;
+    double min_delay_         = 0.05;
+    double max_delay_         = 0.35;
+    float  jitter_scale_      = 2.5f;
+    float  max_extrapolation_ = 0.25f;
+
+    // Local receive time minus server send time, tracked near its minimum
+    double clock_offset_  = 0.0;
+    double last_transit_  = 0.0;
+    double jitter_        = 0.0;
+    double spacing_       = 0.05; // smoothed seconds between snapshots
+    double delay_         = 0.1;
+    double render_tick_   = 0.0;
+    u32    latest_tick_   = 0;
+    bool   have_clock_    = false;
+};
+
+} // namespace lumios::net
@@ -1,13 +1,45 @@
 #include "state_replicator.h"
+#include "interest_manager.h"
+#include "input_queue.h"
+#include "../core/job_system.h"
 
 namespace lumios::net {
 
+static constexpr size_t STATE_SIZE = sizeof(EntityState);
+
 void StateReplicator::track_entity(EntityNetID id, const EntityState& state) {
-    entities_[id] = {state, state, true};
+    auto it = entities_.find(id);
+    if (it != entities_.end()) {
+        it->second.current   = state;
+        it->second.last_sent = state;
+        it->second.dirty     = true;
+        return;
+    }
+
+    u32 slot = static_cast<u32>(slot_ids_.size());
+    entities_[id] = {state, state, slot, true};
+    slot_ids_.push_back(id);
+    slot_dirty_.push_back(0);
+    encoded_.resize(encoded_.size() + STATE_SIZE);
+    memcpy(encoded_.data() + slot * STATE_SIZE, &state, STATE_SIZE);
 }
 
 void StateReplicator::untrack_entity(EntityNetID id) {
-    entities_.erase(id);
+    auto it = entities_.find(id);
+    if (it == entities_.end()) return;
+
+    u32 slot = it->second.slot;
+    u32 last = static_cast<u32>(slot_ids_.size()) - 1;
+    if (slot != last) {
+        memcpy(encoded_.data() + slot * STATE_SIZE, encoded_.data() + last * STATE_SIZE, STATE_SIZE);
+        slot_ids_[slot]   = slot_ids_[last];
+        slot_dirty_[slot] = slot_dirty_[last];
+        entities_[slot_ids_[slot]].slot = slot;
+    }
+    slot_ids_.pop_back();
+    slot_dirty_.pop_back();
+    encoded_.resize(encoded_.size() - STATE_SIZE);
+    entities_.erase(it);
 }
 
 void StateReplicator::update_state(EntityNetID id, const EntityState& state) {
@@ -37,7 +69,7 @@ void StateReplicator::send_full_snapshot(ClientID client) {
         states.push_back(tracked.current);
     }
 
-    NetworkMessage msg = build_snapshot_msg(states);
+    NetworkMessage msg = build_snapshot_msg(states, input_ack(client));
     transport_->send_reliable(client, msg);
 }
 
@@ -54,7 +86,7 @@ void StateReplicator::send_delta(ClientID client) {
     }
 
     if (!changed.empty()) {
-        NetworkMessage msg = build_delta_msg(changed);
+        NetworkMessage msg = build_delta_msg(changed, input_ack(client));
         transport_->send_unreliable(client, msg);
     }
 }
@@ -72,36 +104,172 @@ void StateReplicator::broadcast_deltas() {
     }
 
     if (!changed.empty()) {
-        NetworkMessage msg = build_delta_msg(changed);
+        NetworkMessage msg = build_delta_msg(changed, 0);
         transport_->broadcast_unreliable(msg);
     }
 }
 
-void StateReplicator::on_receive_snapshot(const NetworkMessage& msg,
+u32 StateReplicator::on_receive_snapshot(const NetworkMessage& msg,
     std::unordered_map<EntityNetID, EntityState>& out_states) {
-    size_t offset = 0;
-    u32 count = msg.read<u32>(offset);
-    offset += sizeof(u32);
+    auto header = msg.read<SnapshotHeader>(0);
+    size_t offset = sizeof(SnapshotHeader);
 
-    for (u32 i = 0; i < count && offset + sizeof(EntityState) <= msg.payload.size(); i++) {
+    for (u32 i = 0; i < header.entity_count && offset + sizeof(EntityState) <= msg.payload.size(); i++) {
         EntityState state = msg.read<EntityState>(offset);
         offset += sizeof(EntityState);
         out_states[state.id] = state;
     }
+    for (u32 i = 0; i < header.left_count && offset + sizeof(EntityNetID) <= msg.payload.size(); i++) {
+        out_states.erase(msg.read<EntityNetID>(offset));
+        offset += sizeof(EntityNetID);
+    }
+    return header.server_tick;
+}
+
+u32 StateReplicator::input_ack(ClientID client) const {
+    return inputs_ ? inputs_->last_applied(client) : 0;
+}
+
+// --- Per-tick pipeline ---
+
+void StateReplicator::encode_dirty() {
+    for (auto& [id, tracked] : entities_) {
+        if (!tracked.dirty) continue;
+        memcpy(encoded_.data() + tracked.slot * STATE_SIZE, &tracked.current, STATE_SIZE);
+        slot_dirty_[tracked.slot] = 1;
+        tracked.last_sent = tracked.current;
+        tracked.dirty     = false;
+    }
+}
+
+void StateReplicator::finish_packet(ClientPacket& packet, u32 count, u32 left, u32* sent_ack) const {
+    u32  ack         = input_ack(packet.client);
+    bool ack_changed = sent_ack && *sent_ack != ack;
+
+    if (count == 0 && left == 0 && !ack_changed) {
+        packet.msg.payload.clear();
+        return;
+    }
+    SnapshotHeader header{server_tick_, ack, count, left};
+    memcpy(packet.msg.payload.data(), &header, sizeof(header));
+    if (sent_ack) *sent_ack = ack;
+}
+
+void StateReplicator::add_controlled(ClientPacket& packet, u32& count, bool included, const u32* sent_ack) const {
+    if (included || !sent_ack || *sent_ack == input_ack(packet.client)) return;
+    auto own = controlled_.find(packet.client);
+    if (own == controlled_.end()) return;
+    auto it = entities_.find(own->second);
+    if (it == entities_.end()) return;
+
+    const u8* src = encoded_.data() + it->second.slot * STATE_SIZE;
+    packet.msg.payload.insert(packet.msg.payload.end(), src, src + STATE_SIZE);
+    count++;
+}
+
+void StateReplicator::assemble_packet(ClientPacket& packet, u32* sent_ack) {
+    const VisibilityDiff& diff = interest_->refresh_client(packet.client);
+    const auto& visible = interest_->visible_set(packet.client);
+
+    auto& payload = packet.msg.payload;
+    payload.clear();
+    payload.reserve(sizeof(SnapshotHeader) + visible.size() * STATE_SIZE + diff.left.size() * sizeof(EntityNetID));
+    payload.resize(sizeof(SnapshotHeader));
+
+    auto own = controlled_.find(packet.client);
+    EntityNetID own_id = own != controlled_.end() ? own->second : 0;
+    bool own_included  = false;
+
+    // Both lists are sorted, so entered entities are found with a merge walk
+    u32 count = 0;
+    auto entered = diff.entered.begin();
+    for (EntityNetID id : visible) {
+        bool just_entered = entered != diff.entered.end() && *entered == id;
+        if (just_entered) ++entered;
+
+        auto it = entities_.find(id);
+        if (it == entities_.end()) continue;
+        u32 slot = it->second.slot;
+        if (!just_entered && !slot_dirty_[slot]) continue;
+
+        const u8* src = encoded_.data() + slot * STATE_SIZE;
+        payload.insert(payload.end(), src, src + STATE_SIZE);
+        count++;
+        own_included |= id == own_id;
+    }
+    add_controlled(packet, count, own_included, sent_ack);
+
+    // Without the leave notice the client would keep these forever
+    const u8* left = reinterpret_cast<const u8*>(diff.left.data());
+    payload.insert(payload.end(), left, left + diff.left.size() * sizeof(EntityNetID));
+
+    finish_packet(packet, count, static_cast<u32>(diff.left.size()), sent_ack);
+}
+
+const std::vector<ClientPacket>& StateReplicator::build_tick(std::span<const ClientID> clients) {
+    encode_dirty();
+
+    // Ack slots are created here, serially, so workers only touch their own
+    packets_.resize(clients.size());
+    packet_acks_.resize(clients.size());
+    for (size_t i = 0; i < clients.size(); i++) {
+        packets_[i].client   = clients[i];
+        packets_[i].msg.type = MessageType::StateDelta;
+        packet_acks_[i]      = inputs_ ? &sent_acks_[clients[i]] : nullptr;
+    }
+
+    if (interest_) {
+        auto assemble = [this](u32 begin, u32 end) {
+            for (u32 i = begin; i < end; i++) assemble_packet(packets_[i], packet_acks_[i]);
+        };
+        if (jobs_) jobs_->parallel_for(static_cast<u32>(packets_.size()), 16, assemble);
+        else       assemble(0, static_cast<u32>(packets_.size()));
+    } else {
+        // Without interest management every client receives the same delta
+        std::vector<u8> shared(sizeof(SnapshotHeader));
+        u32 count = 0;
+        for (size_t slot = 0; slot < slot_dirty_.size(); slot++) {
+            if (!slot_dirty_[slot]) continue;
+            const u8* src = encoded_.data() + slot * STATE_SIZE;
+            shared.insert(shared.end(), src, src + STATE_SIZE);
+            count++;
+        }
+        for (size_t i = 0; i < packets_.size(); i++) {
+            packets_[i].msg.payload = shared;
+            u32  client_count = count;
+            auto own = controlled_.find(packets_[i].client);
+            auto it  = own != controlled_.end() ? entities_.find(own->second) : entities_.end();
+            bool own_included = it != entities_.end() && slot_dirty_[it->second.slot];
+            add_controlled(packets_[i], client_count, own_included, packet_acks_[i]);
+            finish_packet(packets_[i], client_count, 0, packet_acks_[i]);
+        }
+    }
+
+    std::fill(slot_dirty_.begin(), slot_dirty_.end(), 0);
+    return packets_;
+}
+
+void StateReplicator::send_tick(std::span<const ClientID> clients) {
+    if (!transport_) return;
+
+    for (const auto& packet : build_tick(clients)) {
+        if (!packet.msg.payload.empty())
+            transport_->send_unreliable(packet.client, packet.msg);
+    }
 }
 
-NetworkMessage StateReplicator::build_snapshot_msg(const std::vector<EntityState>& states) const {
+NetworkMessage StateReplicator::build_snapshot_msg(const std::vector<EntityState>& states, u32 ack) const {
     NetworkMessage msg;
     msg.type = MessageType::StateSnapshot;
-    msg.write(static_cast<u32>(states.size()));
+    msg.write(SnapshotHeader{server_tick_, ack, static_cast<u32>(states.size()), 0});
     for (const auto& s : states) msg.write(s);
     return msg;
 }
 
-NetworkMessage StateReplicator::build_delta_msg(const std::vector<EntityState>& changed) const {
+NetworkMessage StateReplicator::build_delta_msg(const std::vector<EntityState>& changed, u32 ack) const {
     NetworkMessage msg;
     msg.type = MessageType::StateDelta;
-    msg.write(static_cast<u32>(changed.size()));
+    msg.write(SnapshotHeader{server_tick_, ack, static_cast<u32>(changed.size()), 0});
     for (const auto& s : changed) msg.write(s);
     return msg;
 }
@@ -2,10 +2,21 @@
 
 #include "net_types.h"
 #include "net_transport.h"
+#include <span>
 #include <unordered_map>
 
+namespace lumios { class JobSystem; }
+
 namespace lumios::net {
 
+class InterestManager;
+class InputQueue;
+
+struct ClientPacket {
+    ClientID       client = INVALID_CLIENT;
+    NetworkMessage msg;
+};
+
 class StateReplicator {
 public:
     void set_transport(NetworkTransport* transport) { transport_ = transport; }
@@ -19,27 +30,74 @@ public:
     void send_delta(ClientID client);
     void broadcast_deltas();
 
-    void on_receive_snapshot(const NetworkMessage& msg,
-                             std::unordered_map<EntityNetID, EntityState>& out_states);
+    // Returns the server tick the snapshot was taken on
+    u32 on_receive_snapshot(const NetworkMessage& msg,
+                            std::unordered_map<EntityNetID, EntityState>& out_states);
+
+    // Stamped into every outgoing snapshot/delta header
+    void set_server_tick(u32 tick) { server_tick_ = tick; }
+    u32  server_tick() const       { return server_tick_; }
+
+    // --- Per-tick pipeline ---
+    // Every dirty entity is encoded once into a shared cache; per-client
+    // deltas (dirty entities in view plus entities that just entered view,
+    // followed by the IDs that left it) are then assembled from that cache
+    // across the job system's threads.
+    void set_interest(InterestManager* interest) { interest_ = interest; }
+    void set_job_system(JobSystem* jobs) { jobs_ = jobs; }
+    // Source of the per-client input acks written into delta headers. A
+    // client whose ack advanced gets a header-only packet even when none of
+    // its entities changed.
+    void set_input_queue(const InputQueue* inputs) { inputs_ = inputs; }
+    // The entity a client's inputs drive. It rides along with every packet
+    // that advances that client's ack, so reconciliation never rewinds to a
+    // state of it that was lost with an earlier delta.
+    void set_controlled_entity(ClientID client, EntityNetID id) { controlled_[client] = id; }
+    void remove_client(ClientID client) { sent_acks_.erase(client); controlled_.erase(client); }
+
+    // Refreshes each client's interest set and builds its delta. The result
+    // stays valid until the next call; clients with nothing to send get an
+    // empty payload.
+    const std::vector<ClientPacket>& build_tick(std::span<const ClientID> clients);
+    void send_tick(std::span<const ClientID> clients);
 
     void set_snapshot_rate(float hz) { snapshot_interval_ = 1.0f / hz; }
 
 private:
     NetworkTransport* transport_ = nullptr;
+    InterestManager*  interest_  = nullptr;
+    JobSystem*        jobs_      = nullptr;
+    const InputQueue* inputs_    = nullptr;
 
     struct TrackedEntity {
         EntityState current;
         EntityState last_sent;
+        u32  slot  = 0; // index into encoded_
         bool dirty = true;
     };
 
     std::unordered_map<EntityNetID, TrackedEntity> entities_;
+
+    // One encoded EntityState per tracked entity, refreshed only when dirty
+    std::vector<u8>           encoded_;
+    std::vector<EntityNetID>  slot_ids_;
+    std::vector<u8>           slot_dirty_; // encoded this tick
+    std::vector<ClientPacket> packets_;
+    std::vector<u32*>         packet_acks_; // into sent_acks_, one per packet
+    std::unordered_map<ClientID, u32> sent_acks_;
+    std::unordered_map<ClientID, EntityNetID> controlled_;
     float snapshot_interval_ = 1.0f / 20.0f;
     float snapshot_timer_    = 0.0f;
+    u32   server_tick_       = 0;
 
     bool has_changed(const EntityState& a, const EntityState& b) const;
-    NetworkMessage build_snapshot_msg(const std::vector<EntityState>& states) const;
-    NetworkMessage build_delta_msg(const std::vector<EntityState>& changed) const;
+    u32  input_ack(ClientID client) const;
+    NetworkMessage build_snapshot_msg(const std::vector<EntityState>& states, u32 ack) const;
+    NetworkMessage build_delta_msg(const std::vector<EntityState>& changed, u32 ack) const;
+    void encode_dirty();
+    void assemble_packet(ClientPacket& packet, u32* sent_ack);
+    void add_controlled(ClientPacket& packet, u32& count, bool included, const u32* sent_ack) const;
+    void finish_packet(ClientPacket& packet, u32 count, u32 left, u32* sent_ack) const;
 };
 
 } // namespace lumios::net
@@ -0,0 +1,196 @@
+#include "zone_handoff.h"
+#include <algorithm>
+#include <cstring>
+
+namespace lumios::net {
+
+ZoneHandoff::ZoneHandoff(ZoneID zone, ZoneManager& zones, NetworkTransport& transport)
+    : zone_(zone), zones_(zones), transport_(transport) {}
+
+void ZoneHandoff::set_peer(ZoneID zone, ClientID peer) {
+    peers_[zone] = peer;
+}
+
+void ZoneHandoff::add_owned(EntityNetID id, const EntityState& state) {
+    owned_[id] = state;
+    zones_.register_entity(id, zone_);
+}
+
+void ZoneHandoff::remove_owned(EntityNetID id) {
+    clear_ghosts(id);
+    owned_.erase(id);
+    pending_.erase(id);
+    accepted_.erase(id);
+    backoff_.erase(id);
+    zones_.unregister_entity(id);
+}
+
+void ZoneHandoff::update_owned(EntityNetID id, const EntityState& state) {
+    auto it = owned_.find(id);
+    if (it == owned_.end() || pending_.contains(id)) return;
+    it->second = state;
+}
+
+bool ZoneHandoff::is_transferring(EntityNetID id) const {
+    return pending_.contains(id);
+}
+
+void ZoneHandoff::send(ZoneID zone, ZoneTransferOp op, u32 transfer_id, const EntityState& state,
+                       bool with_components, bool reliable) {
+    auto peer = peers_.find(zone);
+    if (peer == peers_.end()) return;
+
+    blob_.clear();
+    if (with_components && serialize_) serialize_(state.id, blob_);
+
+    // Zeroed first so no padding byte leaves uninitialized
+    ZoneTransferHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.op          = op;
+    header.transfer_id = transfer_id;
+    header.from_zone   = zone_;
+    header.to_zone     = zone;
+    header.state       = state;
+    header.blob_size   = static_cast<u32>(blob_.size());
+
+    NetworkMessage msg;
+    msg.type = MessageType::ZoneTransfer;
+    msg.write(header);
+    msg.payload.insert(msg.payload.end(), blob_.begin(), blob_.end());
+
+    if (reliable) transport_.send_reliable(peer->second, msg);
+    else          transport_.send_unreliable(peer->second, msg);
+}
+
+void ZoneHandoff::offer(EntityNetID id, ZoneID to_zone, double now, u32 transfer_id) {
+    pending_[id] = {transfer_id, to_zone, now};
+    send(to_zone, ZoneTransferOp::Offer, transfer_id, owned_[id], true, true);
+}
+
+void ZoneHandoff::tick(double now) {
+    now_ = now;
+    for (const auto& req : zones_.process_transfers(owned_)) {
+        if (pending_.contains(req.entity) || !peers_.contains(req.to_zone)) continue;
+        auto backoff = backoff_.find(req.entity);
+        if (backoff != backoff_.end() && now < backoff->second.retry_at) continue;
+        offer(req.entity, req.to_zone, now, next_transfer_++);
+    }
+
+    for (auto& [id, pending] : pending_) {
+        if (now - pending.sent_at < offer_timeout_) continue;
+        pending.sent_at = now;
+        send(pending.to_zone, ZoneTransferOp::Offer, pending.transfer_id, owned_[id], true, true);
+    }
+
+    for (const auto& [id, state] : owned_)
+        update_ghosts(id, state);
+}
+
+void ZoneHandoff::update_ghosts(EntityNetID id, const EntityState& state) {
+    for (ZoneID neighbour : zones_.get_adjacent_zones(zone_)) {
+        if (!peers_.contains(neighbour)) continue;
+
+        bool inside = zones_.in_zone_margin(neighbour, state.position, ghost_margin_);
+        auto& list  = ghosted_in_[id];
+        auto  it    = std::find(list.begin(), list.end(), neighbour);
+
+        if (inside) {
+            if (it == list.end()) list.push_back(neighbour);
+            send(neighbour, ZoneTransferOp::GhostUpdate, 0, state, false, false);
+        } else if (it != list.end()) {
+            send(neighbour, ZoneTransferOp::GhostRemove, 0, state, false, true);
+            list.erase(it);
+        }
+    }
+}
+
+void ZoneHandoff::clear_ghosts(EntityNetID id, ZoneID except) {
+    auto it = ghosted_in_.find(id);
+    if (it == ghosted_in_.end()) return;
+
+    EntityState state{};
+    state.id = id;
+    for (ZoneID zone : it->second) {
+        if (zone != except)
+            send(zone, ZoneTransferOp::GhostRemove, 0, state, false, true);
+    }
+    ghosted_in_.erase(it);
+}
+
+void ZoneHandoff::on_message(ClientID /*from*/, const NetworkMessage& msg) {
+    if (msg.type != MessageType::ZoneTransfer || msg.payload.size() < sizeof(ZoneTransferHeader))
+        return;
+
+    auto header = msg.read<ZoneTransferHeader>(0);
+    EntityNetID id = header.state.id;
+
+    switch (header.op) {
+        case ZoneTransferOp::Offer: {
+            // Duplicate of an offer we already took: the ack was lost or late
+            auto acc = accepted_.find(id);
+            if (acc != accepted_.end() && acc->second == header.transfer_id && owned_.contains(id)) {
+                send(header.from_zone, ZoneTransferOp::Accept, header.transfer_id, header.state, false, true);
+                return;
+            }
+
+            if (header.to_zone != zone_ || zones_.get_zone_for_position(header.state.position) != zone_) {
+                send(header.from_zone, ZoneTransferOp::Reject, header.transfer_id, header.state, false, true);
+                return;
+            }
+
+            EntityTransferData data;
+            data.state = header.state;
+            size_t blob_offset = sizeof(ZoneTransferHeader);
+            size_t blob_size   = std::min<size_t>(header.blob_size, msg.payload.size() - blob_offset);
+            data.components.assign(msg.payload.begin() + blob_offset,
+                                   msg.payload.begin() + blob_offset + blob_size);
+
+            ghosts_.erase(id);
+            add_owned(id, header.state);
+            accepted_[id] = header.transfer_id;
+            if (on_acquire_) on_acquire_(data);
+
+            send(header.from_zone, ZoneTransferOp::Accept, header.transfer_id, header.state, false, true);
+            break;
+        }
+
+        case ZoneTransferOp::Accept: {
+            auto it = pending_.find(id);
+            if (it == pending_.end() || it->second.transfer_id != header.transfer_id) return;
+
+            ZoneID to_zone = it->second.to_zone;
+            pending_.erase(it);
+            clear_ghosts(id, to_zone);
+            owned_.erase(id);
+            accepted_.erase(id);
+            backoff_.erase(id);
+            zones_.complete_transfer(id, to_zone);
+            transfers_completed_++;
+            if (on_release_) on_release_(id, to_zone);
+            break;
+        }
+
+        case ZoneTransferOp::Reject: {
+            auto it = pending_.find(id);
+            if (it == pending_.end() || it->second.transfer_id != header.transfer_id) return;
+            pending_.erase(it);
+            transfers_rejected_++;
+
+            // Still outside its zone, so tick() would offer it right away
+            auto [entry, first] = backoff_.try_emplace(id, Backoff{0.0, offer_timeout_});
+            if (!first) entry->second.delay = std::min(entry->second.delay * 2.0, max_backoff_);
+            entry->second.retry_at = now_ + entry->second.delay;
+            break;
+        }
+
+        case ZoneTransferOp::GhostUpdate:
+            if (!owned_.contains(id)) ghosts_[id] = header.state;
+            break;
+
+        case ZoneTransferOp::GhostRemove:
+            ghosts_.erase(id);
+            break;
+    }
+}
+
+} // namespace lumios::net
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "net_transport.h"
+#include "zone_manager.h"
+
+namespace lumios::net {
+
+// Payload layout of MessageType::ZoneTransfer; Offers are followed by
+// blob_size bytes of serialized replicated components
+enum class ZoneTransferOp : u8 {
+    Offer,       // source -> target: take ownership of this entity
+    Accept,      // target -> source: ownership taken
+    Reject,      // target -> source: cannot take it, source keeps it
+    GhostUpdate, // owner -> neighbour: read-only copy for its margin region
+    GhostRemove, // owner -> neighbour: drop the copy
+};
+
+struct ZoneTransferHeader {
+    ZoneTransferOp op;
+    u32            transfer_id;
+    ZoneID         from_zone;
+    ZoneID         to_zone;
+    EntityState    state;
+    u32            blob_size;
+};
+
+// Everything a zone needs to take over an entity: the replicated transform
+// plus the opaque component blob produced by the owning zone's serializer
+struct EntityTransferData {
+    EntityState     state;
+    std::vector<u8> components;
+};
+
+// Runs on each zone server. Owned entities that cross out of the zone (plus
+// the ZoneManager boundary margin) are offered to the zone they moved into
+// and frozen until that zone accepts; ownership flips only on the ack, so an
+// entity is never simulated by two zones or by none. Owned entities within
+// `ghost_margin` of a neighbour are mirrored there as read-only ghosts so
+// players near the seam see across it.
+class ZoneHandoff {
+public:
+    using SerializeFn = std::function<void(EntityNetID, std::vector<u8>& out)>;
+    using AcquireFn   = std::function<void(const EntityTransferData&)>;
+    using ReleaseFn   = std::function<void(EntityNetID, ZoneID to_zone)>;
+
+    ZoneHandoff(ZoneID zone, ZoneManager& zones, NetworkTransport& transport);
+
+    // Connection over which the server for `zone` is reached
+    void set_peer(ZoneID zone, ClientID peer);
+
+    void set_serializer(SerializeFn fn) { serialize_  = std::move(fn); }
+    void set_on_acquire(AcquireFn fn)   { on_acquire_ = std::move(fn); }
+    void set_on_release(ReleaseFn fn)   { on_release_ = std::move(fn); }
+
+    void set_ghost_margin(float margin)    { ghost_margin_  = margin; }
+    void set_offer_timeout(double seconds) { offer_timeout_ = seconds; }
+    // A rejected entity is offered again after offer_timeout, doubling
+    // with each further rejection up to this
+    void set_max_backoff(double seconds)   { max_backoff_ = seconds; }
+
+    void add_owned(EntityNetID id, const EntityState& state);
+    void remove_owned(EntityNetID id);
+    void update_owned(EntityNetID id, const EntityState& state);
+
+    // Starts handoffs, refreshes ghosts and re-sends unanswered offers
+    void tick(double now);
+    // Feed every ZoneTransfer message received from a peer zone
+    void on_message(ClientID from, const NetworkMessage& msg);
+
+    bool owns(EntityNetID id) const { return owned_.contains(id); }
+    // Frozen entities must not be simulated until the handoff resolves
+    bool is_transferring(EntityNetID id) const;
+
+    const std::unordered_map<EntityNetID, EntityState>& owned()  const { return owned_; }
+    const std::unordered_map<EntityNetID, EntityState>& ghosts() const { return ghosts_; }
+
+    u32 transfers_completed() const { return transfers_completed_; }
+    u32 transfers_rejected()  const { return transfers_rejected_; }
+
+private:
+    struct PendingTransfer {
+        u32    transfer_id;
+        ZoneID to_zone;
+        double sent_at;
+    };
+
+    // Rejections of an entity still outside its zone
+    struct Backoff {
+        double retry_at;
+        double delay;
+    };
+
+    void send(ZoneID zone, ZoneTransferOp op, u32 transfer_id, const EntityState& state,
+              bool with_components, bool reliable);
+    void offer(EntityNetID id, ZoneID to_zone, double now, u32 transfer_id);
+    void update_ghosts(EntityNetID id, const EntityState& state);
+    void clear_ghosts(EntityNetID id, ZoneID except = INVALID_ZONE);
+
+    ZoneID            zone_;
+    ZoneManager&      zones_;
+    NetworkTransport& transport_;
+
+    SerializeFn serialize_;
+    AcquireFn   on_acquire_;
+    ReleaseFn   on_release_;
+
+    std::unordered_map<ZoneID, ClientID>                 peers_;
+    std::unordered_map<EntityNetID, EntityState>         owned_;
+    std::unordered_map<EntityNetID, PendingTransfer>     pending_;
+    std::unordered_map<EntityNetID, std::vector<ZoneID>> ghosted_in_;
+    std::unordered_map<EntityNetID, EntityState>         ghosts_;
+    std::unordered_map<EntityNetID, u32>                 accepted_; // offers taken, for duplicate acks
+    std::unordered_map<EntityNetID, Backoff>             backoff_;
+    std::vector<u8>                                      blob_;
+
+    float  ghost_margin_        = 20.0f;
+    double offer_timeout_       = 0.5;
+    double max_backoff_         = 8.0;
+    double now_                 = 0.0; // of the last tick
+    u32    next_transfer_       = 1;
+    u32    transfers_completed_ = 0;
+    u32    transfers_rejected_  = 0;
+};
+
+} // namespace lumios::net
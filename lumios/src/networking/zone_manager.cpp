@@ -1,27 +1,143 @@
 #include "zone_manager.h"
+#include <algorithm>
+#include <cmath>
 
 namespace lumios::net {
 
+static constexpr u32 MAX_INDEX_CELLS = 1u << 18;
+
+static const std::vector<ZoneID> s_no_zones;
+
+static bool contains(const ZoneConfig& zone, const glm::vec3& p, float margin) {
+    return p.x >= zone.bounds_min.x - margin && p.x <= zone.bounds_max.x + margin &&
+           p.y >= zone.bounds_min.y - margin && p.y <= zone.bounds_max.y + margin &&
+           p.z >= zone.bounds_min.z - margin && p.z <= zone.bounds_max.z + margin;
+}
+
 void ZoneManager::add_zone(const ZoneConfig& config) {
     zones_[config.id] = config;
+    rebuild_index();
 }
 
 void ZoneManager::remove_zone(ZoneID id) {
     zones_.erase(id);
     std::erase_if(entity_zones_, [id](const auto& pair) { return pair.second == id; });
+    rebuild_index();
 }
 
-ZoneID ZoneManager::get_zone_for_position(const glm::vec3& position) const {
-    for (auto& [id, zone] : zones_) {
-        if (position.x >= zone.bounds_min.x && position.x <= zone.bounds_max.x &&
-            position.y >= zone.bounds_min.y && position.y <= zone.bounds_max.y &&
-            position.z >= zone.bounds_min.z && position.z <= zone.bounds_max.z) {
-            return id;
+void ZoneManager::set_boundary_margin(float margin) {
+    boundary_margin_ = margin;
+    rebuild_index();
+}
+
+void ZoneManager::set_index_cell_size(float size) {
+    index_cell_size_ = size;
+    rebuild_index();
+}
+
+void ZoneManager::rebuild_index() {
+    cell_start_.clear();
+    cell_zones_.clear();
+    adjacency_.clear();
+    index_dim_x_ = index_dim_y_ = index_dim_z_ = 0;
+    if (zones_.empty()) return;
+
+    // Sorted ids keep lookups deterministic where zones overlap
+    std::vector<const ZoneConfig*> sorted;
+    sorted.reserve(zones_.size());
+    for (auto& [id, zone] : zones_) sorted.push_back(&zone);
+    std::sort(sorted.begin(), sorted.end(),
+              [](const ZoneConfig* a, const ZoneConfig* b) { return a->id < b->id; });
+
+    glm::vec3 lo = sorted[0]->bounds_min, hi = sorted[0]->bounds_max;
+    for (auto* z : sorted) {
+        lo = glm::min(lo, z->bounds_min);
+        hi = glm::max(hi, z->bounds_max);
+    }
+
+    float cell = index_cell_size_;
+    glm::vec3 extent = hi - lo;
+    auto dim = [&](float e) { return std::max(1u, static_cast<u32>(std::ceil(e / cell))); };
+    for (;;) {
+        index_dim_x_ = dim(extent.x);
+        index_dim_y_ = dim(extent.y);
+        index_dim_z_ = dim(extent.z);
+        if (static_cast<u64>(index_dim_x_) * index_dim_y_ * index_dim_z_ <= MAX_INDEX_CELLS) break;
+        cell *= 2.0f;
+    }
+    index_min_      = lo;
+    index_inv_cell_ = 1.0f / cell;
+
+    // Two passes into a flat CSR layout: count per cell, then fill
+    u32 cell_count = index_dim_x_ * index_dim_y_ * index_dim_z_;
+    cell_start_.assign(cell_count + 1, 0);
+    auto axis = [this](float v, float origin, u32 d) {
+        return std::min(d - 1, static_cast<u32>(std::max(0.0f, std::floor((v - origin) * index_inv_cell_))));
+    };
+    auto for_cells = [&](const ZoneConfig& z, auto&& fn) {
+        u32 x0 = axis(z.bounds_min.x, lo.x, index_dim_x_), x1 = axis(z.bounds_max.x, lo.x, index_dim_x_);
+        u32 y0 = axis(z.bounds_min.y, lo.y, index_dim_y_), y1 = axis(z.bounds_max.y, lo.y, index_dim_y_);
+        u32 z0 = axis(z.bounds_min.z, lo.z, index_dim_z_), z1 = axis(z.bounds_max.z, lo.z, index_dim_z_);
+        for (u32 cz = z0; cz <= z1; cz++)
+            for (u32 cy = y0; cy <= y1; cy++)
+                for (u32 cx = x0; cx <= x1; cx++)
+                    fn((cz * index_dim_y_ + cy) * index_dim_x_ + cx);
+    };
+    for (auto* z : sorted) for_cells(*z, [&](u32 c) { cell_start_[c + 1]++; });
+    for (u32 c = 0; c < cell_count; c++) cell_start_[c + 1] += cell_start_[c];
+    cell_zones_.resize(cell_start_[cell_count]);
+    std::vector<u32> fill(cell_start_.begin(), cell_start_.end() - 1);
+    for (auto* z : sorted) for_cells(*z, [&](u32 c) { cell_zones_[fill[c]++] = z; });
+
+    // Adjacency only depends on the zone layout, so it is cached here too
+    for (auto* a : sorted) {
+        auto& adjacent = adjacency_[a->id];
+        for (auto* b : sorted) {
+            if (a == b) continue;
+            bool overlaps =
+                a->bounds_min.x <= b->bounds_max.x + boundary_margin_ &&
+                a->bounds_max.x >= b->bounds_min.x - boundary_margin_ &&
+                a->bounds_min.y <= b->bounds_max.y + boundary_margin_ &&
+                a->bounds_max.y >= b->bounds_min.y - boundary_margin_ &&
+                a->bounds_min.z <= b->bounds_max.z + boundary_margin_ &&
+                a->bounds_max.z >= b->bounds_min.z - boundary_margin_;
+            if (overlaps) adjacent.push_back(b->id);
         }
     }
+}
+
+u32 ZoneManager::index_cell(const glm::vec3& p) const {
+    if (cell_start_.empty()) return UINT32_MAX;
+
+    auto axis = [this](float v, float origin, u32 d) -> u32 {
+        float c = std::floor((v - origin) * index_inv_cell_);
+        if (!(c >= 0.0f)) return UINT32_MAX; // NaN too
+        // The max face belongs to the last cell; clamped before the cast,
+        // which is undefined for floats out of u32 range
+        return static_cast<u32>(std::min(c, static_cast<float>(d - 1)));
+    };
+    u32 x = axis(p.x, index_min_.x, index_dim_x_);
+    u32 y = axis(p.y, index_min_.y, index_dim_y_);
+    u32 z = axis(p.z, index_min_.z, index_dim_z_);
+    if (x == UINT32_MAX || y == UINT32_MAX || z == UINT32_MAX) return UINT32_MAX;
+    return (z * index_dim_y_ + y) * index_dim_x_ + x;
+}
+
+ZoneID ZoneManager::get_zone_for_position(const glm::vec3& position) const {
+    u32 cell = index_cell(position);
+    if (cell == UINT32_MAX) return INVALID_ZONE;
+
+    for (u32 i = cell_start_[cell]; i < cell_start_[cell + 1]; i++) {
+        if (contains(*cell_zones_[i], position, 0.0f)) return cell_zones_[i]->id;
+    }
     return INVALID_ZONE;
 }
 
+bool ZoneManager::in_zone_margin(ZoneID id, const glm::vec3& position, float margin) const {
+    auto it = zones_.find(id);
+    return it != zones_.end() && contains(it->second, position, margin);
+}
+
 bool ZoneManager::should_transfer(EntityNetID entity, const glm::vec3& new_position) const {
     auto it = entity_zones_.find(entity);
     if (it == entity_zones_.end()) return false;
@@ -29,13 +145,7 @@ bool ZoneManager::should_transfer(EntityNetID entity, const glm::vec3& new_posit
     auto zone_it = zones_.find(it->second);
     if (zone_it == zones_.end()) return false;
 
-    const auto& zone = zone_it->second;
-    return new_position.x < zone.bounds_min.x - boundary_margin_ ||
-           new_position.x > zone.bounds_max.x + boundary_margin_ ||
-           new_position.y < zone.bounds_min.y - boundary_margin_ ||
-           new_position.y > zone.bounds_max.y + boundary_margin_ ||
-           new_position.z < zone.bounds_min.z - boundary_margin_ ||
-           new_position.z > zone.bounds_max.z + boundary_margin_;
+    return !contains(zone_it->second, new_position, boundary_margin_);
 }
 
 void ZoneManager::register_entity(EntityNetID entity, ZoneID zone) {
@@ -46,58 +156,43 @@ void ZoneManager::unregister_entity(EntityNetID entity) {
     entity_zones_.erase(entity);
 }
 
+ZoneID ZoneManager::get_entity_zone(EntityNetID entity) const {
+    auto it = entity_zones_.find(entity);
+    return it != entity_zones_.end() ? it->second : INVALID_ZONE;
+}
+
 std::vector<ZoneManager::TransferRequest> ZoneManager::process_transfers(
-    const std::unordered_map<EntityNetID, glm::vec3>& entity_positions) {
+    const std::unordered_map<EntityNetID, EntityState>& entity_states) const {
 
     std::vector<TransferRequest> transfers;
 
-    for (auto& [entity, pos] : entity_positions) {
-        if (!should_transfer(entity, pos)) continue;
+    for (auto& [entity, state] : entity_states) {
+        if (!should_transfer(entity, state.position)) continue;
 
-        ZoneID new_zone = get_zone_for_position(pos);
+        ZoneID new_zone = get_zone_for_position(state.position);
         if (new_zone == INVALID_ZONE) continue;
 
-        auto it = entity_zones_.find(entity);
-        ZoneID old_zone = (it != entity_zones_.end()) ? it->second : INVALID_ZONE;
+        ZoneID old_zone = get_entity_zone(entity);
         if (old_zone == new_zone) continue;
 
-        TransferRequest req;
-        req.entity    = entity;
-        req.from_zone = old_zone;
-        req.to_zone   = new_zone;
-        req.state.id       = entity;
-        req.state.position = pos;
-        transfers.push_back(req);
-
-        entity_zones_[entity] = new_zone;
+        transfers.push_back({entity, old_zone, new_zone, state});
     }
 
     return transfers;
 }
 
+void ZoneManager::complete_transfer(EntityNetID entity, ZoneID to_zone) {
+    entity_zones_[entity] = to_zone;
+}
+
 const ZoneConfig* ZoneManager::get_zone(ZoneID id) const {
     auto it = zones_.find(id);
     return it != zones_.end() ? &it->second : nullptr;
 }
 
-std::vector<ZoneID> ZoneManager::get_adjacent_zones(ZoneID id) const {
-    std::vector<ZoneID> adjacent;
-    auto it = zones_.find(id);
-    if (it == zones_.end()) return adjacent;
-
-    const auto& zone = it->second;
-    for (auto& [other_id, other] : zones_) {
-        if (other_id == id) continue;
-        bool overlaps =
-            zone.bounds_min.x <= other.bounds_max.x + boundary_margin_ &&
-            zone.bounds_max.x >= other.bounds_min.x - boundary_margin_ &&
-            zone.bounds_min.y <= other.bounds_max.y + boundary_margin_ &&
-            zone.bounds_max.y >= other.bounds_min.y - boundary_margin_ &&
-            zone.bounds_min.z <= other.bounds_max.z + boundary_margin_ &&
-            zone.bounds_max.z >= other.bounds_min.z - boundary_margin_;
-        if (overlaps) adjacent.push_back(other_id);
-    }
-    return adjacent;
+const std::vector<ZoneID>& ZoneManager::get_adjacent_zones(ZoneID id) const {
+    auto it = adjacency_.find(id);
+    return it != adjacency_.end() ? it->second : s_no_zones;
 }
 
 } // namespace lumios::net
@@ -24,6 +24,7 @@ public:
     bool should_transfer(EntityNetID entity, const glm::vec3& new_position) const;
     void register_entity(EntityNetID entity, ZoneID zone);
     void unregister_entity(EntityNetID entity);
+    ZoneID get_entity_zone(EntityNetID entity) const;
 
     struct TransferRequest {
         EntityNetID entity;
@@ -32,16 +33,46 @@ public:
         EntityState state;
     };
 
+    // Lists entities that left their zone (plus margin) for another zone.
+    // Ownership does not change until complete_transfer() is called, i.e.
+    // once the receiving zone has acknowledged the handoff; the entity's
+    // zone is then the one it was handed to.
     std::vector<TransferRequest> process_transfers(
-        const std::unordered_map<EntityNetID, glm::vec3>& entity_positions);
+        const std::unordered_map<EntityNetID, EntityState>& entity_states) const;
+    void complete_transfer(EntityNetID entity, ZoneID to_zone);
 
     const ZoneConfig* get_zone(ZoneID id) const;
-    std::vector<ZoneID> get_adjacent_zones(ZoneID id) const;
+    const std::vector<ZoneID>& get_adjacent_zones(ZoneID id) const;
+
+    // True if position lies within `margin` of the zone's bounds
+    bool in_zone_margin(ZoneID id, const glm::vec3& position, float margin) const;
+
+    void  set_boundary_margin(float margin);
+    float boundary_margin() const { return boundary_margin_; }
+    // Target edge length of the lookup grid cells; rebuilt on change
+    void  set_index_cell_size(float size);
 
 private:
+    void rebuild_index();
+    u32  index_cell(const glm::vec3& position) const; // UINT32_MAX outside
+
     std::unordered_map<ZoneID, ZoneConfig>    zones_;
     std::unordered_map<EntityNetID, ZoneID>   entity_zones_;
     float boundary_margin_ = 5.0f;
+
+    // Dense grid over the union of all zone bounds; each cell lists the
+    // zones overlapping it. Zones change rarely, so it is rebuilt eagerly.
+    float     index_cell_size_ = 128.0f;
+    float     index_inv_cell_  = 1.0f / 128.0f;
+    glm::vec3 index_min_{0.0f};
+    u32       index_dim_x_ = 0, index_dim_y_ = 0, index_dim_z_ = 0;
+    // Cell c lists cell_zones_[cell_start_[c] .. cell_start_[c + 1]); the
+    // pointers stay valid because zones_ only changes through add/remove,
+    // which rebuild the index.
+    std::vector<u32>               cell_start_;
+    std::vector<const ZoneConfig*> cell_zones_;
+
+    std::unordered_map<ZoneID, std::vector<ZoneID>> adjacency_;
 };
 
 } // namespace lumios::net
@@ -0,0 +1,359 @@
+#include "lag_compensation.h"
+#include "physics_world.h"
+#include "../core/job_system.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace lumios {
+
+void LagCompensation::set_history_length(u32 ticks) {
+    frames_.clear();
+    frames_.resize(std::max(ticks, 1u));
+    recording_  = nullptr;
+    has_frames_ = false;
+}
+
+// --- Recording ---
+
+void LagCompensation::record(u32 tick, const PhysicsWorld& world) {
+    using S = ColliderComponent::Shape;
+
+    begin_frame(tick);
+    for (const auto& b : world.bodies()) {
+        if (b.is_trigger) continue;
+
+        HistoricalCollider c;
+        c.entity = b.entity;
+        c.center = b.position + b.offset;
+        switch (b.shape) {
+            case S::Sphere:
+                c.shape   = HistoricalCollider::Shape::Sphere;
+                c.extents = {b.radius, 0.0f, 0.0f};
+                break;
+            case S::Capsule:
+                c.shape   = HistoricalCollider::Shape::Capsule;
+                c.extents = {b.radius, b.height * 0.5f, 0.0f};
+                break;
+            case S::Mesh:
+            case S::ConvexHull: {
+                const auto* verts = b.hull_verts ? b.hull_verts : b.mesh_verts;
+                c.shape   = HistoricalCollider::Shape::Box;
+                c.extents = b.half_extents;
+                if (verts && !verts->empty()) {
+                    glm::vec3 mn(FLT_MAX), mx(-FLT_MAX);
+                    for (const auto& v : *verts) {
+                        mn = glm::min(mn, v);
+                        mx = glm::max(mx, v);
+                    }
+                    c.center += (mn + mx) * 0.5f;
+                    c.extents = (mx - mn) * 0.5f;
+                }
+                break;
+            }
+            case S::Box:
+            default:
+                c.shape   = HistoricalCollider::Shape::Box;
+                c.extents = b.half_extents;
+                break;
+        }
+        add_collider(c);
+    }
+    end_frame();
+}
+
+void LagCompensation::begin_frame(u32 tick) {
+    Frame& frame = frames_[tick % frames_.size()];
+    frame.tick  = tick;
+    frame.valid = false;
+    frame.colliders.clear();
+    recording_ = &frame;
+}
+
+void LagCompensation::add_collider(const HistoricalCollider& collider) {
+    if (recording_) recording_->colliders.push_back(collider);
+}
+
+void LagCompensation::end_frame() {
+    if (!recording_) return;
+    build_grid(*recording_);
+    recording_->valid = true;
+    newest_tick_ = recording_->tick;
+    has_frames_  = true;
+    recording_   = nullptr;
+}
+
+// --- Broadphase ---
+
+static void collider_bounds(const HistoricalCollider& c, glm::vec3& mn, glm::vec3& mx) {
+    glm::vec3 half;
+    switch (c.shape) {
+        case HistoricalCollider::Shape::Sphere:  half = glm::vec3(c.extents.x); break;
+        case HistoricalCollider::Shape::Capsule: half = {c.extents.x, c.extents.y + c.extents.x, c.extents.x}; break;
+        case HistoricalCollider::Shape::Box:
+        default:                                 half = c.extents; break;
+    }
+    mn = c.center - half;
+    mx = c.center + half;
+}
+
+u32 LagCompensation::bucket(i32 x, i32 y, i32 z, u32 mask) const {
+    u32 h = static_cast<u32>(x) * 73856093u ^ static_cast<u32>(y) * 19349663u ^ static_cast<u32>(z) * 83492791u;
+    return h & mask;
+}
+
+void LagCompensation::build_grid(Frame& frame) {
+    u32 count   = static_cast<u32>(frame.colliders.size());
+    u32 buckets = 64;
+    while (buckets < count * 2) buckets <<= 1;
+    frame.bucket_mask = buckets - 1;
+    frame.large.clear();
+    frame.cell_min = glm::ivec3(INT32_MAX);
+    frame.cell_max = glm::ivec3(INT32_MIN);
+
+    // (bucket, collider) pairs first, then a counting sort into CSR
+    scratch_cells_.clear();
+    for (u32 i = 0; i < count; i++) {
+        glm::vec3 mn, mx;
+        collider_bounds(frame.colliders[i], mn, mx);
+        glm::ivec3 c0(glm::floor(mn * inv_cell_size_));
+        glm::ivec3 c1(glm::floor(mx * inv_cell_size_));
+        glm::ivec3 span = c1 - c0 + 1;
+        if (static_cast<u64>(span.x) * span.y * span.z > MAX_CELLS_PER_COLLIDER) {
+            frame.large.push_back(i);
+            continue;
+        }
+        frame.cell_min = glm::min(frame.cell_min, c0);
+        frame.cell_max = glm::max(frame.cell_max, c1);
+        for (i32 z = c0.z; z <= c1.z; z++)
+            for (i32 y = c0.y; y <= c1.y; y++)
+                for (i32 x = c0.x; x <= c1.x; x++) {
+                    scratch_cells_.push_back(bucket(x, y, z, frame.bucket_mask));
+                    scratch_cells_.push_back(i);
+                }
+    }
+
+    frame.bucket_start.assign(buckets + 1, 0);
+    for (size_t k = 0; k < scratch_cells_.size(); k += 2) frame.bucket_start[scratch_cells_[k] + 1]++;
+    for (u32 b = 0; b < buckets; b++) frame.bucket_start[b + 1] += frame.bucket_start[b];
+
+    frame.bucket_items.resize(scratch_cells_.size() / 2);
+    std::vector<u32>& cursor = scratch_cursor_;
+    cursor.assign(frame.bucket_start.begin(), frame.bucket_start.end() - 1);
+    for (size_t k = 0; k < scratch_cells_.size(); k += 2)
+        frame.bucket_items[cursor[scratch_cells_[k]]++] = scratch_cells_[k + 1];
+}
+
+// --- History lookup ---
+
+const LagCompensation::Frame* LagCompensation::find_frame(u32 tick) const {
+    const Frame& frame = frames_[tick % frames_.size()];
+    return frame.valid && frame.tick == tick ? &frame : nullptr;
+}
+
+u32 LagCompensation::oldest_tick() const {
+    u32 history = static_cast<u32>(frames_.size());
+    u32 first   = newest_tick_ >= history - 1 ? newest_tick_ - (history - 1) : 0;
+    for (u32 t = first; t < newest_tick_; t++)
+        if (find_frame(t)) return t;
+    return newest_tick_;
+}
+
+const LagCompensation::Frame* LagCompensation::clamp_frame(u32 tick) const {
+    if (!has_frames_) return nullptr;
+    if (tick > newest_tick_) tick = newest_tick_;
+    if (const Frame* frame = find_frame(tick)) return frame;
+
+    // Too old or a gap: use the closest newer frame still kept
+    u32 history = static_cast<u32>(frames_.size());
+    u32 first   = newest_tick_ >= history - 1 ? newest_tick_ - (history - 1) : 0;
+    for (u32 t = std::max(tick, first); t <= newest_tick_; t++)
+        if (const Frame* frame = find_frame(t)) return frame;
+    return nullptr;
+}
+
+const HistoricalCollider* LagCompensation::find(u32 tick, entt::entity entity) const {
+    const Frame* frame = find_frame(tick);
+    if (!frame) return nullptr;
+    for (const auto& c : frame->colliders)
+        if (c.entity == entity) return &c;
+    return nullptr;
+}
+
+// --- Narrow phase ---
+
+// Each test returns the entry distance along a normalized ray, or a negative
+// value on a miss. Rays starting inside a collider do not hit it.
+static float ray_box(const glm::vec3& ro, const glm::vec3& inv_rd, const glm::vec3& center, const glm::vec3& half,
+                     glm::vec3& normal) {
+    glm::vec3 t0 = (center - half - ro) * inv_rd;
+    glm::vec3 t1 = (center + half - ro) * inv_rd;
+    glm::vec3 tmin = glm::min(t0, t1), tmax = glm::max(t0, t1);
+    float enter = std::max(std::max(tmin.x, tmin.y), tmin.z);
+    float exit  = std::min(std::min(tmax.x, tmax.y), tmax.z);
+    if (enter > exit || enter < 0.0f) return -1.0f;
+
+    int axis = enter == tmin.x ? 0 : (enter == tmin.y ? 1 : 2);
+    normal = glm::vec3(0.0f);
+    normal[axis] = inv_rd[axis] > 0.0f ? -1.0f : 1.0f;
+    return enter;
+}
+
+static float ray_sphere(const glm::vec3& ro, const glm::vec3& rd, const glm::vec3& center, float radius) {
+    glm::vec3 oc = ro - center;
+    float b = glm::dot(oc, rd);
+    float c = glm::dot(oc, oc) - radius * radius;
+    float h = b * b - c;
+    if (c < 0.0f || h < 0.0f) return -1.0f;
+    float t = -b - std::sqrt(h);
+    return t >= 0.0f ? t : -1.0f;
+}
+
+static float ray_capsule(const glm::vec3& ro, const glm::vec3& rd, const glm::vec3& pa, const glm::vec3& pb,
+                         float radius) {
+    glm::vec3 ba = pb - pa, oa = ro - pa;
+    float baba = glm::dot(ba, ba);
+    float bard = glm::dot(ba, rd);
+    float baoa = glm::dot(ba, oa);
+    float rdoa = glm::dot(rd, oa);
+    float oaoa = glm::dot(oa, oa);
+
+    float a = baba - bard * bard;
+    if (baba > 1e-8f && a > 1e-6f * baba) {
+        // Cylinder body first, then whichever cap the hit fell past
+        float b = baba * rdoa - baoa * bard;
+        float c = baba * oaoa - baoa * baoa - radius * radius * baba;
+        float h = b * b - a * c;
+        if (h < 0.0f) return -1.0f;
+        float t = (-b - std::sqrt(h)) / a;
+        float y = baoa + t * bard;
+        if (y > 0.0f && y < baba) return t >= 0.0f ? t : -1.0f;
+        return ray_sphere(ro, rd, y <= 0.0f ? pa : pb, radius);
+    }
+
+    // Ray along the axis (or a degenerate capsule): nearest cap wins
+    float t0 = ray_sphere(ro, rd, pa, radius);
+    float t1 = ray_sphere(ro, rd, pb, radius);
+    if (t0 < 0.0f) return t1;
+    if (t1 < 0.0f) return t0;
+    return std::min(t0, t1);
+}
+
+static bool test_collider(const HistoricalCollider& c, const RewindRay& ray, const glm::vec3& inv_rd,
+                          RewindHit& best) {
+    glm::vec3 normal;
+    float t;
+    switch (c.shape) {
+        case HistoricalCollider::Shape::Sphere:
+            t = ray_sphere(ray.origin, ray.direction, c.center, c.extents.x);
+            if (t < 0.0f || t >= best.distance) return false;
+            normal = glm::normalize(ray.origin + ray.direction * t - c.center);
+            break;
+        case HistoricalCollider::Shape::Capsule: {
+            glm::vec3 pa = c.center - glm::vec3(0.0f, c.extents.y, 0.0f);
+            glm::vec3 pb = c.center + glm::vec3(0.0f, c.extents.y, 0.0f);
+            t = ray_capsule(ray.origin, ray.direction, pa, pb, c.extents.x);
+            if (t < 0.0f || t >= best.distance) return false;
+            glm::vec3 p = ray.origin + ray.direction * t;
+            float y = glm::clamp(p.y, pa.y, pb.y);
+            normal = glm::normalize(p - glm::vec3(c.center.x, y, c.center.z));
+            break;
+        }
+        case HistoricalCollider::Shape::Box:
+        default:
+            t = ray_box(ray.origin, inv_rd, c.center, c.extents, normal);
+            if (t < 0.0f || t >= best.distance) return false;
+            break;
+    }
+
+    best.hit      = true;
+    best.entity   = c.entity;
+    best.distance = t;
+    best.point    = ray.origin + ray.direction * t;
+    best.normal   = normal;
+    return true;
+}
+
+// --- Queries ---
+
+RewindHit LagCompensation::raycast(const RewindRay& ray) const {
+    RewindHit best;
+    best.distance = ray.max_distance;
+
+    const Frame* frame = clamp_frame(ray.tick);
+    if (!frame || ray.max_distance <= 0.0f) {
+        best.distance = 0.0f;
+        return best;
+    }
+
+    const glm::vec3& ro = ray.origin;
+    const glm::vec3& rd = ray.direction;
+    glm::vec3 inv_rd(1.0f / rd.x, 1.0f / rd.y, 1.0f / rd.z);
+
+    for (u32 i : frame->large) {
+        const auto& c = frame->colliders[i];
+        if (c.entity != ray.ignore) test_collider(c, ray, inv_rd, best);
+    }
+
+    // 3D DDA through the grid cells the ray crosses
+    glm::ivec3 cell(glm::floor(ro * inv_cell_size_));
+    glm::ivec3 step;
+    glm::vec3  t_max, t_delta;
+    for (int a = 0; a < 3; a++) {
+        if (rd[a] > 0.0f) {
+            step[a]    = 1;
+            t_max[a]   = ((cell[a] + 1) * cell_size_ - ro[a]) / rd[a];
+            t_delta[a] = cell_size_ / rd[a];
+        } else if (rd[a] < 0.0f) {
+            step[a]    = -1;
+            t_max[a]   = (cell[a] * cell_size_ - ro[a]) / rd[a];
+            t_delta[a] = -cell_size_ / rd[a];
+        } else {
+            step[a]    = 0;
+            t_max[a]   = FLT_MAX;
+            t_delta[a] = FLT_MAX;
+        }
+    }
+
+    // No walk can usefully go past the far corner of the occupied cells, which
+    // also bounds infinite or huge distances before the integer cast
+    float reach = 0.0f;
+    for (int a = 0; a < 3; a++) {
+        float lo = static_cast<float>(frame->cell_min[a]) - static_cast<float>(cell[a]);
+        float hi = static_cast<float>(frame->cell_max[a]) - static_cast<float>(cell[a]);
+        reach += std::max(std::abs(lo), std::abs(hi));
+    }
+    float steps = std::min(reach + 1.0f, ray.max_distance * inv_cell_size_ * 3.0f + 3.0f);
+    u32 max_steps = frame->bucket_items.empty() ? 0u : static_cast<u32>(std::min(steps, 4.0e9f));
+    for (u32 s = 0; s < max_steps; s++) {
+        u32 b = bucket(cell.x, cell.y, cell.z, frame->bucket_mask);
+        for (u32 k = frame->bucket_start[b]; k < frame->bucket_start[b + 1]; k++) {
+            const auto& c = frame->colliders[frame->bucket_items[k]];
+            if (c.entity != ray.ignore) test_collider(c, ray, inv_rd, best);
+        }
+
+        // Nothing in later cells can be closer than a hit already found
+        int axis = t_max.x < t_max.y ? (t_max.x < t_max.z ? 0 : 2) : (t_max.y < t_max.z ? 1 : 2);
+        float exit = t_max[axis];
+        if (best.hit && best.distance <= exit) break;
+        if (exit > ray.max_distance) break;
+
+        cell[axis]  += step[axis];
+        t_max[axis] += t_delta[axis];
+    }
+
+    if (!best.hit) best.distance = 0.0f;
+    return best;
+}
+
+void LagCompensation::raycast_batch(std::span<const RewindRay> rays, std::span<RewindHit> hits,
+                                    JobSystem* jobs) const {
+    u32 count = static_cast<u32>(std::min(rays.size(), hits.size()));
+    auto run = [&](u32 begin, u32 end) {
+        for (u32 i = begin; i < end; i++) hits[i] = raycast(rays[i]);
+    };
+    if (jobs) jobs->parallel_for(count, 32, run);
+    else      run(0, count);
+}
+
+} // namespace lumios
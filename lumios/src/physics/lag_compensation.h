@@ -0,0 +1,105 @@
+#pragma once
+
+#include "physics_components.h"
+#include <span>
+
+namespace lumios {
+
+class PhysicsWorld;
+class JobSystem;
+
+// Collider pose as it was on a past tick. Boxes are axis-aligned like in
+// PhysicsWorld, capsules are vertical; meshes and hulls are kept as their
+// bounding box.
+struct HistoricalCollider {
+    enum class Shape : u8 { Box, Sphere, Capsule };
+
+    glm::vec3    center;
+    glm::vec3    extents; // box: half extents, sphere: x = radius,
+                          // capsule: x = radius, y = half segment length
+    entt::entity entity;
+    Shape        shape;
+};
+
+struct RewindRay {
+    u32          tick;          // tick the shooter saw on screen
+    glm::vec3    origin;
+    glm::vec3    direction;     // normalized
+    float        max_distance;
+    entt::entity ignore = entt::null; // usually the shooter
+};
+
+struct RewindHit {
+    bool         hit      = false;
+    entt::entity entity   = entt::null;
+    float        distance = 0.0f;
+    glm::vec3    point{0.0f};
+    glm::vec3    normal{0.0f};
+};
+
+// Server-side lag compensation. Every tick the collider poses are stored in
+// a ring of compact frames, each with its own hashed broadphase grid, so a
+// shot can be validated against the world exactly as the shooter saw it.
+// Queries are read-only and may run concurrently; recording must not.
+class LagCompensation {
+public:
+    explicit LagCompensation(u32 history_ticks = 64) { set_history_length(history_ticks); }
+
+    // Clears the history
+    void set_history_length(u32 ticks);
+    void set_cell_size(float size) { cell_size_ = size; inv_cell_size_ = 1.0f / size; }
+
+    // Stores the current non-trigger bodies of the world for this tick
+    void record(u32 tick, const PhysicsWorld& world);
+
+    // Manual capture for servers that move colliders themselves
+    void begin_frame(u32 tick);
+    void add_collider(const HistoricalCollider& collider);
+    void end_frame();
+
+    bool has_tick(u32 tick) const { return find_frame(tick) != nullptr; }
+    u32  newest_tick() const { return newest_tick_; }
+    u32  oldest_tick() const;
+
+    // Closest hit along the ray against the colliders as of ray.tick. Ticks
+    // older than the history are clamped to the oldest one kept.
+    RewindHit raycast(const RewindRay& ray) const;
+    // Batch version, spread over the job system when one is given
+    void raycast_batch(std::span<const RewindRay> rays, std::span<RewindHit> hits, JobSystem* jobs = nullptr) const;
+
+    // Pose of one entity as of tick, or nullptr
+    const HistoricalCollider* find(u32 tick, entt::entity entity) const;
+
+private:
+    // Colliders spanning more cells than this skip the grid and are tested
+    // against every ray (terrain, large statics)
+    static constexpr u32 MAX_CELLS_PER_COLLIDER = 64;
+
+    struct Frame {
+        u32  tick  = 0;
+        bool valid = false;
+        std::vector<HistoricalCollider> colliders;
+        std::vector<u32> bucket_start; // CSR over hashed grid cells
+        std::vector<u32> bucket_items;
+        std::vector<u32> large;        // colliders outside the grid
+        u32              bucket_mask = 0;
+        glm::ivec3       cell_min{0};  // cells covered by gridded colliders
+        glm::ivec3       cell_max{-1};
+    };
+
+    const Frame* find_frame(u32 tick) const;
+    const Frame* clamp_frame(u32 tick) const;
+    void build_grid(Frame& frame);
+    u32  bucket(i32 x, i32 y, i32 z, u32 mask) const;
+
+    std::vector<Frame> frames_;
+    Frame*             recording_     = nullptr;
+    u32                newest_tick_   = 0;
+    bool               has_frames_    = false;
+    float              cell_size_     = 4.0f;
+    float              inv_cell_size_ = 0.25f;
+    std::vector<u32>   scratch_cells_;  // (bucket, collider) pairs while building
+    std::vector<u32>   scratch_cursor_;
+};
+
+} // namespace lumios
@@ -573,9 +573,10 @@ void PhysicsWorld::sync_to_scene(Scene& scene) {
     for (auto& body : bodies_) {
         if (!scene.registry().valid(body.entity)) continue;
         if (body.is_static) continue;
-        auto& t = scene.get<Transform>(body.entity);
-        t.position = body.position;
-        t.rotation = body.rotation;
+        scene.patch<Transform>(body.entity, [&](Transform& t) {
+            t.position = body.position;
+            t.rotation = body.rotation;
+        });
     }
 }
 
@@ -73,6 +73,9 @@ public:
         const std::vector<u32>*       mesh_idx   = nullptr;
     };
 
+    // Bodies as of the last sync/step, e.g. for lag compensation snapshots
+    const std::vector<BodyData>& bodies() const { return bodies_; }
+
 private:
     glm::vec3 gravity_{0.0f, -9.81f, 0.0f};
     float accumulator_    = 0.0f;
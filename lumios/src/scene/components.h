@@ -23,17 +23,38 @@ struct Transform {
     }
 };
 
+// Cached Transform::matrix(), kept by the scene: changing a Transform
+// through patch() marks it dirty and Scene::update_world_matrices()
+// recomputes every dirty one in a single batch. Never serialized.
+struct WorldMatrix {
+    glm::mat4 matrix{1.0f};
+    u32       version = 0;    // bumped on every recompute
+    bool      dirty   = true;
+};
+
 struct MeshComponent {
     MeshHandle     mesh;
     MaterialHandle material;
 };
 
+// Renderer-side cache of a mesh entity's world bounding sphere, rebuilt
+// only when the mesh or the WorldMatrix version differs from the one it
+// was computed from. Added by the renderer, never serialized.
+struct RenderBounds {
+    MeshHandle mesh;
+    u32        version = 0;
+    glm::vec3  center{0.0f};
+    float      radius = 0.0f;
+    u64        moved_frame = 0; // renderer frame the sphere last changed, casters at rest are cached
+};
+
 struct LightComponent {
     LightType type      = LightType::Point;
     glm::vec3 color     = {1.0f, 1.0f, 1.0f};
     float     intensity = 1.0f;
     float     range     = 20.0f;
     float     spot_angle = 45.0f;
+    bool      cast_shadows = true;
 };
 
 struct NameComponent {
@@ -2,6 +2,7 @@
 
 #include <entt/entt.hpp>
 #include "components.h"
+#include "world_matrix.h"
 
 namespace lumios {
 
@@ -9,6 +10,8 @@ class Scene {
     entt::registry registry_;
 
 public:
+    Scene() { connect_world_matrices(registry_); }
+
     entt::entity create_entity(const std::string& name = "") {
         auto e = registry_.create();
         registry_.emplace<Transform>(e);
@@ -31,6 +34,11 @@ public:
     template<typename T>
     const T& get(entt::entity e) const { return registry_.get<T>(e); }
 
+    // Edits a component in place and fires its update signal. Transform
+    // changes must go through here (or add/replace) to reach WorldMatrix.
+    template<typename T, typename... Func>
+    T& patch(entt::entity e, Func&&... func) { return registry_.patch<T>(e, std::forward<Func>(func)...); }
+
     template<typename T>
     bool has(entt::entity e) const { return registry_.all_of<T>(e); }
 
@@ -43,6 +51,10 @@ public:
     entt::registry&       registry()       { return registry_; }
     const entt::registry& registry() const { return registry_; }
 
+    // Called by every consumer before reading WorldMatrix; only the first
+    // call of a frame does any work
+    u32 update_world_matrices() { return lumios::update_world_matrices(registry_); }
+
     void clear() { registry_.clear(); }
 };
 
@@ -67,7 +67,8 @@ std::string SceneSerializer::serialize(const Scene& scene) {
                 {"color",      vec3_to_json(l.color)},
                 {"intensity",  l.intensity},
                 {"range",      l.range},
-                {"spot_angle", l.spot_angle}
+                {"spot_angle", l.spot_angle},
+                {"cast_shadows", l.cast_shadows}
             };
         }
 
@@ -193,6 +194,7 @@ bool SceneSerializer::deserialize(Scene& scene, const std::string& json_str) {
                 l.intensity  = lj.value("intensity", 1.0f);
                 l.range      = lj.value("range", 20.0f);
                 l.spot_angle = lj.value("spot_angle", 45.0f);
+                l.cast_shadows = lj.value("cast_shadows", true);
                 scene.add<LightComponent>(entity) = l;
             }
 
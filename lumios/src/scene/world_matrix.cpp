@@ -0,0 +1,187 @@
+#include "world_matrix.h"
+#include "components.h"
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define LUMIOS_WORLD_SSE 1
+#endif
+
+namespace lumios {
+
+namespace {
+
+// Entities marked dirty since the last update, kept in the registry context.
+// The gather arrays are reused so a steady frame allocates nothing.
+struct DirtyWorldMatrices {
+    std::vector<entt::entity>     entities;
+    std::vector<const Transform*> sources;
+    std::vector<WorldMatrix*>     targets;
+};
+
+void on_transform_construct(entt::registry& registry, entt::entity entity) {
+    registry.emplace_or_replace<WorldMatrix>(entity);
+    registry.ctx().get<DirtyWorldMatrices>().entities.push_back(entity);
+}
+
+void on_transform_update(entt::registry& registry, entt::entity entity) {
+    auto* wm = registry.try_get<WorldMatrix>(entity);
+    if (!wm || wm->dirty) return;
+    wm->dirty = true;
+    registry.ctx().get<DirtyWorldMatrices>().entities.push_back(entity);
+}
+
+void on_transform_destroy(entt::registry& registry, entt::entity entity) {
+    registry.remove<WorldMatrix>(entity);
+}
+
+// --- Scalar ---
+
+// Closed form of Transform::matrix(): T * Ry * Rx * Rz * S
+void compose(const Transform& t, glm::mat4& m) {
+    float rx = radians(t.rotation.x), ry = radians(t.rotation.y), rz = radians(t.rotation.z);
+    float sx = std::sin(rx), cx = std::cos(rx);
+    float sy = std::sin(ry), cy = std::cos(ry);
+    float sz = std::sin(rz), cz = std::cos(rz);
+
+    m[0] = glm::vec4(( cy * cz + sy * sx * sz) * t.scale.x, cx * sz * t.scale.x,
+                     (-sy * cz + cy * sx * sz) * t.scale.x, 0.0f);
+    m[1] = glm::vec4((-cy * sz + sy * sx * cz) * t.scale.y, cx * cz * t.scale.y,
+                     ( sy * sz + cy * sx * cz) * t.scale.y, 0.0f);
+    m[2] = glm::vec4(sy * cx * t.scale.z, -sx * t.scale.z, cy * cx * t.scale.z, 0.0f);
+    m[3] = glm::vec4(t.position, 1.0f);
+}
+
+#if defined(LUMIOS_WORLD_SSE)
+
+// --- SSE ---
+
+// Sine and cosine of four angles in radians: reduction by pi/2 in three
+// Cody-Waite steps, then the Cephes minimax polynomials on [-pi/4, pi/4].
+// Good to a couple of ulp for the angles a Transform holds.
+inline void sincos4(__m128 x, __m128& s, __m128& c) {
+    __m128i q  = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(0.63661977236758134f))); // round(x * 2/pi)
+    __m128  qf = _mm_cvtepi32_ps(q);
+
+    __m128 r = _mm_sub_ps(x, _mm_mul_ps(qf, _mm_set1_ps(1.5703125f)));
+    r = _mm_sub_ps(r, _mm_mul_ps(qf, _mm_set1_ps(4.837512969970703125e-4f)));
+    r = _mm_sub_ps(r, _mm_mul_ps(qf, _mm_set1_ps(7.54978995489188216e-8f)));
+    __m128 r2 = _mm_mul_ps(r, r);
+
+    __m128 ps = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-1.9515295891e-4f), r2), _mm_set1_ps(8.3321608736e-3f));
+    ps = _mm_add_ps(_mm_mul_ps(ps, r2), _mm_set1_ps(-1.6666654611e-1f));
+    ps = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ps, r2), r), r);
+
+    __m128 pc = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.443315711809948e-5f), r2), _mm_set1_ps(-1.388731625493765e-3f));
+    pc = _mm_add_ps(_mm_mul_ps(pc, r2), _mm_set1_ps(4.166664568298827e-2f));
+    pc = _mm_mul_ps(_mm_mul_ps(pc, r2), r2);
+    pc = _mm_add_ps(_mm_sub_ps(pc, _mm_mul_ps(r2, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+    // Odd quadrants swap the two, bit 1 of q (of q + 1) flips the sine (cosine)
+    __m128i one  = _mm_set1_epi32(1);
+    __m128i two  = _mm_set1_epi32(2);
+    __m128  swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, one), one));
+    __m128  sign_s = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, two), 30));
+    __m128  sign_c = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(q, one), two), 30));
+
+    s = _mm_or_ps(_mm_and_ps(swap, pc), _mm_andnot_ps(swap, ps));
+    c = _mm_or_ps(_mm_and_ps(swap, ps), _mm_andnot_ps(swap, pc));
+    s = _mm_xor_ps(s, sign_s);
+    c = _mm_xor_ps(c, sign_c);
+}
+
+// Four transforms at once: the gather turns them into one register per
+// field, the compose runs lane-wise and a 4x4 transpose per column turns
+// the lanes back into matrices.
+void compose4(const Transform* const* src, WorldMatrix* const* dst) {
+    alignas(16) float f[9][4];
+    for (int i = 0; i < 4; i++) {
+        const Transform& t = *src[i];
+        f[0][i] = t.position.x; f[1][i] = t.position.y; f[2][i] = t.position.z;
+        f[3][i] = t.rotation.x; f[4][i] = t.rotation.y; f[5][i] = t.rotation.z;
+        f[6][i] = t.scale.x;    f[7][i] = t.scale.y;    f[8][i] = t.scale.z;
+    }
+
+    __m128 to_rad = _mm_set1_ps(DEG2RAD);
+    __m128 sx, cx, sy, cy, sz, cz;
+    sincos4(_mm_mul_ps(_mm_load_ps(f[3]), to_rad), sx, cx);
+    sincos4(_mm_mul_ps(_mm_load_ps(f[4]), to_rad), sy, cy);
+    sincos4(_mm_mul_ps(_mm_load_ps(f[5]), to_rad), sz, cz);
+
+    __m128 scale_x = _mm_load_ps(f[6]);
+    __m128 scale_y = _mm_load_ps(f[7]);
+    __m128 scale_z = _mm_load_ps(f[8]);
+    __m128 sxsz = _mm_mul_ps(sx, sz);
+    __m128 sxcz = _mm_mul_ps(sx, cz);
+
+    __m128 col[4][4];
+    col[0][0] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(cy, cz), _mm_mul_ps(sy, sxsz)), scale_x);
+    col[0][1] = _mm_mul_ps(_mm_mul_ps(cx, sz), scale_x);
+    col[0][2] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(cy, sxsz), _mm_mul_ps(sy, cz)), scale_x);
+    col[0][3] = _mm_setzero_ps();
+
+    col[1][0] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(sy, sxcz), _mm_mul_ps(cy, sz)), scale_y);
+    col[1][1] = _mm_mul_ps(_mm_mul_ps(cx, cz), scale_y);
+    col[1][2] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(sy, sz), _mm_mul_ps(cy, sxcz)), scale_y);
+    col[1][3] = _mm_setzero_ps();
+
+    col[2][0] = _mm_mul_ps(_mm_mul_ps(sy, cx), scale_z);
+    col[2][1] = _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), sx), scale_z);
+    col[2][2] = _mm_mul_ps(_mm_mul_ps(cy, cx), scale_z);
+    col[2][3] = _mm_setzero_ps();
+
+    col[3][0] = _mm_load_ps(f[0]);
+    col[3][1] = _mm_load_ps(f[1]);
+    col[3][2] = _mm_load_ps(f[2]);
+    col[3][3] = _mm_set1_ps(1.0f);
+
+    for (int c = 0; c < 4; c++) {
+        _MM_TRANSPOSE4_PS(col[c][0], col[c][1], col[c][2], col[c][3]);
+        for (int i = 0; i < 4; i++) _mm_storeu_ps(&dst[i]->matrix[c][0], col[c][i]);
+    }
+}
+
+#endif
+
+} // namespace
+
+void connect_world_matrices(entt::registry& registry) {
+    registry.ctx().emplace<DirtyWorldMatrices>();
+    registry.on_construct<Transform>().connect<&on_transform_construct>();
+    registry.on_update<Transform>().connect<&on_transform_update>();
+    registry.on_destroy<Transform>().connect<&on_transform_destroy>();
+}
+
+u32 update_world_matrices(entt::registry& registry) {
+    auto& dirty = registry.ctx().get<DirtyWorldMatrices>();
+    if (dirty.entities.empty()) return 0;
+
+    // Entities can be destroyed, or marked twice by a re-emplaced Transform,
+    // after they were queued
+    dirty.sources.clear();
+    dirty.targets.clear();
+    for (auto entity : dirty.entities) {
+        if (!registry.valid(entity)) continue;
+        auto* wm = registry.try_get<WorldMatrix>(entity);
+        auto* t  = registry.try_get<Transform>(entity);
+        if (!wm || !t || !wm->dirty) continue;
+        wm->dirty = false;
+        wm->version++;
+        dirty.sources.push_back(t);
+        dirty.targets.push_back(wm);
+    }
+    dirty.entities.clear();
+
+    u32 count = (u32)dirty.targets.size();
+    u32 i = 0;
+
+#if defined(LUMIOS_WORLD_SSE)
+    for (; i + 4 <= count; i += 4) compose4(&dirty.sources[i], &dirty.targets[i]);
+#endif
+    for (; i < count; i++) compose(*dirty.sources[i], dirty.targets[i]->matrix);
+
+    return count;
+}
+
+} // namespace lumios
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <entt/entt.hpp>
+#include "../defines.h"
+#include "../core/types.h"
+
+namespace lumios {
+
+// Keeps a WorldMatrix next to every Transform: emplacing a Transform adds a
+// dirty one, registry.patch<Transform>() / replace() mark it dirty again.
+// Writes through a plain get<Transform>() reference go unnoticed.
+LUMIOS_API void connect_world_matrices(entt::registry& registry);
+
+// Recomputes every dirty WorldMatrix, four at a time with SSE where
+// available. Returns how many were rebuilt; nearly free when none changed.
+LUMIOS_API u32 update_world_matrices(entt::registry& registry);
+
+} // namespace lumios
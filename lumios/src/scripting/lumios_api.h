@@ -68,19 +68,21 @@ struct ScriptContext {
     float dt() const { return delta_time; }
 
     // --- Transform helpers ---
-    Transform& transform() { return scene.get<Transform>(entity); }
+    // Mutable access counts as a change and re-dirties the world matrix;
+    // the getters below read without touching it
+    Transform& transform() { return scene.patch<Transform>(entity); }
 
-    glm::vec3 position() { return transform().position; }
+    glm::vec3 position() { return scene.get<Transform>(entity).position; }
     void set_position(const glm::vec3& p) { transform().position = p; }
 
-    glm::vec3 rotation() { return transform().rotation; }
+    glm::vec3 rotation() { return scene.get<Transform>(entity).rotation; }
     void set_rotation(const glm::vec3& r) { transform().rotation = r; }
 
-    glm::vec3 get_scale() { return transform().scale; }
+    glm::vec3 get_scale() { return scene.get<Transform>(entity).scale; }
     void set_scale(const glm::vec3& s) { transform().scale = s; }
 
     glm::vec3 get_forward() {
-        auto& r = transform().rotation;
+        const auto& r = scene.get<Transform>(entity).rotation;
         float yaw = glm::radians(r.y), pitch = glm::radians(r.x);
         return glm::normalize(glm::vec3(
             cos(yaw) * cos(pitch), sin(pitch), sin(yaw) * cos(pitch)));
@@ -0,0 +1,30 @@
+#version 450
+
+// Next smaller bloom level: 13 bilinear taps over the 6x6 source texels
+// around this one, as four overlapping 4x4 boxes and a center box, which
+// holds up better under motion than a plain 2x2 average.
+
+layout(location = 0) in vec2 fragUV;
+layout(location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform sampler2D srcTex;
+
+vec3 tap(vec2 offset, vec2 texel) {
+    return texture(srcTex, fragUV + offset * texel).rgb;
+}
+
+void main() {
+    vec2 t = 1.0 / vec2(textureSize(srcTex, 0));
+
+    vec3 a = tap(vec2(-2.0, -2.0), t), b = tap(vec2(0.0, -2.0), t), c = tap(vec2(2.0, -2.0), t);
+    vec3 d = tap(vec2(-2.0,  0.0), t), e = tap(vec2(0.0,  0.0), t), f = tap(vec2(2.0,  0.0), t);
+    vec3 g = tap(vec2(-2.0,  2.0), t), h = tap(vec2(0.0,  2.0), t), i = tap(vec2(2.0,  2.0), t);
+    vec3 j = tap(vec2(-1.0, -1.0), t), k = tap(vec2(1.0, -1.0), t);
+    vec3 l = tap(vec2(-1.0,  1.0), t), m = tap(vec2(1.0,  1.0), t);
+
+    vec3 color = e * 0.125
+               + (a + c + g + i) * 0.03125
+               + (b + d + f + h) * 0.0625
+               + (j + k + l + m) * 0.125;
+    outColor = vec4(color, 1.0);
+}
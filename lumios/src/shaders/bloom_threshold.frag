@@ -1,5 +1,10 @@
 #version 450
 
+// First level of the bloom pyramid: the HDR image at half resolution with
+// everything below the threshold taken out. Four bilinear taps cover the
+// 4x4 source texels around this one; weighting them by inverse luminance
+// (a Karis average) keeps single very bright pixels from flickering.
+
 layout(location = 0) in vec2 fragUV;
 layout(location = 0) out vec4 outColor;
 
@@ -7,13 +12,28 @@ layout(set = 0, binding = 0) uniform sampler2D hdrInput;
 
 layout(push_constant) uniform PC {
     float threshold;
+    float knee; // half width of the soft transition around the threshold
 } params;
 
+vec3 prefilter(vec3 color) {
+    float brightness = max(color.r, max(color.g, color.b));
+    float soft = clamp(brightness - params.threshold + params.knee, 0.0, 2.0 * params.knee);
+    soft = soft * soft / (4.0 * params.knee + 1e-4);
+    return color * max(soft, brightness - params.threshold) / max(brightness, 1e-4);
+}
+
 void main() {
-    vec3 color = texture(hdrInput, fragUV).rgb;
-    float brightness = dot(color, vec3(0.2126, 0.7152, 0.0722));
-    if (brightness > params.threshold)
-        outColor = vec4(color, 1.0);
-    else
-        outColor = vec4(0.0, 0.0, 0.0, 1.0);
+    vec2 texel = 1.0 / vec2(textureSize(hdrInput, 0));
+
+    vec3  sum    = vec3(0.0);
+    float weight = 0.0;
+    for (int i = 0; i < 4; i++) {
+        vec2  offset = vec2((i & 1) * 2 - 1, (i >> 1) * 2 - 1) * texel;
+        vec3  color  = min(texture(hdrInput, fragUV + offset).rgb, vec3(65000.0));
+        float w      = 1.0 / (1.0 + dot(color, vec3(0.2126, 0.7152, 0.0722)));
+        sum    += color * w;
+        weight += w;
+    }
+
+    outColor = vec4(prefilter(sum / weight), 1.0);
 }
@@ -0,0 +1,186 @@
+// Clustered PBR lighting with shadows, shared by the mesh fragment shaders.
+// Set 0 bindings 1 and 4-7; the includer declares GlobalUBO (binding 0)
+// as `global` first.
+
+struct Light {
+    vec4 position;
+    vec4 color;
+    vec4 direction;
+    vec4 params;     // x=range, y=spot_cos, z=type, w=first shadow view or -1
+};
+
+// Clustered lights, see LightClusters: the view frustum is cut into
+// size.x * size.y screen tiles by size.z exponential depth slices, and
+// lists holds an (offset, count) pair per froxel followed by the light
+// indices they point into. Directional lights lead the light array and
+// apply everywhere.
+layout(set = 0, binding = 1) uniform LightGrid {
+    uvec4 size;  // tiles x, tiles y, depth slices, directional lights
+    vec4  depth; // near, far, scale, bias: slice = log(view depth) * scale + bias
+} grid;
+
+layout(std430, set = 0, binding = 4) readonly buffer LightBuffer {
+    Light lights[];
+};
+
+layout(std430, set = 0, binding = 5) readonly buffer ClusterLists {
+    uint lists[];
+};
+
+// Shadow maps, see ShadowMaps: every view is a square tile of one depth
+// atlas. Cascades of the sun come first, point lights use six views
+// (+X -X +Y -Y +Z -Z) and spot lights one.
+struct ShadowView {
+    mat4 view_projection;
+    vec4 rect; // atlas uv, offset xy and scale zw
+    vec4 bias; // x = normal offset in world units, per unit of light distance when y = 1
+};
+
+layout(set = 0, binding = 6) uniform Shadows {
+    vec4       splits;    // view depth each cascade ends at
+    vec4       params;    // x = cascades, y = atlas texel size in uv
+    ShadowView views[52]; // ShadowMaps::MAX_VIEWS
+} shadows;
+
+layout(set = 0, binding = 7) uniform sampler2DShadow shadow_atlas;
+
+const float PI = 3.14159265359;
+
+float distribution_ggx(vec3 N, vec3 H, float roughness) {
+    float a  = roughness * roughness;
+    float a2 = a * a;
+    float NdotH  = max(dot(N, H), 0.0);
+    float NdotH2 = NdotH * NdotH;
+
+    float denom = (NdotH2 * (a2 - 1.0) + 1.0);
+    denom = PI * denom * denom;
+    return a2 / max(denom, 0.0001);
+}
+
+float geometry_schlick_ggx(float NdotV, float roughness) {
+    float r = roughness + 1.0;
+    float k = (r * r) / 8.0;
+    return NdotV / (NdotV * (1.0 - k) + k);
+}
+
+float geometry_smith(vec3 N, vec3 V, vec3 L, float roughness) {
+    float NdotV = max(dot(N, V), 0.0);
+    float NdotL = max(dot(N, L), 0.0);
+    return geometry_schlick_ggx(NdotV, roughness) * geometry_schlick_ggx(NdotL, roughness);
+}
+
+vec3 fresnel_schlick(float cosTheta, vec3 F0) {
+    return F0 + (1.0 - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
+}
+
+// 3x3 taps of the hardware 2x2 compare filter, kept inside the view's tile
+float sample_shadow(uint view, vec3 P, vec3 N, float light_distance) {
+    ShadowView sv = shadows.views[view];
+    float offset  = sv.bias.x * (sv.bias.y > 0.0 ? light_distance : 1.0);
+    vec4  clip    = sv.view_projection * vec4(P + N * offset, 1.0);
+    if (clip.w <= 0.0) return 1.0;
+    vec3 ndc = clip.xyz / clip.w;
+    if (any(greaterThan(abs(ndc.xy), vec2(1.0))) || ndc.z >= 1.0) return 1.0;
+
+    float texel = shadows.params.y;
+    vec2  lo    = sv.rect.xy + 1.5 * texel;
+    vec2  hi    = sv.rect.xy + sv.rect.zw - 1.5 * texel;
+    vec2  uv    = sv.rect.xy + (ndc.xy * 0.5 + 0.5) * sv.rect.zw;
+    float lit   = 0.0;
+    for (int y = -1; y <= 1; y++)
+        for (int x = -1; x <= 1; x++)
+            lit += texture(shadow_atlas, vec3(clamp(uv + vec2(x, y) * texel, lo, hi), ndc.z));
+    return lit / 9.0;
+}
+
+float shadow_of(Light light, vec3 P, vec3 N) {
+    int first = int(light.params.w);
+    if (first < 0) return 1.0;
+
+    int type = int(light.params.z);
+    if (type == 0) {
+        float depth = -(global.view * vec4(P, 1.0)).z;
+        for (int c = 0; c < int(shadows.params.x); c++)
+            if (depth < shadows.splits[c]) return sample_shadow(uint(c), P, N, 1.0);
+        return 1.0;
+    }
+
+    vec3  d    = P - light.position.xyz;
+    float dist = length(d);
+    if (type == 2) return sample_shadow(uint(first), P, N, dist);
+
+    // Cube face of the major axis
+    vec3 a = abs(d);
+    uint face = a.x >= a.y && a.x >= a.z ? (d.x >= 0.0 ? 0u : 1u)
+              : a.y >= a.z               ? (d.y >= 0.0 ? 2u : 3u)
+                                         : (d.z >= 0.0 ? 4u : 5u);
+    return sample_shadow(uint(first) + face, P, N, dist);
+}
+
+vec3 shade(Light light, vec3 P, vec3 N, vec3 V, vec3 albedo, float metallic, float roughness, vec3 F0) {
+    int   type  = int(light.params.z);
+    float intensity = light.color.a;
+
+    vec3  L;
+    float atten = 1.0;
+
+    if (type == 0) {
+        L = normalize(-light.direction.xyz);
+    } else {
+        vec3  toLight = light.position.xyz - P;
+        float dist    = length(toLight);
+        L = toLight / dist;
+        float range = light.params.x;
+        atten = clamp(1.0 - (dist * dist) / (range * range), 0.0, 1.0);
+        atten *= atten;
+
+        if (type == 2) {
+            float cosA = dot(L, normalize(-light.direction.xyz));
+            float cosOuter = light.params.y;
+            atten *= clamp((cosA - cosOuter) / (1.0 - cosOuter), 0.0, 1.0);
+        }
+    }
+
+    if (atten > 0.0) atten *= shadow_of(light, P, N);
+
+    vec3 H = normalize(V + L);
+    vec3 radiance = light.color.rgb * intensity * atten;
+
+    float NDF = distribution_ggx(N, H, roughness);
+    float G   = geometry_smith(N, V, L, roughness);
+    vec3  F   = fresnel_schlick(max(dot(H, V), 0.0), F0);
+
+    vec3 numerator    = NDF * G * F;
+    float denominator = 4.0 * max(dot(N, V), 0.0) * max(dot(N, L), 0.0) + 0.0001;
+    vec3 specular     = numerator / denominator;
+
+    vec3 kS = F;
+    vec3 kD = (vec3(1.0) - kS) * (1.0 - metallic);
+
+    float NdotL = max(dot(N, L), 0.0);
+    return (kD * albedo / PI + specular) * radiance * NdotL;
+}
+
+uint cluster_of(vec3 world_pos) {
+    vec4 view_pos = global.view * vec4(world_pos, 1.0);
+    vec4 clip     = global.projection * view_pos;
+    vec2 tiles    = vec2(grid.size.xy);
+    uvec2 tile    = uvec2(clamp((clip.xy / clip.w * 0.5 + 0.5) * tiles, vec2(0.0), tiles - 1.0));
+    float slice   = log(max(-view_pos.z, grid.depth.x)) * grid.depth.z + grid.depth.w;
+    uint  z       = uint(clamp(slice, 0.0, float(grid.size.z - 1u)));
+    return (z * grid.size.y + tile.y) * grid.size.x + tile.x;
+}
+
+// Every directional light, then the lights of the froxel P falls in
+vec3 direct_lighting(vec3 P, vec3 N, vec3 V, vec3 albedo, float metallic, float roughness, vec3 F0) {
+    vec3 Lo = vec3(0.0);
+    for (uint i = 0u; i < grid.size.w; i++)
+        Lo += shade(lights[i], P, N, V, albedo, metallic, roughness, F0);
+
+    uint cluster = cluster_of(P);
+    uint first   = 2u * grid.size.x * grid.size.y * grid.size.z + lists[2u * cluster];
+    uint count   = lists[2u * cluster + 1u];
+    for (uint i = 0u; i < count; i++)
+        Lo += shade(lights[lists[first + i]], P, N, V, albedo, metallic, roughness, F0);
+    return Lo;
+}
@@ -0,0 +1,50 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform GlobalUBO {
+    mat4 view;
+    mat4 projection;
+    vec4 camera_pos;
+    vec4 ambient_color;
+    int  num_lights;
+} global;
+
+struct Instance {
+    mat4 model;
+    uint material;
+    uint batch;
+    vec4 sphere;
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer InstanceBuffer {
+    Instance instances[];
+};
+
+// Instance ids that survived cull.comp, grouped per draw command
+layout(std430, set = 0, binding = 3) readonly buffer VisibleInstances {
+    uint visible[];
+};
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inUV;
+layout(location = 3) in vec4 inColor;
+
+layout(location = 0) out vec3 fragWorldPos;
+layout(location = 1) out vec3 fragNormal;
+layout(location = 2) out vec2 fragUV;
+layout(location = 3) out vec4 fragColor;
+layout(location = 4) flat out uint fragMaterial; // read by mesh_indirect.frag only
+
+void main() {
+    // gl_InstanceIndex includes the draw's firstInstance
+    Instance inst = instances[visible[gl_InstanceIndex]];
+
+    vec4 worldPos = inst.model * vec4(inPosition, 1.0);
+    gl_Position   = global.projection * global.view * worldPos;
+
+    fragWorldPos = worldPos.xyz;
+    fragNormal   = mat3(transpose(inverse(inst.model))) * inNormal;
+    fragUV       = inUV;
+    fragColor    = inColor;
+    fragMaterial = inst.material;
+}
@@ -0,0 +1,57 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(set = 0, binding = 0) uniform GlobalUBO {
+    mat4 view;
+    mat4 projection;
+    vec4 camera_pos;
+    vec4 ambient_color;
+    int  num_lights;
+} global;
+
+#include "lighting.glsl"
+
+struct Material {
+    vec4  base_color;
+    float metallic;
+    float roughness;
+    float ao;
+    uint  albedo;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer MaterialTable {
+    Material materials[];
+};
+
+layout(set = 1, binding = 1) uniform sampler2D textures[];
+
+layout(location = 0) in vec3 fragWorldPos;
+layout(location = 1) in vec3 fragNormal;
+layout(location = 2) in vec2 fragUV;
+layout(location = 3) in vec4 fragColor;
+layout(location = 4) flat in uint fragMaterial;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    vec3 N = normalize(fragNormal);
+    vec3 V = normalize(global.camera_pos.xyz - fragWorldPos);
+
+    // Instances of one indirect draw may use different materials
+    Material material = materials[fragMaterial];
+    vec4 albedo_raw = texture(textures[nonuniformEXT(material.albedo)], fragUV) * material.base_color * fragColor;
+    vec3 albedo = albedo_raw.rgb;
+    float metallic  = material.metallic;
+    float roughness = max(material.roughness, 0.04);
+    float ao        = material.ao;
+
+    vec3 F0 = mix(vec3(0.04), albedo, metallic);
+
+    vec3 Lo = direct_lighting(fragWorldPos, N, V, albedo, metallic, roughness, F0);
+
+    vec3 ambient = global.ambient_color.rgb * global.ambient_color.a * albedo * ao;
+    vec3 color   = ambient + Lo;
+
+    outColor = vec4(color, albedo_raw.a);
+}
@@ -5,8 +5,10 @@ layout(location = 1) in vec2 fragUV;
 
 layout(location = 0) out vec4 outColor;
 
+// Premultiplied for additive blending, which needs no sorting of the
+// alive list
 void main() {
     float dist = length(fragUV - vec2(0.5));
-    float alpha = 1.0 - smoothstep(0.3, 0.5, dist);
-    outColor = vec4(fragColor.rgb, fragColor.a * alpha);
+    float alpha = fragColor.a * (1.0 - smoothstep(0.3, 0.5, dist));
+    outColor = vec4(fragColor.rgb * alpha, alpha);
 }
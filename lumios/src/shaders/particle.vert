@@ -1,7 +1,10 @@
 #version 450
 
+// Camera-facing quads, one instance per entry of the alive list that
+// particle.comp filled; drawn indirectly with its instance count.
+
 struct Particle {
-    vec4 position; // xyz = pos, w = life
+    vec4 position; // xyz = pos, w = remaining life
     vec4 velocity; // xyz = vel, w = size
     vec4 color;
 };
@@ -10,11 +13,14 @@ layout(std430, set = 0, binding = 0) readonly buffer ParticleBuffer {
     Particle particles[];
 };
 
-layout(set = 0, binding = 1) uniform CameraUBO {
-    mat4 view;
-    mat4 projection;
-    vec3 camera_right;
-    vec3 camera_up;
+layout(std430, set = 0, binding = 2) readonly buffer AliveList {
+    uint alive[];
+};
+
+layout(push_constant) uniform PC {
+    mat4 view_projection;
+    vec4 camera_right;
+    vec4 camera_up;
 } cam;
 
 layout(location = 0) out vec4 fragColor;
@@ -26,23 +32,16 @@ const vec2 quad_verts[6] = vec2[](
 );
 
 void main() {
-    uint particle_idx = gl_VertexIndex / 6;
-    uint vert_idx     = gl_VertexIndex % 6;
-
-    Particle p = particles[particle_idx];
-    if (p.position.w <= 0.0) {
-        gl_Position = vec4(0.0);
-        return;
-    }
+    Particle p = particles[alive[gl_InstanceIndex]];
 
-    vec2 offset = quad_verts[vert_idx];
+    vec2 offset = quad_verts[gl_VertexIndex];
     float size  = p.velocity.w;
 
     vec3 world_pos = p.position.xyz
-        + cam.camera_right * offset.x * size
-        + cam.camera_up    * offset.y * size;
+        + cam.camera_right.xyz * offset.x * size
+        + cam.camera_up.xyz    * offset.y * size;
 
-    gl_Position = cam.projection * cam.view * vec4(world_pos, 1.0);
+    gl_Position = cam.view_projection * vec4(world_pos, 1.0);
     fragColor = p.color;
     fragUV    = offset + 0.5;
 }
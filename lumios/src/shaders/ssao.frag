@@ -1,58 +1,63 @@
 #version 450
 
+// Ambient occlusion from the depth buffer alone, at a fraction of its
+// resolution. View-space positions are rebuilt from depth and the
+// projection terms, normals from their screen-space derivatives. The
+// kernel is turned per pixel by interleaved gradient noise, which
+// ssao_blur.frag averages away.
+
 layout(location = 0) in vec2 fragUV;
 layout(location = 0) out float outAO;
 
 layout(set = 0, binding = 0) uniform sampler2D depthTex;
-layout(set = 0, binding = 1) uniform sampler2D noiseTex;
 
-layout(set = 0, binding = 2) uniform SSAOParams {
-    mat4 projection;
-    mat4 view;
-    vec4 samples[64];
-    vec2 noise_scale;
+layout(set = 0, binding = 4) uniform Kernel {
+    vec4 samples[64]; // hemisphere around +Z, denser near the center
+} kernel;
+
+layout(push_constant) uniform PC {
+    vec4  projection; // P[0][0], P[1][1], P[2][2], P[3][2]
     float radius;
     float bias;
-    int kernel_size;
+    int   kernel_size;
 } params;
 
-vec3 reconstruct_position(vec2 uv, float depth) {
-    vec4 clip = vec4(uv * 2.0 - 1.0, depth, 1.0);
-    vec4 view_pos = inverse(params.projection) * clip;
-    return view_pos.xyz / view_pos.w;
+float view_z(float depth) {
+    return -params.projection.w / (depth + params.projection.z);
+}
+
+// The main pass flips Y through a negative viewport height, so rows run
+// top to bottom while NDC y points up
+vec3 view_position(vec2 uv, float depth) {
+    float z   = view_z(depth);
+    vec2  ndc = vec2(uv.x * 2.0 - 1.0, 1.0 - uv.y * 2.0);
+    return vec3(ndc / params.projection.xy * -z, z);
 }
 
 void main() {
-    float depth = texture(depthTex, fragUV).r;
+    // Derivatives before any pixel of the quad leaves
+    float depth  = textureLod(depthTex, fragUV, 0.0).r;
+    vec3  pos    = view_position(fragUV, depth);
+    vec3  normal = normalize(cross(dFdy(pos), dFdx(pos)));
     if (depth >= 1.0) { outAO = 1.0; return; }
 
-    vec3 frag_pos = reconstruct_position(fragUV, depth);
-    vec3 noise = texture(noiseTex, fragUV * params.noise_scale).xyz * 2.0 - 1.0;
-
-    // Approximate normal from depth
-    vec3 dFdxPos = dFdx(frag_pos);
-    vec3 dFdyPos = dFdy(frag_pos);
-    vec3 normal = normalize(cross(dFdxPos, dFdyPos));
-
-    vec3 tangent   = normalize(noise - normal * dot(noise, normal));
-    vec3 bitangent = cross(normal, tangent);
-    mat3 TBN       = mat3(tangent, bitangent, normal);
+    float angle     = 6.2831853 * fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+    vec3  random    = vec3(cos(angle), sin(angle), 0.0);
+    vec3  tangent   = normalize(random - normal * dot(random, normal));
+    vec3  bitangent = cross(normal, tangent);
+    mat3  TBN       = mat3(tangent, bitangent, normal);
 
     float occlusion = 0.0;
     for (int i = 0; i < params.kernel_size; i++) {
-        vec3 sample_pos = TBN * params.samples[i].xyz;
-        sample_pos = frag_pos + sample_pos * params.radius;
-
-        vec4 offset = params.projection * vec4(sample_pos, 1.0);
-        offset.xyz /= offset.w;
-        offset.xyz  = offset.xyz * 0.5 + 0.5;
+        vec3 sample_pos = pos + TBN * kernel.samples[i].xyz * params.radius;
 
-        float sample_depth = texture(depthTex, offset.xy).r;
-        vec3 sampled_pos = reconstruct_position(offset.xy, sample_depth);
+        vec2  ndc      = params.projection.xy * sample_pos.xy / -sample_pos.z;
+        vec2  uv       = vec2(ndc.x * 0.5 + 0.5, 0.5 - ndc.y * 0.5);
+        float sample_z = view_z(textureLod(depthTex, uv, 0.0).r);
 
-        float range_check = smoothstep(0.0, 1.0, params.radius / abs(frag_pos.z - sampled_pos.z));
-        occlusion += (sampled_pos.z >= sample_pos.z + params.bias ? 1.0 : 0.0) * range_check;
+        float range_check = smoothstep(0.0, 1.0, params.radius / abs(pos.z - sample_z));
+        occlusion += (sample_z >= sample_pos.z + params.bias ? 1.0 : 0.0) * range_check;
     }
 
-    outAO = 1.0 - (occlusion / float(params.kernel_size));
+    outAO = 1.0 - occlusion / float(params.kernel_size);
 }
@@ -0,0 +1,35 @@
+#version 450
+
+// 4x4 blur of the raw occlusion, the size of the noise pattern ssao.frag
+// leaves. Taps whose depth is far from this pixel's are dropped, so
+// occlusion does not bleed across silhouettes.
+
+layout(location = 0) in vec2 fragUV;
+layout(location = 0) out float outAO;
+
+layout(set = 0, binding = 0) uniform sampler2D aoTex;
+layout(set = 0, binding = 1) uniform sampler2D depthTex; // full resolution
+
+layout(push_constant) uniform PC {
+    vec4 projection; // P[0][0], P[1][1], P[2][2], P[3][2]
+} params;
+
+float linear_depth(vec2 uv) {
+    return params.projection.w / (textureLod(depthTex, uv, 0.0).r + params.projection.z);
+}
+
+void main() {
+    vec2  texel  = 1.0 / vec2(textureSize(aoTex, 0));
+    float center = linear_depth(fragUV);
+
+    float sum = 0.0, weight = 0.0;
+    for (int y = -2; y < 2; y++) {
+        for (int x = -2; x < 2; x++) {
+            vec2  uv = fragUV + (vec2(x, y) + 0.5) * texel;
+            float w  = abs(linear_depth(uv) - center) <= 0.1 * center ? 1.0 : 0.0;
+            sum    += textureLod(aoTex, uv, 0.0).r * w;
+            weight += w;
+        }
+    }
+    outAO = weight > 0.0 ? sum / weight : textureLod(aoTex, fragUV, 0.0).r;
+}
@@ -1,14 +1,23 @@
 #version 450
 
+// Resolves the HDR image onto the swapchain: ambient occlusion and bloom
+// applied, then exposure and ACES. Gamma is 1 for sRGB targets, which
+// encode on write.
+
 layout(location = 0) in vec2 fragUV;
 layout(location = 0) out vec4 outColor;
 
 layout(set = 0, binding = 0) uniform sampler2D hdrInput;
 layout(set = 0, binding = 1) uniform sampler2D bloomInput;
+layout(set = 0, binding = 2) uniform sampler2D aoInput;  // reduced resolution
+layout(set = 0, binding = 3) uniform sampler2D depthTex; // full resolution
 
 layout(push_constant) uniform PC {
     float exposure;
     float bloom_strength;
+    float ao_strength;
+    float gamma;
+    vec2  depth_params; // P[2][2], P[3][2]
 } params;
 
 vec3 aces_tonemap(vec3 x) {
@@ -20,17 +29,43 @@ vec3 aces_tonemap(vec3 x) {
     return clamp((x * (a * x + b)) / (x * (c * x + d) + e), 0.0, 1.0);
 }
 
+float linear_depth(vec2 uv) {
+    return params.depth_params.y / (textureLod(depthTex, uv, 0.0).r + params.depth_params.x);
+}
+
+// Joint bilateral upsample: the four low-resolution texels around this
+// pixel, weighted bilinearly and by how close their depth is to its own
+float upsampled_ao() {
+    vec2  size   = vec2(textureSize(aoInput, 0));
+    vec2  pos    = fragUV * size - 0.5;
+    vec2  base   = floor(pos);
+    vec2  f      = pos - base;
+    float center = linear_depth(fragUV);
+
+    float sum = 0.0, weight = 0.0;
+    for (int i = 0; i < 4; i++) {
+        vec2  corner   = vec2(i & 1, i >> 1);
+        vec2  uv       = (base + corner + 0.5) / size;
+        vec2  bilinear = mix(1.0 - f, f, corner);
+        float w        = bilinear.x * bilinear.y / (1e-3 + abs(linear_depth(uv) - center) / center);
+        sum    += textureLod(aoInput, uv, 0.0).r * w;
+        weight += w;
+    }
+    return weight > 0.0 ? sum / weight : 1.0;
+}
+
 void main() {
     vec3 hdr = texture(hdrInput, fragUV).rgb;
-    vec3 bloom = texture(bloomInput, fragUV).rgb;
 
-    hdr += bloom * params.bloom_strength;
+    // A strength of 0 means the effect is off and its input is a stand-in
+    if (params.ao_strength > 0.0)
+        hdr *= mix(1.0, upsampled_ao(), params.ao_strength);
+    if (params.bloom_strength > 0.0)
+        hdr += texture(bloomInput, fragUV).rgb * params.bloom_strength;
     hdr *= params.exposure;
 
     vec3 mapped = aces_tonemap(hdr);
-
-    // Gamma correction
-    mapped = pow(mapped, vec3(1.0 / 2.2));
+    mapped = pow(mapped, vec3(params.gamma));
 
     outColor = vec4(mapped, 1.0);
 }
@@ -1,5 +1,8 @@
 #version 450
 
+// One triangle covering the screen, for the tonemap and every other
+// fullscreen post pass; draw with 3 vertices and no vertex buffer
+
 layout(location = 0) out vec2 fragUV;
 
 void main() {
@@ -0,0 +1,516 @@
+// Micro-benchmarks for the networking stack. Run without arguments for all
+// suites or pass a suite name to run just one.
+
+#include "networking/interest_manager.h"
+#include "networking/state_replicator.h"
+#include "networking/loopback_transport.h"
+#include "networking/packet_codec.h"
+#include "networking/zone_handoff.h"
+#include "physics/lag_compensation.h"
+#include "core/job_system.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+using namespace lumios;
+using namespace lumios::net;
+
+using Clock = std::chrono::steady_clock;
+
+static double ms_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// --- InterestManager ---
+
+static void bench_interest(GridMode mode, const char* label) {
+    constexpr u32   ENTITY_COUNT = 10000;
+    constexpr u32   CLIENT_COUNT = 1000;
+    constexpr u32   TICKS        = 60;
+    constexpr float DT           = 1.0f / 20.0f;
+    constexpr float HALF_WORLD   = 2000.0f;
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> pos_xz(-HALF_WORLD, HALF_WORLD);
+    std::uniform_real_distribution<float> pos_y(0.0f, 50.0f);
+    std::uniform_real_distribution<float> speed(-8.0f, 8.0f);
+
+    InterestManager im;
+    im.set_world_bounds({-HALF_WORLD, -100.0f, -HALF_WORLD}, {HALF_WORLD, 400.0f, HALF_WORLD});
+    im.set_grid_mode(mode);
+    im.set_cell_size(50.0f);
+    im.set_interest_radius(200.0f);
+
+    std::vector<glm::vec3> positions(ENTITY_COUNT), velocities(ENTITY_COUNT);
+    for (u32 i = 0; i < ENTITY_COUNT; i++) {
+        positions[i]  = {pos_xz(rng), pos_y(rng), pos_xz(rng)};
+        velocities[i] = {speed(rng), 0.0f, speed(rng)};
+        im.update_entity(i, positions[i]);
+    }
+    for (u32 c = 0; c < CLIENT_COUNT; c++) {
+        im.update_client(c, positions[c * (ENTITY_COUNT / CLIENT_COUNT)]);
+        im.refresh_client(c);
+    }
+
+    double update_ms = 0.0, refresh_ms = 0.0, query_ms = 0.0;
+    u64 entered = 0, left = 0, visible = 0;
+
+    for (u32 t = 0; t < TICKS; t++) {
+        auto start = Clock::now();
+        for (u32 i = 0; i < ENTITY_COUNT; i++) {
+            positions[i] += velocities[i] * DT;
+            im.update_entity(i, positions[i]);
+        }
+        for (u32 c = 0; c < CLIENT_COUNT; c++)
+            im.update_client(c, positions[c * (ENTITY_COUNT / CLIENT_COUNT)]);
+        update_ms += ms_since(start);
+
+        start = Clock::now();
+        for (u32 c = 0; c < CLIENT_COUNT; c++) {
+            const auto& diff = im.refresh_client(c);
+            entered += diff.entered.size();
+            left    += diff.left.size();
+        }
+        refresh_ms += ms_since(start);
+
+        start = Clock::now();
+        for (u32 c = 0; c < CLIENT_COUNT; c++)
+            visible += im.get_visible_entities(c).size();
+        query_ms += ms_since(start);
+    }
+
+    printf("interest/%-10s %u entities, %u clients, %u cells\n",
+           label, ENTITY_COUNT, CLIENT_COUNT, im.cell_count());
+    printf("  update   %8.3f ms/tick\n", update_ms / TICKS);
+    printf("  refresh  %8.3f ms/tick  (%.1f enter, %.1f leave per client per tick)\n",
+           refresh_ms / TICKS,
+           static_cast<double>(entered) / (TICKS * CLIENT_COUNT),
+           static_cast<double>(left) / (TICKS * CLIENT_COUNT));
+    printf("  query    %8.3f ms/tick  (%.1f visible per client)\n",
+           query_ms / TICKS, static_cast<double>(visible) / (TICKS * CLIENT_COUNT));
+}
+
+// --- Snapshot pipeline ---
+
+struct SnapshotWorld {
+    static constexpr u32   ENTITY_COUNT = 10000;
+    static constexpr float HALF_WORLD   = 2000.0f;
+    static constexpr float DT           = 1.0f / 20.0f;
+
+    std::vector<EntityState> states;
+
+    explicit SnapshotWorld(u32 seed) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> pos(-HALF_WORLD, HALF_WORLD);
+        std::uniform_real_distribution<float> speed(-8.0f, 8.0f);
+        states.resize(ENTITY_COUNT);
+        for (u32 i = 0; i < ENTITY_COUNT; i++) {
+            states[i] = {i, {pos(rng), 0.0f, pos(rng)}, glm::vec3(0.0f),
+                         {speed(rng), 0.0f, speed(rng)}, 0x1u};
+        }
+    }
+
+    void step() {
+        for (auto& s : states) s.position += s.velocity * DT;
+    }
+
+    void setup_interest(InterestManager& im, const std::vector<ClientID>& clients) const {
+        im.set_world_bounds({-HALF_WORLD, -100.0f, -HALF_WORLD}, {HALF_WORLD, 400.0f, HALF_WORLD});
+        im.set_grid_mode(GridMode::Planar);
+        for (const auto& s : states) im.update_entity(s.id, s.position);
+        for (ClientID c : clients) im.update_client(c, states[c % ENTITY_COUNT].position);
+    }
+
+    void move_interest(InterestManager& im, const std::vector<ClientID>& clients) const {
+        for (const auto& s : states) im.update_entity(s.id, s.position);
+        for (ClientID c : clients) im.update_client(c, states[c % ENTITY_COUNT].position);
+    }
+};
+
+// Reference: serialize every visible entity separately for each client on one thread
+static double run_snapshot_naive(u32 client_count, u32 ticks, u64& bytes) {
+    SnapshotWorld world(99);
+    std::vector<ClientID> clients(client_count);
+    for (u32 c = 0; c < client_count; c++) clients[c] = c * 7;
+
+    InterestManager im;
+    world.setup_interest(im, clients);
+
+    std::unordered_map<EntityNetID, EntityState> tracked;
+
+    double total_ms = 0.0;
+    bytes = 0;
+    for (u32 t = 0; t < ticks; t++) {
+        world.step();
+        world.move_interest(im, clients);
+        for (const auto& s : world.states) tracked[s.id] = s;
+
+        auto start = Clock::now();
+        for (ClientID c : clients) {
+            im.refresh_client(c);
+            const auto& visible = im.visible_set(c);
+            NetworkMessage msg;
+            msg.type = MessageType::StateDelta;
+            msg.write(SnapshotHeader{t, 0, static_cast<u32>(visible.size()), 0});
+            for (EntityNetID id : visible) msg.write(tracked[id]);
+            bytes += msg.payload.size();
+        }
+        total_ms += ms_since(start);
+    }
+    return total_ms / ticks;
+}
+
+static double run_snapshot_pipeline(u32 client_count, u32 ticks, JobSystem* jobs, u64& bytes) {
+    SnapshotWorld world(99);
+    std::vector<ClientID> clients(client_count);
+    for (u32 c = 0; c < client_count; c++) clients[c] = c * 7;
+
+    InterestManager im;
+    world.setup_interest(im, clients);
+
+    StateReplicator rep;
+    rep.set_interest(&im);
+    rep.set_job_system(jobs);
+    for (const auto& s : world.states) rep.track_entity(s.id, s);
+    rep.build_tick(clients); // prime visible sets
+
+    double total_ms = 0.0;
+    bytes = 0;
+    for (u32 t = 0; t < ticks; t++) {
+        world.step();
+        world.move_interest(im, clients);
+        for (const auto& s : world.states) rep.update_state(s.id, s);
+
+        auto start = Clock::now();
+        for (const auto& packet : rep.build_tick(clients))
+            bytes += packet.msg.payload.size();
+        total_ms += ms_since(start);
+    }
+    return total_ms / ticks;
+}
+
+static void bench_snapshot(u32 client_count) {
+    constexpr u32 TICKS = 40;
+
+    JobSystem single(0);
+    JobSystem pool;
+
+    u64 naive_bytes = 0, single_bytes = 0, pool_bytes = 0;
+    double naive_ms  = run_snapshot_naive(client_count, TICKS, naive_bytes);
+    double single_ms = run_snapshot_pipeline(client_count, TICKS, &single, single_bytes);
+    double pool_ms   = run_snapshot_pipeline(client_count, TICKS, &pool, pool_bytes);
+
+    double per_client = static_cast<double>(TICKS) * client_count;
+    printf("snapshot/%u clients, %u entities\n", client_count, SnapshotWorld::ENTITY_COUNT);
+    printf("  per-client serialize   %8.3f ms/tick  (%.0f B/client)\n",
+           naive_ms, static_cast<double>(naive_bytes) / per_client);
+    printf("  pipeline 1 thread      %8.3f ms/tick  (%.0f B/client)\n",
+           single_ms, static_cast<double>(single_bytes) / per_client);
+    printf("  pipeline %-2u threads    %8.3f ms/tick  (%.0f B/client)\n",
+           pool.thread_count(), pool_ms, static_cast<double>(pool_bytes) / per_client);
+}
+
+// --- Packet codec ---
+
+// Per-client deltas from the snapshot pipeline, as the transport would see them
+static std::vector<NetworkMessage> capture_deltas(u32 seed, u32 client_count, u32 ticks) {
+    SnapshotWorld world(seed);
+    std::vector<ClientID> clients(client_count);
+    for (u32 c = 0; c < client_count; c++) clients[c] = c * 7;
+
+    InterestManager im;
+    world.setup_interest(im, clients);
+    StateReplicator rep;
+    rep.set_interest(&im);
+    for (const auto& s : world.states) rep.track_entity(s.id, s);
+
+    std::vector<NetworkMessage> out;
+    for (u32 t = 0; t < ticks; t++) {
+        world.step();
+        world.move_interest(im, clients);
+        for (const auto& s : world.states) rep.update_state(s.id, s);
+        rep.set_server_tick(t);
+        for (const auto& packet : rep.build_tick(clients))
+            if (!packet.msg.payload.empty()) out.push_back(packet.msg);
+    }
+    return out;
+}
+
+static void bench_codec() {
+    // Train and measure on different worlds so the model is not overfitted
+    auto training = capture_deltas(7, 500, 20);
+    auto traffic  = capture_deltas(99, 1000, 20);
+
+    PacketCodec::Trainer trainer;
+    for (const auto& msg : training) trainer.add(msg);
+    PacketCodec codec;
+    trainer.build(codec);
+
+    std::vector<std::vector<u8>> encoded(traffic.size());
+    u64 raw_bytes = 0, coded_bytes = 0;
+    auto start = Clock::now();
+    for (size_t i = 0; i < traffic.size(); i++) {
+        codec.encode(traffic[i], encoded[i]);
+        raw_bytes   += traffic[i].payload.size();
+        coded_bytes += encoded[i].size();
+    }
+    double encode_ms = ms_since(start);
+
+    std::vector<u8> decoded;
+    u32 mismatches = 0;
+    start = Clock::now();
+    for (size_t i = 0; i < traffic.size(); i++) {
+        bool ok = codec.decode(traffic[i].type, encoded[i].data(), encoded[i].size(), decoded);
+        mismatches += !ok || decoded != traffic[i].payload;
+    }
+    double decode_ms = ms_since(start);
+
+    double packets = static_cast<double>(traffic.size());
+    printf("codec/rans %zu packets, trained on %llu\n", traffic.size(),
+           static_cast<unsigned long long>(trainer.message_count()));
+    printf("  size     %.1f -> %.1f B/packet  (%.1f%% saved)\n",
+           raw_bytes / packets, coded_bytes / packets, 100.0 * (1.0 - double(coded_bytes) / raw_bytes));
+    printf("  encode   %6.2f us/packet  (%.0f MB/s)\n",
+           encode_ms * 1000.0 / packets, raw_bytes / 1e3 / encode_ms);
+    printf("  decode   %6.2f us/packet  (%.0f MB/s)  %u mismatches\n",
+           decode_ms * 1000.0 / packets, raw_bytes / 1e3 / decode_ms, mismatches);
+}
+
+// --- Zones ---
+
+static void bench_zone_lookup() {
+    constexpr u32   GRID    = 16;
+    constexpr float SIZE    = 256.0f;
+    constexpr u32   LOOKUPS = 1000000;
+
+    ZoneManager zm;
+    for (u32 z = 0; z < GRID; z++) {
+        for (u32 x = 0; x < GRID; x++) {
+            glm::vec3 lo{x * SIZE, -100.0f, z * SIZE};
+            zm.add_zone({z * GRID + x, lo, lo + glm::vec3(SIZE, 200.0f, SIZE), "127.0.0.1", 0});
+        }
+    }
+
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> pos(-50.0f, GRID * SIZE + 50.0f);
+    std::vector<glm::vec3> points(LOOKUPS);
+    for (auto& p : points) p = {pos(rng), 0.0f, pos(rng)};
+
+    auto start = Clock::now();
+    u64 hits = 0;
+    for (const auto& p : points) hits += zm.get_zone_for_position(p) != INVALID_ZONE;
+    double lookup_ms = ms_since(start);
+
+    start = Clock::now();
+    u64 adjacent = 0;
+    for (u32 i = 0; i < LOOKUPS; i++) adjacent += zm.get_adjacent_zones(i % (GRID * GRID)).size();
+    double adjacent_ms = ms_since(start);
+
+    printf("zones/lookup %u zones\n", GRID * GRID);
+    printf("  position  %6.1f ns/lookup  (%.1f%% inside)\n",
+           lookup_ms * 1e6 / LOOKUPS, 100.0 * hits / LOOKUPS);
+    printf("  adjacent  %6.1f ns/lookup  (%.1f neighbours)\n",
+           adjacent_ms * 1e6 / LOOKUPS, static_cast<double>(adjacent) / LOOKUPS);
+}
+
+// Two zone servers on a loopback hub hand entities back and forth across x = 0
+static void bench_zone_handoff() {
+    constexpr u32   ENTITY_COUNT = 2000;
+    constexpr u32   TICKS        = 600;
+    constexpr float DT           = 1.0f / 20.0f;
+    constexpr u32   BLOB_SIZE    = 96;
+
+    ZoneManager zones_a, zones_b;
+    for (ZoneManager* zm : {&zones_a, &zones_b}) {
+        zm->add_zone({1, {-500.0f, -100.0f, -500.0f}, {0.0f, 100.0f, 500.0f}, "127.0.0.1", 7001});
+        zm->add_zone({2, {0.0f, -100.0f, -500.0f}, {500.0f, 100.0f, 500.0f}, "127.0.0.1", 7002});
+    }
+
+    LoopbackHub hub;
+    LoopbackTransport link_a(hub), link_b(hub);
+    ZoneHandoff zone_a(1, zones_a, link_a), zone_b(2, zones_b, link_b);
+
+    link_a.set_on_connect([&](ClientID peer) { zone_a.set_peer(2, peer); });
+    link_b.set_on_connect([&](ClientID peer) { zone_b.set_peer(1, peer); });
+    link_a.set_on_message([&](ClientID from, const NetworkMessage& msg) { zone_a.on_message(from, msg); });
+    link_b.set_on_message([&](ClientID from, const NetworkMessage& msg) { zone_b.on_message(from, msg); });
+    link_a.start_server(7001);
+    link_b.connect("127.0.0.1", 7001);
+    link_a.poll();
+    link_b.poll();
+
+    // Component blob: a recognisable pattern so the receiver can verify it
+    u32 corrupt = 0;
+    for (ZoneHandoff* z : {&zone_a, &zone_b}) {
+        z->set_serializer([](EntityNetID id, std::vector<u8>& out) {
+            for (u32 i = 0; i < BLOB_SIZE; i++) out.push_back(static_cast<u8>(id + i));
+        });
+        z->set_on_acquire([&](const EntityTransferData& data) {
+            bool ok = data.components.size() == BLOB_SIZE;
+            for (u32 i = 0; ok && i < BLOB_SIZE; i++)
+                ok = data.components[i] == static_cast<u8>(data.state.id + i);
+            corrupt += !ok;
+        });
+    }
+
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> pos(-480.0f, 480.0f);
+    std::uniform_real_distribution<float> speed(-15.0f, 15.0f);
+    for (u32 i = 0; i < ENTITY_COUNT; i++) {
+        EntityState s{i, {pos(rng), 0.0f, pos(rng)}, glm::vec3(0.0f), {speed(rng), 0.0f, 0.0f}, 0x1u};
+        (s.position.x < 0.0f ? zone_a : zone_b).add_owned(i, s);
+    }
+
+    auto simulate = [&](ZoneHandoff& zone) {
+        std::vector<EntityState> moved;
+        for (const auto& [id, state] : zone.owned()) {
+            if (zone.is_transferring(id)) continue;
+            EntityState s = state;
+            s.position += s.velocity * DT;
+            if (std::abs(s.position.x) > 480.0f) s.velocity.x = -s.velocity.x;
+            moved.push_back(s);
+        }
+        for (const auto& s : moved) zone.update_owned(s.id, s);
+    };
+
+    u64 violations = 0, ghosts = 0;
+    auto start = Clock::now();
+    for (u32 t = 0; t < TICKS; t++) {
+        double now = t * DT;
+        simulate(zone_a);
+        simulate(zone_b);
+        zone_a.tick(now);
+        zone_b.tick(now);
+        link_a.poll();
+        link_b.poll();
+        link_a.poll();
+
+        // Exactly one zone may simulate each entity at any time
+        for (u32 i = 0; i < ENTITY_COUNT; i++) {
+            u32 active = (zone_a.owns(i) && !zone_a.is_transferring(i)) +
+                         (zone_b.owns(i) && !zone_b.is_transferring(i));
+            u32 held   = zone_a.owns(i) + zone_b.owns(i);
+            violations += active > 1 || held == 0;
+        }
+        ghosts += zone_a.ghosts().size() + zone_b.ghosts().size();
+    }
+    double total_ms = ms_since(start);
+
+    printf("zones/handoff %u entities, 2 zones over loopback, %u ticks\n", ENTITY_COUNT, TICKS);
+    printf("  transfers %u completed, %u rejected, %u corrupt blobs, %llu ownership violations\n",
+           zone_a.transfers_completed() + zone_b.transfers_completed(),
+           zone_a.transfers_rejected() + zone_b.transfers_rejected(), corrupt,
+           static_cast<unsigned long long>(violations));
+    printf("  ghosts    %.1f per tick\n", static_cast<double>(ghosts) / TICKS);
+    printf("  traffic   %.1f KB/tick between zones\n",
+           static_cast<double>(link_a.bytes_sent() + link_b.bytes_sent()) / 1024.0 / TICKS);
+    printf("  cost      %.3f ms/tick\n", total_ms / TICKS);
+}
+
+// --- Lag compensation ---
+
+// Moving capsules over a ground slab; shots rewind to random ticks in the
+// history. A second history with one huge cell is the brute-force reference.
+static void bench_lag() {
+    constexpr u32   COLLIDER_COUNT = 5000;
+    constexpr u32   HISTORY        = 64;
+    constexpr u32   SHOTS_PER_TICK = 500;
+    constexpr float DT             = 1.0f / 60.0f;
+    constexpr float HALF_WORLD     = 500.0f;
+    constexpr float RANGE          = 300.0f;
+
+    std::mt19937 rng(35);
+    std::uniform_real_distribution<float> pos(-HALF_WORLD, HALF_WORLD);
+    std::uniform_real_distribution<float> speed(-6.0f, 6.0f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    std::vector<glm::vec3> positions(COLLIDER_COUNT), velocities(COLLIDER_COUNT);
+    for (u32 i = 0; i < COLLIDER_COUNT; i++) {
+        positions[i]  = {pos(rng), 1.0f, pos(rng)};
+        velocities[i] = {speed(rng), 0.0f, speed(rng)};
+    }
+
+    LagCompensation lag(HISTORY), reference(HISTORY);
+    reference.set_cell_size(1.0e5f);
+
+    double record_ms = 0.0;
+    for (u32 t = 0; t < HISTORY; t++) {
+        for (u32 i = 0; i < COLLIDER_COUNT; i++) positions[i] += velocities[i] * DT;
+
+        for (LagCompensation* history : {&lag, &reference}) {
+            auto start = Clock::now();
+            history->begin_frame(t);
+            history->add_collider({{0.0f, -0.5f, 0.0f}, {HALF_WORLD, 0.5f, HALF_WORLD},
+                                   static_cast<entt::entity>(COLLIDER_COUNT), HistoricalCollider::Shape::Box});
+            for (u32 i = 0; i < COLLIDER_COUNT; i++)
+                history->add_collider({positions[i], {0.4f, 0.5f, 0.0f}, static_cast<entt::entity>(i),
+                                       HistoricalCollider::Shape::Capsule});
+            history->end_frame();
+            if (history == &lag) record_ms += ms_since(start);
+        }
+    }
+
+    // Shooters stand on colliders and fire roughly level; every tenth shot
+    // has no range limit
+    std::vector<RewindRay> rays(SHOTS_PER_TICK);
+    for (auto& ray : rays) {
+        u32 shooter = rng() % COLLIDER_COUNT;
+        const HistoricalCollider* from = lag.find(HISTORY - 1, static_cast<entt::entity>(shooter));
+        ray.tick         = static_cast<u32>(rng() % HISTORY);
+        ray.origin       = from->center + glm::vec3(0.0f, 0.5f, 0.0f);
+        ray.direction    = glm::normalize(glm::vec3(unit(rng), unit(rng) * 0.05f, unit(rng)));
+        ray.max_distance = (&ray - rays.data()) % 10 == 0 ? INFINITY : RANGE;
+        ray.ignore       = static_cast<entt::entity>(shooter);
+    }
+
+    std::vector<RewindHit> hits(rays.size()), expected(rays.size());
+    auto start = Clock::now();
+    lag.raycast_batch(rays, hits);
+    double single_ms = ms_since(start);
+
+    JobSystem pool;
+    start = Clock::now();
+    lag.raycast_batch(rays, hits, &pool);
+    double pool_ms = ms_since(start);
+
+    reference.raycast_batch(rays, expected, &pool);
+    u32 hit_count = 0, mismatches = 0;
+    for (size_t i = 0; i < rays.size(); i++) {
+        hit_count += hits[i].hit;
+        if (hits[i].hit != expected[i].hit || hits[i].entity != expected[i].entity ||
+            std::abs(hits[i].distance - expected[i].distance) > 1e-3f)
+            mismatches++;
+    }
+
+    printf("lag/%u colliders, %u ticks of history\n", COLLIDER_COUNT, HISTORY);
+    printf("  record     %8.3f ms/tick\n", record_ms / HISTORY);
+    printf("  raycast    %8.2f us/ray  (%.0f%% hit, %u mismatches vs brute force)\n",
+           single_ms * 1000.0 / rays.size(), 100.0 * hit_count / rays.size(), mismatches);
+    printf("  %u shots  %8.3f ms on 1 thread, %.3f ms on %u threads\n",
+           SHOTS_PER_TICK, single_ms, pool_ms, pool.thread_count());
+}
+
+int main(int argc, char** argv) {
+    std::string suite = argc > 1 ? argv[1] : "";
+
+    if (suite.empty() || suite == "interest") {
+        bench_interest(GridMode::Volumetric, "volumetric");
+        bench_interest(GridMode::Planar, "planar");
+    }
+    if (suite.empty() || suite == "snapshot") {
+        bench_snapshot(1000);
+        bench_snapshot(5000);
+    }
+    if (suite.empty() || suite == "codec") {
+        bench_codec();
+    }
+    if (suite.empty() || suite == "zones") {
+        bench_zone_lookup();
+        bench_zone_handoff();
+    }
+    if (suite.empty() || suite == "lag") {
+        bench_lag();
+    }
+    return 0;
+}
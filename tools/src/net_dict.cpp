@@ -0,0 +1,117 @@
+// Trains a PacketCodec dictionary from captured traffic (lumios_netload
+// --capture, or message logs from --record) and reports how well it
+// compresses the capture.
+//
+//   lumios_netdict <capture> [more captures...] -o <dictionary>
+
+#include "networking/message_log.h"
+#include "networking/packet_codec.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+
+using namespace lumios;
+using namespace lumios::net;
+
+using Clock = std::chrono::steady_clock;
+
+static bool read_message_log(const std::string& path, std::vector<NetworkMessage>& out) {
+    MessageLogReader reader;
+    if (!reader.open(path)) return false;
+    MessageLogEntry entry;
+    while (reader.next(entry)) {
+        if (entry.event == LogEvent::Inbound || entry.event == LogEvent::Outbound)
+            out.push_back(std::move(entry.msg));
+    }
+    return true;
+}
+
+static bool read_capture(const std::string& path, std::vector<NetworkMessage>& out) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        fprintf(stderr, "failed to open capture %s\n", path.c_str());
+        return false;
+    }
+
+    char magic[4] = {};
+    file.read(magic, sizeof(magic));
+    if (file && memcmp(magic, "LNLG", 4) == 0) return read_message_log(path, out);
+    file.clear();
+    file.seekg(0);
+
+    for (;;) {
+        u16 type = 0;
+        u32 size = 0;
+        if (!file.read(reinterpret_cast<char*>(&type), sizeof(type))) break;
+        if (!file.read(reinterpret_cast<char*>(&size), sizeof(size)) || size > (64u << 20)) {
+            fprintf(stderr, "truncated capture %s\n", path.c_str());
+            return false;
+        }
+        NetworkMessage msg;
+        msg.type = static_cast<MessageType>(type);
+        msg.payload.resize(size);
+        if (!file.read(reinterpret_cast<char*>(msg.payload.data()), size)) {
+            fprintf(stderr, "truncated capture %s\n", path.c_str());
+            return false;
+        }
+        out.push_back(std::move(msg));
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> inputs;
+    std::string output;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) output = argv[++i];
+        else inputs.push_back(arg);
+    }
+    if (inputs.empty() || output.empty()) {
+        fprintf(stderr, "usage: lumios_netdict <capture> [more captures...] -o <dictionary>\n");
+        return 1;
+    }
+
+    std::vector<NetworkMessage> messages;
+    for (const auto& path : inputs)
+        if (!read_capture(path, messages)) return 1;
+
+    PacketCodec::Trainer trainer;
+    for (const auto& msg : messages) trainer.add(msg);
+    PacketCodec codec;
+    trainer.build(codec);
+    if (!codec.save(output)) return 1;
+
+    // Per-type ratio and cost over the training set; a held-out capture
+    // run through lumios_netload --dict gives the honest number
+    struct Result { u64 count = 0, raw = 0, coded = 0; double encode_us = 0.0; };
+    std::map<MessageType, Result> results;
+    std::vector<u8> encoded, decoded;
+    u32 failures = 0;
+    for (const auto& msg : messages) {
+        auto start = Clock::now();
+        codec.encode(msg, encoded);
+        auto& r = results[msg.type];
+        r.encode_us += std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+        r.count++;
+        r.raw   += msg.payload.size();
+        r.coded += encoded.size();
+        if (!codec.decode(msg.type, encoded.data(), encoded.size(), decoded) || decoded != msg.payload)
+            failures++;
+    }
+
+    printf("lumios_netdict: %zu messages, %u models -> %s\n", messages.size(), codec.model_count(), output.c_str());
+    printf("  %-14s %10s %12s %12s %8s %12s\n", "type", "count", "raw B", "coded B", "ratio", "us/packet");
+    for (const auto& [type, r] : results) {
+        printf("  %-14s %10llu %12llu %12llu %7.1f%% %12.2f\n", message_type_name(type),
+               static_cast<unsigned long long>(r.count), static_cast<unsigned long long>(r.raw),
+               static_cast<unsigned long long>(r.coded), r.raw ? 100.0 * r.coded / r.raw : 100.0,
+               r.count ? r.encode_us / r.count : 0.0);
+    }
+    if (failures) {
+        fprintf(stderr, "%u messages failed to round-trip\n", failures);
+        return 1;
+    }
+    return 0;
+}
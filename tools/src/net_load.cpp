@@ -0,0 +1,408 @@
+// Headless load generator: one authoritative server and thousands of bot
+// clients in a single process over the loopback transport. Bots run the real
+// client stack (prediction + interpolation) and drive scripted inputs, so the
+// server sees the same message mix a live deployment would.
+//
+//   lumios_netload [--clients N] [--npcs N] [--ticks N] [--rate HZ] [--threads N]
+//                  [--capture FILE] [--dict FILE] [--record FILE] [--loss F]
+//
+// --capture writes every payload in both directions as {u16 type, u32 size, bytes}
+// records for lumios_netdict; --dict compresses all datagrams with a trained
+// PacketCodec dictionary; --record keeps a server-side message log for
+// lumios_netreplay; --loss drops that fraction of unreliable datagrams in
+// both directions.
+
+#include "networking/client_prediction.h"
+#include "networking/input_queue.h"
+#include "networking/interest_manager.h"
+#include "networking/loopback_transport.h"
+#include "networking/message_log.h"
+#include "networking/net_stats.h"
+#include "networking/packet_codec.h"
+#include "networking/snapshot_interpolator.h"
+#include "networking/state_replicator.h"
+#include "core/job_system.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <random>
+
+using namespace lumios;
+using namespace lumios::net;
+
+using Clock = std::chrono::steady_clock;
+
+static double ms_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+struct Options {
+    u32   clients = 1000;
+    u32   npcs    = 2000;
+    u32   ticks   = 600;
+    float rate    = 20.0f;
+    u32   threads = UINT32_MAX;
+    std::string capture;
+    std::string dict;
+    std::string record;
+    float loss = 0.0f;
+};
+
+static constexpr u16   SERVER_PORT = 7777;
+static constexpr float HALF_WORLD  = 2000.0f;
+static constexpr float MOVE_SPEED  = 6.0f;
+
+// Same step on server and bots, as prediction requires
+static void move_step(EntityState& s, const ClientInput& in, float dt) {
+    s.velocity = glm::vec3(in.move_x, 0.0f, in.move_y) * MOVE_SPEED;
+    s.position += s.velocity * dt;
+    s.position.x = std::clamp(s.position.x, -HALF_WORLD, HALF_WORLD);
+    s.position.z = std::clamp(s.position.z, -HALF_WORLD, HALF_WORLD);
+    s.rotation.y = in.look_yaw;
+}
+
+// --- Traffic accounting ---
+
+struct TypeStats {
+    u64 count = 0;
+    u64 bytes = 0;
+};
+
+struct Traffic {
+    std::map<MessageType, TypeStats> up;   // bots -> server
+    std::map<MessageType, TypeStats> down; // server -> bots
+    std::ofstream    capture;
+
+    void count(std::map<MessageType, TypeStats>& dir, const NetworkMessage& msg) {
+        auto& s = dir[msg.type];
+        s.count++;
+        s.bytes += msg.payload.size();
+    }
+
+    void record(const NetworkMessage& msg) {
+        if (!capture.is_open()) return;
+        u16 type = static_cast<u16>(msg.type);
+        u32 size = static_cast<u32>(msg.payload.size());
+        capture.write(reinterpret_cast<const char*>(&type), sizeof(type));
+        capture.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        capture.write(reinterpret_cast<const char*>(msg.payload.data()), size);
+    }
+};
+
+// --- Bot ---
+
+struct Bot {
+    LoopbackTransport    link;
+    ClientPrediction     prediction;
+    SnapshotInterpolator interpolator;
+    ClientID             server = INVALID_CLIENT;
+    bool                 spawned = false;
+    float                phase;
+    float                turn_rate;
+
+    Bot(LoopbackHub& hub, u32 seed) : link(hub) {
+        std::mt19937 rng(seed);
+        phase     = std::uniform_real_distribution<float>(0.0f, 6.2831853f)(rng);
+        turn_rate = std::uniform_real_distribution<float>(-0.5f, 0.5f)(rng);
+    }
+
+    // Wander along a slowly turning heading, pausing now and then
+    ClientInput script(double time) const {
+        float heading = phase + turn_rate * static_cast<float>(time);
+        bool  paused  = std::fmod(time + phase, 10.0) > 8.0;
+        ClientInput in{};
+        in.move_x   = paused ? 0.0f : std::cos(heading);
+        in.move_y   = paused ? 0.0f : std::sin(heading);
+        in.look_yaw = glm::degrees(heading);
+        return in;
+    }
+};
+
+// --- Server ---
+
+struct Server {
+    LoopbackTransport link;
+    InterestManager   interest;
+    InputQueue        inputs;
+    StateReplicator   replicator;
+    JobSystem         jobs;
+    NetStats          stats;
+
+    std::unordered_map<ClientID, EntityState> players;
+    std::vector<EntityState>                  npcs;
+    std::vector<ClientID>                     clients;
+    std::vector<u32>                          snapshot_sizes; // every delta sent
+    EntityNetID                               next_entity = 1;
+
+    Server(LoopbackHub& hub, u32 threads) : link(hub), jobs(threads) {
+        interest.set_world_bounds({-HALF_WORLD, -100.0f, -HALF_WORLD}, {HALF_WORLD, 400.0f, HALF_WORLD});
+        interest.set_grid_mode(GridMode::Planar);
+        replicator.set_transport(&link);
+        replicator.set_interest(&interest);
+        replicator.set_input_queue(&inputs);
+        replicator.set_job_system(&jobs);
+        link.set_stats(&stats);
+        // The run is much faster than real time: ping every tick and give up
+        // on a ping after a few wall-clock ticks
+        stats.set_ping_interval(0.0f);
+        stats.set_ping_timeout(0.02f);
+    }
+
+    EntityState spawn(const glm::vec3& pos) {
+        EntityState s{};
+        s.id = next_entity++;
+        s.position = pos;
+        s.component_mask = 0x1u;
+        replicator.track_entity(s.id, s);
+        interest.update_entity(s.id, pos);
+        return s;
+    }
+
+    void tick(u32 tick, float dt) {
+        for (auto& [client, state] : players) {
+            ClientInput in;
+            if (inputs.pop(client, in)) move_step(state, in, dt);
+            replicator.update_state(state.id, state);
+            interest.update_entity(state.id, state.position);
+            interest.update_client(client, state.position);
+        }
+        for (auto& npc : npcs) {
+            npc.position += npc.velocity * dt;
+            if (std::abs(npc.position.x) > HALF_WORLD) npc.velocity.x = -npc.velocity.x;
+            if (std::abs(npc.position.z) > HALF_WORLD) npc.velocity.z = -npc.velocity.z;
+            replicator.update_state(npc.id, npc);
+            interest.update_entity(npc.id, npc.position);
+        }
+        replicator.set_server_tick(tick);
+        for (const auto& packet : replicator.build_tick(clients)) {
+            if (packet.msg.payload.empty()) continue;
+            snapshot_sizes.push_back(static_cast<u32>(packet.msg.payload.size()));
+            link.send_unreliable(packet.client, packet.msg);
+        }
+
+        for (ClientID client : clients) stats.set_queue_depth(client, 0, inputs.pending(client));
+        stats.update(link);
+    }
+};
+
+static double percentile(std::vector<double> v, double p) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    size_t i = static_cast<size_t>(p * (v.size() - 1) + 0.5);
+    return v[i];
+}
+
+static bool parse_args(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) { fprintf(stderr, "missing value for %s\n", arg.c_str()); return false; }
+        const char* value = argv[++i];
+        if      (arg == "--clients") opt.clients = static_cast<u32>(std::atoi(value));
+        else if (arg == "--npcs")    opt.npcs    = static_cast<u32>(std::atoi(value));
+        else if (arg == "--ticks")   opt.ticks   = static_cast<u32>(std::atoi(value));
+        else if (arg == "--rate")    opt.rate    = static_cast<float>(std::atof(value));
+        else if (arg == "--threads") opt.threads = static_cast<u32>(std::atoi(value));
+        else if (arg == "--capture") opt.capture = value;
+        else if (arg == "--dict")    opt.dict    = value;
+        else if (arg == "--record")  opt.record  = value;
+        else if (arg == "--loss")    opt.loss    = static_cast<float>(std::atof(value));
+        else { fprintf(stderr, "unknown option %s\n", arg.c_str()); return false; }
+    }
+    return opt.clients > 0 && opt.ticks > 0 && opt.rate > 0.0f;
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parse_args(argc, argv, opt)) {
+        fprintf(stderr, "usage: lumios_netload [--clients N] [--npcs N] [--ticks N] [--rate HZ] [--threads N]\n"
+                        "                      [--capture FILE] [--dict FILE] [--record FILE] [--loss F]\n");
+        return 1;
+    }
+
+    PacketCodec codec;
+    if (!opt.dict.empty() && !codec.load(opt.dict)) return 1;
+    const PacketCodec* wire_codec = opt.dict.empty() ? nullptr : &codec;
+
+    const float dt = 1.0f / opt.rate;
+    LoopbackHub hub;
+    Traffic     traffic;
+    Server      server(hub, opt.threads);
+    server.link.set_codec(wire_codec);
+    server.link.set_drop_rate(opt.loss);
+    MessageRecorder recorder;
+    if (!opt.record.empty()) {
+        if (!recorder.open(opt.record)) return 1;
+        server.link.set_recorder(&recorder);
+    }
+    if (!opt.capture.empty()) {
+        traffic.capture.open(opt.capture, std::ios::binary);
+        if (!traffic.capture.is_open()) {
+            fprintf(stderr, "failed to open capture file %s\n", opt.capture.c_str());
+            return 1;
+        }
+    }
+    double      sim_time = 0.0;
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> pos(-HALF_WORLD * 0.9f, HALF_WORLD * 0.9f);
+    std::uniform_real_distribution<float> speed(-4.0f, 4.0f);
+
+    server.link.start_server(SERVER_PORT);
+    server.link.set_on_connect([&](ClientID client) {
+        EntityState s = server.spawn({pos(rng), 0.0f, pos(rng)});
+        server.players[client] = s;
+        server.clients.push_back(client);
+        server.interest.update_client(client, s.position);
+        server.replicator.set_controlled_entity(client, s.id);
+
+        NetworkMessage spawn;
+        spawn.type = MessageType::EntitySpawn;
+        spawn.write(s);
+        server.link.send_reliable(client, spawn);
+    });
+    server.link.set_on_message([&](ClientID client, const NetworkMessage& msg) {
+        traffic.count(traffic.up, msg);
+        traffic.record(msg);
+        if (msg.type == MessageType::Input) server.inputs.on_receive(client, msg);
+    });
+
+    for (u32 i = 0; i < opt.npcs; i++) {
+        EntityState s = server.spawn({pos(rng), 0.0f, pos(rng)});
+        s.velocity = {speed(rng), 0.0f, speed(rng)};
+        server.npcs.push_back(s);
+    }
+
+    std::vector<Unique<Bot>> bots;
+    bots.reserve(opt.clients);
+    for (u32 i = 0; i < opt.clients; i++) {
+        auto bot = std::make_unique<Bot>(hub, i + 1);
+        Bot* b = bot.get();
+        b->prediction.set_move_fn(move_step);
+        b->prediction.set_tick_rate(opt.rate);
+        b->interpolator.set_tick_rate(opt.rate);
+        b->link.set_codec(wire_codec);
+        b->link.set_drop_rate(opt.loss);
+        b->link.set_on_connect([b](ClientID server_id) { b->server = server_id; });
+        b->link.set_on_message([&traffic, &sim_time, b](ClientID, const NetworkMessage& msg) {
+            traffic.count(traffic.down, msg);
+            traffic.record(msg);
+            if (msg.type == MessageType::EntitySpawn) {
+                EntityState s = msg.read<EntityState>(0);
+                b->prediction.set_controlled_entity(s.id);
+                b->prediction.reset(s);
+                b->spawned = true;
+            } else if (msg.type == MessageType::StateDelta || msg.type == MessageType::StateSnapshot) {
+                b->prediction.on_snapshot(msg);
+                b->interpolator.on_receive(msg, sim_time);
+            }
+        });
+        b->link.connect("loopback", SERVER_PORT);
+        bots.push_back(std::move(bot));
+    }
+    server.link.poll();
+    for (auto& b : bots) b->link.poll();
+
+    printf("lumios_netload: %u clients, %u npcs, %u ticks at %.0f Hz, %u server threads\n",
+           opt.clients, opt.npcs, opt.ticks, opt.rate, server.jobs.thread_count());
+
+    std::vector<double> tick_ms;
+    tick_ms.reserve(opt.ticks);
+    auto run_start = Clock::now();
+
+    for (u32 t = 1; t <= opt.ticks; t++) {
+        double now = t * static_cast<double>(dt);
+        sim_time = now;
+
+        for (auto& b : bots) {
+            if (!b->spawned) continue;
+            NetworkMessage msg = b->prediction.apply_input(b->script(now));
+            b->link.send_unreliable(b->server, msg);
+        }
+
+        server.link.poll();
+        auto start = Clock::now();
+        server.tick(t, dt);
+        tick_ms.push_back(ms_since(start));
+
+        // Bots receive after the server tick; interpolation runs at tick rate
+        for (auto& b : bots) {
+            b->link.poll();
+            b->interpolator.update(now, dt);
+            b->prediction.update(dt);
+        }
+    }
+    double wall_ms = ms_since(run_start);
+
+    u64 down_bytes = 0, up_bytes = 0;
+    for (auto& [type, s] : traffic.down) down_bytes += s.bytes;
+    for (auto& [type, s] : traffic.up)   up_bytes   += s.bytes;
+
+    double seconds = opt.ticks * static_cast<double>(dt);
+    double budget  = 1000.0 * dt;
+    printf("\nserver tick (budget %.1f ms)\n", budget);
+    printf("  p50 %8.3f ms   p90 %8.3f ms   p99 %8.3f ms   max %8.3f ms\n",
+           percentile(tick_ms, 0.50), percentile(tick_ms, 0.90),
+           percentile(tick_ms, 0.99), percentile(tick_ms, 1.0));
+
+    printf("\nbandwidth (payload bytes, simulated %.1f s)\n", seconds);
+    printf("  down      %10.1f B/client/s\n", down_bytes / seconds / opt.clients);
+    printf("  up        %10.1f B/client/s\n", up_bytes / seconds / opt.clients);
+    NetStatsSnapshot net = server.stats.snapshot();
+    if (wire_codec) {
+        // Server-side wire sizes; pings and pongs are left out like they
+        // are from the payload totals
+        u64 wire_down = 0, wire_up = 0;
+        for (const auto& [type, t] : net.by_type) {
+            if (type == MessageType::Ping || type == MessageType::Pong) continue;
+            wire_down += t.sent_bytes;
+            wire_up   += t.recv_bytes;
+        }
+        printf("  wire down %10.1f B/client/s (%.1f%% of payload)\n",
+               wire_down / seconds / opt.clients, 100.0 * wire_down / std::max<u64>(down_bytes, 1));
+        printf("  wire up   %10.1f B/client/s (%.1f%% of payload)\n",
+               wire_up / seconds / opt.clients, 100.0 * wire_up / std::max<u64>(up_bytes, 1));
+    }
+
+    std::vector<double> rtt, rtt_var, loss, queue;
+    for (const auto& c : net.clients) {
+        rtt.push_back(c.rtt_ms);
+        rtt_var.push_back(c.rtt_var_ms);
+        loss.push_back(c.loss * 100.0);
+        queue.push_back(c.recv_queue);
+    }
+    printf("\nserver NetStats (%zu clients, wall-clock RTT)\n", net.clients.size());
+    printf("  rtt      p50 %8.3f ms  p99 %8.3f ms   var p50 %8.3f ms\n",
+           percentile(rtt, 0.50), percentile(rtt, 0.99), percentile(rtt_var, 0.50));
+    printf("  loss     p50 %8.1f %%   p99 %8.1f %%\n", percentile(loss, 0.50), percentile(loss, 0.99));
+    printf("  inputs   p50 %8.0f      max %8.0f queued\n", percentile(queue, 0.50), percentile(queue, 1.0));
+
+    std::vector<double> sizes(server.snapshot_sizes.begin(), server.snapshot_sizes.end());
+    double mean = 0.0;
+    for (double s : sizes) mean += s;
+    mean = sizes.empty() ? 0.0 : mean / sizes.size();
+    printf("\nsnapshot size (%zu sent)\n", sizes.size());
+    printf("  mean %8.0f B   p50 %8.0f B   p99 %8.0f B   max %8.0f B\n",
+           mean, percentile(sizes, 0.50), percentile(sizes, 0.99), percentile(sizes, 1.0));
+
+    printf("\nmessages by type\n");
+    printf("  %-14s %-5s %12s %14s %10s\n", "type", "dir", "count", "bytes", "avg B");
+    auto print_dir = [](const char* dir, const std::map<MessageType, TypeStats>& stats) {
+        for (auto& [type, s] : stats) {
+            printf("  %-14s %-5s %12llu %14llu %10.1f\n", message_type_name(type), dir,
+                   static_cast<unsigned long long>(s.count), static_cast<unsigned long long>(s.bytes),
+                   s.count ? static_cast<double>(s.bytes) / s.count : 0.0);
+        }
+    };
+    print_dir("down", traffic.down);
+    print_dir("up", traffic.up);
+
+    if (recorder.is_open()) {
+        printf("\nrecorded %llu messages (%.1f MB) to %s\n", static_cast<unsigned long long>(recorder.record_count()),
+               recorder.bytes_written() / 1e6, opt.record.c_str());
+    }
+    printf("\nwall time %.1f s (bots included)\n", wall_ms / 1000.0);
+    return 0;
+}
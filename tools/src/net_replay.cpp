@@ -0,0 +1,282 @@
+// Offline replay of a server-side message log (lumios_netload --record, or any
+// transport with a MessageRecorder attached). The log is cut into server
+// ticks by the snapshot headers it sent; each tick's entity states, client
+// views and input acks are reconstructed from the recorded traffic and fed
+// through InterestManager + StateReplicator as fast as possible. Replayed
+// packets are compared against the recorded ones, so the tool doubles as a
+// regression check for replication changes.
+//
+//   lumios_netreplay <log> [--loops N] [--threads N] [--radius R] [--cell S]
+//                          [--bounds HALF] [--volumetric]
+
+#include "networking/input_queue.h"
+#include "networking/interest_manager.h"
+#include "networking/message_log.h"
+#include "networking/state_replicator.h"
+#include "core/job_system.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using namespace lumios;
+using namespace lumios::net;
+
+using Clock = std::chrono::steady_clock;
+
+static double ms_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+struct Options {
+    std::string log;
+    u32   loops     = 1;
+    u32   threads   = UINT32_MAX;
+    float radius    = 200.0f;
+    float cell      = 50.0f;
+    float bounds    = 2000.0f;
+    bool  planar    = true;
+};
+
+// --- Log -> ticks ---
+
+struct RecordedPacket {
+    ClientID       client;
+    u32            size;
+    SnapshotHeader header;
+    std::vector<EntityState> states;
+    std::vector<EntityNetID> left;
+};
+
+struct Frame {
+    u32 tick = 0;
+    std::vector<ClientID>       connects;
+    std::vector<ClientID>       disconnects;
+    std::vector<MessageLogEntry> inputs;
+    std::vector<std::pair<ClientID, EntityNetID>> spawns; // client -> controlled entity
+    std::vector<RecordedPacket> packets;
+    std::vector<EntityState>    states; // every distinct state sent this tick
+};
+
+static bool parse_packet(const MessageLogEntry& entry, RecordedPacket& out) {
+    const auto& payload = entry.msg.payload;
+    if (payload.size() < sizeof(SnapshotHeader)) return false;
+    out.client = entry.peer;
+    out.size   = static_cast<u32>(payload.size());
+    out.header = entry.msg.read<SnapshotHeader>(0);
+    size_t states_size = static_cast<size_t>(out.header.entity_count) * sizeof(EntityState);
+    size_t left_size   = static_cast<size_t>(out.header.left_count) * sizeof(EntityNetID);
+    if (sizeof(SnapshotHeader) + states_size + left_size > payload.size())
+        return false;
+    out.states.resize(out.header.entity_count);
+    memcpy(out.states.data(), payload.data() + sizeof(SnapshotHeader), states_size);
+    out.left.resize(out.header.left_count);
+    memcpy(out.left.data(), payload.data() + sizeof(SnapshotHeader) + states_size, left_size);
+    return true;
+}
+
+static bool load_frames(const std::string& path, std::vector<Frame>& frames, u64& record_count) {
+    MessageLogReader reader;
+    if (!reader.open(path)) return false;
+
+    Frame pending; // events seen since the last tick's packets
+    MessageLogEntry entry;
+    record_count = 0;
+    while (reader.next(entry)) {
+        record_count++;
+        switch (entry.event) {
+            case LogEvent::Connect:    pending.connects.push_back(entry.peer); break;
+            case LogEvent::Disconnect: pending.disconnects.push_back(entry.peer); break;
+            case LogEvent::Inbound:
+                if (entry.msg.type == MessageType::Input) pending.inputs.push_back(entry);
+                break;
+            case LogEvent::Outbound:
+                if (entry.msg.type == MessageType::EntitySpawn) {
+                    pending.spawns.push_back({entry.peer, entry.msg.read<EntityState>(0).id});
+                } else if (entry.msg.type == MessageType::StateDelta) {
+                    RecordedPacket packet;
+                    if (!parse_packet(entry, packet)) {
+                        fprintf(stderr, "malformed delta in %s\n", path.c_str());
+                        return false;
+                    }
+                    // A server tick's packets are sent back to back; a new
+                    // tick number starts the next frame
+                    if (frames.empty() || frames.back().tick != packet.header.server_tick) {
+                        pending.tick = packet.header.server_tick;
+                        frames.push_back(std::move(pending));
+                        pending = {};
+                    }
+                    frames.back().packets.push_back(std::move(packet));
+                }
+                break;
+        }
+    }
+
+    for (auto& frame : frames) {
+        std::unordered_map<EntityNetID, u32> seen;
+        for (const auto& packet : frame.packets) {
+            for (const auto& s : packet.states)
+                if (seen.emplace(s.id, static_cast<u32>(frame.states.size())).second) frame.states.push_back(s);
+        }
+    }
+    return true;
+}
+
+// --- Replay ---
+
+static bool same_packet(const RecordedPacket& recorded, const NetworkMessage& replayed) {
+    RecordedPacket r;
+    MessageLogEntry entry;
+    entry.peer = recorded.client;
+    entry.msg  = replayed;
+    if (!parse_packet(entry, r)) return false;
+    if (r.header.server_tick != recorded.header.server_tick || r.header.input_ack != recorded.header.input_ack ||
+        r.states.size() != recorded.states.size() || r.left != recorded.left)
+        return false;
+
+    // Entity order inside a delta is not part of the protocol
+    auto by_id = [](const EntityState& a, const EntityState& b) { return a.id < b.id; };
+    std::vector<EntityState> a = recorded.states;
+    std::sort(a.begin(), a.end(), by_id);
+    std::sort(r.states.begin(), r.states.end(), by_id);
+    return memcmp(a.data(), r.states.data(), a.size() * sizeof(EntityState)) == 0;
+}
+
+struct ReplayResult {
+    std::vector<double> tick_ms;
+    u64 recorded_packets = 0, replayed_packets = 0, matched = 0;
+    u64 recorded_bytes = 0, replayed_bytes = 0;
+};
+
+static void replay(const std::vector<Frame>& frames, const Options& opt, JobSystem& jobs, ReplayResult& result) {
+    InterestManager interest;
+    interest.set_world_bounds({-opt.bounds, -opt.bounds, -opt.bounds}, {opt.bounds, opt.bounds, opt.bounds});
+    interest.set_grid_mode(opt.planar ? GridMode::Planar : GridMode::Volumetric);
+    interest.set_cell_size(opt.cell);
+    interest.set_interest_radius(opt.radius);
+
+    InputQueue      inputs;
+    StateReplicator replicator;
+    replicator.set_interest(&interest);
+    replicator.set_input_queue(&inputs);
+    replicator.set_job_system(&jobs);
+
+    std::vector<ClientID> clients;
+    std::unordered_map<ClientID, EntityNetID> controlled;
+    std::unordered_map<EntityNetID, glm::vec3> positions;
+    std::unordered_map<ClientID, const RecordedPacket*> recorded;
+
+    for (const auto& frame : frames) {
+        for (ClientID c : frame.connects) clients.push_back(c);
+        for (ClientID c : frame.disconnects) {
+            clients.erase(std::remove(clients.begin(), clients.end(), c), clients.end());
+            interest.remove_client(c);
+            inputs.remove_client(c);
+            replicator.remove_client(c);
+            controlled.erase(c);
+        }
+        for (const auto& [client, entity] : frame.spawns) controlled[client] = entity;
+        for (const auto& entry : frame.inputs) inputs.on_receive(entry.peer, entry.msg);
+
+        auto start = Clock::now();
+
+        for (const auto& s : frame.states) {
+            auto [it, added] = positions.try_emplace(s.id, s.position);
+            if (added) replicator.track_entity(s.id, s);
+            else       replicator.update_state(s.id, s);
+            it->second = s.position;
+            interest.update_entity(s.id, s.position);
+        }
+        for (const auto& [client, entity] : controlled) {
+            auto it = positions.find(entity);
+            if (it != positions.end()) interest.update_client(client, it->second);
+        }
+
+        // Apply inputs up to what the server acknowledged this tick; a
+        // client without a packet had no ack change
+        recorded.clear();
+        for (const auto& packet : frame.packets) {
+            recorded[packet.client] = &packet;
+            ClientInput in;
+            while (inputs.last_applied(packet.client) < packet.header.input_ack && inputs.pop(packet.client, in)) {}
+        }
+
+        replicator.set_server_tick(frame.tick);
+        const auto& packets = replicator.build_tick(clients);
+        result.tick_ms.push_back(ms_since(start));
+
+        for (const auto& packet : packets) {
+            if (packet.msg.payload.empty()) continue;
+            result.replayed_packets++;
+            result.replayed_bytes += packet.msg.payload.size();
+            auto it = recorded.find(packet.client);
+            if (it != recorded.end() && same_packet(*it->second, packet.msg)) result.matched++;
+        }
+        for (const auto& packet : frame.packets) {
+            result.recorded_packets++;
+            result.recorded_bytes += packet.size;
+        }
+    }
+}
+
+static double percentile(std::vector<double> v, double p) {
+    if (v.empty()) return 0.0;
+    std::sort(v.begin(), v.end());
+    size_t i = static_cast<size_t>(p * (v.size() - 1) + 0.5);
+    return v[i];
+}
+
+static bool parse_args(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--volumetric") { opt.planar = false; continue; }
+        if (arg.rfind("--", 0) != 0) { opt.log = arg; continue; }
+        if (i + 1 >= argc) { fprintf(stderr, "missing value for %s\n", arg.c_str()); return false; }
+        const char* value = argv[++i];
+        if      (arg == "--loops")   opt.loops   = static_cast<u32>(std::atoi(value));
+        else if (arg == "--threads") opt.threads = static_cast<u32>(std::atoi(value));
+        else if (arg == "--radius")  opt.radius  = static_cast<float>(std::atof(value));
+        else if (arg == "--cell")    opt.cell    = static_cast<float>(std::atof(value));
+        else if (arg == "--bounds")  opt.bounds  = static_cast<float>(std::atof(value));
+        else { fprintf(stderr, "unknown option %s\n", arg.c_str()); return false; }
+    }
+    return !opt.log.empty() && opt.loops > 0;
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parse_args(argc, argv, opt)) {
+        fprintf(stderr, "usage: lumios_netreplay <log> [--loops N] [--threads N] [--radius R] [--cell S]\n"
+                        "                        [--bounds HALF] [--volumetric]\n");
+        return 1;
+    }
+
+    std::vector<Frame> frames;
+    u64 record_count = 0;
+    auto load_start = Clock::now();
+    if (!load_frames(opt.log, frames, record_count)) return 1;
+    double load_ms = ms_since(load_start);
+
+    JobSystem jobs(opt.threads);
+    printf("lumios_netreplay: %s, %llu records, %zu ticks (parsed in %.1f ms), %u threads\n", opt.log.c_str(),
+           static_cast<unsigned long long>(record_count), frames.size(), load_ms, jobs.thread_count());
+
+    for (u32 loop = 0; loop < opt.loops; loop++) {
+        ReplayResult result;
+        auto start = Clock::now();
+        replay(frames, opt, jobs, result);
+        double total_ms = ms_since(start);
+
+        printf("\nloop %u: %.1f ms, %.0f ticks/s\n", loop + 1, total_ms, frames.size() / (total_ms / 1000.0));
+        printf("  tick   p50 %8.3f ms   p90 %8.3f ms   p99 %8.3f ms   max %8.3f ms\n",
+               percentile(result.tick_ms, 0.50), percentile(result.tick_ms, 0.90),
+               percentile(result.tick_ms, 0.99), percentile(result.tick_ms, 1.0));
+        printf("  packets recorded %llu (%llu B)   replayed %llu (%llu B)   matching %.3f%%\n",
+               static_cast<unsigned long long>(result.recorded_packets),
+               static_cast<unsigned long long>(result.recorded_bytes),
+               static_cast<unsigned long long>(result.replayed_packets),
+               static_cast<unsigned long long>(result.replayed_bytes),
+               result.recorded_packets ? 100.0 * result.matched / result.recorded_packets : 100.0);
+    }
+    return 0;
+}